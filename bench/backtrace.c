@@ -0,0 +1,79 @@
+/**
+ * times sylvan_backtrace through a deep stack, the first unwind reads the unwind info,
+ * the ones after it only read the stack
+ *
+ * usage: make bench && ./build/bench/backtrace
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sylvan/sylvan.h>
+
+#include "bench.h"
+
+#define DEPTH       500
+#define MAX_FRAMES  1024
+#define RUNS        1000
+
+/**
+ * recurses depth times and waits at the bottom, tells fd once it's there
+ */
+static int __attribute__((noinline))
+descend(int depth, int fd) {
+    if (depth == 0) {
+        char c = 0;
+        if (write(fd, &c, 1) != 1)
+            _exit(1);
+        for (;;)
+            pause();
+    }
+    return descend(depth - 1, fd) + 1;
+}
+
+/**
+ * runs in the target, which stays DEPTH frames down
+ */
+static void
+target(int fd, void *arg) {
+    (void)arg;
+    _exit(descend(DEPTH, fd));
+}
+
+int
+main(void) {
+    char ready;
+    pid_t pid = bench_spawn(target, NULL, &ready, sizeof(ready));
+    if (pid < 0) {
+        fprintf(stderr, "could not start target\n");
+        return EXIT_FAILURE;
+    }
+
+    struct sylvan_inferior *inf;
+    if (sylvan_inferior_create(&inf) || sylvan_attach(inf, pid)) {
+        fprintf(stderr, "%s\n", sylvan_get_last_error());
+        bench_kill(pid);
+        return EXIT_FAILURE;
+    }
+
+    static struct sylvan_frame frames[MAX_FRAMES];
+    size_t count = 0;
+
+    double start = bench_now_ms();
+    if (sylvan_backtrace(inf, frames, MAX_FRAMES, &count))
+        fprintf(stderr, "%s\n", sylvan_get_last_error());
+    double cold = bench_now_ms() - start;
+
+    start = bench_now_ms();
+    for (int i = 0; i < RUNS; i++)
+        sylvan_backtrace(inf, frames, MAX_FRAMES, &count);
+    double warm = (bench_now_ms() - start) / RUNS;
+
+    printf("%-10s %14s %14s %14s\n", "frames", "cold (ms)", "warm (ms)", "per frame (us)");
+    printf("%-10zu %14.3f %14.3f %14.3f\n", count, cold, warm, count ? warm * 1e3 / count : 0);
+
+    sylvan_inferior_destroy(inf);
+    bench_kill(pid);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+/**
+ * target and timing helpers the benchmarks share, linked into each of them
+ */
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "bench.h"
+
+double
+bench_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+pid_t
+bench_spawn(void (*child)(int fd, void *arg), void *arg, void *msg, size_t size) {
+    int fd[2];
+    if (pipe(fd) < 0)
+        return -1;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        close(fd[0]);
+        child(fd[1], arg);
+        _exit(1);
+    }
+
+    close(fd[1]);
+    ssize_t n = read(fd[0], msg, size);
+    close(fd[0]);
+    if (n < 0 || (size_t)n != size) {
+        bench_kill(pid);
+        return -1;
+    }
+    return pid;
+}
+
+/**
+ * sends the address of the mapping, 0 if it couldn't be made
+ */
+static void
+bench_mapping_child(int fd, void *arg) {
+    size_t size = *(size_t *)arg;
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    uintptr_t addr = mem == MAP_FAILED ? 0 : (uintptr_t)mem;
+    if (write(fd, &addr, sizeof(addr)) != sizeof(addr))
+        _exit(1);
+    close(fd);
+    for (;;)
+        pause();
+}
+
+pid_t
+bench_spawn_mapping(size_t size, uintptr_t *addrp) {
+    pid_t pid = bench_spawn(bench_mapping_child, &size, addrp, sizeof(*addrp));
+    if (pid > 0 && !*addrp) {
+        bench_kill(pid);
+        return -1;
+    }
+    return pid;
+}
+
+void
+bench_kill(pid_t pid) {
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+}
\ No newline at end of file
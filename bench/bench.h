@@ -0,0 +1,30 @@
+#ifndef SYLVAN_BENCH_H
+#define SYLVAN_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * monotonic time in milliseconds
+ */
+double bench_now_ms(void);
+
+/**
+ * forks a target that runs child with the write end of a pipe, child sends size bytes on it once the target
+ * is ready and doesn't return. the parent reads them into msg
+ * returns the target's pid, -1 if it couldn't be started or didn't send the whole message
+ */
+pid_t bench_spawn(void (*child)(int fd, void *arg), void *arg, void *msg, size_t size);
+
+/**
+ * forks a target with a size byte writable mapping that's faulted in up front, returns its address through addrp
+ */
+pid_t bench_spawn_mapping(size_t size, uintptr_t *addrp);
+
+/**
+ * kills the target and waits for it
+ */
+void bench_kill(pid_t pid);
+
+#endif /* SYLVAN_BENCH_H */
\ No newline at end of file
@@ -0,0 +1,75 @@
+/**
+ * compares word reads through sylvan_get_memory at a stop, where the pages read are cached,
+ * against one process_vm_readv per read
+ *
+ * usage: make bench && ./build/bench/memory_read
+ */
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+
+#include <sylvan/sylvan.h>
+
+#include "bench.h"
+
+#define PAGES 8
+#define READS 100000
+
+/**
+ * the address of the i-th read, words spread over every page
+ */
+static uintptr_t
+read_addr(uintptr_t base, unsigned i) {
+    return base + (i * 520UL) % (PAGES * 0x1000UL - 8);
+}
+
+int
+main(void) {
+    uintptr_t addr;
+    pid_t pid = bench_spawn_mapping(PAGES * 0x1000UL, &addr);
+    if (pid < 0) {
+        fprintf(stderr, "could not start target\n");
+        return EXIT_FAILURE;
+    }
+
+    struct sylvan_inferior *inf;
+    if (sylvan_inferior_create(&inf) || sylvan_attach(inf, pid)) {
+        fprintf(stderr, "%s\n", sylvan_get_last_error());
+        bench_kill(pid);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t sum = 0, word;
+
+    double start = bench_now_ms();
+    for (unsigned i = 0; i < READS; i++) {
+        struct iovec local = { .iov_base = &word, .iov_len = sizeof(word) };
+        struct iovec remote = { .iov_base = (void *)read_addr(addr, i), .iov_len = sizeof(word) };
+        if (process_vm_readv(pid, &local, 1, &remote, 1, 0) != sizeof(word)) {
+            perror("process_vm_readv");
+            break;
+        }
+        sum += word;
+    }
+    double direct = bench_now_ms() - start;
+
+    start = bench_now_ms();
+    for (unsigned i = 0; i < READS; i++) {
+        if (sylvan_get_memory(inf, read_addr(addr, i), &word)) {
+            fprintf(stderr, "%s\n", sylvan_get_last_error());
+            break;
+        }
+        sum += word;
+    }
+    double cached = bench_now_ms() - start;
+
+    printf("%u word reads over %d pages (checksum %lu)\n", READS, PAGES, (unsigned long)sum);
+    printf("%-24s %10.3f ms\n", "process_vm_readv each", direct);
+    printf("%-24s %10.3f ms %9.1fx\n", "sylvan_get_memory", cached, cached > 0 ? direct / cached : 0);
+
+    sylvan_inferior_destroy(inf);
+    bench_kill(pid);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+/**
+ * compares sylvan_write_memory against the old word-by-word PTRACE_POKEDATA loop
+ *
+ * usage: make bench && ./build/bench/memory_write
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+
+#include <sylvan/sylvan.h>
+
+#include "bench.h"
+
+#define MAX_SIZE (64UL << 20)
+
+static const size_t sizes[] = { 4UL << 10, 1UL << 20, 64UL << 20 };
+
+/**
+ * the write path sylvan_set_memory used before the bulk write path
+ */
+static int
+poke_loop(pid_t pid, uintptr_t addr, const uint8_t *bytes, size_t size) {
+    size_t offset = 0;
+    while (offset + 8 <= size) {
+        uint64_t chunk;
+        memcpy(&chunk, bytes + offset, 8);
+        if (ptrace(PTRACE_POKEDATA, pid, (void *)(addr + offset), (void *)chunk) < 0)
+            return -1;
+        offset += 8;
+    }
+    return 0;
+}
+
+int
+main(void) {
+    /* the mapping is faulted in up front, so neither write path pays for the first touch of its pages */
+    uintptr_t addr;
+    pid_t pid = bench_spawn_mapping(MAX_SIZE, &addr);
+    if (pid < 0) {
+        fprintf(stderr, "could not start target\n");
+        return EXIT_FAILURE;
+    }
+
+    struct sylvan_inferior *inf;
+    if (sylvan_inferior_create(&inf) || sylvan_attach(inf, pid)) {
+        fprintf(stderr, "%s\n", sylvan_get_last_error());
+        bench_kill(pid);
+        return EXIT_FAILURE;
+    }
+
+    uint8_t *buf = malloc(MAX_SIZE);
+    if (!buf) {
+        fprintf(stderr, "out of memory\n");
+        sylvan_inferior_destroy(inf);
+        bench_kill(pid);
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < MAX_SIZE; i++)
+        buf[i] = (uint8_t)i;
+
+    printf("%-10s %14s %14s %10s\n", "size", "poke (ms)", "bulk (ms)", "speedup");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t size = sizes[i];
+
+        double start = bench_now_ms();
+        if (poke_loop(pid, addr, buf, size) < 0)
+            perror("ptrace poke data");
+        double poke = bench_now_ms() - start;
+
+        start = bench_now_ms();
+        if (sylvan_write_memory(inf, addr, buf, size))
+            fprintf(stderr, "%s\n", sylvan_get_last_error());
+        double bulk = bench_now_ms() - start;
+
+        printf("%-10zu %14.3f %14.3f %9.1fx\n", size, poke, bulk, bulk > 0 ? poke / bulk : 0);
+    }
+
+    free(buf);
+    sylvan_inferior_destroy(inf);
+    bench_kill(pid);
+    return EXIT_SUCCESS;
+}
@@ -1,26 +1,75 @@
 #ifndef SYLVAN_INCLUDE_BREAKPOINT_H
 #define SYLVAN_INCLUDE_BREAKPOINT_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <sylvan/error.h>
 #include <stdbool.h>
+#include <uthash.h>
 
-#define MAX_BREAKPOINTS 256
+#define SYLVAN_HW_BREAKPOINTS 4     /* DR0 - DR3 */
+
+typedef enum {
+    SYLVAN_BREAKPOINT_SOFTWARE,     /* 0xCC patched into the text */
+    SYLVAN_BREAKPOINT_HARDWARE,     /* debug register, execute */
+    SYLVAN_BREAKPOINT_WATCH,        /* debug register, data access */
+} sylvan_breakpoint_type_t;
+
+typedef enum {
+    SYLVAN_WATCH_WRITE      = 1,    /* DR7 R/W bits 01 */
+    SYLVAN_WATCH_READWRITE  = 3,    /* DR7 R/W bits 11 */
+} sylvan_watch_t;
 
 struct sylvan_breakpoint {
-    uintptr_t addr;
-    uint8_t og_byte;
+    int id;                 /* stable id, never reused within an inferior */
+    uintptr_t addr;         /* hash key */
+    sylvan_breakpoint_type_t type;
+    uint8_t og_byte;        /* software only */
+    int hw_slot;            /* debug register index, hardware and watch only */
+    size_t watch_len;       /* 1, 2, 4 or 8, watch only */
+    sylvan_watch_t watch_kind;
+    uint8_t dstep_insn[16]; /* original instruction relocated to the scratch slot, software only */
+    uint8_t dstep_len;
+    uint8_t dstep_flags;
+    char *symbol;           /* function it was set on, looked up again in every new process */
+    char *condition;        /* source of the condition, NULL if unconditional */
+    struct sylvan_expr *condition_expr;
+    unsigned long hit_count;
+    unsigned long ignore_count; /* hits left to continue through without stopping */
+    uint64_t last_hit_ns;   /* CLOCK_MONOTONIC time of the last hit */
+    uint64_t interval_min_ns;
+    uint64_t interval_sum_ns;
+    uint32_t *interval_hist; /* log-linear histogram of the time between hits, NULL before the second hit */
     bool is_enabled_log;
     bool is_enabled_phy;
+    bool is_internal;       /* set by the library for its own use, id is -1 and it isn't counted */
+    bool is_pending;        /* symbol isn't resolved in this process yet, addr is a placeholder and nothing is inserted */
+    UT_hash_handle hh;
+};
+
+struct sylvan_breakpoint_stats {
+    unsigned long hit_count;
+    unsigned long interval_count;   /* min, avg and p99 are 0 until there are two hits */
+    uint64_t min_ns;
+    uint64_t avg_ns;
+    uint64_t p99_ns;
 };
 
 struct sylvan_inferior;
+struct sylvan_expr;
 
 sylvan_code_t sylvan_breakpoint_enable(struct sylvan_inferior *inf, uintptr_t addr);
 sylvan_code_t sylvan_breakpoint_disable(struct sylvan_inferior *inf, uintptr_t addr);
 
 sylvan_code_t sylvan_breakpoint_set(struct sylvan_inferior *inf, uintptr_t addr);
+sylvan_code_t sylvan_breakpoint_set_hw(struct sylvan_inferior *inf, uintptr_t addr);
+sylvan_code_t sylvan_breakpoint_set_symbol(struct sylvan_inferior *inf, const char *symbol, bool hw, uintptr_t *addrp);
+sylvan_code_t sylvan_watchpoint_set(struct sylvan_inferior *inf, uintptr_t addr, size_t len, sylvan_watch_t kind);
 sylvan_code_t sylvan_breakpoint_unset(struct sylvan_inferior *inf, uintptr_t addr);
+sylvan_code_t sylvan_breakpoint_set_condition(struct sylvan_inferior *inf, uintptr_t addr, const char *condition);
+sylvan_code_t sylvan_breakpoint_set_ignore(struct sylvan_inferior *inf, uintptr_t addr, unsigned long count);
+sylvan_code_t sylvan_breakpoint_get_stats(const struct sylvan_breakpoint *breakpoint, struct sylvan_breakpoint_stats *stats);
 
+sylvan_code_t sylvan_breakpoint_get_by_id(struct sylvan_inferior *inf, int id, struct sylvan_breakpoint **breakpointp);
 
 #endif /* SYLVAN_INCLUDE_BREAKPOINT_H */
@@ -46,6 +46,8 @@ typedef enum sylvan_code_t {
     SYLVANC_PTRACE_POKETEXT_FAILED         ,    /* could not write to memory */
     SYLVANC_PTRACE_PEEKDATA_FAILED         ,    /* could not read from memory */
     SYLVANC_PTRACE_POKEDATA_FAILED         ,    /* could not write to memory */
+    SYLVANC_PTRACE_PEEKUSER_FAILED         ,    /* could not read from the user area */
+    SYLVANC_PTRACE_POKEUSER_FAILED         ,    /* could not write to the user area */
 
     /* breakpoint errors */
     SYVLANC_BREAKPOINT_ERROR        = 0x500,
@@ -60,6 +62,16 @@ typedef enum sylvan_code_t {
     SYLVANC_DWARF_NOT_FOUND                ,    /* not dwarf info */
     SYLVANC_SYMBOL_NOT_FOUND               ,    /* symbol not found */
 
+    /* expression errors */
+    SYLVANC_EXPR_ERROR              = 0x700,
+    SYLVANC_EXPR_SYNTAX                    ,    /* expression doesn't parse */
+    SYLVANC_EXPR_DIVISION_BY_ZERO          ,    /* division by zero while evaluating */
+
+    /* system call tracing codes */
+    SYLVANC_SYSCALL_ERROR           = 0x800,
+    SYLVANC_SYSCALL_ENTRY                  ,    /* program stopped entering a traced system call */
+    SYLVANC_SYSCALL_FILTER_FAILED          ,    /* could not install the seccomp filter */
+
 } sylvan_code_t;
 
 struct sylvan_error_context {
@@ -0,0 +1,21 @@
+#ifndef SYLVAN_INCLUDE_EVENT_H
+#define SYLVAN_INCLUDE_EVENT_H
+
+#include <sylvan/error.h>
+
+struct sylvan_inferior;
+
+/**
+ * a file descriptor that becomes readable when a process may have an event
+ * after it does, call sylvan_event_poll with a 0 timeout until it reports nothing
+ */
+sylvan_code_t sylvan_event_fd(int *fd);
+
+/**
+ * waits up to timeout_ms (-1 forever, 0 not at all) for an event of any inferior and handles it
+ * sets *infp to the inferior that stopped or exited and returns what sylvan_continue would have returned
+ * for it, *infp is NULL if nothing happened
+ */
+sylvan_code_t sylvan_event_poll(int timeout_ms, struct sylvan_inferior **infp);
+
+#endif /* SYLVAN_INCLUDE_EVENT_H */
\ No newline at end of file
@@ -2,7 +2,11 @@
 #define SYLVAN_INCLUDE_SYLVAN_INFERIOR_H
 
 #include <sylvan/breakpoint.h>
+#include <sylvan/line.h>
 #include <sylvan/symbol.h>
+#include <sylvan/syscall.h>
+#include <sylvan/thread.h>
+#include <sylvan/unwind.h>
 #include <sylvan/error.h>
 #include <stdbool.h>
 #include <sys/types.h>
@@ -16,42 +20,97 @@ typedef enum {
     SYLVAN_INFSTATE_STOPPED,
 } sylvan_inferior_state_t;
 
+typedef enum {
+    SYLVAN_FOLLOW_FORK_PARENT,      /* the child is let go without breakpoints */
+    SYLVAN_FOLLOW_FORK_CHILD,       /* the inferior moves to the child, the parent is let go */
+    SYLVAN_FOLLOW_FORK_BOTH,        /* the child becomes a new inferior with a copy of the breakpoints */
+} sylvan_follow_fork_t;
+
+struct sylvan_memcache;
 
 
 struct sylvan_inferior {
     int id;
+    struct sylvan_inferior *next;           /* see sylvan_inferior_list */
     pid_t pid;
     sylvan_inferior_state_t status;
     char *realpath;
     char *args;
     bool is_attached;
 
-    struct sylvan_breakpoint breakpoints[MAX_BREAKPOINTS];
+    struct sylvan_thread *threads;          /* uthash table keyed by tid */
+    struct sylvan_thread *thread;           /* current thread, the last one to report a stop or the selected one */
+    bool interrupting;                      /* sylvan_interrupt asked for a stop that hasn't been reported yet */
+    bool non_stop;                          /* a stop halts only the thread it happened in, see sylvan_set_non_stop */
+    sylvan_follow_fork_t follow_fork;       /* which process is debugged after a fork, see sylvan_set_follow_fork */
+
+    struct sylvan_breakpoint *breakpoints;  /* uthash table keyed by addr, iterates in id order */
     int breakpoint_count;
+    int breakpoint_idx;                     /* next breakpoint id */
+    struct sylvan_breakpoint *hw_breakpoints[SYLVAN_HW_BREAKPOINTS]; /* debug register slot owners */
+    uint64_t stop_ns;                       /* CLOCK_MONOTONIC time of the current stop */
+
+    struct sylvan_breakpoint *run_to_breakpoint; /* internal breakpoint a run to a location stops at, see sylvan_advance */
+    pid_t run_to_tid;                       /* the thread that has to reach it */
+    uintptr_t run_to_sp;                    /* lowest rsp it stops with, frames called from there are below it */
+    bool run_to_by_cfa;                     /* run_to_sp is a frame's CFA, compared with the CFA of the frame it's reached in */
 
+    uintptr_t dstep_scratch;                /* page in the process used for displaced stepping */
+    int dstep_owner;                        /* id of the breakpoint whose instruction is in the scratch slot */
+
+    struct sylvan_sym_strings sym_strings;
     struct sylvan_sym_table elf_table;
-    struct sylvan_sym_table dwarf_table;
+    struct sylvan_sym_table dwarf_table;   /* filled from dwarf_index on the first lookup */
+    struct sylvan_dwarf_index *dwarf_index; /* compile units not parsed yet */
+    struct sylvan_line_index *line_index;   /* the executable's line table, opened on the first lookup */
+    uintptr_t load_bias;                    /* where a PIE executable was loaded, 0 if it isn't one */
+    struct sylvan_unwind *unwind;           /* unwind rules of the objects a backtrace went through */
+    struct sylvan_memcache *memcache;       /* pages read at the current stop, see sylvan_read_memory */
+
+    struct sylvan_solib *solibs;            /* shared objects of the process */
+    uintptr_t r_debug;                      /* the dynamic linker's _r_debug, 0 until it's set up */
+    struct sylvan_breakpoint *solib_breakpoint; /* internal breakpoint on _dl_debug_state */
+
+    uint64_t syscalls_traced[SYLVAN_SYSCALL_WORDS];   /* bitmap of the system calls reported, see sylvan_set_syscall_trace */
+    uint64_t syscalls_filtered[SYLVAN_SYSCALL_WORDS]; /* bitmap of those the filters in the process stop on */
 };
 
 sylvan_code_t sylvan_inferior_create(struct sylvan_inferior **inf);
 sylvan_code_t sylvan_inferior_destroy(struct sylvan_inferior *inf);
+struct sylvan_inferior *sylvan_inferior_list(void);
+sylvan_code_t sylvan_inferior_find(int id, struct sylvan_inferior **infp);
 
 sylvan_code_t sylvan_attach(struct sylvan_inferior *inf, pid_t pid);
 sylvan_code_t sylvan_detach(struct sylvan_inferior *inf);
 
 sylvan_code_t sylvan_run(struct sylvan_inferior *inf);
 sylvan_code_t sylvan_continue(struct sylvan_inferior *inf);
+sylvan_code_t sylvan_continue_background(struct sylvan_inferior *inf);
+sylvan_code_t sylvan_interrupt(struct sylvan_inferior *inf);
 sylvan_code_t sylvan_stepinst(struct sylvan_inferior *inf);
+sylvan_code_t sylvan_stepinst_count(struct sylvan_inferior *inf, unsigned long count, unsigned long *done);
+sylvan_code_t sylvan_advance(struct sylvan_inferior *inf, uintptr_t addr);
+sylvan_code_t sylvan_until(struct sylvan_inferior *inf, uintptr_t addr);
+sylvan_code_t sylvan_nexti(struct sylvan_inferior *inf);
+sylvan_code_t sylvan_finish(struct sylvan_inferior *inf, uintptr_t *ret_addr);
+sylvan_code_t sylvan_stepline(struct sylvan_inferior *inf);
+sylvan_code_t sylvan_nextline(struct sylvan_inferior *inf);
 
 sylvan_code_t sylvan_get_regs(struct sylvan_inferior *inf, struct user_regs_struct *regs);
 sylvan_code_t sylvan_set_regs(struct sylvan_inferior *inf, const struct user_regs_struct *regs);
 
 sylvan_code_t sylvan_set_filepath(struct sylvan_inferior *inf, const char *filepath);
 sylvan_code_t sylvan_set_args(struct sylvan_inferior *inf, const char *args);
+sylvan_code_t sylvan_set_non_stop(struct sylvan_inferior *inf, bool non_stop);
+sylvan_code_t sylvan_set_follow_fork(struct sylvan_inferior *inf, sylvan_follow_fork_t mode);
 
+sylvan_code_t sylvan_read_memory(struct sylvan_inferior *inf, uintptr_t addr, void *buf, size_t len);
 sylvan_code_t sylvan_get_memory(struct sylvan_inferior *inf, uintptr_t addr, uint64_t *data);
+sylvan_code_t sylvan_write_memory(struct sylvan_inferior *inf, uintptr_t addr, const void *buf, size_t len);
 sylvan_code_t sylvan_set_memory(struct sylvan_inferior *inf, uintptr_t addr, const void *data, size_t size);
 
+sylvan_code_t sylvan_sym_lookup_addr(struct sylvan_inferior *inf, uintptr_t addr, const char **name, uintptr_t *offset);
+sylvan_code_t sylvan_get_function_addr(struct sylvan_inferior *inf, const char *function, uintptr_t *addr);
 sylvan_code_t sylvan_set_breakpoint_function(struct sylvan_inferior *inf, const char *function);
 
 #endif /* SYLVAN_INCLUDE_SYLVAN_INFERIOR_H */
@@ -0,0 +1,32 @@
+#ifndef SYLVAN_INCLUDE_LINE_H
+#define SYLVAN_INCLUDE_LINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sylvan/error.h>
+
+struct sylvan_inferior;
+struct sylvan_line_index;
+
+/* the source line an address belongs to */
+struct sylvan_line_info {
+    const char *file;           /* path from the line table, owned by the index */
+    unsigned int line;
+    uintptr_t start;            /* addresses of the line's block around the address, in the process */
+    uintptr_t end;
+    bool is_statement;          /* the address is where a statement of the line begins */
+};
+
+/**
+ * finds the source line of addr in the executable's line table
+ * only the compile unit covering addr is read, the first time one of its addresses is looked up
+ */
+sylvan_code_t sylvan_line_lookup_addr(struct sylvan_inferior *inf, uintptr_t addr, struct sylvan_line_info *info);
+
+/**
+ * finds the lowest address of line in file, or of the next line that has code if line has none
+ * file may be a path or its last components, like main.c or src/main.c
+ */
+sylvan_code_t sylvan_line_find(struct sylvan_inferior *inf, const char *file, unsigned int line, uintptr_t *addr);
+
+#endif /* SYLVAN_INCLUDE_LINE_H */
\ No newline at end of file
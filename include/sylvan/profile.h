@@ -0,0 +1,42 @@
+#ifndef SYLVAN_INCLUDE_PROFILE_H
+#define SYLVAN_INCLUDE_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sylvan/error.h>
+
+struct sylvan_inferior;
+struct sylvan_profile_stack;
+
+#define SYLVAN_PROFILE_MAX_HZ       10000
+#define SYLVAN_PROFILE_MAX_SECONDS  86400   /* a day, keeps the end time well inside a uint64_t of nanoseconds */
+#define SYLVAN_PROFILE_MAX_FRAMES   128     /* a deeper stack is cut off at its outer end */
+
+/* the stacks sylvan_profile sampled and what sampling them cost */
+struct sylvan_profile {
+    struct sylvan_profile_stack *stacks;    /* uthash table keyed by the pcs of a stack */
+    size_t samples;                         /* times the process was stopped */
+    size_t thread_samples;                  /* stacks taken, one per thread and sample */
+    uint64_t stop_ns;                       /* the process was stopped this long for all samples together, up to the resume */
+    uint64_t max_stop_ns;                   /* longest of those stops */
+    uint64_t elapsed_ns;                    /* from the first resume to the end */
+};
+
+/**
+ * runs the stopped process for seconds and interrupts it hz times a second, the stacks of all its threads
+ * are unwound and counted before it's resumed. a stop the user has to see, like a breakpoint hit, ends it early
+ * and is returned like sylvan_continue would return it. *profilep has the samples taken up to then even
+ * if an error is returned, free it with sylvan_profile_free
+ */
+sylvan_code_t sylvan_profile(struct sylvan_inferior *inf, double seconds, unsigned int hz, struct sylvan_profile **profilep);
+
+/**
+ * writes the stacks in the folded format flame graph tools read, a line of function names
+ * from the outermost frame in, separated by ';', and the number of samples
+ */
+sylvan_code_t sylvan_profile_write_folded(struct sylvan_inferior *inf, const struct sylvan_profile *profile, FILE *file);
+
+void sylvan_profile_free(struct sylvan_profile *profile);
+
+#endif /* SYLVAN_INCLUDE_PROFILE_H */
\ No newline at end of file
@@ -6,7 +6,12 @@
 #endif /* __cplusplus */
 
 #include <sylvan/error.h>
+#include <sylvan/event.h>
 #include <sylvan/inferior.h>
+#include <sylvan/line.h>
+#include <sylvan/profile.h>
+#include <sylvan/syscall.h>
+#include <sylvan/unwind.h>
 
 #ifdef __cplusplus
     } /* extern "C" */
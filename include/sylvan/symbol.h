@@ -1,18 +1,45 @@
 #ifndef SYLVAN_INCLUDE_SYLMBOL_H
 #define SYLVAN_INCLUDE_SYLMBOL_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
 struct symbol {
-    char *name;
+    const char *name;           /* interned in sylvan_sym_strings */
     uintptr_t addr;
+    size_t size;                /* 0 if unknown */
+};
+
+struct sylvan_arena_block;
+struct sylvan_dwarf_index;
+
+/* symbol names of an inferior, bump allocated and interned so elf and dwarf tables share them */
+struct sylvan_sym_strings {
+    struct sylvan_arena_block *blocks;
+    const char **slots;         /* open addressing set of the interned names */
+    size_t slot_count;          /* power of two */
+    size_t used;
+    void *map;                  /* symbol cache file the loaded names point into */
+    size_t map_size;
 };
 
 struct sylvan_sym_table {
-    struct symbol *symbols;
+    struct symbol *symbols;     /* sorted by name */
     size_t count;
     size_t capacity;
+    struct symbol **by_addr;    /* the same symbols sorted by address */
+    uintptr_t text_end;         /* end of the object's last executable section, bounds the symbols of unknown size */
+};
+
+/* shared object loaded in the process, found through the dynamic linker's link_map list */
+struct sylvan_solib {
+    char *path;
+    uintptr_t base;             /* l_addr, already added to the symbol addresses */
+    bool seen;                  /* still in link_map, cleared while it's walked */
+    struct sylvan_sym_strings strings;
+    struct sylvan_sym_table table;
+    struct sylvan_solib *next;  /* link_map order */
 };
 
 #endif /* SYLVAN_INCLUDE_SYLMBOL_H */
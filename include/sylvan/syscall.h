@@ -0,0 +1,29 @@
+#ifndef SYLVAN_INCLUDE_SYSCALL_H
+#define SYLVAN_INCLUDE_SYSCALL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sylvan/error.h>
+
+#define SYLVAN_SYSCALL_MAX 512          /* system call numbers that can be traced are below this */
+#define SYLVAN_SYSCALL_TRACE_MAX 128    /* at most this many at once, each is a jump in the filter */
+#define SYLVAN_SYSCALL_WORDS (SYLVAN_SYSCALL_MAX / 64)
+
+struct sylvan_inferior;
+
+/**
+ * stops the process when it enters one of the count system calls in nrs, the stop is reported with
+ * SYLVANC_SYSCALL_ENTRY and the system call runs once the process is continued. count 0 stops tracing.
+ * the process traps them with a seccomp filter, the other system calls don't stop it at all.
+ * a filter is installed when the program is run or, if it's stopped, right away. a filter can't be taken
+ * out again, system calls that aren't traced anymore stop it for a moment and it goes on
+ */
+sylvan_code_t sylvan_set_syscall_trace(struct sylvan_inferior *inf, const int *nrs, size_t count);
+
+/**
+ * true if the system call nr is traced in inf
+ */
+bool sylvan_syscall_is_traced(struct sylvan_inferior *inf, long nr);
+
+#endif /* SYLVAN_INCLUDE_SYSCALL_H */
\ No newline at end of file
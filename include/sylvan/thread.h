@@ -0,0 +1,36 @@
+#ifndef SYLVAN_INCLUDE_THREAD_H
+#define SYLVAN_INCLUDE_THREAD_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/user.h>
+#include <sylvan/error.h>
+#include <uthash.h>
+
+struct sylvan_inferior;
+struct sylvan_breakpoint;
+
+struct sylvan_thread {
+    pid_t tid;                              /* hash key */
+    bool is_stopped;                        /* in a ptrace stop, its registers can be read */
+    bool has_pending;                       /* stopped for a reason of its own while the others were being stopped */
+    int pending_status;                     /* wait status of that stop, reported before anything is resumed */
+    bool paused;                            /* stopped only for a moment by sylvan_thread_pause_all */
+    int pending_signal;                     /* held back from a step, delivered by the next PTRACE_CONT or detach */
+
+    struct user_regs_struct regs;           /* register cache, only valid for the current stop */
+    bool regs_valid;
+    bool regs_dirty;                        /* regs has to be written back before resuming */
+
+    struct sylvan_breakpoint *stop_breakpoint; /* breakpoint that caused the current stop */
+
+    UT_hash_handle hh;                      /* inf->threads */
+};
+
+/**
+ * makes the thread with the given tid the current one, registers and stepping apply to it
+ * in non-stop mode the thread has to be stopped, the others may be running
+ */
+sylvan_code_t sylvan_thread_select(struct sylvan_inferior *inf, pid_t tid);
+
+#endif /* SYLVAN_INCLUDE_THREAD_H */
\ No newline at end of file
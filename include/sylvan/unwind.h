@@ -0,0 +1,25 @@
+#ifndef SYLVAN_INCLUDE_UNWIND_H
+#define SYLVAN_INCLUDE_UNWIND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sylvan/error.h>
+
+struct sylvan_inferior;
+struct sylvan_unwind;
+
+/* a frame of a backtrace */
+struct sylvan_frame {
+    uintptr_t pc;               /* where it's executing, a return address for all but the innermost frame */
+    uintptr_t cfa;              /* rsp in the caller before the call, 0 if the frame couldn't be unwound */
+};
+
+/**
+ * unwinds the current thread's stack into frames, innermost first, at most max of them
+ * uses the .eh_frame or .debug_frame of the object a pc is in and follows the frame pointer
+ * where there's none. the unwind rules are kept, unwinding through the same code again reads nothing
+ * but the stack
+ */
+sylvan_code_t sylvan_backtrace(struct sylvan_inferior *inf, struct sylvan_frame *frames, size_t max, size_t *count);
+
+#endif /* SYLVAN_INCLUDE_UNWIND_H */
\ No newline at end of file
@@ -1,13 +1,36 @@
 #include <assert.h>
+#include <errno.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/ptrace.h>
+#include <sys/user.h>
 
 #include <sylvan/breakpoint.h>
+#include <sylvan/inferior.h>
 #include "sylvan.h"
+#include "displaced.h"
 #include "error.h"
+#include "expr.h"
+#include "symbol.h"
+#include "thread.h"
 
 #define isactive(inf) (inf->status == SYLVAN_INFSTATE_RUNNING || inf->status == SYLVAN_INFSTATE_STOPPED)
 
+#define DEBUGREG_OFFSET(i) (offsetof(struct user, u_debugreg) + (i) * sizeof(((struct user *)0)->u_debugreg[0]))
+#define DR7_ENABLE(slot) (1UL << ((slot) * 2))
+#define DR7_RW_SHIFT(slot) (16 + (slot) * 4)
+#define DR7_LEN_SHIFT(slot) (18 + (slot) * 4)
+#define DR7_SLOT_MASK(slot) (DR7_ENABLE(slot) | (0xFUL << DR7_RW_SHIFT(slot)))
+
+/* interval histogram: 8 linear sub-buckets per power of two, about 12% relative error */
+#define HIST_SUB_BITS 3
+#define HIST_SUB (1U << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+/* key of a breakpoint whose symbol isn't loaded, in the kernel half so it can't clash with a real one */
+#define PENDING_ADDR(id) (UINTPTR_MAX - (uintptr_t)(id))
+
 /**
  * finds the breakpoint which corresponds to addr, sets breakpointp if breakpointp is not NULL
  * return SYLVANC_OK if found else SYVLANC_BREAKPOINT_NOT_FOUND
@@ -17,23 +40,40 @@ sylvan_breakpoint_find_by_addr(struct sylvan_inferior *inf, uintptr_t addr, stru
 
     assert(inf); // should have been checked by the caller
 
-    int breakpoint_count = inf->breakpoint_count;
-    struct sylvan_breakpoint *breakpoints = inf->breakpoints;
-    for (int i = 0; i < breakpoint_count; ++i)
-        if (breakpoints[i].addr == addr) {
+    struct sylvan_breakpoint *breakpoint;
+    HASH_FIND(hh, inf->breakpoints, &addr, sizeof(uintptr_t), breakpoint);
+    if (!breakpoint)
+        return SYVLANC_BREAKPOINT_NOT_FOUND;
+
+    if (breakpointp)
+        *breakpointp = breakpoint;
+    return SYLVANC_OK;
+}
+
+/**
+ * finds the breakpoint with the given id, sets breakpointp if breakpointp is not NULL
+ * ids are only used by the ui, so a walk over the table is fine here
+ */
+sylvan_code_t sylvan_breakpoint_get_by_id(struct sylvan_inferior *inf, int id, struct sylvan_breakpoint **breakpointp) {
+    if (!inf)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp)
+        if (breakpoint->id == id && !breakpoint->is_internal) {
             if (breakpointp)
-                *breakpointp = breakpoints + i;
+                *breakpointp = breakpoint;
             return SYLVANC_OK;
         }
 
-    return SYVLANC_BREAKPOINT_NOT_FOUND;
+    return sylvan_set_message(SYVLANC_BREAKPOINT_NOT_FOUND, "No breakpoint with id %d", id);
 }
 
 /**
  * creates a physical breakpoint (replaces the byte at breakpoint addr with 0xCC in the actual process)
  */
-SYLVAN_INTERNAL sylvan_code_t
-sylvan_breakpoint_create_phybp(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
+static sylvan_code_t
+sylvan_breakpoint_create_swbp(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
 
     assert(inf && breakpoint && isactive(inf)); // should have been checked by the caller
 
@@ -57,8 +97,8 @@ sylvan_breakpoint_create_phybp(struct sylvan_inferior *inf, struct sylvan_breakp
 /**
  * removes the physical breakpoint (replaces 0xCC with the original byte at the breakpoint addr in the actual process)
  */
-SYLVAN_INTERNAL sylvan_code_t
-sylvan_breakpoint_remove_phybp(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
+static sylvan_code_t
+sylvan_breakpoint_remove_swbp(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
 
     assert(inf && breakpoint && isactive(inf)); // should have been checked by the caller
 
@@ -79,6 +119,202 @@ sylvan_breakpoint_remove_phybp(struct sylvan_inferior *inf, struct sylvan_breakp
     return SYLVANC_OK;
 }
 
+/**
+ * encodes a watch length into the DR7 LEN bits
+ */
+static unsigned long
+sylvan_breakpoint_dr7_len(size_t len) {
+    switch (len) {
+        case 2:     return 0x1;
+        case 4:     return 0x3;
+        case 8:     return 0x2;
+        default:    return 0x0;
+    }
+}
+
+/**
+ * DR7 with every slot whose breakpoint is inserted enabled
+ */
+static unsigned long
+sylvan_breakpoint_dr7(struct sylvan_inferior *inf) {
+    unsigned long dr7 = 0;
+    for (int slot = 0; slot < SYLVAN_HW_BREAKPOINTS; slot++) {
+        struct sylvan_breakpoint *breakpoint = inf->hw_breakpoints[slot];
+        if (!breakpoint || !breakpoint->is_enabled_phy)
+            continue;
+
+        unsigned long rw = breakpoint->type == SYLVAN_BREAKPOINT_WATCH ? (unsigned long)breakpoint->watch_kind : 0;
+        unsigned long len = breakpoint->type == SYLVAN_BREAKPOINT_WATCH ? sylvan_breakpoint_dr7_len(breakpoint->watch_len) : 0;
+        dr7 |= DR7_ENABLE(slot) | (rw << DR7_RW_SHIFT(slot)) | (len << DR7_LEN_SHIFT(slot));
+    }
+    return dr7;
+}
+
+/**
+ * writes the address of slot (or none if slot is negative) and DR7 to a thread
+ * a thread that exited and wasn't collected yet is skipped
+ */
+static sylvan_code_t
+sylvan_breakpoint_write_dr(struct sylvan_thread *thread, int slot, uintptr_t addr, unsigned long dr7) {
+    if (slot >= 0 && ptrace(PTRACE_POKEUSER, thread->tid, (void *)DEBUGREG_OFFSET(slot), (void *)addr) < 0)
+        return errno == ESRCH ? SYLVANC_OK : sylvan_set_errno_msg(SYLVANC_PTRACE_POKEUSER_FAILED, "ptrace poke user");
+
+    if (ptrace(PTRACE_POKEUSER, thread->tid, (void *)DEBUGREG_OFFSET(7), (void *)dr7) < 0)
+        return errno == ESRCH ? SYLVANC_OK : sylvan_set_errno_msg(SYLVANC_PTRACE_POKEUSER_FAILED, "ptrace poke user");
+
+    return SYLVANC_OK;
+}
+
+/**
+ * programs the breakpoint's debug register slot and enables it in DR7
+ * debug registers belong to a thread, every stopped thread gets them
+ */
+static sylvan_code_t
+sylvan_breakpoint_create_hwbp(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
+
+    assert(inf && breakpoint && isactive(inf)); // should have been checked by the caller
+
+    if (breakpoint->is_enabled_phy)
+        return SYLVANC_OK;
+
+    breakpoint->is_enabled_phy = true;
+    unsigned long dr7 = sylvan_breakpoint_dr7(inf);
+
+    sylvan_code_t code;
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp)
+        if (thread->is_stopped && (code = sylvan_breakpoint_write_dr(thread, breakpoint->hw_slot, breakpoint->addr, dr7))) {
+            breakpoint->is_enabled_phy = false;
+            return code;
+        }
+
+    return SYLVANC_OK;
+}
+
+/**
+ * clears the breakpoint's debug register slot in DR7 of every stopped thread
+ */
+static sylvan_code_t
+sylvan_breakpoint_remove_hwbp(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
+
+    assert(inf && breakpoint && isactive(inf)); // should have been checked by the caller
+
+    if (!breakpoint->is_enabled_phy)
+        return SYLVANC_OK;
+
+    breakpoint->is_enabled_phy = false;
+    unsigned long dr7 = sylvan_breakpoint_dr7(inf);
+
+    sylvan_code_t code;
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp)
+        if (thread->is_stopped && (code = sylvan_breakpoint_write_dr(thread, -1, 0, dr7))) {
+            breakpoint->is_enabled_phy = true;
+            return code;
+        }
+
+    return SYLVANC_OK;
+}
+
+/**
+ * loads every inserted hardware breakpoint into a new thread, which starts with its debug registers clear
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_load_hwbp(struct sylvan_inferior *inf, struct sylvan_thread *thread) {
+
+    assert(inf && thread); // should have been checked by the caller
+
+    unsigned long dr7 = sylvan_breakpoint_dr7(inf);
+    if (!dr7)
+        return SYLVANC_OK;
+
+    sylvan_code_t code;
+    for (int slot = 0; slot < SYLVAN_HW_BREAKPOINTS; slot++) {
+        struct sylvan_breakpoint *breakpoint = inf->hw_breakpoints[slot];
+        if (breakpoint && breakpoint->is_enabled_phy &&
+            (code = sylvan_breakpoint_write_dr(thread, slot, breakpoint->addr, 0)))
+            return code;
+    }
+
+    return sylvan_breakpoint_write_dr(thread, -1, 0, dr7);
+}
+
+/**
+ * resumes the threads a pause stopped, code is the result of what was done meanwhile and wins over a resume error
+ */
+static sylvan_code_t
+sylvan_breakpoint_unpause(struct sylvan_inferior *inf, bool paused, sylvan_code_t code) {
+    if (!paused)
+        return code;
+
+    sylvan_code_t resume_code = sylvan_thread_resume_paused(inf);
+    return code ? code : resume_code;
+}
+
+/**
+ * an int3 can be inserted under running threads, everything else pauses them: debug registers are only
+ * written to stopped threads, and a thread may have hit an int3 being removed without being collected yet
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_create_phybp(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
+    if (breakpoint->is_pending)
+        return SYLVANC_OK;
+    if (breakpoint->type == SYLVAN_BREAKPOINT_SOFTWARE)
+        return sylvan_breakpoint_create_swbp(inf, breakpoint);
+
+    sylvan_code_t code;
+    bool paused;
+    if ((code = sylvan_thread_pause_all(inf, &paused)))
+        return code;
+
+    code = sylvan_breakpoint_create_hwbp(inf, breakpoint);
+
+    return sylvan_breakpoint_unpause(inf, paused, code);
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_remove_phybp(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
+    sylvan_code_t code;
+    bool paused;
+    if ((code = sylvan_thread_pause_all(inf, &paused)))
+        return code;
+
+    if (breakpoint->type == SYLVAN_BREAKPOINT_SOFTWARE)
+        code = sylvan_breakpoint_remove_swbp(inf, breakpoint);
+    else
+        code = sylvan_breakpoint_remove_hwbp(inf, breakpoint);
+
+    return sylvan_breakpoint_unpause(inf, paused, code);
+}
+
+/**
+ * finds the breakpoint owning the debug register slot that fired, according to DR6 of the current thread
+ * DR6 is cleared so the next hit reports only its own slot
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_find_by_dr6(struct sylvan_inferior *inf, struct sylvan_breakpoint **breakpointp) {
+
+    assert(inf && inf->thread && breakpointp && isactive(inf)); // should have been checked by the caller
+
+    pid_t tid = inf->thread->tid;
+
+    errno = 0;
+    unsigned long dr6 = ptrace(PTRACE_PEEKUSER, tid, (void *)DEBUGREG_OFFSET(6), NULL);
+    if (errno)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_PEEKUSER_FAILED, "ptrace peek user");
+
+    if (ptrace(PTRACE_POKEUSER, tid, (void *)DEBUGREG_OFFSET(6), NULL) < 0)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_POKEUSER_FAILED, "ptrace poke user");
+
+    for (int i = 0; i < SYLVAN_HW_BREAKPOINTS; ++i)
+        if ((dr6 & (1UL << i)) && inf->hw_breakpoints[i]) {
+            *breakpointp = inf->hw_breakpoints[i];
+            return SYLVANC_OK;
+        }
+
+    return SYVLANC_BREAKPOINT_NOT_FOUND;
+}
+
 SYLVAN_INTERNAL sylvan_code_t
 sylvan_breakpoint_enable_ptr(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
 
@@ -134,22 +370,169 @@ sylvan_code_t sylvan_breakpoint_disable(struct sylvan_inferior *inf, uintptr_t a
 }
 
 /**
- * sets a breakpoint and enables it
+ * adds a breakpoint of the given type to the table and enables it
  */
-sylvan_code_t sylvan_breakpoint_set(struct sylvan_inferior *inf, uintptr_t addr) {
-    if (!inf)
-        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+static sylvan_code_t
+sylvan_breakpoint_add(struct sylvan_inferior *inf, uintptr_t addr, sylvan_breakpoint_type_t type, bool internal, struct sylvan_breakpoint **breakpointp) {
 
-    int breakpoint_count = inf->breakpoint_count;
-    if (breakpoint_count == MAX_BREAKPOINTS)
-        return sylvan_set_code(SYVLANC_BREAKPOINT_LIMIT_REACHED);
+    assert(inf); // should have been checked by the caller
 
     if (sylvan_breakpoint_find_by_addr(inf, addr, NULL) != SYVLANC_BREAKPOINT_NOT_FOUND)
         return sylvan_set_code(SYVLANC_BREAKPOINT_ALREADY_EXISTS);
 
-    struct sylvan_breakpoint *breakpoint = inf->breakpoints + inf->breakpoint_count++;
+    int slot = -1;
+    if (type != SYLVAN_BREAKPOINT_SOFTWARE) {
+        for (int i = 0; i < SYLVAN_HW_BREAKPOINTS && slot < 0; ++i)
+            if (!inf->hw_breakpoints[i])
+                slot = i;
+        if (slot < 0)
+            return sylvan_set_message(SYVLANC_BREAKPOINT_LIMIT_REACHED, "All %d debug registers are in use", SYLVAN_HW_BREAKPOINTS);
+    }
+
+    struct sylvan_breakpoint *breakpoint = calloc(1, sizeof(struct sylvan_breakpoint));
+    if (!breakpoint)
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    breakpoint->id = internal ? -1 : inf->breakpoint_idx++;
     breakpoint->addr = addr;
+    breakpoint->type = type;
+    breakpoint->hw_slot = slot;
     breakpoint->is_enabled_log = true;
+    breakpoint->is_internal = internal;
+
+    if (slot >= 0)
+        inf->hw_breakpoints[slot] = breakpoint;
+
+    HASH_ADD(hh, inf->breakpoints, addr, sizeof(uintptr_t), breakpoint);
+    if (!internal)
+        inf->breakpoint_count++;
+
+    if (breakpointp)
+        *breakpointp = breakpoint;
+
+    return SYLVANC_OK;
+}
+
+/**
+ * sets a breakpoint and enables it
+ */
+sylvan_code_t sylvan_breakpoint_set(struct sylvan_inferior *inf, uintptr_t addr) {
+    if (!inf)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    struct sylvan_breakpoint *breakpoint;
+    sylvan_code_t code;
+    if ((code = sylvan_breakpoint_add(inf, addr, SYLVAN_BREAKPOINT_SOFTWARE, false, &breakpoint)))
+        return code;
+
+    if (!isactive(inf))
+        return SYLVANC_OK;
+
+    return sylvan_breakpoint_enable_ptr(inf, breakpoint);
+}
+
+/**
+ * sets a breakpoint on a function of the executable or of a loaded shared object
+ * its address is looked up again in every new process, so it follows a PIE executable or a library wherever
+ * they are loaded. a symbol nothing has yet makes it pending until an object with it is loaded
+ * sets *addrp to the key the breakpoint is found by, which is a placeholder while it's pending
+ */
+sylvan_code_t sylvan_breakpoint_set_symbol(struct sylvan_inferior *inf, const char *symbol, bool hw, uintptr_t *addrp) {
+    if (!inf || !symbol || !*symbol)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    char *copy = strdup(symbol);
+    if (!copy)
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    uintptr_t addr;
+    bool pending = !sylvan_sym_resolve(inf, symbol, &addr);
+    if (pending)
+        addr = PENDING_ADDR(inf->breakpoint_idx);
+
+    struct sylvan_breakpoint *breakpoint;
+    sylvan_code_t code;
+    if ((code = sylvan_breakpoint_add(inf, addr, hw ? SYLVAN_BREAKPOINT_HARDWARE : SYLVAN_BREAKPOINT_SOFTWARE, false, &breakpoint))) {
+        free(copy);
+        return code;
+    }
+
+    breakpoint->symbol = copy;
+    breakpoint->is_pending = pending;
+
+    if (addrp)
+        *addrp = addr;
+
+    if (!isactive(inf))
+        return SYLVANC_OK;
+
+    return sylvan_breakpoint_enable_ptr(inf, breakpoint);
+}
+
+/**
+ * sets a software breakpoint the library handles itself, the process never stops there for the user
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_set_internal(struct sylvan_inferior *inf, uintptr_t addr, struct sylvan_breakpoint **breakpointp) {
+
+    assert(inf); // should have been checked by the caller
+
+    struct sylvan_breakpoint *breakpoint;
+    sylvan_code_t code;
+    if ((code = sylvan_breakpoint_add(inf, addr, SYLVAN_BREAKPOINT_SOFTWARE, true, &breakpoint)))
+        return code;
+
+    if (breakpointp)
+        *breakpointp = breakpoint;
+
+    if (!isactive(inf))
+        return SYLVANC_OK;
+
+    return sylvan_breakpoint_enable_ptr(inf, breakpoint);
+}
+
+/**
+ * sets a hardware execute breakpoint using a free debug register and enables it
+ */
+sylvan_code_t sylvan_breakpoint_set_hw(struct sylvan_inferior *inf, uintptr_t addr) {
+    if (!inf)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    struct sylvan_breakpoint *breakpoint;
+    sylvan_code_t code;
+    if ((code = sylvan_breakpoint_add(inf, addr, SYLVAN_BREAKPOINT_HARDWARE, false, &breakpoint)))
+        return code;
+
+    if (!isactive(inf))
+        return SYLVANC_OK;
+
+    return sylvan_breakpoint_enable_ptr(inf, breakpoint);
+}
+
+/**
+ * sets a data watchpoint on len bytes at addr using a free debug register and enables it
+ * len has to be 1, 2, 4 or 8 and addr has to be aligned to it
+ */
+sylvan_code_t sylvan_watchpoint_set(struct sylvan_inferior *inf, uintptr_t addr, size_t len, sylvan_watch_t kind) {
+    if (!inf)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (len != 1 && len != 2 && len != 4 && len != 8)
+        return sylvan_set_message(SYLVANC_INVALID_ARGUMENT, "Watch length has to be 1, 2, 4 or 8");
+
+    if (addr & (len - 1))
+        return sylvan_set_message(SYLVANC_INVALID_ARGUMENT, "Address %#lx is not aligned to %zu bytes", addr, len);
+
+    if (kind != SYLVAN_WATCH_WRITE && kind != SYLVAN_WATCH_READWRITE)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    struct sylvan_breakpoint *breakpoint;
+    sylvan_code_t code;
+    if ((code = sylvan_breakpoint_add(inf, addr, SYLVAN_BREAKPOINT_WATCH, false, &breakpoint)))
+        return code;
+
+    breakpoint->watch_len = len;
+    breakpoint->watch_kind = kind;
 
     if (!isactive(inf))
         return SYLVANC_OK;
@@ -157,6 +540,44 @@ sylvan_code_t sylvan_breakpoint_set(struct sylvan_inferior *inf, uintptr_t addr)
     return sylvan_breakpoint_enable_ptr(inf, breakpoint);
 }
 
+/**
+ * removes a breakpoint from the table and frees it, the caller removes it from memory first
+ * or knows the process it was inserted in is gone
+ */
+SYLVAN_INTERNAL void
+sylvan_breakpoint_delete(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
+
+    assert(inf && breakpoint); // should have been checked by the caller
+
+    if (breakpoint->hw_slot >= 0)
+        inf->hw_breakpoints[breakpoint->hw_slot] = NULL;
+
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp)
+        if (thread->stop_breakpoint == breakpoint)
+            thread->stop_breakpoint = NULL;
+
+    if (inf->solib_breakpoint == breakpoint)
+        inf->solib_breakpoint = NULL;
+
+    if (inf->run_to_breakpoint == breakpoint)
+        inf->run_to_breakpoint = NULL;
+
+    /* internal ids are reused, a new breakpoint with this id must not run the old copy */
+    if (inf->dstep_owner == breakpoint->id)
+        inf->dstep_owner = SYLVAN_DSTEP_NO_OWNER;
+
+    if (!breakpoint->is_internal)
+        inf->breakpoint_count--;
+
+    HASH_DEL(inf->breakpoints, breakpoint);
+    sylvan_expr_destroy(breakpoint->condition_expr);
+    free(breakpoint->symbol);
+    free(breakpoint->condition);
+    free(breakpoint->interval_hist);
+    free(breakpoint);
+}
+
 /**
  * disables breakpoint and unsets it
  */
@@ -172,30 +593,159 @@ sylvan_code_t sylvan_breakpoint_unset(struct sylvan_inferior *inf, uintptr_t add
     if ((code = sylvan_breakpoint_disable_ptr(inf, breakpoint)))
         return code;
 
-    struct sylvan_breakpoint *breakpoints = inf->breakpoints;
+    sylvan_breakpoint_delete(inf, breakpoint);
 
-    // breakpoints[i] = breakpoints[n - 1]
-    if (--inf->breakpoint_count)
-        breakpoints[breakpoint - breakpoints] = breakpoints[inf->breakpoint_count];
+    return SYLVANC_OK;
+}
+
+/**
+ * compiles a condition for the breakpoint at addr, a hit where it evaluates to 0 doesn't stop the program
+ * a NULL or empty condition makes the breakpoint unconditional again
+ */
+sylvan_code_t sylvan_breakpoint_set_condition(struct sylvan_inferior *inf, uintptr_t addr, const char *condition) {
+    if (!inf)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    struct sylvan_breakpoint *breakpoint;
+    if (sylvan_breakpoint_find_by_addr(inf, addr, &breakpoint))
+        return sylvan_set_code(SYVLANC_BREAKPOINT_NOT_FOUND);
+
+    struct sylvan_expr *expr = NULL;
+    char *source = NULL;
+
+    if (condition && *condition) {
+        sylvan_code_t code;
+        if ((code = sylvan_expr_compile(condition, &expr)))
+            return code;
+
+        if (!(source = strdup(condition))) {
+            sylvan_expr_destroy(expr);
+            return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+        }
+    }
+
+    sylvan_expr_destroy(breakpoint->condition_expr);
+    free(breakpoint->condition);
+    breakpoint->condition_expr = expr;
+    breakpoint->condition = source;
 
     return SYLVANC_OK;
 }
 
-SYLVAN_INTERNAL sylvan_code_t
-sylvan_breakpoint_clearall(struct sylvan_inferior *inf) {
+/**
+ * makes the next count hits of the breakpoint at addr continue without stopping
+ */
+sylvan_code_t sylvan_breakpoint_set_ignore(struct sylvan_inferior *inf, uintptr_t addr, unsigned long count) {
     if (!inf)
         return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
 
-    if (!isactive(inf)) {
-        inf->breakpoint_count = 0;
+    struct sylvan_breakpoint *breakpoint;
+    if (sylvan_breakpoint_find_by_addr(inf, addr, &breakpoint))
+        return sylvan_set_code(SYVLANC_BREAKPOINT_NOT_FOUND);
+
+    breakpoint->ignore_count = count;
+    return SYLVANC_OK;
+}
+
+static unsigned
+sylvan_breakpoint_hist_bucket(uint64_t ns) {
+    if (ns < HIST_SUB)
+        return (unsigned)ns;
+
+    unsigned exp = 63 - __builtin_clzll(ns);
+    unsigned sub = (unsigned)(ns >> (exp - HIST_SUB_BITS)) & (HIST_SUB - 1);
+    return (exp - HIST_SUB_BITS + 1) * HIST_SUB + sub;
+}
+
+/**
+ * the middle of the range of values that land in bucket
+ */
+static uint64_t
+sylvan_breakpoint_hist_value(unsigned bucket) {
+    if (bucket < HIST_SUB)
+        return bucket;
+
+    unsigned exp = bucket / HIST_SUB + HIST_SUB_BITS - 1;
+    uint64_t low = (uint64_t)(HIST_SUB + bucket % HIST_SUB) << (exp - HIST_SUB_BITS);
+    return low + ((1ULL << (exp - HIST_SUB_BITS)) >> 1);
+}
+
+/**
+ * counts a hit at now_ns and adds the time since the previous hit to the interval statistics
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_record_hit(struct sylvan_breakpoint *breakpoint, uint64_t now_ns) {
+
+    assert(breakpoint); // should have been checked by the caller
+
+    breakpoint->hit_count++;
+
+    uint64_t last_ns = breakpoint->last_hit_ns;
+    breakpoint->last_hit_ns = now_ns;
+    if (breakpoint->hit_count < 2 || now_ns < last_ns)
         return SYLVANC_OK;
+
+    if (!breakpoint->interval_hist && !(breakpoint->interval_hist = calloc(HIST_BUCKETS, sizeof(uint32_t))))
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    uint64_t interval = now_ns - last_ns;
+    if (breakpoint->hit_count == 2 || interval < breakpoint->interval_min_ns)
+        breakpoint->interval_min_ns = interval;
+    breakpoint->interval_sum_ns += interval;
+    breakpoint->interval_hist[sylvan_breakpoint_hist_bucket(interval)]++;
+
+    return SYLVANC_OK;
+}
+
+/**
+ * hit count and min/avg/p99 of the time between consecutive hits
+ */
+sylvan_code_t sylvan_breakpoint_get_stats(const struct sylvan_breakpoint *breakpoint, struct sylvan_breakpoint_stats *stats) {
+    if (!breakpoint || !stats)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    memset(stats, 0, sizeof(struct sylvan_breakpoint_stats));
+    stats->hit_count = breakpoint->hit_count;
+
+    if (!breakpoint->interval_hist)
+        return SYLVANC_OK;
+
+    unsigned long count = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++)
+        count += breakpoint->interval_hist[i];
+    if (!count)
+        return SYLVANC_OK;
+
+    stats->interval_count = count;
+    stats->min_ns = breakpoint->interval_min_ns;
+    stats->avg_ns = breakpoint->interval_sum_ns / count;
+
+    unsigned long rank = count - count / 100, seen = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        seen += breakpoint->interval_hist[i];
+        if (seen >= rank) {
+            stats->p99_ns = sylvan_breakpoint_hist_value(i);
+            break;
+        }
     }
+
+    if (stats->p99_ns < stats->min_ns)
+        stats->p99_ns = stats->min_ns;
+
+    return SYLVANC_OK;
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_clearall(struct sylvan_inferior *inf) {
+    if (!inf)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
     sylvan_code_t code;
-    struct sylvan_breakpoint *breakpoints = inf->breakpoints;
-    while (inf->breakpoint_count) {
-        if ((code = sylvan_breakpoint_remove_phybp(inf, breakpoints + inf->breakpoint_count - 1)))
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp) {
+        if (isactive(inf) && (code = sylvan_breakpoint_remove_phybp(inf, breakpoint)))
             return code;
-        inf->breakpoint_count--;
+        sylvan_breakpoint_delete(inf, breakpoint);
     }
 
     return SYLVANC_OK;
@@ -206,11 +756,236 @@ sylvan_breakpoint_reset_phybp(struct sylvan_inferior *inf) {
     if (!inf)
         return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
 
-    struct sylvan_breakpoint *breakpoints = inf->breakpoints;
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp)
+        breakpoint->is_enabled_phy = false;
+
+    return SYLVANC_OK;
+}
+
+/**
+ * gives dst, which has no breakpoints yet, a copy of every breakpoint of src for the child of a fork
+ * the child's memory is a copy of the parent's, so the inserted ones are in it already. hits are counted anew.
+ * shared is true for a vfork, whose child runs in the parent's memory
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_copy_all(struct sylvan_inferior *dst, struct sylvan_inferior *src, bool shared) {
+
+    assert(dst && src && !dst->breakpoints); // should have been checked by the caller
+
+    sylvan_code_t code;
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, src->breakpoints, breakpoint, tmp) {
+        /* where the parent runs to is its own business, its int3 is taken out of a copied memory */
+        if (breakpoint == src->run_to_breakpoint && !shared) {
+            if (breakpoint->type != SYLVAN_BREAKPOINT_SOFTWARE || !breakpoint->is_enabled_phy)
+                continue;
+
+            long data = ptrace(PTRACE_PEEKTEXT, dst->pid, (void *) breakpoint->addr, NULL);
+            if (data == -1)
+                return sylvan_set_errno_msg(SYLVANC_PTRACE_PEEKTEXT_FAILED, "ptrace peek text");
+
+            data = (data & ~0xFF) | breakpoint->og_byte;
+            if (ptrace(PTRACE_POKETEXT, dst->pid, (void *) breakpoint->addr, (void *)data) == -1)
+                return sylvan_set_errno_msg(SYLVANC_PTRACE_POKETEXT_FAILED, "ptrace poke text");
+            continue;
+        }
+
+        struct sylvan_breakpoint *copy = malloc(sizeof(struct sylvan_breakpoint));
+        if (!copy)
+            return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+        *copy = *breakpoint;
+        copy->symbol = NULL;
+        copy->condition = NULL;
+        copy->condition_expr = NULL;
+        copy->hit_count = 0;
+        copy->last_hit_ns = 0;
+        copy->interval_min_ns = 0;
+        copy->interval_sum_ns = 0;
+        copy->interval_hist = NULL;
+
+        /* in the table first, so dst frees it if the rest fails */
+        HASH_ADD(hh, dst->breakpoints, addr, sizeof(uintptr_t), copy);
+        if (!copy->is_internal)
+            dst->breakpoint_count++;
+        if (copy->hw_slot >= 0)
+            dst->hw_breakpoints[copy->hw_slot] = copy;
+        if (breakpoint == src->solib_breakpoint)
+            dst->solib_breakpoint = copy;
+
+        /* the int3 stays for the parent, no thread of the child has run_to_tid 0 so it only passes through
+         * until its exec takes the breakpoint out */
+        if (breakpoint == src->run_to_breakpoint) {
+            dst->run_to_breakpoint = copy;
+            dst->run_to_tid = 0;
+            dst->run_to_sp = 0;
+            dst->run_to_by_cfa = false;
+        }
+
+        if (breakpoint->symbol && !(copy->symbol = strdup(breakpoint->symbol)))
+            return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+        if (breakpoint->condition) {
+            if (!(copy->condition = strdup(breakpoint->condition)))
+                return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+            if ((code = sylvan_expr_compile(copy->condition, &copy->condition_expr)))
+                return code;
+        }
+    }
+
+    dst->breakpoint_idx = src->breakpoint_idx;
+    dst->dstep_scratch = src->dstep_scratch;
+    dst->dstep_owner = src->dstep_owner;
+
+    return SYLVANC_OK;
+}
+
+/**
+ * writes the original bytes of inf's inserted int3s into the process pid, which is inf's own process or a
+ * child that copied or shares its memory. with threads the debug registers of inf's stopped threads are
+ * cleared too, a child starts without them. the table isn't changed, it still says what inf had inserted
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_strip(struct sylvan_inferior *inf, pid_t pid, bool threads) {
+
+    assert(inf); // should have been checked by the caller
+
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp) {
+        if (breakpoint->type != SYLVAN_BREAKPOINT_SOFTWARE || !breakpoint->is_enabled_phy)
+            continue;
+
+        long data = ptrace(PTRACE_PEEKTEXT, pid, (void *) breakpoint->addr, NULL);
+        if (data == -1)
+            return sylvan_set_errno_msg(SYLVANC_PTRACE_PEEKTEXT_FAILED, "ptrace peek text");
+
+        data = (data & ~0xFF) | breakpoint->og_byte;
+        if (ptrace(PTRACE_POKETEXT, pid, (void *) breakpoint->addr, (void *)data) == -1)
+            return sylvan_set_errno_msg(SYLVANC_PTRACE_POKETEXT_FAILED, "ptrace poke text");
+    }
+
+    if (!threads || !sylvan_breakpoint_dr7(inf))
+        return SYLVANC_OK;
+
+    sylvan_code_t code;
+    struct sylvan_thread *thread, *tmpthread;
+    HASH_ITER(hh, inf->threads, thread, tmpthread)
+        if (thread->is_stopped && (code = sylvan_breakpoint_write_dr(thread, -1, 0, 0)))
+            return code;
+
+    return SYLVANC_OK;
+}
+
+/**
+ * true if breakpoint is an int3 in the process that lies in the len bytes at addr
+ */
+static bool
+sylvan_breakpoint_inserted_in(const struct sylvan_breakpoint *breakpoint, uintptr_t addr, size_t len) {
+    return breakpoint->type == SYLVAN_BREAKPOINT_SOFTWARE && breakpoint->is_enabled_phy &&
+           breakpoint->addr >= addr && breakpoint->addr - addr < len;
+}
+
+/**
+ * see lib/sylvan/breakpoint.h
+ */
+SYLVAN_INTERNAL void
+sylvan_breakpoint_shadow(struct sylvan_inferior *inf, uintptr_t addr, uint8_t *buf, size_t len) {
+
+    assert(inf && buf); // should have been checked by the caller
+
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp)
+        if (sylvan_breakpoint_inserted_in(breakpoint, addr, len))
+            buf[breakpoint->addr - addr] = breakpoint->og_byte;
+}
+
+/**
+ * see lib/sylvan/breakpoint.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_cover(struct sylvan_inferior *inf, uintptr_t addr, const uint8_t *data, size_t len, uint8_t **bytesp) {
+
+    assert(inf && data && bytesp); // should have been checked by the caller
+
+    *bytesp = NULL;
+
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp) {
+        if (!sylvan_breakpoint_inserted_in(breakpoint, addr, len))
+            continue;
+
+        if (!*bytesp) {
+            if (!(*bytesp = malloc(len)))
+                return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+            memcpy(*bytesp, data, len);
+        }
+
+        breakpoint->og_byte = data[breakpoint->addr - addr];
+        (*bytesp)[breakpoint->addr - addr] = 0xCC;
+    }
+
+    return SYLVANC_OK;
+}
+
+static int
+sylvan_breakpoint_idcmp(struct sylvan_breakpoint *a, struct sylvan_breakpoint *b) {
+    return (a->id > b->id) - (a->id < b->id);
+}
+
+/**
+ * looks up the symbol of every pending breakpoint in one pass, moves the ones it finds to their address
+ * in the process and inserts them. all first makes every breakpoint set on a symbol pending, for a new
+ * process or after objects were unloaded. what a moved breakpoint inserted at its old location is removed,
+ * an int3 in text that was unmapped is only forgotten
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_breakpoint_resolve(struct sylvan_inferior *inf, bool all) {
+
+    assert(inf); // should have been checked by the caller
+
+    sylvan_code_t code;
+    bool moved = false;
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp) {
+        if (!breakpoint->symbol || (!all && !breakpoint->is_pending))
+            continue;
+
+        uintptr_t addr;
+        bool found = sylvan_sym_resolve(inf, breakpoint->symbol, &addr);
+
+        /* two symbols can alias one address, the later breakpoint waits for the earlier one to go */
+        if (found && addr != breakpoint->addr && sylvan_breakpoint_find_by_addr(inf, addr, NULL) == SYLVANC_OK)
+            found = false;
+
+        if (!found)
+            addr = PENDING_ADDR(breakpoint->id);
+        breakpoint->is_pending = !found;
+
+        if (addr != breakpoint->addr) {
+            /* armed debug registers or an int3 in text that's still mapped would fire at the old address */
+            if (breakpoint->is_enabled_phy && isactive(inf) && (code = sylvan_breakpoint_remove_phybp(inf, breakpoint)) &&
+                breakpoint->type != SYLVAN_BREAKPOINT_SOFTWARE)
+                return code;
+
+            if (inf->dstep_owner == breakpoint->id)
+                inf->dstep_owner = SYLVAN_DSTEP_NO_OWNER;
+
+            HASH_DEL(inf->breakpoints, breakpoint);
+            breakpoint->addr = addr;
+            breakpoint->dstep_flags = 0;
+            breakpoint->is_enabled_phy = false;
+            HASH_ADD(hh, inf->breakpoints, addr, sizeof(uintptr_t), breakpoint);
+            moved = true;
+        }
+
+        if (breakpoint->is_enabled_log && isactive(inf) && (code = sylvan_breakpoint_create_phybp(inf, breakpoint)))
+            return code;
+    }
 
-    int breakpoint_count = inf->breakpoint_count;
-    for (int i = 0; i < breakpoint_count; ++i)
-        breakpoints[i].is_enabled_phy = false;
+    /* re-adding put the moved ones at the end, the ui lists them in id order */
+    if (moved)
+        HASH_SRT(hh, inf->breakpoints, sylvan_breakpoint_idcmp);
 
     return SYLVANC_OK;
 }
@@ -221,10 +996,9 @@ sylvan_breakpoint_setall_phybp(struct sylvan_inferior *inf) {
     assert(inf && isactive(inf));// should have been checked by the caller
 
     sylvan_code_t code;
-    int breakpoint_count = inf->breakpoint_count;
-    struct sylvan_breakpoint *breakpoints = inf->breakpoints;
-    for (int i = 0; i < breakpoint_count; ++i)
-        if ((code = sylvan_breakpoint_create_phybp(inf, breakpoints + i)))
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp)
+        if ((code = sylvan_breakpoint_create_phybp(inf, breakpoint)))
             return code;
 
     return SYLVANC_OK;
@@ -236,10 +1010,9 @@ sylvan_breakpoint_unsetall_phybp(struct sylvan_inferior *inf) {
     assert(inf && isactive(inf));// should have been checked by the caller
 
     sylvan_code_t code;
-    int breakpoint_count = inf->breakpoint_count;
-    struct sylvan_breakpoint *breakpoints = inf->breakpoints;
-    for (int i = 0; i < breakpoint_count; ++i)
-        if ((code = sylvan_breakpoint_remove_phybp(inf, breakpoints + i)))
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp)
+        if ((code = sylvan_breakpoint_remove_phybp(inf, breakpoint)))
             return code;
 
     return SYLVANC_OK;
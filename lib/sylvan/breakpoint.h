@@ -2,15 +2,42 @@
 #define SYLVAN_BREAKPOINT_H
 
 #include <sylvan/breakpoint.h>
+#include <sylvan/thread.h>
 
 sylvan_code_t sylvan_breakpoint_find_by_addr(struct sylvan_inferior *inf, uintptr_t addr, struct sylvan_breakpoint **breakpointp);
+sylvan_code_t sylvan_breakpoint_find_by_dr6(struct sylvan_inferior *inf, struct sylvan_breakpoint **breakpointp);
+sylvan_code_t sylvan_breakpoint_load_hwbp(struct sylvan_inferior *inf, struct sylvan_thread *thread);
 
 sylvan_code_t sylvan_breakpoint_enable_ptr(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint);
 sylvan_code_t sylvan_breakpoint_disable_ptr(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint);
 
+sylvan_code_t sylvan_breakpoint_set_internal(struct sylvan_inferior *inf, uintptr_t addr, struct sylvan_breakpoint **breakpointp);
+void sylvan_breakpoint_delete(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint);
+
+sylvan_code_t sylvan_breakpoint_record_hit(struct sylvan_breakpoint *breakpoint, uint64_t now_ns);
+
 sylvan_code_t sylvan_breakpoint_clearall(struct sylvan_inferior *inf);
 sylvan_code_t sylvan_breakpoint_reset_phybp(struct sylvan_inferior *inf);
 
+sylvan_code_t sylvan_breakpoint_copy_all(struct sylvan_inferior *dst, struct sylvan_inferior *src, bool shared);
+sylvan_code_t sylvan_breakpoint_strip(struct sylvan_inferior *inf, pid_t pid, bool threads);
+
+/**
+ * replaces the int3s inserted in the len bytes at addr, which buf holds as read from the process,
+ * with the bytes they replaced
+ */
+void sylvan_breakpoint_shadow(struct sylvan_inferior *inf, uintptr_t addr, uint8_t *buf, size_t len);
+
+/**
+ * data is about to be written at addr, the bytes of it that land on inserted int3s become the bytes those
+ * breakpoints restore. *bytesp is a copy of data with the int3s kept, to be written instead and freed by the caller,
+ * or NULL if there's no int3 in the way
+ */
+sylvan_code_t sylvan_breakpoint_cover(struct sylvan_inferior *inf, uintptr_t addr, const uint8_t *data, size_t len,
+                                      uint8_t **bytesp);
+
+sylvan_code_t sylvan_breakpoint_resolve(struct sylvan_inferior *inf, bool all);
+
 sylvan_code_t sylvan_breakpoint_setall_phybp(struct sylvan_inferior *inf);
 sylvan_code_t sylvan_breakpoint_unsetall_phybp(struct sylvan_inferior *inf);
 
@@ -0,0 +1,288 @@
+#include <assert.h>
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/user.h>
+
+#include <Zydis/Zydis.h>
+
+#include <sylvan/inferior.h>
+#include "breakpoint.h"
+#include "displaced.h"
+#include "error.h"
+#include "inferior.h"
+#include "sylvan.h"
+#include "syscall.h"
+#include "thread.h"
+
+#define SYLVAN_DSTEP_NO_SCRATCH ((uintptr_t)-1)    /* allocation failed, don't retry */
+#define SYLVAN_DSTEP_PAGE_SIZE 0x1000UL
+#define SYLVAN_DSTEP_NEAR (1UL << 30)               /* keep the scratch page within rel32 reach of the text */
+#define USER_REG_OFFSET(reg) offsetof(struct user, regs.reg)
+
+/**
+ * forgets the scratch page and every relocated instruction, called for every new process
+ */
+SYLVAN_INTERNAL void
+sylvan_dstep_reset(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    inf->dstep_scratch = 0;
+    inf->dstep_owner = SYLVAN_DSTEP_NO_OWNER;
+
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, inf->breakpoints, breakpoint, tmp)
+        breakpoint->dstep_flags = 0;
+}
+
+/**
+ * maps the scratch page by running mmap in the process
+ * the syscall instruction is written over the breakpoint at addr for a single step and restored right after
+ */
+static sylvan_code_t
+sylvan_dstep_run_mmap(struct sylvan_inferior *inf, uintptr_t addr) {
+
+    assert(inf); // should have been checked by the caller
+
+    uintptr_t hint = addr > SYLVAN_DSTEP_NEAR ? addr - SYLVAN_DSTEP_NEAR : addr + SYLVAN_DSTEP_NEAR;
+    unsigned long args[6] = {
+        hint & ~(SYLVAN_DSTEP_PAGE_SIZE - 1), SYLVAN_DSTEP_PAGE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+        MAP_PRIVATE | MAP_ANONYMOUS, (unsigned long)-1, 0,
+    };
+
+    sylvan_code_t code;
+    long result;
+    if ((code = sylvan_syscall_inject(inf, addr, SYS_mmap, args, &result)))
+        return code;
+
+    /* mmap returns -errno on failure */
+    if (result < 0 && result > -4096) {
+        inf->dstep_scratch = SYLVAN_DSTEP_NO_SCRATCH;
+        return SYLVANC_OK;
+    }
+
+    inf->dstep_scratch = (uintptr_t)result;
+    inf->dstep_owner = SYLVAN_DSTEP_NO_OWNER;
+
+    return SYLVANC_OK;
+}
+
+/**
+ * maps the scratch page, the other threads are paused while the breakpoint at addr is a syscall
+ */
+static sylvan_code_t
+sylvan_dstep_alloc_scratch(struct sylvan_inferior *inf, uintptr_t addr) {
+
+    sylvan_code_t code;
+    bool paused;
+    if ((code = sylvan_thread_pause_all(inf, &paused)))
+        return code;
+
+    code = sylvan_dstep_run_mmap(inf, addr);
+    if (!paused)
+        return code;
+
+    sylvan_code_t resume_code = sylvan_thread_resume_paused(inf);
+    return code ? code : resume_code;
+}
+
+/**
+ * reads the original instruction bytes at addr, sylvan_read_memory shows the saved byte of every inserted 0xCC
+ * returns how many of the SYLVAN_INSN_MAX bytes could be read
+ */
+SYLVAN_INTERNAL size_t
+sylvan_dstep_read_original(struct sylvan_inferior *inf, uintptr_t addr, uint8_t *buf) {
+
+    size_t len = SYLVAN_INSN_MAX;
+    if (sylvan_read_memory(inf, addr, buf, len)) {
+        /* the instruction may end right before an unmapped page */
+        len = SYLVAN_DSTEP_PAGE_SIZE - (addr & (SYLVAN_DSTEP_PAGE_SIZE - 1));
+        if (len > SYLVAN_INSN_MAX || sylvan_read_memory(inf, addr, buf, len))
+            return 0;
+    }
+
+    return len;
+}
+
+/**
+ * decodes the original instruction at addr and tells whether it's a call or a ret in *kind
+ * returns its length, 0 if it can't be read or decoded
+ */
+SYLVAN_INTERNAL size_t
+sylvan_dstep_decode(struct sylvan_inferior *inf, uintptr_t addr, int *kind) {
+
+    assert(inf && kind); // should have been checked by the caller
+
+    *kind = 0;
+
+    uint8_t buf[SYLVAN_INSN_MAX];
+    size_t len = sylvan_dstep_read_original(inf, addr, buf);
+
+    ZydisDisassembledInstruction instr;
+    if (!len || !ZYAN_SUCCESS(ZydisDisassembleIntel(ZYDIS_MACHINE_MODE_LONG_64, addr, buf, len, &instr)))
+        return 0;
+
+    if (instr.info.meta.category == ZYDIS_CATEGORY_CALL)
+        *kind = SYLVAN_INSN_CALL;
+    else if (instr.info.meta.category == ZYDIS_CATEGORY_RET)
+        *kind = SYLVAN_INSN_RET;
+
+    return instr.info.length;
+}
+
+/**
+ * decodes the original instruction and relocates it to the scratch slot
+ * sets SYLVAN_DSTEP_INPLACE when the instruction has to be stepped where it is
+ */
+static void
+sylvan_dstep_prepare(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
+
+    uint8_t buf[SYLVAN_INSN_MAX];
+    size_t len = sylvan_dstep_read_original(inf, breakpoint->addr, buf);
+
+    ZydisDisassembledInstruction instr;
+    if (!len || !ZYAN_SUCCESS(ZydisDisassembleIntel(ZYDIS_MACHINE_MODE_LONG_64, breakpoint->addr, buf, len, &instr))) {
+        breakpoint->dstep_flags = SYLVAN_DSTEP_INPLACE;
+        return;
+    }
+
+    /* syscall leaves the return address in rcx, which would point into the scratch page */
+    if (instr.info.mnemonic == ZYDIS_MNEMONIC_SYSCALL) {
+        breakpoint->dstep_flags = SYLVAN_DSTEP_INPLACE;
+        return;
+    }
+
+    uint8_t flags = SYLVAN_DSTEP_DECODED;
+    bool rip_relative = false;
+
+    for (int i = 0; i < instr.info.operand_count; i++) {
+        ZydisDecodedOperand *operand = &instr.operands[i];
+        if (operand->type == ZYDIS_OPERAND_TYPE_MEMORY && operand->mem.base == ZYDIS_REGISTER_RIP)
+            rip_relative = true;
+        if (operand->type == ZYDIS_OPERAND_TYPE_IMMEDIATE && operand->imm.is_relative)
+            flags |= SYLVAN_DSTEP_RELATIVE;
+    }
+
+    if (instr.info.meta.category == ZYDIS_CATEGORY_CALL)
+        flags |= SYLVAN_DSTEP_CALL;
+
+    memcpy(breakpoint->dstep_insn, buf, instr.info.length);
+
+    /* rebase the displacement so it still points at the same data from the scratch slot */
+    if (rip_relative) {
+        int32_t disp;
+        int64_t moved = (int64_t)(breakpoint->addr - inf->dstep_scratch);
+        int64_t relocated;
+
+        if (instr.info.raw.disp.size != 32) {
+            breakpoint->dstep_flags = SYLVAN_DSTEP_INPLACE;
+            return;
+        }
+
+        memcpy(&disp, breakpoint->dstep_insn + instr.info.raw.disp.offset, sizeof(disp));
+        relocated = (int64_t)disp + moved;
+        if (relocated < INT32_MIN || relocated > INT32_MAX) {
+            breakpoint->dstep_flags = SYLVAN_DSTEP_INPLACE;
+            return;
+        }
+
+        disp = (int32_t)relocated;
+        memcpy(breakpoint->dstep_insn + instr.info.raw.disp.offset, &disp, sizeof(disp));
+    }
+
+    breakpoint->dstep_len = instr.info.length;
+    breakpoint->dstep_flags = flags;
+}
+
+/**
+ * fixes rip and the pushed return address after the relocated instruction ran in the scratch slot
+ */
+static sylvan_code_t
+sylvan_dstep_fixup(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint) {
+
+    uintptr_t scratch = inf->dstep_scratch;
+    pid_t tid = inf->thread->tid;
+
+    errno = 0;
+    uintptr_t rip = (uintptr_t)ptrace(PTRACE_PEEKUSER, tid, USER_REG_OFFSET(rip), NULL);
+    if (errno)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_PEEKUSER_FAILED, "ptrace peekuser");
+
+    /* a faulting instruction leaves rip on the scratch slot and pushes nothing */
+    bool executed = rip != scratch;
+
+    if ((breakpoint->dstep_flags & SYLVAN_DSTEP_RELATIVE) || (rip >= scratch && rip <= scratch + breakpoint->dstep_len)) {
+        rip = rip - scratch + breakpoint->addr;
+        if (ptrace(PTRACE_POKEUSER, tid, USER_REG_OFFSET(rip), rip) < 0)
+            return sylvan_set_errno_msg(SYLVANC_PTRACE_POKEUSER_FAILED, "ptrace pokeuser");
+    }
+
+    if ((breakpoint->dstep_flags & SYLVAN_DSTEP_CALL) && executed) {
+        errno = 0;
+        uintptr_t rsp = (uintptr_t)ptrace(PTRACE_PEEKUSER, tid, USER_REG_OFFSET(rsp), NULL);
+        if (errno)
+            return sylvan_set_errno_msg(SYLVANC_PTRACE_PEEKUSER_FAILED, "ptrace peekuser");
+
+        uint64_t retaddr = breakpoint->addr + breakpoint->dstep_len;
+        return sylvan_write_memory(inf, rsp, &retaddr, sizeof(retaddr));
+    }
+
+    return SYLVANC_OK;
+}
+
+/**
+ * executes the original instruction of a software breakpoint out of line, the 0xCC stays in the text
+ * *stepped is false if the instruction can't be displaced and the caller has to step it in place
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_dstep_over(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint, int *wstatus, bool *stepped) {
+
+    assert(inf && breakpoint && stepped); // should have been checked by the caller
+
+    sylvan_code_t code;
+    *stepped = false;
+
+    if (inf->dstep_scratch == SYLVAN_DSTEP_NO_SCRATCH)
+        return SYLVANC_OK;
+
+    if (!(breakpoint->dstep_flags & (SYLVAN_DSTEP_DECODED | SYLVAN_DSTEP_INPLACE))) {
+        if (!inf->dstep_scratch) {
+            if ((code = sylvan_dstep_alloc_scratch(inf, breakpoint->addr)))
+                return code;
+            if (inf->dstep_scratch == SYLVAN_DSTEP_NO_SCRATCH)
+                return SYLVANC_OK;
+        }
+        sylvan_dstep_prepare(inf, breakpoint);
+    }
+
+    if (breakpoint->dstep_flags & SYLVAN_DSTEP_INPLACE)
+        return SYLVANC_OK;
+
+    /* the slot keeps the last instruction, a breakpoint hit in a loop doesn't rewrite it */
+    if (inf->dstep_owner != breakpoint->id) {
+        if ((code = sylvan_write_memory(inf, inf->dstep_scratch, breakpoint->dstep_insn, breakpoint->dstep_len)))
+            return code;
+        inf->dstep_owner = breakpoint->id;
+    }
+
+    if ((code = sylvan_regs_fetch(inf)))
+        return code;
+
+    inf->thread->regs.rip = inf->dstep_scratch;
+    inf->thread->regs_dirty = true;
+
+    if ((code = sylvan_step(inf, wstatus)))
+        return code;
+
+    if ((code = sylvan_dstep_fixup(inf, breakpoint)))
+        return code;
+
+    *stepped = true;
+
+    return SYLVANC_OK;
+}
\ No newline at end of file
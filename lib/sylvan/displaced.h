@@ -0,0 +1,24 @@
+#ifndef SYLVAN_DISPLACED_H
+#define SYLVAN_DISPLACED_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <sylvan/inferior.h>
+
+#define SYLVAN_DSTEP_DECODED    0x01    /* dstep_insn holds the relocated copy */
+#define SYLVAN_DSTEP_INPLACE    0x02    /* can't be displaced, step it in place */
+#define SYLVAN_DSTEP_RELATIVE   0x04    /* relative branch, the target is relative to the scratch slot */
+#define SYLVAN_DSTEP_CALL       0x08    /* pushes the scratch return address */
+
+#define SYLVAN_DSTEP_NO_OWNER   INT_MIN /* dstep_owner when the scratch slot holds nothing, internal breakpoints use -1 */
+
+#define SYLVAN_INSN_MAX         15      /* longest x86-64 instruction */
+#define SYLVAN_INSN_CALL        1       /* kinds sylvan_dstep_decode reports */
+#define SYLVAN_INSN_RET         2
+
+void sylvan_dstep_reset(struct sylvan_inferior *inf);
+size_t sylvan_dstep_read_original(struct sylvan_inferior *inf, uintptr_t addr, uint8_t *buf);
+size_t sylvan_dstep_decode(struct sylvan_inferior *inf, uintptr_t addr, int *kind);
+sylvan_code_t sylvan_dstep_over(struct sylvan_inferior *inf, struct sylvan_breakpoint *breakpoint, int *wstatus, bool *stepped);
+
+#endif /* SYLVAN_DISPLACED_H */
@@ -54,6 +54,8 @@ const char *sylvan_strerror(sylvan_code_t code) {
         case SYLVANC_PTRACE_POKETEXT_FAILED:    return "Could not write to memory";
         case SYLVANC_PTRACE_PEEKDATA_FAILED:    return "Could not read from memory";
         case SYLVANC_PTRACE_POKEDATA_FAILED:    return "Could not write to memory";
+        case SYLVANC_PTRACE_PEEKUSER_FAILED:    return "Could not read debug registers";
+        case SYLVANC_PTRACE_POKEUSER_FAILED:    return "Could not write debug registers";
         
 
         case SYVLANC_BREAKPOINT_ERROR:          return "Breakpoint error";
@@ -67,6 +69,14 @@ const char *sylvan_strerror(sylvan_code_t code) {
         case SYLVANC_DWARF_NOT_FOUND:           return "Debug symbols not found";
         case SYLVANC_SYMBOL_NOT_FOUND:          return "Symbol not found";
 
+        case SYLVANC_EXPR_ERROR:                return "Expression error";
+        case SYLVANC_EXPR_SYNTAX:               return "Invalid expression";
+        case SYLVANC_EXPR_DIVISION_BY_ZERO:     return "Division by zero";
+
+        case SYLVANC_SYSCALL_ERROR:             return "System call tracing error";
+        case SYLVANC_SYSCALL_ENTRY:             return "Program entered a traced system call";
+        case SYLVANC_SYSCALL_FILTER_FAILED:     return "Could not install the seccomp filter";
+
     }
     return "Unknown error";
 }
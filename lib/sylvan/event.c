@@ -0,0 +1,267 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+
+#include <sylvan/event.h>
+#include <sylvan/inferior.h>
+#include "error.h"
+#include "event.h"
+#include "inferior.h"
+#include "sylvan.h"
+#include "thread.h"
+
+/*
+ * every thread is waited for with waitpid(-1) and handed to the inferior that owns it
+ * a pidfd only becomes readable when its process exits, not when it stops, so the wake up comes
+ * from SIGCHLD read through a signalfd instead. SIGCHLD is blocked for that, children unblock it
+ */
+static int sylvan_event_epoll = -1;
+static int sylvan_event_signal = -1;
+static bool sylvan_event_more;         /* events may be left after the last reported one */
+
+/* a stop handled while the caller of a synchronous wait waited for another inferior */
+struct sylvan_event_report {
+    struct sylvan_inferior *inf;
+    sylvan_code_t code;
+    char *message;
+    struct sylvan_event_report *next;
+};
+
+static struct sylvan_event_report *sylvan_event_reports = NULL;    /* in the order they happened */
+
+static sylvan_code_t
+sylvan_event_init(void) {
+    if (sylvan_event_epoll >= 0)
+        return SYLVANC_OK;
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0)
+        return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "block SIGCHLD");
+
+    int sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (sfd < 0)
+        return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "signalfd");
+
+    int efd = epoll_create1(EPOLL_CLOEXEC);
+    if (efd < 0) {
+        close(sfd);
+        return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "epoll create");
+    }
+
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = sfd };
+    if (epoll_ctl(efd, EPOLL_CTL_ADD, sfd, &event) < 0) {
+        close(efd);
+        close(sfd);
+        return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "epoll add");
+    }
+
+    sylvan_event_epoll = efd;
+    sylvan_event_signal = sfd;
+
+    /* a child may have changed state before SIGCHLD was blocked */
+    sylvan_event_more = true;
+    return SYLVANC_OK;
+}
+
+/**
+ * reads the queued SIGCHLDs, they only say that some child has something to collect
+ */
+static void
+sylvan_event_drain(void) {
+    struct signalfd_siginfo info[8];
+    while (read(sylvan_event_signal, info, sizeof(info)) > 0)
+        ;
+}
+
+/**
+ * see lib/sylvan/event.h
+ */
+SYLVAN_INTERNAL void
+sylvan_event_defer(struct sylvan_inferior *inf, sylvan_code_t code) {
+
+    assert(inf); // should have been checked by the caller
+
+    /* the inferior is stopped either way, without memory only the message is lost */
+    struct sylvan_event_report *report = malloc(sizeof(struct sylvan_event_report));
+    if (!report)
+        return;
+
+    report->inf = inf;
+    report->code = code;
+    report->message = code ? strdup(sylvan_get_last_error()) : NULL;
+    report->next = NULL;
+
+    struct sylvan_event_report **tail = &sylvan_event_reports;
+    while (*tail)
+        tail = &(*tail)->next;
+    *tail = report;
+}
+
+/**
+ * see lib/sylvan/event.h
+ */
+SYLVAN_INTERNAL void
+sylvan_event_forget(struct sylvan_inferior *inf) {
+    struct sylvan_event_report **reportp = &sylvan_event_reports;
+    while (*reportp) {
+        struct sylvan_event_report *report = *reportp;
+        if (report->inf != inf) {
+            reportp = &report->next;
+            continue;
+        }
+        *reportp = report->next;
+        free(report->message);
+        free(report);
+    }
+}
+
+/**
+ * returns the oldest deferred report and sets *infp to its inferior
+ */
+static sylvan_code_t
+sylvan_event_take_report(struct sylvan_inferior **infp) {
+    struct sylvan_event_report *report = sylvan_event_reports;
+    sylvan_event_reports = report->next;
+
+    *infp = report->inf;
+    sylvan_code_t code = report->code;
+    if (code)
+        code = report->message ? sylvan_set_message(code, "%s", report->message) : sylvan_set_code(code);
+
+    free(report->message);
+    free(report);
+    return code;
+}
+
+sylvan_code_t sylvan_event_fd(int *fd) {
+    if (!fd)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    sylvan_code_t code;
+    if ((code = sylvan_event_init()))
+        return code;
+
+    *fd = sylvan_event_epoll;
+    return SYLVANC_OK;
+}
+
+sylvan_code_t sylvan_event_poll(int timeout_ms, struct sylvan_inferior **infp) {
+    if (!infp)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    *infp = NULL;
+
+    sylvan_code_t code;
+    if ((code = sylvan_event_init()))
+        return code;
+
+    if (sylvan_event_reports)
+        return sylvan_event_take_report(infp);
+
+    /* stops kept as pending while stopping other threads don't raise SIGCHLD again */
+    if (!sylvan_event_more && !sylvan_thread_has_pending()) {
+        struct epoll_event event;
+        int n = epoll_wait(sylvan_event_epoll, &event, 1, timeout_ms);
+        if (n < 0 && errno != EINTR)
+            return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "epoll wait");
+        if (n <= 0)
+            return SYLVANC_OK;
+    }
+
+    sylvan_event_drain();
+    sylvan_event_more = false;
+
+    for (;;) {
+        int status;
+        struct sylvan_inferior *inf;
+        struct sylvan_thread *thread;
+        code = sylvan_thread_wait(NULL, false, &inf, &thread, &status);
+
+        /* threads of inferiors that were destroyed or never traced are just reaped */
+        if (!inf)
+            return SYLVANC_OK;
+
+        if (code) {
+            sylvan_event_more = true;
+            *infp = inf;
+            return code;
+        }
+
+        bool report;
+        code = sylvan_handle_event(inf, thread, status, &report);
+        if (report || code) {
+            sylvan_event_more = true;
+            *infp = inf;
+            return code;
+        }
+    }
+}
+
+/**
+ * see lib/sylvan/event.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_event_wait(uint64_t timeout_ns) {
+
+    sylvan_code_t code;
+    if ((code = sylvan_event_init()))
+        return code;
+
+    /* epoll_wait only takes milliseconds */
+    struct pollfd pfd = { .fd = sylvan_event_epoll, .events = POLLIN };
+    struct timespec timeout = { .tv_sec = timeout_ns / 1000000000ULL, .tv_nsec = timeout_ns % 1000000000ULL };
+    if (ppoll(&pfd, 1, &timeout, NULL) < 0 && errno != EINTR)
+        return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "ppoll");
+
+    sylvan_event_drain();
+    return SYLVANC_OK;
+}
+
+/**
+ * see lib/sylvan/event.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_event_handle(struct sylvan_inferior *inf, bool *reported) {
+
+    assert(inf && reported); // should have been checked by the caller
+
+    *reported = false;
+
+    sylvan_code_t code;
+    if ((code = sylvan_event_init()))
+        return code;
+
+    for (;;) {
+        int status;
+        struct sylvan_inferior *owner;
+        struct sylvan_thread *thread;
+        code = sylvan_thread_wait(NULL, false, &owner, &thread, &status);
+        if (!owner)
+            return SYLVANC_OK;
+
+        bool report = true;
+        if (!code)
+            code = sylvan_handle_event(owner, thread, status, &report);
+        if (!report && !code)
+            continue;
+
+        sylvan_event_more = true;
+        if (owner == inf) {
+            *reported = true;
+            return code;
+        }
+        sylvan_event_defer(owner, code);
+    }
+}
\ No newline at end of file
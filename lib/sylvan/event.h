@@ -0,0 +1,32 @@
+#ifndef SYLVAN_EVENT_H
+#define SYLVAN_EVENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sylvan/event.h>
+#include <sylvan/inferior.h>
+
+/**
+ * keeps code and the last error message as what inf reports on the next sylvan_event_poll, for a stop that
+ * was handled while the caller waited for another inferior
+ */
+void sylvan_event_defer(struct sylvan_inferior *inf, sylvan_code_t code);
+
+/**
+ * drops what inf had left to report, called when it's destroyed
+ */
+void sylvan_event_forget(struct sylvan_inferior *inf);
+
+/**
+ * waits up to timeout_ns for a process to have an event, sylvan_event_handle collects it
+ */
+sylvan_code_t sylvan_event_wait(uint64_t timeout_ns);
+
+/**
+ * handles the events of all processes without waiting, like sylvan_event_poll does for inferiors running
+ * in the background. *reported is set if inf stopped or exited for a reason the user has to see, that's returned.
+ * what other inferiors report is deferred to sylvan_event_poll
+ */
+sylvan_code_t sylvan_event_handle(struct sylvan_inferior *inf, bool *reported);
+
+#endif /* SYLVAN_EVENT_H */
\ No newline at end of file
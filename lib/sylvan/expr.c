@@ -0,0 +1,458 @@
+#include <assert.h>
+#include <ctype.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/user.h>
+
+#include <sylvan/inferior.h>
+#include "error.h"
+#include "expr.h"
+#include "inferior.h"
+#include "sylvan.h"
+
+#define SYLVAN_EXPR_STACK 32        /* max operand stack depth of a compiled expression */
+#define SYLVAN_EXPR_NESTING 64      /* max parser recursion */
+
+#define REG_OFFSET(reg) { #reg, offsetof(struct user_regs_struct, reg) }
+
+typedef enum {
+    SYLVAN_EXPR_CONST,
+    SYLVAN_EXPR_REG,        /* arg is the offset in struct user_regs_struct */
+    SYLVAN_EXPR_LOAD,       /* replaces the address on top with size bytes read from it */
+    SYLVAN_EXPR_NEG,
+    SYLVAN_EXPR_LNOT,
+    SYLVAN_EXPR_BNOT,
+    SYLVAN_EXPR_MUL,
+    SYLVAN_EXPR_DIV,
+    SYLVAN_EXPR_MOD,
+    SYLVAN_EXPR_ADD,
+    SYLVAN_EXPR_SUB,
+    SYLVAN_EXPR_SHL,
+    SYLVAN_EXPR_SHR,
+    SYLVAN_EXPR_LT,
+    SYLVAN_EXPR_LE,
+    SYLVAN_EXPR_GT,
+    SYLVAN_EXPR_GE,
+    SYLVAN_EXPR_EQ,
+    SYLVAN_EXPR_NE,
+    SYLVAN_EXPR_BAND,
+    SYLVAN_EXPR_XOR,
+    SYLVAN_EXPR_BOR,
+    SYLVAN_EXPR_AND,        /* jumps to arg keeping 0 if top is 0, pops otherwise */
+    SYLVAN_EXPR_OR,         /* jumps to arg with 1 if top isn't 0, pops otherwise */
+    SYLVAN_EXPR_BOOL,
+} sylvan_expr_opcode_t;
+
+struct sylvan_expr_op {
+    sylvan_expr_opcode_t op;
+    uint8_t size;           /* load only */
+    bool is_signed;         /* load only */
+    int64_t arg;
+};
+
+struct sylvan_expr {
+    struct sylvan_expr_op *ops;
+    size_t count;
+    size_t capacity;
+};
+
+struct sylvan_expr_parser {
+    const char *src;
+    const char *pos;
+    struct sylvan_expr *expr;
+    int sp;                 /* operand stack depth at this point of the program */
+    int nesting;
+};
+
+static const struct {
+    const char *name;
+    size_t offset;
+} sylvan_expr_regs[] = {
+    REG_OFFSET(rax), REG_OFFSET(rbx), REG_OFFSET(rcx), REG_OFFSET(rdx),
+    REG_OFFSET(rsi), REG_OFFSET(rdi), REG_OFFSET(rbp), REG_OFFSET(rsp),
+    REG_OFFSET(r8),  REG_OFFSET(r9),  REG_OFFSET(r10), REG_OFFSET(r11),
+    REG_OFFSET(r12), REG_OFFSET(r13), REG_OFFSET(r14), REG_OFFSET(r15),
+    REG_OFFSET(rip), REG_OFFSET(eflags), REG_OFFSET(orig_rax),
+    REG_OFFSET(fs_base), REG_OFFSET(gs_base),
+};
+
+static const struct {
+    const char *name;
+    uint8_t size;
+    bool is_signed;
+} sylvan_expr_types[] = {
+    { "u8", 1, false }, { "u16", 2, false }, { "u32", 4, false }, { "u64", 8, false },
+    { "i8", 1, true },  { "i16", 2, true },  { "i32", 4, true },  { "i64", 8, true },
+};
+
+/* two character operators come first so they win over their prefixes */
+static const struct {
+    const char *token;
+    int prec;
+    sylvan_expr_opcode_t op;
+} sylvan_expr_binops[] = {
+    { "||", 1, SYLVAN_EXPR_OR },  { "&&", 2, SYLVAN_EXPR_AND },
+    { "==", 6, SYLVAN_EXPR_EQ },  { "!=", 6, SYLVAN_EXPR_NE },
+    { "<=", 7, SYLVAN_EXPR_LE },  { ">=", 7, SYLVAN_EXPR_GE },
+    { "<<", 8, SYLVAN_EXPR_SHL }, { ">>", 8, SYLVAN_EXPR_SHR },
+    { "|", 3, SYLVAN_EXPR_BOR },  { "^", 4, SYLVAN_EXPR_XOR },  { "&", 5, SYLVAN_EXPR_BAND },
+    { "<", 7, SYLVAN_EXPR_LT },   { ">", 7, SYLVAN_EXPR_GT },
+    { "+", 9, SYLVAN_EXPR_ADD },  { "-", 9, SYLVAN_EXPR_SUB },
+    { "*", 10, SYLVAN_EXPR_MUL }, { "/", 10, SYLVAN_EXPR_DIV }, { "%", 10, SYLVAN_EXPR_MOD },
+};
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+static sylvan_code_t sylvan_expr_parse_binary(struct sylvan_expr_parser *p, int min_prec);
+
+/**
+ * reports a syntax error at the current position
+ */
+static sylvan_code_t
+sylvan_expr_syntax_error(struct sylvan_expr_parser *p, const char *what) {
+    return sylvan_set_message(SYLVANC_EXPR_SYNTAX, "%s at column %ld of '%s'", what, (long)(p->pos - p->src) + 1, p->src);
+}
+
+static void
+sylvan_expr_skip_space(struct sylvan_expr_parser *p) {
+    while (isspace((unsigned char)*p->pos))
+        p->pos++;
+}
+
+/**
+ * reads an identifier into buf, returns its length or 0 if there is none at the current position
+ */
+static size_t
+sylvan_expr_ident(struct sylvan_expr_parser *p, char *buf, size_t size) {
+    const char *start = p->pos;
+    if (!isalpha((unsigned char)*start) && *start != '_')
+        return 0;
+
+    const char *end = start;
+    while (isalnum((unsigned char)*end) || *end == '_')
+        end++;
+
+    size_t len = end - start;
+    if (len >= size)
+        len = size - 1;
+    memcpy(buf, start, len);
+    buf[len] = '\0';
+    p->pos = end;
+    return len;
+}
+
+/**
+ * appends an instruction and tracks the operand stack depth
+ */
+static sylvan_code_t
+sylvan_expr_emit(struct sylvan_expr_parser *p, sylvan_expr_opcode_t op, int64_t arg, int stack_effect) {
+    struct sylvan_expr *expr = p->expr;
+
+    if (expr->count == expr->capacity) {
+        size_t capacity = expr->capacity ? expr->capacity * 2 : 16;
+        struct sylvan_expr_op *ops = realloc(expr->ops, capacity * sizeof(struct sylvan_expr_op));
+        if (!ops)
+            return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+        expr->ops = ops;
+        expr->capacity = capacity;
+    }
+
+    p->sp += stack_effect;
+    if (p->sp > SYLVAN_EXPR_STACK)
+        return sylvan_expr_syntax_error(p, "expression too complex");
+
+    expr->ops[expr->count++] = (struct sylvan_expr_op){ .op = op, .arg = arg };
+    return SYLVANC_OK;
+}
+
+/**
+ * parses the optional (type*) after a dereference, defaults to u64
+ */
+static sylvan_code_t
+sylvan_expr_parse_cast(struct sylvan_expr_parser *p, uint8_t *size, bool *is_signed) {
+    *size = 8;
+    *is_signed = false;
+
+    const char *save = p->pos;
+    sylvan_expr_skip_space(p);
+    if (*p->pos != '(')
+        goto plain;
+    p->pos++;
+    sylvan_expr_skip_space(p);
+
+    char name[8];
+    if (!sylvan_expr_ident(p, name, sizeof(name)))
+        goto plain;
+
+    size_t i;
+    for (i = 0; i < ARRAY_LEN(sylvan_expr_types); i++)
+        if (strcmp(name, sylvan_expr_types[i].name) == 0)
+            break;
+    if (i == ARRAY_LEN(sylvan_expr_types))
+        goto plain;     /* a parenthesized address like *(rsi+8) */
+
+    sylvan_expr_skip_space(p);
+    if (*p->pos++ != '*')
+        return sylvan_expr_syntax_error(p, "expected '*' in cast");
+    sylvan_expr_skip_space(p);
+    if (*p->pos++ != ')')
+        return sylvan_expr_syntax_error(p, "expected ')' after cast");
+
+    *size = sylvan_expr_types[i].size;
+    *is_signed = sylvan_expr_types[i].is_signed;
+    return SYLVANC_OK;
+
+plain:
+    p->pos = save;
+    return SYLVANC_OK;
+}
+
+static sylvan_code_t
+sylvan_expr_parse_unary(struct sylvan_expr_parser *p) {
+    sylvan_code_t code;
+
+    if (++p->nesting > SYLVAN_EXPR_NESTING)
+        return sylvan_expr_syntax_error(p, "expression nested too deeply");
+
+    sylvan_expr_skip_space(p);
+    char c = *p->pos;
+
+    if (c == '-' || c == '!' || c == '~') {
+        p->pos++;
+        if ((code = sylvan_expr_parse_unary(p)))
+            return code;
+        code = sylvan_expr_emit(p, c == '-' ? SYLVAN_EXPR_NEG : c == '!' ? SYLVAN_EXPR_LNOT : SYLVAN_EXPR_BNOT, 0, 0);
+    }
+    else
+    if (c == '*') {
+        uint8_t size;
+        bool is_signed;
+        p->pos++;
+        if ((code = sylvan_expr_parse_cast(p, &size, &is_signed)))
+            return code;
+        if ((code = sylvan_expr_parse_unary(p)))
+            return code;
+        if (!(code = sylvan_expr_emit(p, SYLVAN_EXPR_LOAD, 0, 0))) {
+            p->expr->ops[p->expr->count - 1].size = size;
+            p->expr->ops[p->expr->count - 1].is_signed = is_signed;
+        }
+    }
+    else
+    if (c == '(') {
+        p->pos++;
+        if ((code = sylvan_expr_parse_binary(p, 1)))
+            return code;
+        sylvan_expr_skip_space(p);
+        if (*p->pos != ')')
+            return sylvan_expr_syntax_error(p, "expected ')'");
+        p->pos++;
+    }
+    else
+    if (isdigit((unsigned char)c)) {
+        char *end;
+        int64_t value = (int64_t)strtoull(p->pos, &end, 0);
+        if (isalnum((unsigned char)*end) || *end == '_')
+            return sylvan_expr_syntax_error(p, "invalid number");
+        p->pos = end;
+        code = sylvan_expr_emit(p, SYLVAN_EXPR_CONST, value, 1);
+    }
+    else {
+        char name[16];
+        const char *start = p->pos;
+        if (!sylvan_expr_ident(p, name, sizeof(name)))
+            return sylvan_expr_syntax_error(p, *p->pos ? "unexpected character" : "unexpected end of expression");
+
+        size_t i;
+        for (i = 0; i < ARRAY_LEN(sylvan_expr_regs); i++)
+            if (strcmp(name, sylvan_expr_regs[i].name) == 0)
+                break;
+        if (i == ARRAY_LEN(sylvan_expr_regs)) {
+            p->pos = start;
+            return sylvan_expr_syntax_error(p, "unknown register");
+        }
+        code = sylvan_expr_emit(p, SYLVAN_EXPR_REG, (int64_t)sylvan_expr_regs[i].offset, 1);
+    }
+
+    p->nesting--;
+    return code;
+}
+
+/**
+ * precedence climbing over sylvan_expr_binops, && and || compile to short circuit jumps
+ */
+static sylvan_code_t
+sylvan_expr_parse_binary(struct sylvan_expr_parser *p, int min_prec) {
+    sylvan_code_t code;
+
+    if ((code = sylvan_expr_parse_unary(p)))
+        return code;
+
+    for (;;) {
+        sylvan_expr_skip_space(p);
+
+        size_t i;
+        for (i = 0; i < ARRAY_LEN(sylvan_expr_binops); i++)
+            if (strncmp(p->pos, sylvan_expr_binops[i].token, strlen(sylvan_expr_binops[i].token)) == 0)
+                break;
+        if (i == ARRAY_LEN(sylvan_expr_binops) || sylvan_expr_binops[i].prec < min_prec)
+            return SYLVANC_OK;
+
+        sylvan_expr_opcode_t op = sylvan_expr_binops[i].op;
+        p->pos += strlen(sylvan_expr_binops[i].token);
+
+        if (op == SYLVAN_EXPR_AND || op == SYLVAN_EXPR_OR) {
+            if ((code = sylvan_expr_emit(p, op, 0, -1)))
+                return code;
+            size_t jump = p->expr->count - 1;
+            if ((code = sylvan_expr_parse_binary(p, sylvan_expr_binops[i].prec + 1)))
+                return code;
+            if ((code = sylvan_expr_emit(p, SYLVAN_EXPR_BOOL, 0, 0)))
+                return code;
+            p->expr->ops[jump].arg = (int64_t)p->expr->count;
+            continue;
+        }
+
+        if ((code = sylvan_expr_parse_binary(p, sylvan_expr_binops[i].prec + 1)))
+            return code;
+        if ((code = sylvan_expr_emit(p, op, 0, -1)))
+            return code;
+    }
+}
+
+/**
+ * compiles src into a program for sylvan_expr_eval
+ * values are signed 64 bit, registers use their 64 bit names and
+ * *(u8*) ... *(i64*) read memory, a bare * reads a u64
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_expr_compile(const char *src, struct sylvan_expr **exprp) {
+
+    assert(src && exprp); // should have been checked by the caller
+
+    struct sylvan_expr *expr = calloc(1, sizeof(struct sylvan_expr));
+    if (!expr)
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    struct sylvan_expr_parser p = { .src = src, .pos = src, .expr = expr };
+
+    sylvan_code_t code = sylvan_expr_parse_binary(&p, 1);
+    if (!code) {
+        sylvan_expr_skip_space(&p);
+        if (*p.pos)
+            code = sylvan_expr_syntax_error(&p, "unexpected character");
+    }
+
+    if (code) {
+        sylvan_expr_destroy(expr);
+        return code;
+    }
+
+    *exprp = expr;
+    return SYLVANC_OK;
+}
+
+/**
+ * runs a compiled expression against the registers and memory of the stopped process
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_expr_eval(struct sylvan_inferior *inf, const struct sylvan_expr *expr, int64_t *result) {
+
+    assert(inf && expr && result); // should have been checked by the caller
+
+    sylvan_code_t code;
+    if ((code = sylvan_regs_fetch(inf)))
+        return code;
+
+    int64_t stack[SYLVAN_EXPR_STACK];
+    int sp = 0;
+
+    for (size_t i = 0; i < expr->count; i++) {
+        const struct sylvan_expr_op *op = &expr->ops[i];
+        int64_t a = sp >= 2 ? stack[sp - 2] : 0;
+        int64_t b = sp >= 1 ? stack[sp - 1] : 0;
+        uint64_t value;
+
+        switch (op->op) {
+            case SYLVAN_EXPR_CONST:
+                stack[sp++] = op->arg;
+                continue;
+            case SYLVAN_EXPR_REG:
+                stack[sp++] = (int64_t)*(unsigned long long *)((char *)&inf->thread->regs + op->arg);
+                continue;
+            case SYLVAN_EXPR_LOAD:
+                value = 0;
+                if ((code = sylvan_read_memory(inf, (uintptr_t)b, &value, op->size)))
+                    return code;
+                if (op->is_signed && op->size < 8) {
+                    int shift = 64 - op->size * 8;
+                    stack[sp - 1] = (int64_t)(value << shift) >> shift;
+                } else
+                    stack[sp - 1] = (int64_t)value;
+                continue;
+            case SYLVAN_EXPR_NEG:   stack[sp - 1] = (int64_t)(0 - (uint64_t)b); continue;
+            case SYLVAN_EXPR_LNOT:  stack[sp - 1] = !b; continue;
+            case SYLVAN_EXPR_BNOT:  stack[sp - 1] = ~b; continue;
+            case SYLVAN_EXPR_BOOL:  stack[sp - 1] = b != 0; continue;
+            case SYLVAN_EXPR_AND:
+                if (!b)
+                    i = op->arg - 1;
+                else
+                    sp--;
+                continue;
+            case SYLVAN_EXPR_OR:
+                if (b) {
+                    stack[sp - 1] = 1;
+                    i = op->arg - 1;
+                } else
+                    sp--;
+                continue;
+            default:
+                break;
+        }
+
+        /* binary operators */
+        switch (op->op) {
+            case SYLVAN_EXPR_MUL:   a = (int64_t)((uint64_t)a * (uint64_t)b); break;
+            case SYLVAN_EXPR_DIV:
+            case SYLVAN_EXPR_MOD:
+                if (!b)
+                    return sylvan_set_code(SYLVANC_EXPR_DIVISION_BY_ZERO);
+                if (b == -1)
+                    a = op->op == SYLVAN_EXPR_DIV ? (int64_t)(0 - (uint64_t)a) : 0;
+                else
+                    a = op->op == SYLVAN_EXPR_DIV ? a / b : a % b;
+                break;
+            case SYLVAN_EXPR_ADD:   a = (int64_t)((uint64_t)a + (uint64_t)b); break;
+            case SYLVAN_EXPR_SUB:   a = (int64_t)((uint64_t)a - (uint64_t)b); break;
+            case SYLVAN_EXPR_SHL:   a = (int64_t)((uint64_t)a << (b & 63)); break;
+            case SYLVAN_EXPR_SHR:   a = (int64_t)((uint64_t)a >> (b & 63)); break;
+            case SYLVAN_EXPR_LT:    a = a < b; break;
+            case SYLVAN_EXPR_LE:    a = a <= b; break;
+            case SYLVAN_EXPR_GT:    a = a > b; break;
+            case SYLVAN_EXPR_GE:    a = a >= b; break;
+            case SYLVAN_EXPR_EQ:    a = a == b; break;
+            case SYLVAN_EXPR_NE:    a = a != b; break;
+            case SYLVAN_EXPR_BAND:  a = a & b; break;
+            case SYLVAN_EXPR_XOR:   a = a ^ b; break;
+            case SYLVAN_EXPR_BOR:   a = a | b; break;
+            default:
+                assert(0); /* this shouldn't happen */
+        }
+        stack[--sp - 1] = a;
+    }
+
+    assert(sp == 1);
+    *result = stack[0];
+    return SYLVANC_OK;
+}
+
+SYLVAN_INTERNAL void
+sylvan_expr_destroy(struct sylvan_expr *expr) {
+    if (!expr)
+        return;
+    free(expr->ops);
+    free(expr);
+}
\ No newline at end of file
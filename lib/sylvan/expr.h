@@ -0,0 +1,13 @@
+#ifndef SYLVAN_EXPR_H
+#define SYLVAN_EXPR_H
+
+#include <stdint.h>
+#include <sylvan/inferior.h>
+
+struct sylvan_expr;
+
+sylvan_code_t sylvan_expr_compile(const char *src, struct sylvan_expr **exprp);
+sylvan_code_t sylvan_expr_eval(struct sylvan_inferior *inf, const struct sylvan_expr *expr, int64_t *result);
+void sylvan_expr_destroy(struct sylvan_expr *expr);
+
+#endif /* SYLVAN_EXPR_H */
@@ -0,0 +1,195 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+
+#include <sylvan/inferior.h>
+#include "breakpoint.h"
+#include "error.h"
+#include "fork.h"
+#include "solib.h"
+#include "sylvan.h"
+#include "symbol.h"
+#include "syscall.h"
+#include "thread.h"
+
+/**
+ * takes inf's breakpoints out of the child pid and lets it go, a forked child got a copy of the int3s
+ * and a vfork child shares them with the parent, they go back in at PTRACE_EVENT_VFORK_DONE
+ */
+static sylvan_code_t
+sylvan_fork_detach_child(struct sylvan_inferior *inf, pid_t pid, bool vfork) {
+
+    sylvan_code_t code = sylvan_breakpoint_strip(inf, pid, false);
+
+    if (!code && vfork) {
+        struct sylvan_breakpoint *breakpoint, *tmp;
+        HASH_ITER(hh, inf->breakpoints, breakpoint, tmp)
+            if (breakpoint->type == SYLVAN_BREAKPOINT_SOFTWARE)
+                breakpoint->is_enabled_phy = false;
+    }
+
+    /* detached even if stripping failed, keeping it stopped forever would be worse */
+    if (ptrace(PTRACE_DETACH, pid, NULL, NULL) < 0 && errno != ESRCH && !code)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace detach");
+
+    return code;
+}
+
+/**
+ * moves inf over to the child pid, the parent is detached with its breakpoints taken out
+ * a forked child keeps the int3s it copied, a vfork child runs without any until it execs
+ */
+static sylvan_code_t
+sylvan_fork_follow_child(struct sylvan_inferior *inf, pid_t pid, bool vfork, struct sylvan_thread **threadp) {
+
+    sylvan_code_t code;
+    if ((code = sylvan_thread_stop_all(inf)))
+        return code;
+
+    if ((code = sylvan_breakpoint_strip(inf, inf->pid, true)))
+        return code;
+
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp) {
+        if ((code = sylvan_thread_regs_flush(thread)))
+            return code;
+        if (ptrace(PTRACE_DETACH, thread->tid, NULL, (void *)(long)thread->pending_signal) < 0 && errno != ESRCH)
+            return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace detach");
+    }
+
+    sylvan_thread_clear(inf);
+    inf->pid = pid;
+    inf->interrupting = false;
+
+    if ((code = sylvan_thread_add(inf, pid, &thread)))
+        return code;
+
+    thread->is_stopped = true;
+    inf->thread = thread;
+    *threadp = thread;
+
+    /* what's inserted is in the parent's memory, which was just stripped, exec inserts it all again */
+    if (vfork) {
+        sylvan_breakpoint_reset_phybp(inf);
+        sylvan_solib_clear(inf);
+        return SYLVANC_OK;
+    }
+
+    return sylvan_breakpoint_load_hwbp(inf, thread);
+}
+
+/**
+ * makes the child pid a new inferior with inf's executable, symbols and a copy of its breakpoints
+ * and resumes it, its stops reach the event loop like those of any inferior running in the background
+ */
+static sylvan_code_t
+sylvan_fork_add_inferior(struct sylvan_inferior *inf, pid_t pid, bool vfork) {
+
+    struct sylvan_inferior *child;
+    sylvan_code_t code;
+    if ((code = sylvan_inferior_create(&child)))
+        return code;
+
+    child->pid = pid;
+    child->status = SYLVAN_INFSTATE_STOPPED;
+    child->is_attached = inf->is_attached;
+    child->non_stop = inf->non_stop;
+    child->follow_fork = inf->follow_fork;
+    child->load_bias = inf->load_bias;
+    memcpy(child->syscalls_traced, inf->syscalls_traced, sizeof(child->syscalls_traced));
+    memcpy(child->syscalls_filtered, inf->syscalls_filtered, sizeof(child->syscalls_filtered));
+
+    struct sylvan_thread *thread = NULL;
+    if ((inf->realpath && !(child->realpath = strdup(inf->realpath))) ||
+        (inf->args && !(child->args = strdup(inf->args))))
+        code = sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    if (!code)
+        code = sylvan_sym_load_tables(child);
+    if (!code)
+        code = sylvan_thread_add(child, pid, &thread);
+    if (!code) {
+        thread->is_stopped = true;
+        child->thread = thread;
+        code = sylvan_breakpoint_copy_all(child, inf, vfork);
+    }
+
+    if (code) {
+        /* forgotten without touching the process, which goes like one that isn't followed */
+        child->pid = 0;
+        child->status = SYLVAN_INFSTATE_NONE;
+        sylvan_thread_clear(child);
+        sylvan_inferior_destroy(child);
+        sylvan_fork_detach_child(inf, pid, vfork);
+        return code;
+    }
+
+    /* the libraries are where they were in the parent, the link_map it inherited lists them */
+    child->r_debug = inf->r_debug;
+    if ((code = sylvan_breakpoint_load_hwbp(child, thread)) ||
+        (child->r_debug && (code = sylvan_solib_update(child))))
+        return code;
+
+    if ((code = sylvan_thread_resume(child, thread, PTRACE_CONT)) && errno != ESRCH)
+        return code;
+
+    child->status = SYLVAN_INFSTATE_RUNNING;
+    return SYLVANC_OK;
+}
+
+/**
+ * see lib/sylvan/fork.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_fork_follow(struct sylvan_inferior *inf, struct sylvan_thread *thread, bool vfork,
+                   struct sylvan_thread **threadp) {
+
+    assert(inf && thread && threadp); // should have been checked by the caller
+
+    *threadp = thread;
+
+    unsigned long msg;
+    if (ptrace(PTRACE_GETEVENTMSG, thread->tid, NULL, &msg) < 0)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace get event message");
+
+    pid_t pid = (pid_t)msg;
+
+    int status;
+    sylvan_code_t code;
+    if ((code = sylvan_thread_wait_new(pid, &status)))
+        return code;
+
+    /* killed before its first instruction */
+    if (!WIFSTOPPED(status))
+        return SYLVANC_OK;
+
+    /* the filters are inherited, a process let go with one would get ENOSYS from its traced system calls */
+    sylvan_follow_fork_t mode = sylvan_syscall_filtering(inf) ? SYLVAN_FOLLOW_FORK_BOTH : inf->follow_fork;
+
+    switch (mode) {
+        case SYLVAN_FOLLOW_FORK_CHILD:
+            return sylvan_fork_follow_child(inf, pid, vfork, threadp);
+        case SYLVAN_FOLLOW_FORK_BOTH:
+            return sylvan_fork_add_inferior(inf, pid, vfork);
+        default:
+            return sylvan_fork_detach_child(inf, pid, vfork);
+    }
+}
+
+/**
+ * see lib/sylvan/fork.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_fork_vfork_done(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    return sylvan_breakpoint_setall_phybp(inf);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef SYLVAN_FORK_H
+#define SYLVAN_FORK_H
+
+#include <stdbool.h>
+#include <sylvan/inferior.h>
+
+/**
+ * handles the PTRACE_EVENT_FORK or PTRACE_EVENT_VFORK stop of thread as inf->follow_fork says, the child
+ * is stopped at its first instruction until then. sets *threadp to the thread the caller resumes, which is
+ * the child's once inf follows it, thread and the rest of the parent are detached then
+ */
+sylvan_code_t sylvan_fork_follow(struct sylvan_inferior *inf, struct sylvan_thread *thread, bool vfork,
+                                 struct sylvan_thread **threadp);
+
+/**
+ * handles the PTRACE_EVENT_VFORK_DONE stop of the parent once its vfork child exec'd or exited,
+ * the breakpoints taken out of the memory they shared go back in
+ */
+sylvan_code_t sylvan_fork_vfork_done(struct sylvan_inferior *inf);
+
+#endif /* SYLVAN_FORK_H */
\ No newline at end of file
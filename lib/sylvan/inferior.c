@@ -1,3 +1,5 @@
+#define _GNU_SOURCE
+
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
@@ -8,44 +10,247 @@
 #include <string.h>
 #include <unistd.h>
 #include <limits.h>
+#include <fcntl.h>
 #include <sys/ptrace.h>
+#include <sys/uio.h>
 #include <sys/user.h>
 #include <sys/wait.h>
 #include <wordexp.h>
 #include <sys/personality.h>
+#include <time.h>
 
 #include <sylvan/inferior.h>
 #include "breakpoint.h"
+#include "displaced.h"
 #include "error.h"
+#include "event.h"
+#include "expr.h"
+#include "fork.h"
+#include "inferior.h"
+#include "memcache.h"
+#include "profile.h"
+#include "solib.h"
+#include "sylvan.h"
 #include "utils.h"
 #include "symbol.h"
+#include "syscall.h"
+#include "thread.h"
+#include "unwind.h"
+
+#define SYLVAN_EFLAGS_RF (1UL << 16)    /* resume flag, suppresses instruction breakpoints for one instruction */
 
 static int sylvan_inferior_idx = 0;
 static int sylvan_inferior_count = 0;
+static struct sylvan_inferior *sylvan_inferiors = NULL;   /* in id order */
 
 
 /**
- * checks for a change in the state of the process and updates the inferior state
+ * fills the register cache of the current thread, at most one PTRACE_GETREGS per stop
  */
-static sylvan_code_t sylvan_update_inf_status(struct sylvan_inferior *inf, int *status, bool blocking) {
+SYLVAN_INTERNAL sylvan_code_t sylvan_regs_fetch(struct sylvan_inferior *inf) {
 
     assert(inf != NULL); /* inf should not be NULL in an internal library function */
 
-    if (inf->pid <= 0)
+    if (inf->thread == NULL)
         return sylvan_set_message(SYLVANC_INVALID_STATE, "Program is not being run");
 
-    int result, status_;
-    do {
-        result = waitpid(inf->pid, &status_, blocking ? 0 : WNOHANG);
-    } while (result == -1 && errno == EINTR);
+    return sylvan_thread_regs_fetch(inf->thread);
+}
 
-    if (!result)   /* no change in state */
+/**
+ * writes the register cache of the current thread back if it was modified
+ */
+SYLVAN_INTERNAL sylvan_code_t sylvan_regs_flush(struct sylvan_inferior *inf) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    if (inf->thread == NULL)
         return SYLVANC_OK;
 
-    if (result == -1) {
-        if (errno != ECHILD)
+    return sylvan_thread_regs_flush(inf->thread);
+}
+
+/**
+ * inserts the breakpoints into a new process image, the symbol tables are those of its executable already
+ */
+static sylvan_code_t sylvan_start_breakpoints(struct sylvan_inferior *inf) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    sylvan_code_t code;
+    if ((code = sylvan_breakpoint_reset_phybp(inf)))
+        return code;
+
+    if ((code = sylvan_solib_find_load_bias(inf)))
+        return code;
+
+    /* breakpoints on functions of the executable move with it, those in libraries wait for sylvan_solib_start */
+    if ((code = sylvan_breakpoint_resolve(inf, true)))
+        return code;
+
+    if ((code = sylvan_breakpoint_setall_phybp(inf)))
+        return code;
+
+    if ((code = sylvan_solib_start(inf)))
+        return code;
+
+    return SYLVANC_OK;
+}
+
+/**
+ * the process replaced its image with an exec, the symbols are loaded from the new executable
+ * and the breakpoints set on functions are looked up again in it
+ */
+static sylvan_code_t sylvan_follow_exec(struct sylvan_inferior *inf) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    char *path = NULL;
+    if (sylvan_real_path_pid(inf->pid, &path) == SYLVANC_OK) {
+        free(inf->realpath);
+        inf->realpath = path;
+    }
+
+    sylvan_dstep_reset(inf);
+    sylvan_memcache_invalidate(inf);
+    sylvan_solib_clear(inf);
+
+    /* where sylvan_advance and the like were headed is gone with the old image */
+    if (inf->run_to_breakpoint)
+        sylvan_breakpoint_delete(inf, inf->run_to_breakpoint);
+
+    sylvan_code_t code;
+    if ((code = sylvan_sym_load_tables(inf)))
+        return code;
+
+    return sylvan_start_breakpoints(inf);
+}
+
+/**
+ * single steps the current thread and waits for it, the other threads stay where they are
+ * a thread it starts on the way is left stopped, unless the inferior is in non-stop mode
+ */
+SYLVAN_INTERNAL sylvan_code_t sylvan_step(struct sylvan_inferior *inf, int *status) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    struct sylvan_thread *thread = inf->thread;
+    if (thread == NULL)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Program is not being run");
+
+    sylvan_code_t code;
+    int status_;
+    for (;;) {
+        if ((code = sylvan_thread_resume(inf, thread, PTRACE_SINGLESTEP)))
+            return code;
+
+        int result;
+        do {
+            result = waitpid(thread->tid, &status_, __WALL);
+        } while (result == -1 && errno == EINTR);
+
+        if (result == -1)
             return sylvan_set_errno_msg(SYLVANC_WAITPID_FAILED, "waitpid");
 
+        if (!WIFSTOPPED(status_))
+            break;
+
+        thread->is_stopped = true;
+
+        /* clone and a late interrupt stop before the instruction is done, step on */
+        if (status_ >> 8 == (SIGTRAP | (PTRACE_EVENT_CLONE << 8))) {
+            struct sylvan_thread *clone;
+            if ((code = sylvan_thread_add_clone(inf, thread, &clone)))
+                return code;
+            if (inf->non_stop && clone && !clone->has_pending &&
+                (code = sylvan_thread_resume(inf, clone, PTRACE_CONT)) && errno != ESRCH)
+                return code;
+            continue;
+        }
+
+        /* a fork is followed on the way too, following the child ends the step at its first instruction */
+        int event = SYLVAN_PTRACE_EVENT(status_);
+        if (WSTOPSIG(status_) == SIGTRAP && (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK)) {
+            struct sylvan_thread *stopped;
+            if ((code = sylvan_fork_follow(inf, thread, event == PTRACE_EVENT_VFORK, &stopped)))
+                return code;
+            if (stopped == thread)
+                continue;
+            thread = stopped;
+            status_ = (SIGTRAP << 8) | 0x7f;
+            break;
+        }
+
+        if (WSTOPSIG(status_) == SIGTRAP && event == PTRACE_EVENT_VFORK_DONE) {
+            if ((code = sylvan_fork_vfork_done(inf)))
+                return code;
+            continue;
+        }
+
+        /* a system call a filter traps stops before it runs, the step runs it */
+        if (WSTOPSIG(status_) == SIGTRAP && event == PTRACE_EVENT_SECCOMP)
+            continue;
+
+        /*
+         * a child that exited stops the step before the instruction ran, a followed fork makes that common
+         * the program still gets the signal once it's continued, a pre-forking server reaps its workers in the handler
+         */
+        if (WSTOPSIG(status_) == SIGCHLD && !event) {
+            if (!thread->pending_signal)
+                thread->pending_signal = SIGCHLD;
+            continue;
+        }
+
+        if (SYLVAN_PTRACE_EVENT(status_) != PTRACE_EVENT_STOP || WSTOPSIG(status_) != SIGTRAP || inf->interrupting)
+            break;
+    }
+
+    if (status)
+        *status = status_;
+
+    /* a thread that isn't the leader can exit on its own, the rest of the process is still there */
+    if (!WIFSTOPPED(status_) && thread->tid != inf->pid) {
+        pid_t tid = thread->tid;
+        sylvan_thread_remove(inf, thread);
+        inf->thread = sylvan_thread_find(inf, inf->pid);
+        return sylvan_set_message(SYLVANC_PROC_STOPPED, "thread %d exited", tid);
+    }
+
+    if ((code = sylvan_set_wait_status(inf, status_)))
+        return code;
+
+    /* the instruction was an exec, the other threads are gone with the old image */
+    if (status_ >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) {
+        struct sylvan_thread *other, *tmp;
+        HASH_ITER(hh, inf->threads, other, tmp)
+            if (other != thread)
+                sylvan_thread_remove(inf, other);
+        return sylvan_follow_exec(inf);
+    }
+
+    return SYLVANC_OK;
+}
+
+/**
+ * waits for a change in the state of the process and updates the inferior state
+ * the thread it came from becomes the current one. doesn't look at why the process stopped
+ */
+SYLVAN_INTERNAL sylvan_code_t sylvan_wait_inf(struct sylvan_inferior *inf, int *status, bool blocking) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    if (inf->pid <= 0)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Program is not being run");
+
+    struct sylvan_inferior *owner;
+    struct sylvan_thread *thread;
+    int status_;
+    sylvan_code_t code;
+    if ((code = sylvan_thread_wait(inf, blocking, &owner, &thread, &status_))) {
+        int pid = inf->pid;
+        if (code != SYLVANC_WAITPID_FAILED || errno != ECHILD)
+            return code;
+
         if (kill(inf->pid, 0) != -1)
             return sylvan_set_message(SYLVANC_PROC_NOT_ATTACHED, "Process %d exists but is not being traced", inf->pid);
 
@@ -55,55 +260,180 @@ static sylvan_code_t sylvan_update_inf_status(struct sylvan_inferior *inf, int *
         inf->status = SYLVAN_INFSTATE_NONE;
         inf->pid = 0;
         inf->is_attached = false;
-        return sylvan_set_message(SYLVANC_PROC_NOT_FOUND, "Process %d doesn't exist", inf->pid);
+        sylvan_thread_clear(inf);
+        return sylvan_set_message(SYLVANC_PROC_NOT_FOUND, "Process %d doesn't exist", pid);
     }
 
+    if (owner == NULL)   /* no change in state */
+        return SYLVANC_OK;
+
+    inf->thread = thread;
+
+    if (status)
+        *status = status_;
+
+    return sylvan_set_wait_status(inf, status_);
+}
+
+/**
+ * updates the inferior state from a wait status of its process
+ * returns SYLVANC_PROC_EXITED or SYLVANC_PROC_TERMINATED if the process is gone
+ */
+SYLVAN_INTERNAL sylvan_code_t sylvan_set_wait_status(struct sylvan_inferior *inf, int status) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    int pid = inf->pid;
+
     /* there's a status change */
-    if (WIFEXITED(status_)) {
-        int pid = inf->pid;
+    if (WIFEXITED(status)) {
         inf->status = SYLVAN_INFSTATE_EXITED;
         inf->pid = 0;
-        return sylvan_set_message(SYLVANC_PROC_EXITED, "Process %d exited with code %d", pid, WEXITSTATUS(status_));
+        sylvan_thread_clear(inf);
+        return sylvan_set_message(SYLVANC_PROC_EXITED, "Process %d exited with code %d", pid, WEXITSTATUS(status));
     }
-    if (WIFSIGNALED(status_)) {
+    if (WIFSIGNALED(status)) {
         inf->status = SYLVAN_INFSTATE_TERMINATED;
         inf->pid = 0;
-        return sylvan_set_message(SYLVANC_PROC_TERMINATED, "Process %d terminated by signal %d", inf->pid, WTERMSIG(status_));
+        sylvan_thread_clear(inf);
+        return sylvan_set_message(SYLVANC_PROC_TERMINATED, "Process %d terminated by signal %d", pid, WTERMSIG(status));
     }
-    if (WIFSTOPPED(status_)) {
-        // temporary fix to get it to return the breakpoint addr
+    if (WIFSTOPPED(status))
         inf->status = SYLVAN_INFSTATE_STOPPED;
-        if (blocking) {
-            siginfo_t info;
-            if (ptrace(PTRACE_GETSIGINFO, inf->pid, NULL, &info) < 0)
-                return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace get siginfo");
-
-            struct user_regs_struct regs;
-            if (ptrace(PTRACE_GETREGS, inf->pid, NULL, &regs) < 0)
-                return sylvan_set_errno_msg(SYLVANC_PTRACE_GETREGS_FAILED, "ptrace get regs");
-
-            if (info.si_code != SI_KERNEL)
-                return sylvan_set_message(SYLVANC_PROC_STOPPED, "program stopped at %#lx", regs.rip);
-            
-            struct sylvan_breakpoint *breakpoint;
-            if (sylvan_breakpoint_find_by_addr(inf, regs.rip - 1, &breakpoint))
-                return SYLVANC_OK;
-
-            int idx = breakpoint - inf->breakpoints;
-            return sylvan_set_message(SYVLANC_BREAKPOINT_HIT, "breakpoint %d at %#lx", idx, breakpoint->addr);
-        }
-        return SYLVANC_OK;
-    }
-    if (WIFCONTINUED(status_))
+    else
+    if (WIFCONTINUED(status))
         inf->status = SYLVAN_INFSTATE_RUNNING;
     else
         assert(0); /* this shouldn't happen */
 
+    return SYLVANC_OK;
+}
+
+/**
+ * reads the monotonic clock in nanoseconds
+ */
+static uint64_t sylvan_monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * records the time of a stop, breakpoint intervals are measured from it
+ */
+static void sylvan_stamp_stop(struct sylvan_inferior *inf) {
+    inf->stop_ns = sylvan_monotonic_ns();
+}
+
+/**
+ * names the current thread in stop messages, if there is more than one
+ */
+static const char *sylvan_thread_note(struct sylvan_inferior *inf, char *buf, size_t size) {
+    if (inf->thread == NULL || HASH_COUNT(inf->threads) < 2)
+        return "";
+
+    snprintf(buf, size, " in thread %d", inf->thread->tid);
+    return buf;
+}
+
+/**
+ * reports why the current thread stopped with status. a breakpoint hit rewinds rip
+ * to the breakpoint address in the register cache
+ */
+static sylvan_code_t sylvan_stop_reason(struct sylvan_inferior *inf, int status) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    if (!WIFSTOPPED(status))
+        return SYLVANC_OK;
+
+    sylvan_stamp_stop(inf);
+
+    struct sylvan_thread *thread = inf->thread;
+    sylvan_code_t code;
+    if ((code = sylvan_regs_fetch(inf)))
+        return code;
+
+    char where[128];
+    char which[32];
+
+    /* an interrupt or a group stop, there's no siginfo for those */
+    if (SYLVAN_PTRACE_EVENT(status) == PTRACE_EVENT_STOP) {
+        inf->interrupting = false;
+        return sylvan_set_message(SYLVANC_PROC_STOPPED, "program stopped at %#lx%s%s", thread->regs.rip,
+                                  sylvan_sym_format_addr(inf, thread->regs.rip, where, sizeof(where)),
+                                  sylvan_thread_note(inf, which, sizeof(which)));
+    }
+
+    /* orig_rax has the number, rax is -ENOSYS until the system call runs */
+    if (SYLVAN_PTRACE_EVENT(status) == PTRACE_EVENT_SECCOMP)
+        return sylvan_set_message(SYLVANC_SYSCALL_ENTRY, "system call %lld at %#lx%s%s", (long long)thread->regs.orig_rax, thread->regs.rip,
+                                  sylvan_sym_format_addr(inf, thread->regs.rip, where, sizeof(where)),
+                                  sylvan_thread_note(inf, which, sizeof(which)));
+
+    siginfo_t info;
+    if (ptrace(PTRACE_GETSIGINFO, thread->tid, NULL, &info) < 0)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace get siginfo");
+
+    struct sylvan_breakpoint *breakpoint;
+    if (info.si_signo == SIGTRAP && info.si_code == TRAP_HWBKPT) {
+        if ((code = sylvan_breakpoint_find_by_dr6(inf, &breakpoint)) == SYVLANC_BREAKPOINT_NOT_FOUND)
+            return sylvan_set_message(SYLVANC_PROC_STOPPED, "program stopped at %#lx%s%s", thread->regs.rip,
+                                      sylvan_sym_format_addr(inf, thread->regs.rip, where, sizeof(where)),
+                                      sylvan_thread_note(inf, which, sizeof(which)));
+        if (code)
+            return code;
+
+        thread->stop_breakpoint = breakpoint;
+        if (breakpoint->type == SYLVAN_BREAKPOINT_WATCH)
+            return sylvan_set_message(SYVLANC_BREAKPOINT_HIT, "watchpoint %d at %#lx, program stopped at %#lx%s%s", breakpoint->id, breakpoint->addr,
+                                      thread->regs.rip, sylvan_sym_format_addr(inf, thread->regs.rip, where, sizeof(where)),
+                                      sylvan_thread_note(inf, which, sizeof(which)));
+        return sylvan_set_message(SYVLANC_BREAKPOINT_HIT, "breakpoint %d at %#lx%s%s", breakpoint->id, breakpoint->addr,
+                                  sylvan_sym_format_addr(inf, breakpoint->addr, where, sizeof(where)),
+                                  sylvan_thread_note(inf, which, sizeof(which)));
+    }
+
+    if (info.si_code != SI_KERNEL)
+        return sylvan_set_message(SYLVANC_PROC_STOPPED, "program stopped at %#lx%s%s", thread->regs.rip,
+                                  sylvan_sym_format_addr(inf, thread->regs.rip, where, sizeof(where)),
+                                  sylvan_thread_note(inf, which, sizeof(which)));
+
+    if (sylvan_breakpoint_find_by_addr(inf, thread->regs.rip - 1, &breakpoint) || breakpoint->type != SYLVAN_BREAKPOINT_SOFTWARE || !breakpoint->is_enabled_phy)
+        return SYLVANC_OK;
+
+    thread->regs.rip = breakpoint->addr;
+    thread->regs_dirty = true;
+    thread->stop_breakpoint = breakpoint;
+
+    return sylvan_set_message(SYVLANC_BREAKPOINT_HIT, "breakpoint %d at %#lx%s%s", breakpoint->id, breakpoint->addr,
+                              sylvan_sym_format_addr(inf, breakpoint->addr, where, sizeof(where)),
+                              sylvan_thread_note(inf, which, sizeof(which)));
+}
+
+/**
+ * checks for a change in the state of the process and updates the inferior state
+ * when blocking, reports why the process stopped
+ */
+static sylvan_code_t sylvan_update_inf_status(struct sylvan_inferior *inf, int *status, bool blocking) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    int status_ = 0;
+    sylvan_code_t code;
+    if ((code = sylvan_wait_inf(inf, &status_, blocking)))
+        return code;
+
     if (status)
         *status = status_;
 
-    return SYLVANC_OK;
+    if (blocking)
+        return sylvan_stop_reason(inf, status_);
 
+    if (WIFSTOPPED(status_))
+        sylvan_stamp_stop(inf);
+
+    return SYLVANC_OK;
 }
 
 /**
@@ -128,6 +458,21 @@ static void sylvan_update_wait_status(int status, struct sylvan_inferior *inf) {
         assert(0); /* this shouldn't happen */
 }
 
+/**
+ * stops a process left running by sylvan_continue_background and waits until all its threads are stopped
+ */
+static sylvan_code_t sylvan_stop_running(struct sylvan_inferior *inf) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    sylvan_code_t code;
+    if ((code = sylvan_thread_stop_all(inf)))
+        return code;
+
+    inf->status = SYLVAN_INFSTATE_STOPPED;
+    return SYLVANC_OK;
+}
+
 /**
  * kills the associated process
 */
@@ -144,21 +489,29 @@ static sylvan_code_t sylvan_kill(struct sylvan_inferior *inf) {
         inf->is_attached = false;
         inf->pid = 0;
         inf->status = SYLVAN_INFSTATE_NONE;
+        sylvan_thread_clear(inf);
         return SYLVANC_OK;
     }
     
-    int status;
-    int result;
-    do {
-        result = waitpid(inf->pid, &status, 0);
-    } while (result == -1 && errno == EINTR);
-    
-    if (result == -1)
-        return sylvan_set_errno_msg(SYLVANC_WAITPID_FAILED, "waitpid");
+    /* stops that were already queued come first, then every thread exits and the leader last */
+    for (;;) {
+        struct sylvan_inferior *owner;
+        struct sylvan_thread *thread;
+        int status;
+        sylvan_code_t code = sylvan_thread_wait(inf, true, &owner, &thread, &status);
+        if (code == SYLVANC_WAITPID_FAILED) {
+            if (errno != ECHILD)
+                return code;
+            break;
+        }
+        if (!code && owner && !WIFSTOPPED(status))
+            break;
+    }
 
     inf->is_attached = false;
     inf->pid = 0;
     inf->status = SYLVAN_INFSTATE_NONE;
+    sylvan_thread_clear(inf);
     
     return SYLVANC_OK;
 }
@@ -210,6 +563,11 @@ sylvan_code_t sylvan_inferior_create(struct sylvan_inferior **infp) {
     inf->id = sylvan_inferior_idx++;
     sylvan_inferior_count++;
 
+    struct sylvan_inferior **tail = &sylvan_inferiors;
+    while (*tail)
+        tail = &(*tail)->next;
+    *tail = inf;
+
     *infp = inf;
 
     return SYLVANC_OK;
@@ -226,9 +584,23 @@ sylvan_code_t sylvan_inferior_destroy(struct sylvan_inferior *inf) {
     if ((code = sylvan_terminate_or_detach(inf)))
         return code;
 
+    sylvan_event_forget(inf);
+
+    if ((code = sylvan_breakpoint_clearall(inf)))
+        return code;
+
+    sylvan_solib_clear(inf);
+    sylvan_memcache_destroy(inf);
+
     if ((code = sylvan_sym_destroy(inf)))
         return code;
 
+    for (struct sylvan_inferior **infp = &sylvan_inferiors; *infp; infp = &(*infp)->next)
+        if (*infp == inf) {
+            *infp = inf->next;
+            break;
+        }
+
     free(inf->realpath);
     free(inf->args);
     free(inf);
@@ -238,9 +610,75 @@ sylvan_code_t sylvan_inferior_destroy(struct sylvan_inferior *inf) {
     return SYLVANC_OK;
 }
 
+/**
+ * the first inferior, the others follow through inf->next in the order they were created
+ */
+struct sylvan_inferior *sylvan_inferior_list(void) {
+    return sylvan_inferiors;
+}
+
+/**
+ * finds the inferior with the given id
+ */
+sylvan_code_t sylvan_inferior_find(int id, struct sylvan_inferior **infp) {
+    if (!infp)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    for (struct sylvan_inferior *inf = sylvan_inferiors; inf; inf = inf->next)
+        if (inf->id == id) {
+            *infp = inf;
+            return SYLVANC_OK;
+        }
+
+    return sylvan_set_message(SYLVANC_INVALID_ARGUMENT, "No inferior with id %d", id);
+}
+
+/**
+ * starts the thread table of a new process with its leader, stopped with status
+ */
+static sylvan_code_t sylvan_start_threads(struct sylvan_inferior *inf, int status) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    sylvan_thread_clear(inf);
+
+    struct sylvan_thread *leader;
+    sylvan_code_t code;
+    if ((code = sylvan_thread_add(inf, inf->pid, &leader)))
+        return code;
+
+    leader->is_stopped = true;
+    inf->thread = leader;
+    inf->interrupting = false;
+
+    /* the stop may be the leader starting a thread */
+    if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_CLONE << 8)))
+        return sylvan_thread_add_clone(inf, leader, NULL);
+
+    return SYLVANC_OK;
+}
+
+/**
+ * resumes the stopped threads other than the current one, which is all non-stop mode keeps stopped
+ */
+static sylvan_code_t sylvan_resume_others(struct sylvan_inferior *inf) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    sylvan_code_t code;
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp) {
+        if (thread == inf->thread || !thread->is_stopped || thread->has_pending)
+            continue;
+        if ((code = sylvan_thread_resume(inf, thread, PTRACE_CONT)) && errno != ESRCH)
+            return code;
+    }
+
+    return SYLVANC_OK;
+}
 
 /**
- * attaches to a process
+ * attaches to a process and all of its threads
  */
 sylvan_code_t sylvan_attach(struct sylvan_inferior *inf, pid_t pid) {
     if (inf == NULL)
@@ -256,13 +694,17 @@ sylvan_code_t sylvan_attach(struct sylvan_inferior *inf, pid_t pid) {
     if ((code = sylvan_terminate_or_detach(inf)))
         return code;
     
-    if (ptrace(PTRACE_ATTACH, pid, NULL, NULL) < 0) {
+    /* seized rather than attached, only a seized thread can be stopped with PTRACE_INTERRUPT */
+    if (ptrace(PTRACE_SEIZE, pid, NULL, (void *)SYLVAN_PTRACE_OPTIONS) < 0) {
         if (errno == EPERM)
             return sylvan_set_message(SYLVANC_PTRACE_ATTACH_FAILED, "Permission denied to attach to process %d", pid);
         if (errno == ESRCH)
             return sylvan_set_message(SYLVANC_PROC_NOT_FOUND, "Process %d does not exist", pid);
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_ATTACH_FAILED, "ptrace attach");
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_ATTACH_FAILED, "ptrace seize");
     }
+
+    if (ptrace(PTRACE_INTERRUPT, pid, NULL, NULL) < 0 && errno != ESRCH)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_ATTACH_FAILED, "ptrace interrupt");
     
     char *path = NULL;
     sylvan_real_path_pid(pid, &path); /* don't care if it fails */
@@ -270,7 +712,7 @@ sylvan_code_t sylvan_attach(struct sylvan_inferior *inf, pid_t pid) {
     int status;
     int result;
     do {
-        result = waitpid(pid, &status, 0);
+        result = waitpid(pid, &status, __WALL);
     } while (result == -1 && errno == EINTR);
     
     if (result == -1) {
@@ -298,16 +740,27 @@ sylvan_code_t sylvan_attach(struct sylvan_inferior *inf, pid_t pid) {
     inf->pid = pid;
     inf->is_attached = true;
     inf->realpath = path;
+    memset(inf->syscalls_filtered, 0, sizeof(inf->syscalls_filtered));
+    sylvan_dstep_reset(inf);
+    sylvan_memcache_invalidate(inf);
+    sylvan_solib_clear(inf);
 
     if ((code = sylvan_sym_load_tables(inf)))
         return code;
 
-    if ((code = sylvan_breakpoint_reset_phybp(inf)))
+    if ((code = sylvan_start_threads(inf, status)))
         return code;
 
-    if ((code = sylvan_breakpoint_setall_phybp(inf)))
+    if ((code = sylvan_thread_seize_all(inf)))
+        return code;
+
+    if ((code = sylvan_start_breakpoints(inf)))
         return code;
 
+    /* a service attached to in non-stop mode keeps running in every thread but the one that was interrupted */
+    if (inf->non_stop)
+        return sylvan_resume_others(inf);
+
     return SYLVANC_OK;
 }
 
@@ -321,7 +774,12 @@ sylvan_code_t sylvan_detach(struct sylvan_inferior *inf) {
     if (!inf->is_attached)
         return sylvan_set_message(SYLVANC_PROC_NOT_ATTACHED, "Process is not being traced");
 
-    sylvan_code_t code = sylvan_update_inf_status(inf, NULL, false);
+    sylvan_code_t code;
+    bool running = inf->status == SYLVAN_INFSTATE_RUNNING || (inf->non_stop && inf->status == SYLVAN_INFSTATE_STOPPED);
+    if (running && (code = sylvan_stop_running(inf)))
+        return code == SYLVANC_PROC_EXITED || code == SYLVANC_PROC_TERMINATED ? SYLVANC_OK : code;
+
+    code = sylvan_update_inf_status(inf, NULL, false);
     if (code == SYLVANC_PROC_EXITED || code == SYLVANC_PROC_TERMINATED)
         return SYLVANC_OK;
 
@@ -331,9 +789,18 @@ sylvan_code_t sylvan_detach(struct sylvan_inferior *inf) {
     if ((code = sylvan_breakpoint_unsetall_phybp(inf)))
         return code;
 
-    if (ptrace(PTRACE_DETACH, inf->pid, NULL, NULL) < 0)
-        if (errno != ESRCH)
-            return sylvan_set_errno_msg(SYLVANC_PTRACE_DETACH_FAILED, "ptrace detach");
+    /* threads rewound off a breakpoint carry that in their register cache */
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp) {
+        if ((code = sylvan_thread_regs_flush(thread)) && errno != ESRCH)
+            return code;
+
+        if (ptrace(PTRACE_DETACH, thread->tid, NULL, (void *)(long)thread->pending_signal) < 0)
+            if (errno != ESRCH)
+                return sylvan_set_errno_msg(SYLVANC_PTRACE_DETACH_FAILED, "ptrace detach");
+
+        sylvan_thread_remove(inf, thread);
+    }
 
     inf->is_attached = false;
     inf->pid = 0;
@@ -357,9 +824,9 @@ static void exit_child(int wd, sylvan_code_t code) {
 /**
  * well, handles child process
  */
-static void handle_child(struct sylvan_inferior *inf, int fd[2]) {
+static void handle_child(struct sylvan_inferior *inf, int fd[2], int go[2]) {
 
-    if (close(fd[0]) < 0)
+    if (close(fd[0]) < 0 || close(go[1]) < 0)
         _exit(1);
 
     int wd = fd[1];
@@ -367,8 +834,11 @@ static void handle_child(struct sylvan_inferior *inf, int fd[2]) {
     // if (setpgid(0, 0))
     //     exit_child(wd, SYLVANC_SYSTEM_ERROR);
 
-    if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0)
-        exit_child(wd, SYLVANC_PTRACE_ERROR);
+    /* the event loop blocks SIGCHLD to read it from a signalfd, the program shouldn't inherit that */
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
 
     size_t args_len = inf->args == NULL ? 0 : strlen(inf->args);
     size_t path_len = strlen(inf->realpath);
@@ -379,7 +849,7 @@ static void handle_child(struct sylvan_inferior *inf, int fd[2]) {
         exit_child(wd, SYLVANC_OUT_OF_MEMORY);
     }
 
-    memcpy(args, inf->realpath, path_len);
+    memcpy(args, inf->realpath, path_len + 1);
 
     char **argv = (char*[]){ args, NULL };
 
@@ -398,20 +868,323 @@ static void handle_child(struct sylvan_inferior *inf, int fd[2]) {
         argv = p.we_wordv;
     }
 
+    struct sock_fprog filter;
+    if (sylvan_syscall_filter_build(inf->syscalls_traced, &filter))
+        exit_child(wd, SYLVANC_OUT_OF_MEMORY);
+
     if (close(wd) < 0)
         _exit(1);
 
+    /* the parent seizes us in the meantime, PTRACE_TRACEME would leave us attached but not seized */
+    char c;
+    while (read(go[0], &c, 1) < 0 && errno == EINTR)
+        ;
+    close(go[0]);
+
+    /* only once we're seized, a system call the filter traces fails with ENOSYS while nobody traces us */
+    if (filter.len && sylvan_syscall_filter_load(&filter))
+        _exit(1);
+
     execvp(inf->realpath, argv);
 
     _exit(1);
 }
 
+/**
+ * helper function to handle breakpoint at current instruction address
+ * steps over the original instruction if rip sits on an inserted breakpoint,
+ * out of line when possible, otherwise by removing the breakpoint for one step
+ */
+static sylvan_code_t sylvan_handle_breakpoint_at_current_addr(struct sylvan_inferior *inf, int *wstatus) {
+    sylvan_code_t code;
+
+    if ((code = sylvan_regs_fetch(inf)))
+        return code;
+
+    struct sylvan_thread *thread = inf->thread;
+
+    struct sylvan_breakpoint *breakpoint;
+    if (sylvan_breakpoint_find_by_addr(inf, thread->regs.rip, &breakpoint) == SYVLANC_BREAKPOINT_NOT_FOUND)
+        return SYVLANC_BREAKPOINT_NOT_FOUND;
+
+    if (!breakpoint->is_enabled_phy)
+        return SYVLANC_BREAKPOINT_NOT_FOUND; 
+
+    /* rip is past a system call that hasn't run yet, the breakpoint is hit once it did */
+    if (sylvan_syscall_entering(thread))
+        return SYVLANC_BREAKPOINT_NOT_FOUND;
+
+    /* the kernel sets RF when a hardware breakpoint fires, set it ourselves if we got here some other way */
+    if (breakpoint->type == SYLVAN_BREAKPOINT_HARDWARE) {
+        if (!(thread->regs.eflags & SYLVAN_EFLAGS_RF)) {
+            thread->regs.eflags |= SYLVAN_EFLAGS_RF;
+            thread->regs_dirty = true;
+        }
+        return SYVLANC_BREAKPOINT_NOT_FOUND;
+    }
+
+    if (breakpoint->type != SYLVAN_BREAKPOINT_SOFTWARE)
+        return SYVLANC_BREAKPOINT_NOT_FOUND;
+
+    bool stepped;
+    if ((code = sylvan_dstep_over(inf, breakpoint, wstatus, &stepped)))
+        return code;
+
+    if (stepped)
+        return SYLVANC_OK;
+
+    /* the breakpoint is out of the text for a step, no other thread may run past it meanwhile */
+    bool paused;
+    if ((code = sylvan_thread_pause_all(inf, &paused)))
+        return code;
+
+    if ((code = sylvan_breakpoint_disable_ptr(inf, breakpoint)))
+        return code;
+
+    if ((code = sylvan_step(inf, wstatus)))
+        return code;
+
+    if ((code = sylvan_breakpoint_enable_ptr(inf, breakpoint)))
+        return code;
+
+    return paused ? sylvan_thread_resume_paused(inf) : SYLVANC_OK;
+}
+
+/**
+ * true if the current thread reached the run to breakpoint in the frame it's headed for or one of its callers
+ * a frame whose CFA can't be found stops it, rather than running past the location
+ */
+static bool sylvan_run_to_reached(struct sylvan_inferior *inf) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    struct user_regs_struct *regs = &inf->thread->regs;
+    if (inf->thread->tid != inf->run_to_tid)
+        return false;
+
+    if (!inf->run_to_by_cfa)
+        return regs->rsp >= inf->run_to_sp;
+
+    /* the caller's sp is the CFA of the frame the thread is in */
+    struct sylvan_unwind_regs frame = { regs->rip, regs->rsp, regs->rbp };
+    uintptr_t slot;
+    return sylvan_unwind_step(inf, &frame, true, &slot) || frame.sp >= inf->run_to_sp;
+}
+
+/**
+ * evaluates the condition of the breakpoint that stopped the process, then counts the hit
+ * sets *stop to false if the condition is false or the hit is ignored, the process should be
+ * resumed without returning to the caller
+ */
+static sylvan_code_t sylvan_check_stop_condition(struct sylvan_inferior *inf, bool *stop) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    struct sylvan_breakpoint *breakpoint = inf->thread->stop_breakpoint;
+    *stop = true;
+
+    if (!breakpoint)
+        return SYLVANC_OK;
+
+    if (breakpoint->is_internal) {
+        *stop = breakpoint == inf->run_to_breakpoint && sylvan_run_to_reached(inf);
+        return breakpoint == inf->solib_breakpoint ? sylvan_solib_update(inf) : SYLVANC_OK;
+    }
+
+    sylvan_code_t code;
+    if (breakpoint->condition_expr) {
+        int64_t result;
+        if ((code = sylvan_expr_eval(inf, breakpoint->condition_expr, &result))) {
+            char reason[256];
+            snprintf(reason, sizeof(reason), "%s", sylvan_get_last_error());
+            return sylvan_set_message(code, "breakpoint %d at %#lx, error in condition '%s': %s",
+                                      breakpoint->id, breakpoint->addr, breakpoint->condition, reason);
+        }
+
+        if (!result) {
+            *stop = false;
+            return SYLVANC_OK;
+        }
+    }
+
+    if ((code = sylvan_breakpoint_record_hit(breakpoint, inf->stop_ns)))
+        return code;
+
+    if (breakpoint->ignore_count) {
+        breakpoint->ignore_count--;
+        *stop = false;
+    }
+
+    return SYLVANC_OK;
+}
+
+/**
+ * looks at why the process stopped with status, sets *resume if the caller shouldn't see the stop
+ * breakpoints whose condition is false are stepped over, the process is left ready to be resumed
+ */
+static sylvan_code_t sylvan_filter_stop(struct sylvan_inferior *inf, int status, bool *resume) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    *resume = false;
+
+    sylvan_code_t code, cond_code;
+
+    /* an exec of the process itself, it runs on with the breakpoints in the new image */
+    if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) {
+        if ((code = sylvan_follow_exec(inf)))
+            return code;
+        *resume = true;
+        return SYLVANC_OK;
+    }
+
+    /* a filter installed for a system call that isn't traced anymore, filters can't be taken out */
+    if (SYLVAN_PTRACE_EVENT(status) == PTRACE_EVENT_SECCOMP) {
+        if ((code = sylvan_regs_fetch(inf)))
+            return code;
+        if (!sylvan_syscall_is_traced(inf, (long)inf->thread->regs.orig_rax)) {
+            *resume = true;
+            return SYLVANC_OK;
+        }
+    }
+
+    if ((code = sylvan_stop_reason(inf, status)) != SYVLANC_BREAKPOINT_HIT)
+        return code;
+
+    bool stop;
+    if ((cond_code = sylvan_check_stop_condition(inf, &stop)))
+        return cond_code;
+
+    /* arrived where sylvan_advance and the like were headed, it isn't a breakpoint of the user */
+    struct sylvan_thread *thread = inf->thread;
+    if (stop && thread->stop_breakpoint && thread->stop_breakpoint == inf->run_to_breakpoint) {
+        char where[128];
+        char which[32];
+        return sylvan_set_message(SYLVANC_PROC_STOPPED, "program stopped at %#lx%s%s", thread->regs.rip,
+                                  sylvan_sym_format_addr(inf, thread->regs.rip, where, sizeof(where)),
+                                  sylvan_thread_note(inf, which, sizeof(which)));
+    }
+
+    if (stop)
+        return code;
+
+    if ((cond_code = sylvan_handle_breakpoint_at_current_addr(inf, NULL)) && cond_code != SYVLANC_BREAKPOINT_NOT_FOUND)
+        return cond_code;
+
+    *resume = true;
+    return SYLVANC_OK;
+}
+
+/**
+ * stops the other threads once one of them stopped for a reason the caller has to see,
+ * in non-stop mode they keep running. code is what the stop was reported with, it's returned unless stopping fails
+ */
+static sylvan_code_t sylvan_report_stop(struct sylvan_inferior *inf, sylvan_code_t code) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    if (inf->status != SYLVAN_INFSTATE_STOPPED || inf->non_stop)
+        return code;
+
+    sylvan_code_t stop_code;
+    if ((stop_code = sylvan_thread_stop_all(inf)))
+        return stop_code;
+
+    return code;
+}
+
+/**
+ * resumes every stopped thread, or only the current one in non-stop mode
+ * a pending stop isn't resumed, the next wait reports it
+ */
+static sylvan_code_t sylvan_resume_threads(struct sylvan_inferior *inf) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    if (!inf->non_stop)
+        return sylvan_thread_resume_all(inf);
+
+    struct sylvan_thread *thread = inf->thread;
+    if (thread == NULL || !thread->is_stopped || thread->has_pending)
+        return SYLVANC_OK;
+
+    sylvan_code_t code;
+    if ((code = sylvan_thread_resume(inf, thread, PTRACE_CONT)) && errno != ESRCH)
+        return code;
+
+    return SYLVANC_OK;
+}
+
+/**
+ * resumes the process until a thread stops for a reason the caller has to see, then stops the others
+ * unless the inferior is in non-stop mode. breakpoints whose condition is false are stepped over without returning
+ */
+static sylvan_code_t sylvan_resume_until_stop(struct sylvan_inferior *inf) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    sylvan_code_t code;
+    for (;;) {
+        if ((code = sylvan_resume_threads(inf)))
+            return code;
+
+        int status;
+        if ((code = sylvan_wait_inf(inf, &status, true)))
+            return sylvan_report_stop(inf, code);
+
+        bool resume;
+        code = sylvan_filter_stop(inf, status, &resume);
+        if (!resume)
+            return sylvan_report_stop(inf, code);
+    }
+}
+
+/**
+ * see lib/sylvan/inferior.h
+ */
+SYLVAN_INTERNAL sylvan_code_t sylvan_handle_event(struct sylvan_inferior *inf, struct sylvan_thread *thread,
+                                                  int status, bool *report) {
+
+    assert(inf != NULL && report != NULL); /* should have been checked by the caller */
+
+    *report = true;
+
+    /* in non-stop mode the thread the user is looking at stays current if this stop isn't reported */
+    pid_t current = inf->thread ? inf->thread->tid : 0;
+    sylvan_inferior_state_t state = inf->status;
+
+    if (thread)
+        inf->thread = thread;
+
+    sylvan_code_t code;
+    if ((code = sylvan_set_wait_status(inf, status)) || !WIFSTOPPED(status))
+        return code;
+
+    bool resume;
+    code = sylvan_filter_stop(inf, status, &resume);
+    if (!resume)
+        return sylvan_report_stop(inf, code);
+
+    if ((code = sylvan_resume_threads(inf)))
+        return code;
+
+    if (inf->non_stop && state == SYLVAN_INFSTATE_STOPPED) {
+        inf->thread = sylvan_thread_find(inf, current);
+        inf->status = inf->thread ? SYLVAN_INFSTATE_STOPPED : SYLVAN_INFSTATE_RUNNING;
+    } else {
+        inf->status = SYLVAN_INFSTATE_RUNNING;
+    }
+
+    *report = false;
+    return SYLVANC_OK;
+}
+
 /**
  * handles parent process
  */
-static sylvan_code_t handle_parent(pid_t pid, struct sylvan_inferior *inf, int fd[2]) {
+static sylvan_code_t handle_parent(pid_t pid, struct sylvan_inferior *inf, int fd[2], int go[2]) {
 
-    if (close(fd[1]) < 0)
+    if (close(fd[1]) < 0 || close(go[0]) < 0)
         return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "close pipe");
 
     int rd = fd[0];
@@ -422,9 +1195,21 @@ static sylvan_code_t handle_parent(pid_t pid, struct sylvan_inferior *inf, int f
         bytes_read = read(rd, buf, sizeof(buf));
     } while (bytes_read == -1 && errno == EINTR);
 
+    /* the child execs once go is closed, seized by then the exec is its first stop */
+    sylvan_code_t seize_code = SYLVANC_OK;
+    if (bytes_read == 0 && ptrace(PTRACE_SEIZE, pid, NULL, (void *)SYLVAN_PTRACE_OPTIONS) < 0) {
+        seize_code = sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace seize");
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    close(go[1]);
+
     if (close(rd) < 0)
         return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "close pipe");
 
+    if (seize_code)
+        return seize_code;
+
     if (bytes_read < 0)
         return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "read from pipe");
 
@@ -444,169 +1229,633 @@ static sylvan_code_t handle_parent(pid_t pid, struct sylvan_inferior *inf, int f
         return sylvan_set_code(code);
     }
 
-    int status;
-    int res;
-    do {
-        res = waitpid(pid, &status, 0);
-    } while (res == -1 && errno == EINTR);
+    int status;
+    int res;
+    for (;;) {
+        do {
+            res = waitpid(pid, &status, __WALL);
+        } while (res == -1 && errno == EINTR);
+
+        /* the child's last system calls before the exec can be traced ones */
+        if (res == -1 || !WIFSTOPPED(status) || SYLVAN_PTRACE_EVENT(status) != PTRACE_EVENT_SECCOMP)
+            break;
+
+        if (ptrace(PTRACE_CONT, pid, NULL, NULL) < 0)
+            return sylvan_set_errno_msg(SYLVANC_PTRACE_CONT_FAILED, "ptrace cont");
+    }
+
+    if (res == -1)
+        return sylvan_set_errno_msg(SYLVANC_WAITPID_FAILED, "waitpid");
+
+    if (WIFEXITED(status))
+        return sylvan_set_message(SYLVANC_PROC_CHILD, "Child process exited with code %d", WEXITSTATUS(status));
+
+    sylvan_update_wait_status(status, inf);
+    inf->pid = pid;
+    inf->is_attached = false;
+    memcpy(inf->syscalls_filtered, inf->syscalls_traced, sizeof(inf->syscalls_filtered));
+    sylvan_dstep_reset(inf);
+    sylvan_memcache_invalidate(inf);
+    sylvan_solib_clear(inf);
+
+    sylvan_code_t code;
+    if ((code = sylvan_start_threads(inf, status)))
+        return code;
+
+    if ((code = sylvan_start_breakpoints(inf)))
+        return code;
+
+    return sylvan_resume_until_stop(inf);
+}
+
+/**
+ * runs a new process. replaces existing process
+ */
+sylvan_code_t sylvan_run(struct sylvan_inferior *inf) {
+    if (inf == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (inf->realpath == NULL)
+        return sylvan_set_message(SYLVANC_FILE_NOT_FOUND, "No executable path specified");
+
+    if (access(inf->realpath, X_OK))
+        return sylvan_set_errno_msg(SYLVANC_NOT_EXECUTABLE, "File '%s' is not executable", inf->realpath);
+
+    sylvan_code_t code;
+    if ((code = sylvan_kill(inf)))
+        return code;
+
+    int fd[2];
+    if (pipe(fd) < 0)
+        return sylvan_set_errno_msg(SYLVANC_PIPE_FAILED, "pipe");
+
+    int go[2];
+    if (pipe(go) < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        return sylvan_set_errno_msg(SYLVANC_PIPE_FAILED, "pipe");
+    }
+    
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fd[0]);
+        close(fd[1]);
+        close(go[0]);
+        close(go[1]);
+        return sylvan_set_errno_msg(SYLVANC_FORK_FAILED, "fork");
+    }
+
+    if (pid == 0)
+        handle_child(inf, fd, go); // never returns
+
+    return handle_parent(pid, inf, fd, go);
+}
+
+/**
+ * validates process state before operations
+ */
+static sylvan_code_t sylvan_validate_process_state(struct sylvan_inferior *inf, int *wstatus) {
+    if (inf == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    /* its events belong to the event loop, a wait here would skip the breakpoint handling */
+    if (inf->status == SYLVAN_INFSTATE_RUNNING && inf->pid > 0)
+        return sylvan_set_message(SYLVANC_PROC_RUNNING, "Process %d is running in the background", inf->pid);
+    
+    sylvan_code_t code;
+    if ((code = sylvan_update_inf_status(inf, wstatus, false)))
+        return code;
+
+    if ((inf->status != SYLVAN_INFSTATE_STOPPED)) {
+        if (inf->status == SYLVAN_INFSTATE_RUNNING)
+            return sylvan_set_message(SYLVANC_PROC_RUNNING, "Process %d is already running", inf->pid);
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Process %d is not in a stopped state", inf->pid);
+    }
+    
+    return SYLVANC_OK;
+}
+
+/**
+ * continues the stopped process
+ */
+sylvan_code_t sylvan_continue(struct sylvan_inferior *inf) {
+    sylvan_code_t code;
+    
+    if ((code = sylvan_validate_process_state(inf, NULL)))
+        return code;
+
+    if ((code = sylvan_handle_breakpoint_at_current_addr(inf, NULL)) && code != SYVLANC_BREAKPOINT_NOT_FOUND)
+        return code;
+
+    return sylvan_resume_until_stop(inf);
+}
+
+/**
+ * continues the stopped process without waiting for it, sylvan_event_poll reports where it stops
+ */
+sylvan_code_t sylvan_continue_background(struct sylvan_inferior *inf) {
+    sylvan_code_t code;
+
+    if ((code = sylvan_validate_process_state(inf, NULL)))
+        return code;
+
+    if ((code = sylvan_handle_breakpoint_at_current_addr(inf, NULL)) && code != SYVLANC_BREAKPOINT_NOT_FOUND)
+        return code;
+
+    if ((code = sylvan_resume_threads(inf)))
+        return code;
+
+    inf->status = SYLVAN_INFSTATE_RUNNING;
+    return SYLVANC_OK;
+}
+
+/**
+ * asks a process running in the background to stop, sylvan_event_poll reports the stop
+ * and all of its threads are stopped by then. in non-stop mode only one running thread
+ * is stopped, the current one if it runs
+ */
+sylvan_code_t sylvan_interrupt(struct sylvan_inferior *inf) {
+    if (inf == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (inf->pid <= 0 || (inf->status != SYLVAN_INFSTATE_RUNNING && !(inf->non_stop && inf->status == SYLVAN_INFSTATE_STOPPED)))
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Process is not running");
+
+    /* one thread is enough, the others are stopped when its stop is reported */
+    struct sylvan_thread *thread = inf->thread, *tmp;
+    if (thread == NULL || thread->is_stopped)
+        HASH_ITER(hh, inf->threads, thread, tmp)
+            if (!thread->is_stopped)
+                break;
+
+    if (thread == NULL || thread->is_stopped)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "No thread is running");
+
+    if (ptrace(PTRACE_INTERRUPT, thread->tid, NULL, NULL) < 0)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace interrupt");
+
+    inf->interrupting = true;
+    return SYLVANC_OK;
+}
+
+/**
+ * steps the current thread through a single instruction, the other threads stay stopped
+ */
+sylvan_code_t sylvan_stepinst(struct sylvan_inferior *inf) {
+    sylvan_code_t code;
+    
+    if ((code = sylvan_validate_process_state(inf, NULL)))
+        return code;
+
+    if ((code = sylvan_handle_breakpoint_at_current_addr(inf, NULL)) && code != SYVLANC_BREAKPOINT_NOT_FOUND)
+        return code;
+
+    if (!code)
+        return SYLVANC_OK;
+
+    int status;
+    if ((code = sylvan_step(inf, &status)))
+        return code;
+
+    return sylvan_stop_reason(inf, status);
+}
+
+/**
+ * true if status is the trap of a completed single step, or of the first instruction of a followed fork child
+ */
+static bool sylvan_is_step_trap(int status) {
+    return WIFSTOPPED(status) && WSTOPSIG(status) == SIGTRAP && !SYLVAN_PTRACE_EVENT(status);
+}
+
+/**
+ * single-steps the current thread for the stepping loops, *stepped is set once the instruction ran
+ * a stop for another reason, like a signal or an exit, and an enabled breakpoint whose condition holds
+ * where the thread arrives are returned like sylvan_continue returns them, the registers are fetched
+ */
+static sylvan_code_t sylvan_step_checked(struct sylvan_inferior *inf, bool *stepped) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    *stepped = false;
+
+    /* a breakpoint the thread sits on is stepped over out of line, that's the step */
+    int status = 0;
+    sylvan_code_t code = sylvan_handle_breakpoint_at_current_addr(inf, &status);
+    if (code == SYVLANC_BREAKPOINT_NOT_FOUND)
+        code = sylvan_step(inf, &status);
+
+    if (code)
+        return code;
+
+    if (!sylvan_is_step_trap(status))
+        return sylvan_stop_reason(inf, status);
+
+    *stepped = true;
+
+    if ((code = sylvan_regs_fetch(inf)))
+        return code;
+
+    struct sylvan_thread *thread = inf->thread;
+    struct sylvan_breakpoint *breakpoint;
+    if (sylvan_breakpoint_find_by_addr(inf, thread->regs.rip, &breakpoint) || breakpoint->is_internal ||
+        breakpoint->type == SYLVAN_BREAKPOINT_WATCH || !breakpoint->is_enabled_phy)
+        return SYLVANC_OK;
+
+    sylvan_stamp_stop(inf);
+    thread->stop_breakpoint = breakpoint;
+
+    bool stop;
+    if ((code = sylvan_check_stop_condition(inf, &stop)) || !stop)
+        return code;
+
+    char where[128];
+    char which[32];
+    return sylvan_set_message(SYVLANC_BREAKPOINT_HIT, "breakpoint %d at %#lx%s%s", breakpoint->id, breakpoint->addr,
+                              sylvan_sym_format_addr(inf, breakpoint->addr, where, sizeof(where)),
+                              sylvan_thread_note(inf, which, sizeof(which)));
+}
+
+/**
+ * steps the current thread through count instructions in one go, the process state is checked once and
+ * the other threads stay stopped. stepping ends early when the thread stops for another reason, like a signal
+ * or an exit, or arrives at an enabled breakpoint whose condition holds, which counts as a hit.
+ * *done is the number of instructions executed
+ */
+sylvan_code_t sylvan_stepinst_count(struct sylvan_inferior *inf, unsigned long count, unsigned long *done) {
+    sylvan_code_t code;
+    unsigned long done_ = 0;
+
+    if (done)
+        *done = 0;
+
+    if ((code = sylvan_validate_process_state(inf, NULL)))
+        return code;
+
+    while (done_ < count) {
+        bool stepped;
+        code = sylvan_step_checked(inf, &stepped);
+        done_ += stepped;
+        if (code)
+            break;
+    }
+
+    if (done)
+        *done = done_;
+
+    return code;
+}
+
+/**
+ * takes out the breakpoint sylvan_run_to planted, the process may be gone by now
+ */
+static sylvan_code_t sylvan_run_to_clear(struct sylvan_inferior *inf) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    struct sylvan_breakpoint *breakpoint = inf->run_to_breakpoint;
+    if (breakpoint == NULL)
+        return SYLVANC_OK;
+
+    sylvan_code_t code = sylvan_breakpoint_disable_ptr(inf, breakpoint);
+    sylvan_breakpoint_delete(inf, breakpoint);
+    return code;
+}
+
+/**
+ * continues the validated process until the current thread reaches addr with rsp at or above sp, with
+ * a one-shot internal breakpoint there instead of stepping. frames called from where it's headed are below sp,
+ * they run through addr. with by_cfa, sp is a CFA and the CFA of the frame addr is reached in has to be at or above it.
+ * a breakpoint of the user at addr is hit like it would be anyway
+ */
+static sylvan_code_t sylvan_run_to_frame(struct sylvan_inferior *inf, uintptr_t addr, uintptr_t sp, bool by_cfa) {
+
+    assert(inf != NULL); /* inf should not be NULL in an internal library function */
+
+    sylvan_code_t code;
+    struct sylvan_breakpoint *breakpoint;
+    if (sylvan_breakpoint_find_by_addr(inf, addr, &breakpoint) == SYLVANC_OK) {
+        if (breakpoint->is_internal || breakpoint->type == SYLVAN_BREAKPOINT_WATCH || !breakpoint->is_enabled_phy)
+            return sylvan_set_message(SYLVANC_INVALID_STATE, "There's a breakpoint at %#lx that doesn't stop the program", addr);
+    } else if ((code = sylvan_breakpoint_set_internal(inf, addr, &inf->run_to_breakpoint))) {
+        return code;
+    }
+
+    inf->run_to_tid = inf->thread->tid;
+    inf->run_to_sp = sp;
+    inf->run_to_by_cfa = by_cfa;
+
+    if ((code = sylvan_handle_breakpoint_at_current_addr(inf, NULL)) && code != SYVLANC_BREAKPOINT_NOT_FOUND) {
+        sylvan_run_to_clear(inf);
+        return code;
+    }
+
+    code = sylvan_resume_until_stop(inf);
+
+    sylvan_code_t clear_code = sylvan_run_to_clear(inf);
+    return clear_code ? clear_code : code;
+}
+
+/**
+ * sylvan_run_to_frame with rsp at or above sp where addr is reached
+ */
+static sylvan_code_t sylvan_run_to(struct sylvan_inferior *inf, uintptr_t addr, uintptr_t sp) {
+    return sylvan_run_to_frame(inf, addr, sp, false);
+}
+
+/**
+ * continues the stopped process until the current thread reaches addr or stops for another reason
+ * returns SYLVANC_PROC_STOPPED once it's there
+ */
+sylvan_code_t sylvan_advance(struct sylvan_inferior *inf, uintptr_t addr) {
+    if (inf == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
 
-    if (res == -1)
-        return sylvan_set_errno_msg(SYLVANC_WAITPID_FAILED, "waitpid");
+    sylvan_code_t code;
+    if ((code = sylvan_validate_process_state(inf, NULL)))
+        return code;
 
-    if (WIFEXITED(status))
-        return sylvan_set_message(SYLVANC_PROC_CHILD, "Child process exited with code %d", WEXITSTATUS(status));
+    return sylvan_run_to(inf, addr, 0);
+}
 
-    sylvan_update_wait_status(status, inf);
-    inf->pid = pid;
-    inf->is_attached = false;
+/**
+ * like sylvan_advance, but passes addr when it's reached in a function called from the current one,
+ * like a recursive call of the same function
+ */
+sylvan_code_t sylvan_until(struct sylvan_inferior *inf, uintptr_t addr) {
+    if (inf == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
 
     sylvan_code_t code;
-    if ((code = sylvan_breakpoint_reset_phybp(inf)))
+    if ((code = sylvan_validate_process_state(inf, NULL)) || (code = sylvan_regs_fetch(inf)))
         return code;
 
-    if ((code = sylvan_breakpoint_setall_phybp(inf)))
+    /* rsp moves within a function that pushes in its body, the frame is told by its CFA, or rsp without unwind info */
+    struct user_regs_struct *regs = &inf->thread->regs;
+    struct sylvan_unwind_regs caller = { regs->rip, regs->rsp, regs->rbp };
+    uintptr_t slot;
+    if (sylvan_unwind_step(inf, &caller, true, &slot))
+        return sylvan_run_to(inf, addr, regs->rsp);
+
+    return sylvan_run_to_frame(inf, addr, caller.sp, true);
+}
+
+/**
+ * runs the current thread to addr for the line stepping, SYLVANC_OK once it's there
+ * anything else that stopped it on the way is returned as it is
+ */
+static sylvan_code_t sylvan_step_run_to(struct sylvan_inferior *inf, uintptr_t addr, uintptr_t sp) {
+    pid_t tid = inf->thread->tid;
+
+    sylvan_code_t code = sylvan_run_to(inf, addr, sp);
+    if (code != SYLVANC_PROC_STOPPED || inf->thread->tid != tid)
         return code;
 
-    if (ptrace(PTRACE_CONT, inf->pid, NULL, NULL) < 0)
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_CONT_FAILED, "ptrace cont");
+    if ((code = sylvan_regs_fetch(inf)))
+        return code;
 
-    return sylvan_update_inf_status(inf, NULL, true);
+    return inf->thread->regs.rip == addr ? SYLVANC_OK : SYLVANC_PROC_STOPPED;
 }
 
 /**
- * runs a new process. replaces existing process
+ * steps one instruction of the current thread, a call is run as a whole with a breakpoint on the instruction
+ * after it, which the callee returns to with rsp where it is now. SYLVANC_OK once it's there, like a step
  */
-sylvan_code_t sylvan_run(struct sylvan_inferior *inf) {
+sylvan_code_t sylvan_nexti(struct sylvan_inferior *inf) {
     if (inf == NULL)
         return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
 
-    if (inf->realpath == NULL)
-        return sylvan_set_message(SYLVANC_FILE_NOT_FOUND, "No executable path specified");
-
-    if (access(inf->realpath, X_OK))
-        return sylvan_set_errno_msg(SYLVANC_NOT_EXECUTABLE, "File '%s' is not executable", inf->realpath);
-
     sylvan_code_t code;
-    if ((code = sylvan_kill(inf)))
+    if ((code = sylvan_validate_process_state(inf, NULL)) || (code = sylvan_regs_fetch(inf)))
         return code;
 
-    int fd[2];
-    if (pipe(fd) < 0)
-        return sylvan_set_errno_msg(SYLVANC_PIPE_FAILED, "pipe");
-    
-    pid_t pid = fork();
-    if (pid < 0) {
-        close(fd[0]);
-        close(fd[1]);
-        return sylvan_set_errno_msg(SYLVANC_FORK_FAILED, "fork");
-    }
+    int kind;
+    uintptr_t rip = inf->thread->regs.rip;
+    size_t len = sylvan_dstep_decode(inf, rip, &kind);
 
-    if (pid == 0)
-        handle_child(inf, fd); // never returns
+    if (!len || kind != SYLVAN_INSN_CALL)
+        return sylvan_stepinst(inf);
 
-    return handle_parent(pid, inf, fd);
+    return sylvan_step_run_to(inf, rip + len, inf->thread->regs.rsp);
 }
 
 /**
- * helper function to handle breakpoint at current instruction address
+ * steps the current thread until it's at the beginning of a statement of another source line.
+ * with over, calls are run as a whole like sylvan_nexti does. a call into code without line info,
+ * like a plt stub or a library, is run until it returns either way. the thread also stops where
+ * a ret takes it, even in the middle of a line, and in code without line info it didn't call
  */
-static sylvan_code_t sylvan_handle_breakpoint_at_current_addr(struct sylvan_inferior *inf, int *wstatus) {
+static sylvan_code_t sylvan_step_line(struct sylvan_inferior *inf, bool over) {
     sylvan_code_t code;
-    
-    struct user_regs_struct regs;
-    if (ptrace(PTRACE_GETREGS, inf->pid, NULL, &regs) < 0)
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_GETREGS_FAILED, "ptrace get regs");
+    if ((code = sylvan_validate_process_state(inf, NULL)) || (code = sylvan_regs_fetch(inf)))
+        return code;
 
-    struct sylvan_breakpoint *breakpoint;
-    if (sylvan_breakpoint_find_by_addr(inf, regs.rip - 1, &breakpoint) == SYVLANC_BREAKPOINT_NOT_FOUND)
-        return SYVLANC_BREAKPOINT_NOT_FOUND;
+    struct sylvan_line_info from;
+    if (sylvan_line_lookup_addr(inf, inf->thread->regs.rip, &from))
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "No line information for %#llx, use stepi", inf->thread->regs.rip);
+
+    for (;;) {
+        struct user_regs_struct *regs = &inf->thread->regs;
+        uintptr_t rip = regs->rip;
+
+        int kind;
+        size_t len = sylvan_dstep_decode(inf, rip, &kind);
+
+        bool ran_over = over && len && kind == SYLVAN_INSN_CALL;
+        if (ran_over) {
+            if ((code = sylvan_step_run_to(inf, rip + len, regs->rsp)))
+                return code;
+        } else {
+            bool stepped;
+            if ((code = sylvan_step_checked(inf, &stepped)))
+                return code;
+        }
 
-    if (!breakpoint->is_enabled_phy)
-        return SYVLANC_BREAKPOINT_NOT_FOUND; 
+        regs = &inf->thread->regs;
 
-    regs.rip--;
+        struct sylvan_line_info to;
+        if (sylvan_line_lookup_addr(inf, regs->rip, &to)) {
+            /* a call that was run over is back after itself already, rsp is the caller's */
+            if (kind != SYLVAN_INSN_CALL || ran_over)
+                return SYLVANC_OK;
 
-    if (ptrace(PTRACE_SETREGS, inf->pid, NULL, &regs) < 0)
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_SETREGS_FAILED, "ptrace set regs");
+            /* on the first instruction of the callee, its return address is at rsp */
+            uintptr_t ret_addr;
+            if ((code = sylvan_read_memory(inf, regs->rsp, &ret_addr, sizeof(ret_addr))) ||
+                (code = sylvan_step_run_to(inf, ret_addr, regs->rsp + sizeof(ret_addr))))
+                return code;
 
-    if ((code = sylvan_breakpoint_disable_ptr(inf, breakpoint)))
-        return code;
+            regs = &inf->thread->regs;
+            if ((code = sylvan_line_lookup_addr(inf, regs->rip, &to)))
+                return code;
+        }
 
-    if (ptrace(PTRACE_SINGLESTEP, inf->pid, NULL, NULL) < 0)
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_STEP_FAILED, "ptrace single step");
+        if (kind == SYLVAN_INSN_RET)
+            return SYLVANC_OK;
 
-    if ((code = sylvan_update_inf_status(inf, wstatus, true)))
-        return code;
+        if (regs->rip >= from.start && regs->rip < from.end)
+            continue;
 
-    if ((code = sylvan_breakpoint_enable_ptr(inf, breakpoint)))
-        return code;
+        /* the files are interned, the same path is the same pointer */
+        if (to.is_statement && (to.line != from.line || to.file != from.file))
+            return SYLVANC_OK;
 
-    return SYLVANC_OK;
+        /* another block of the same line, or the middle of a line, stepping goes on to its end */
+        from = to;
+    }
 }
 
 /**
- * validates process state before operations
+ * steps the current thread to the next source line, into the functions it calls that have line info
  */
-static sylvan_code_t sylvan_validate_process_state(struct sylvan_inferior *inf, int *wstatus) {
+sylvan_code_t sylvan_stepline(struct sylvan_inferior *inf) {
     if (inf == NULL)
         return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
-    
-    sylvan_code_t code;
-    if ((code = sylvan_update_inf_status(inf, wstatus, false)))
-        return code;
 
-    if ((inf->status != SYLVAN_INFSTATE_STOPPED)) {
-        if (inf->status == SYLVAN_INFSTATE_RUNNING)
-            return sylvan_set_message(SYLVANC_PROC_RUNNING, "Process %d is already running", inf->pid);
-        return sylvan_set_message(SYLVANC_INVALID_STATE, "Process %d is not in a stopped state", inf->pid);
-    }
-    
-    return SYLVANC_OK;
+    return sylvan_step_line(inf, false);
 }
 
 /**
- * continues the stopped process
+ * steps the current thread to the next source line, the calls it makes are run as a whole
  */
-sylvan_code_t sylvan_continue(struct sylvan_inferior *inf) {
+sylvan_code_t sylvan_nextline(struct sylvan_inferior *inf) {
+    if (inf == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    return sylvan_step_line(inf, true);
+}
+
+/**
+ * runs the current thread until the function it's in returns, with a breakpoint on the return address
+ * a recursive call of the same function returning there first is run through
+ * *ret_addr is where it returns to
+ */
+sylvan_code_t sylvan_finish(struct sylvan_inferior *inf, uintptr_t *ret_addr) {
+    if (inf == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
     sylvan_code_t code;
-    
-    if ((code = sylvan_validate_process_state(inf, NULL)))
+    if ((code = sylvan_validate_process_state(inf, NULL)) || (code = sylvan_regs_fetch(inf)))
         return code;
 
-    if ((code = sylvan_handle_breakpoint_at_current_addr(inf, NULL)) && code != SYVLANC_BREAKPOINT_NOT_FOUND)
+    struct user_regs_struct *regs = &inf->thread->regs;
+    struct sylvan_unwind_regs caller = { regs->rip, regs->rsp, regs->rbp };
+    uintptr_t slot;
+    if ((code = sylvan_unwind_step(inf, &caller, true, &slot)))
         return code;
 
-    if (ptrace(PTRACE_CONT, inf->pid, NULL, NULL) < 0)
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_CONT_FAILED, "ptrace cont");
+    if (!caller.pc)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "The outermost frame doesn't return");
 
-    if ((code = sylvan_update_inf_status(inf, NULL, true)))
-        return code;
+    if (ret_addr)
+        *ret_addr = caller.pc;
+
+    /* the ret pops the slot, the caller goes on with rsp at its CFA */
+    return sylvan_run_to(inf, caller.pc, caller.sp);
+}
+
+/**
+ * unwinds the stack of every stopped thread into profile
+ */
+static sylvan_code_t sylvan_profile_sample(struct sylvan_inferior *inf, struct sylvan_profile *profile) {
+    struct sylvan_frame frames[SYLVAN_PROFILE_MAX_FRAMES];
+
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp) {
+        /* a zombie leader has no registers left to read */
+        size_t count;
+        if (!thread->is_stopped || sylvan_unwind_thread(inf, thread, frames, SYLVAN_PROFILE_MAX_FRAMES, &count) || !count)
+            continue;
+
+        sylvan_code_t code;
+        if ((code = sylvan_profile_add(profile, frames, count)))
+            return code;
+        profile->thread_samples++;
+    }
 
+    profile->samples++;
     return SYLVANC_OK;
 }
 
 /**
- * steps through a single instruction
+ * see include/sylvan/profile.h
  */
-sylvan_code_t sylvan_stepinst(struct sylvan_inferior *inf) {
+sylvan_code_t sylvan_profile(struct sylvan_inferior *inf, double seconds, unsigned int hz, struct sylvan_profile **profilep) {
+    /* written so NaN fails both comparisons */
+    if (inf == NULL || profilep == NULL || !(seconds > 0 && seconds <= SYLVAN_PROFILE_MAX_SECONDS) ||
+        hz == 0 || hz > SYLVAN_PROFILE_MAX_HZ)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    *profilep = NULL;
+
     sylvan_code_t code;
-    
     if ((code = sylvan_validate_process_state(inf, NULL)))
         return code;
 
-    if ((code = sylvan_handle_breakpoint_at_current_addr(inf, NULL)) && code != SYVLANC_BREAKPOINT_NOT_FOUND)
+    /* the stacks of threads left running would be missing and a sample would stop them */
+    if (inf->non_stop)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Profiling needs all-stop mode, set non-stop off");
+
+    struct sylvan_profile *profile;
+    if ((code = sylvan_profile_create(&profile)))
         return code;
+    *profilep = profile;
 
-    if (!code)
-        return SYLVANC_OK;
-    
-    if (ptrace(PTRACE_SINGLESTEP, inf->pid, NULL, NULL) < 0)
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_STEP_FAILED, "ptrace single step");
+    /* it runs like in the background between the samples, so its breakpoints are handled as they're hit */
+    if ((code = sylvan_continue_background(inf)))
+        return code;
+
+    uint64_t period = 1000000000ULL / hz;
+    uint64_t start = sylvan_monotonic_ns();
+    uint64_t end = start + (uint64_t)(seconds * 1e9);
+    uint64_t tick = start;
+
+    for (;;) {
+        /* a tick the last stop ran into is skipped, the samples stay evenly spaced */
+        uint64_t now = sylvan_monotonic_ns();
+        do
+            tick += period;
+        while (tick <= now);
+        if (tick > end)
+            tick = end;
+
+        bool reported = false;
+        while (!(code = sylvan_event_handle(inf, &reported)) && !reported && (now = sylvan_monotonic_ns()) < tick)
+            if ((code = sylvan_event_wait(tick - now)))
+                break;
+
+        /* a reported stop has stopped every thread already */
+        if (code || reported)
+            break;
+
+        uint64_t stop = sylvan_monotonic_ns();
+        if ((code = sylvan_thread_stop_all(inf)) || (code = sylvan_profile_sample(inf, profile)))
+            break;
+
+        /* up to the resume, on a single cpu the first thread resumed runs before the call returns */
+        uint64_t stopped = sylvan_monotonic_ns() - stop;
+        profile->stop_ns += stopped;
+        if (stopped > profile->max_stop_ns)
+            profile->max_stop_ns = stopped;
+
+        /* with a pending stop nothing is resumed, the next round of events handles it first */
+        if (tick >= end || (code = sylvan_thread_resume_all(inf)))
+            break;
+    }
+
+    profile->elapsed_ns = sylvan_monotonic_ns() - start;
+
+    /* the end and an error leave it stopped, where the last sample was taken if it's the end */
+    if (inf->status == SYLVAN_INFSTATE_RUNNING && inf->pid > 0) {
+        sylvan_code_t stop_code;
+        if ((stop_code = sylvan_thread_stop_all(inf)))
+            return code ? code : stop_code;
+        inf->status = SYLVAN_INFSTATE_STOPPED;
+    }
 
-    return sylvan_update_inf_status(inf, NULL, true);
+    return code;
 }
 /**
- * gets cpu regs
+ * gets cpu regs, served from the register cache after the first call in a stop
  */
 sylvan_code_t sylvan_get_regs(struct sylvan_inferior *inf, struct user_regs_struct *regs) {
     if (inf == NULL || regs == NULL)
@@ -619,14 +1868,15 @@ sylvan_code_t sylvan_get_regs(struct sylvan_inferior *inf, struct user_regs_stru
     if (inf->status != SYLVAN_INFSTATE_STOPPED && inf->status != SYLVAN_INFSTATE_RUNNING)
         return sylvan_set_message(SYLVANC_INVALID_STATE, "Cannot get registers: process is not running or stopped");
 
-    if (ptrace(PTRACE_GETREGS, inf->pid, NULL, regs) < 0)
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_GETREGS_FAILED, "ptrace get regs");
-    
+    if ((code = sylvan_regs_fetch(inf)))
+        return code;
+
+    *regs = inf->thread->regs;
     return SYLVANC_OK;
 }
 
 /**
- * sets cpu regs
+ * sets cpu regs in the register cache
  */
 sylvan_code_t sylvan_set_regs(struct sylvan_inferior *inf, const struct user_regs_struct *regs) {
     if (inf == NULL || regs == NULL)
@@ -639,9 +1889,13 @@ sylvan_code_t sylvan_set_regs(struct sylvan_inferior *inf, const struct user_reg
     if (inf->status != SYLVAN_INFSTATE_STOPPED && inf->status != SYLVAN_INFSTATE_RUNNING)
         return sylvan_set_message(SYLVANC_INVALID_STATE,  "Cannot set registers: process is not running or stopped");
     
-    if (ptrace(PTRACE_SETREGS, inf->pid, NULL, regs) < 0)
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_SETREGS_FAILED, "ptrace set regs");
-    
+    if (inf->thread == NULL)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Program is not being run");
+
+    /* written back on the next resume */
+    inf->thread->regs = *regs;
+    inf->thread->regs_valid = true;
+    inf->thread->regs_dirty = true;
     return SYLVANC_OK;
 }
 
@@ -705,83 +1959,320 @@ sylvan_code_t sylvan_set_args(struct sylvan_inferior *inf, const char *args) {
 }
 
 /**
- * reads a memory location
+ * switches between all-stop, where a stop halts every thread, and non-stop, where only the thread
+ * that stopped halts and continuing resumes only the current one. breakpoints stay inserted either way.
+ * a stopped process keeps only its current thread stopped once non-stop mode is on
  */
-sylvan_code_t sylvan_get_memory(struct sylvan_inferior *inf, uintptr_t addr, uint64_t *data){
+sylvan_code_t sylvan_set_non_stop(struct sylvan_inferior *inf, bool non_stop) {
+    if (inf == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (inf->status == SYLVAN_INFSTATE_RUNNING && inf->pid > 0)
+        return sylvan_set_message(SYLVANC_PROC_RUNNING, "Process %d is running in the background", inf->pid);
+
+    /* threads still running in non-stop mode have to be stopped before all-stop takes over */
+    sylvan_code_t code;
+    if (inf->non_stop && !non_stop && inf->status == SYLVAN_INFSTATE_STOPPED &&
+        (code = sylvan_thread_stop_all(inf)))
+        return code;
+
+    inf->non_stop = non_stop;
+
+    if (non_stop && inf->status == SYLVAN_INFSTATE_STOPPED && inf->pid > 0)
+        return sylvan_resume_others(inf);
+
+    return SYLVANC_OK;
+}
+
+/**
+ * chooses what happens to the child of a fork: it's let go without breakpoints (parent), the inferior
+ * moves over to it and the parent is let go (child), or it becomes a new inferior with a copy of the
+ * breakpoints (both). either way the child is taken over in the stop the fork reports, before it runs
+ */
+sylvan_code_t sylvan_set_follow_fork(struct sylvan_inferior *inf, sylvan_follow_fork_t mode) {
     if (inf == NULL)
         return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
-    
-    errno = 0;
-    uint64_t _data;
-    _data = ptrace(PTRACE_PEEKDATA, inf->pid, (void *)(addr), NULL);
-    if (errno)
-        return sylvan_set_errno_msg(SYLVANC_PTRACE_PEEKDATA_FAILED, "Cannot read address %lx", (addr));
 
-    *data = _data;
+    if (mode != SYLVAN_FOLLOW_FORK_PARENT && mode != SYLVAN_FOLLOW_FORK_CHILD && mode != SYLVAN_FOLLOW_FORK_BOTH)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
 
+    inf->follow_fork = mode;
     return SYLVANC_OK;
 }
 
+/**
+ * reads with process_vm_readv, stops at the first page it can't read
+ * returns the number of bytes read
+ */
+static size_t sylvan_read_memory_vm(pid_t pid, uintptr_t addr, uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        struct iovec local = { .iov_base = buf + done, .iov_len = len - done };
+        struct iovec remote = { .iov_base = (void *)(addr + done), .iov_len = len - done };
+        ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    return done;
+}
 
 /**
- * set a memory location to given bytes
+ * reads through /proc/<pid>/mem, works on pages process_vm_readv refuses (e.g. PROT_NONE)
+ * returns the number of bytes read
  */
-sylvan_code_t sylvan_set_memory(struct sylvan_inferior *inf, uintptr_t addr, const void *data, size_t size) {
-    
+static size_t sylvan_read_memory_procfs(pid_t pid, uintptr_t addr, uint8_t *buf, size_t len) {
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/mem", pid);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(fd, buf + done, len - done, (off_t)(addr + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+
+    close(fd);
+    return done;
+}
+
+/**
+ * reads word by word with PTRACE_PEEKDATA, last resort
+ * returns the number of bytes read
+ */
+static size_t sylvan_read_memory_peek(pid_t pid, uintptr_t addr, uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        errno = 0;
+        long word = ptrace(PTRACE_PEEKDATA, pid, (void *)(addr + done), NULL);
+        if (errno)
+            break;
+
+        size_t n = len - done < sizeof(long) ? len - done : sizeof(long);
+        memcpy(buf + done, &word, n);
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * see lib/sylvan/inferior.h
+ * tries process_vm_readv first, then /proc/<pid>/mem, then PTRACE_PEEKDATA for whatever is left
+ */
+SYLVAN_INTERNAL size_t
+sylvan_read_memory_raw(pid_t pid, uintptr_t addr, uint8_t *buf, size_t len) {
+
+    assert(buf); // should have been checked by the caller
+
+    size_t done = sylvan_read_memory_vm(pid, addr, buf, len);
+
+    if (done < len)
+        done += sylvan_read_memory_procfs(pid, addr + done, buf + done, len - done);
+
+    if (done < len)
+        done += sylvan_read_memory_peek(pid, addr + done, buf + done, len - done);
+
+    return done;
+}
+
+/**
+ * reads len bytes starting at addr into buf, the int3s of inserted breakpoints read as the bytes they replaced
+ * while the process is stopped the pages read are cached until it runs again, see lib/sylvan/memcache.h
+ */
+sylvan_code_t sylvan_read_memory(struct sylvan_inferior *inf, uintptr_t addr, void *buf, size_t len) {
+    if (inf == NULL || buf == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (inf->pid <= 0)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Program is not being run");
+
+    if (sylvan_memcache_read(inf, addr, buf, len))
+        return SYLVANC_OK;
+
+    size_t done = sylvan_read_memory_raw(inf->pid, addr, buf, len);
+    if (done < len)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_PEEKDATA_FAILED, "Cannot read address %lx", addr + done);
+
+    sylvan_breakpoint_shadow(inf, addr, buf, len);
+    return SYLVANC_OK;
+}
+
+/**
+ * reads a memory location
+ */
+sylvan_code_t sylvan_get_memory(struct sylvan_inferior *inf, uintptr_t addr, uint64_t *data){
     if (inf == NULL || data == NULL)
         return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
-    
-    if (size == 0)
-        return sylvan_set_code(SYLVANC_OK); 
-    
-    if (addr == 0)
-        return sylvan_set_errno_msg(SYLVANC_INVALID_ARGUMENT, "Invalid address 0x%lx", addr);
-    
 
-    const uint8_t *bytes = (const uint8_t *)data;
-    size_t offset = 0;
+    return sylvan_read_memory(inf, addr, data, sizeof(uint64_t));
+}
 
-    while (offset + 8 <= size) {
-        uint64_t chunk = 0;
-        memcpy(&chunk, bytes + offset, 8);
 
-        if (ptrace(PTRACE_POKEDATA, inf->pid, (void *)(addr + offset), (void *)chunk) < 0) 
-            return sylvan_set_errno_msg(SYLVANC_PTRACE_POKEDATA_FAILED, "cannot write at 0x%lx: %s", addr + offset);
-        
-        offset += 8;
+/**
+ * writes with process_vm_writev, stops at the first page it can't write (e.g. read only text)
+ * returns the number of bytes written
+ */
+static size_t sylvan_write_memory_vm(pid_t pid, uintptr_t addr, const uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        struct iovec local = { .iov_base = (void *)(buf + done), .iov_len = len - done };
+        struct iovec remote = { .iov_base = (void *)(addr + done), .iov_len = len - done };
+        ssize_t n = process_vm_writev(pid, &local, 1, &remote, 1, 0);
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    return done;
+}
+
+/**
+ * writes through /proc/<pid>/mem, which is allowed to write read only private mappings
+ * returns the number of bytes written
+ */
+static size_t sylvan_write_memory_procfs(pid_t pid, uintptr_t addr, const uint8_t *buf, size_t len) {
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/mem", pid);
+
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(fd, buf + done, len - done, (off_t)(addr + done));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+
+    close(fd);
+    return done;
+}
+
+/**
+ * writes word by word with PTRACE_POKEDATA, the unaligned tail is merged with the current memory
+ * returns the number of bytes written
+ */
+static size_t sylvan_write_memory_poke(pid_t pid, uintptr_t addr, const uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done + sizeof(long) <= len) {
+        long word;
+        memcpy(&word, buf + done, sizeof(long));
+        if (ptrace(PTRACE_POKEDATA, pid, (void *)(addr + done), (void *)word) < 0)
+            return done;
+        done += sizeof(long);
     }
-    
-    if (offset < size) {
-        size_t remaining = size - offset;
-        uint64_t current_data = 0;
-        if (sylvan_get_memory(inf, (uintptr_t){addr + offset}, &current_data)) 
-            return sylvan_set_errno_msg(SYLVANC_PTRACE_POKEDATA_FAILED, "cannot write at 0x%lx: %s", addr + offset);        
-        
-        uint64_t new_data = 0;
-        memcpy(&new_data, bytes + offset, remaining);
 
-        uint64_t mask = (1ULL << (remaining * 8)) - 1;
-        new_data = (current_data & ~mask) | (new_data & mask);
+    if (done < len) {
+        errno = 0;
+        long word = ptrace(PTRACE_PEEKDATA, pid, (void *)(addr + done), NULL);
+        if (errno)
+            return done;
 
-        if (ptrace(PTRACE_POKEDATA, inf->pid, (void *)(addr + offset), (void *)new_data) < 0) 
-            return sylvan_set_errno_msg(SYLVANC_PTRACE_POKEDATA_FAILED, "cannot write at 0x%lx: %s", addr + offset);
-        
+        memcpy(&word, buf + done, len - done);
+        if (ptrace(PTRACE_POKEDATA, pid, (void *)(addr + done), (void *)word) < 0)
+            return done;
+        done = len;
     }
 
+    return done;
+}
+
+/**
+ * writes len bytes from buf starting at addr
+ * tries process_vm_writev first, then /proc/<pid>/mem, then PTRACE_POKEDATA for whatever is left
+ */
+static sylvan_code_t sylvan_write_memory_process(pid_t pid, uintptr_t addr, const uint8_t *buf, size_t len) {
+    size_t done = sylvan_write_memory_vm(pid, addr, buf, len);
+
+    if (done < len)
+        done += sylvan_write_memory_procfs(pid, addr + done, buf + done, len - done);
+
+    if (done < len)
+        done += sylvan_write_memory_poke(pid, addr + done, buf + done, len - done);
+
+    if (done < len)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_POKEDATA_FAILED, "cannot write at 0x%lx", addr + done);
+
     return SYLVANC_OK;
 }
 
-sylvan_code_t sylvan_set_breakpoint_function(struct sylvan_inferior *inf, const char *function) {
-    if (!inf || !function)
+/**
+ * see lib/sylvan/inferior.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_write_memory_raw(struct sylvan_inferior *inf, uintptr_t addr, const void *buf, size_t len) {
+
+    assert(inf && buf && inf->pid > 0); // should have been checked by the caller
+
+    sylvan_memcache_drop(inf, addr, len);
+    return sylvan_write_memory_process(inf->pid, addr, buf, len);
+}
+
+/**
+ * writes len bytes from buf starting at addr, a byte that lands on the int3 of an inserted breakpoint
+ * becomes the byte the breakpoint restores and the int3 stays. the cached pages are written through
+ */
+sylvan_code_t sylvan_write_memory(struct sylvan_inferior *inf, uintptr_t addr, const void *buf, size_t len) {
+    if (inf == NULL || buf == NULL)
         return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
 
-    uintptr_t addr;
+    if (len == 0)
+        return SYLVANC_OK;
+
+    if (addr == 0)
+        return sylvan_set_message(SYLVANC_INVALID_ARGUMENT, "Invalid address 0x%lx", addr);
+
+    if (inf->pid <= 0)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Program is not being run");
+
     sylvan_code_t code;
-    if ((code = sylvan_get_label_addr(inf, function, &addr)))
+    uint8_t *covered;
+    if ((code = sylvan_breakpoint_cover(inf, addr, buf, len, &covered)))
         return code;
 
-    if ((code = sylvan_breakpoint_set(inf, addr)))
-        return code;
+    /* a write that stopped halfway leaves the cache not knowing what's there */
+    if ((code = sylvan_write_memory_process(inf->pid, addr, covered ? covered : buf, len)))
+        sylvan_memcache_drop(inf, addr, len);
+    else
+        sylvan_memcache_write(inf, addr, buf, len);
 
-    return SYLVANC_OK;
+    free(covered);
+    return code;
+}
+
+/**
+ * set a memory location to given bytes
+ */
+sylvan_code_t sylvan_set_memory(struct sylvan_inferior *inf, uintptr_t addr, const void *data, size_t size) {
+    return sylvan_write_memory(inf, addr, data, size);
+}
+
+/**
+ * looks up the address of a function in the inferior's symbol tables
+ */
+sylvan_code_t sylvan_get_function_addr(struct sylvan_inferior *inf, const char *function, uintptr_t *addr) {
+    if (!inf || !function || !addr)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    return sylvan_get_label_addr(inf, function, addr);
+}
+
+/**
+ * sets a software breakpoint on function, see sylvan_breakpoint_set_symbol
+ */
+sylvan_code_t sylvan_set_breakpoint_function(struct sylvan_inferior *inf, const char *function) {
+    if (!inf || !function)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    return sylvan_breakpoint_set_symbol(inf, function, false, NULL);
 }
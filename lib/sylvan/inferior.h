@@ -0,0 +1,33 @@
+#ifndef SYLVAN_INFERIOR_H
+#define SYLVAN_INFERIOR_H
+
+#include <stdbool.h>
+#include <sys/ptrace.h>
+#include <sylvan/inferior.h>
+
+sylvan_code_t sylvan_regs_fetch(struct sylvan_inferior *inf);
+sylvan_code_t sylvan_regs_flush(struct sylvan_inferior *inf);
+
+sylvan_code_t sylvan_step(struct sylvan_inferior *inf, int *status);
+sylvan_code_t sylvan_wait_inf(struct sylvan_inferior *inf, int *status, bool blocking);
+sylvan_code_t sylvan_set_wait_status(struct sylvan_inferior *inf, int status);
+
+/**
+ * reads len bytes at addr of the process pid as they are, int3s included and without the page cache
+ * returns how many bytes could be read, sylvan_last_error isn't set
+ */
+size_t sylvan_read_memory_raw(pid_t pid, uintptr_t addr, uint8_t *buf, size_t len);
+
+/**
+ * writes len bytes at addr as they are, over int3s too, and drops the cached pages they touch
+ */
+sylvan_code_t sylvan_write_memory_raw(struct sylvan_inferior *inf, uintptr_t addr, const void *buf, size_t len);
+
+/**
+ * handles a wait status the event loop collected for thread, a thread of inf
+ * a stop the user doesn't see (false condition, ignored hit, internal breakpoint) resumes the process
+ * and clears *report, anything else stops every thread and is returned like sylvan_continue would return it
+ */
+sylvan_code_t sylvan_handle_event(struct sylvan_inferior *inf, struct sylvan_thread *thread, int status, bool *report);
+
+#endif /* SYLVAN_INFERIOR_H */
@@ -0,0 +1,672 @@
+#define _GNU_SOURCE
+
+#include <dwarf.h>
+#include <libdwarf.h>
+#include <assert.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sylvan/inferior.h>
+#include <uthash.h>
+#include "error.h"
+#include "line.h"
+#include "sylvan.h"
+
+#define SYLVAN_LINE_NO_FILE UINT32_MAX
+
+/* a row of a line program, 16 bytes */
+struct sylvan_line_row {
+    uintptr_t addr;                 /* link time */
+    uint32_t line;
+    uint32_t file : 30;             /* index into the index's files */
+    uint32_t is_stmt : 1;
+    uint32_t end_sequence : 1;      /* first address past the sequence, not a line */
+};
+
+/* a compile unit, its line program is read the first time one of its addresses or files is needed */
+struct sylvan_line_unit {
+    Dwarf_Off offset;               /* of the CU DIE in .debug_info */
+    bool has_range;                 /* low_pc and high_pc are in its DIE */
+    bool loaded;
+    struct sylvan_line_row *rows;   /* sequences sorted by address, each ends with an end_sequence row */
+    size_t count;
+    uint32_t *by_line;              /* the statement rows sorted by file, line and address */
+    size_t by_line_count;
+};
+
+/* addresses a unit covers, from its DIE or, for a unit without a contiguous range, from its sequences */
+struct sylvan_line_span {
+    uintptr_t low;
+    uintptr_t high;
+    size_t unit;
+};
+
+struct sylvan_line_file {
+    char *path;
+    uint32_t id;
+    UT_hash_handle hh;
+};
+
+struct sylvan_line_index {
+    Dwarf_Debug dbg;                /* kept open to read the units on demand */
+    struct sylvan_line_unit *units;
+    size_t unit_count;
+    size_t unranged;                /* units without a range that aren't loaded yet */
+    struct sylvan_line_span *spans;
+    size_t span_count;
+    size_t span_capacity;
+    bool spans_sorted;              /* by low, unsorted after a unit without a range is loaded */
+    const char **files;             /* every source path once, owned by file_ids */
+    size_t file_count;
+    size_t file_capacity;
+    struct sylvan_line_file *file_ids;  /* uthash by path */
+};
+
+/**
+ * see lib/sylvan/line.h
+ */
+SYLVAN_INTERNAL void
+sylvan_line_destroy(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    struct sylvan_line_index *index = inf->line_index;
+    if (!index)
+        return;
+
+    for (size_t i = 0; i < index->unit_count; i++) {
+        free(index->units[i].rows);
+        free(index->units[i].by_line);
+    }
+
+    struct sylvan_line_file *file, *tmp;
+    HASH_ITER(hh, index->file_ids, file, tmp) {
+        HASH_DEL(index->file_ids, file);
+        free(file->path);
+        free(file);
+    }
+
+    if (index->dbg)
+        dwarf_finish(index->dbg);
+
+    free(index->units);
+    free(index->spans);
+    free(index->files);
+    free(index);
+    inf->line_index = NULL;
+}
+
+static bool
+sylvan_line_add_span(struct sylvan_line_index *index, uintptr_t low, uintptr_t high, size_t unit) {
+    if (index->span_count == index->span_capacity) {
+        size_t capacity = index->span_capacity ? index->span_capacity * 2 : 64;
+        struct sylvan_line_span *spans = realloc(index->spans, capacity * sizeof(struct sylvan_line_span));
+        if (!spans)
+            return false;
+        index->spans = spans;
+        index->span_capacity = capacity;
+    }
+
+    index->spans[index->span_count++] = (struct sylvan_line_span){ low, high, unit };
+    index->spans_sorted = false;
+    return true;
+}
+
+/**
+ * records where each compile unit is and the addresses it covers, without reading its line program
+ */
+static bool
+sylvan_line_scan_units(struct sylvan_line_index *index) {
+    Dwarf_Error err;
+    size_t capacity = 0;
+
+    for (;;) {
+        Dwarf_Die cu_die = 0;
+        Dwarf_Unsigned cu_header_length = 0;
+        Dwarf_Half version_stamp = 0;
+        Dwarf_Unsigned abbrev_offset = 0;
+        Dwarf_Half address_size = 0;
+        Dwarf_Half offset_size = 0;
+        Dwarf_Half extension_size = 0;
+        Dwarf_Sig8 signature;
+        Dwarf_Unsigned typeoffset = 0;
+        Dwarf_Unsigned next_cu_header = 0;
+        Dwarf_Half header_cu_type = 0;
+
+        int res = dwarf_next_cu_header_e(
+            index->dbg, true, &cu_die, &cu_header_length, &version_stamp,
+            &abbrev_offset, &address_size, &offset_size, &extension_size,
+            &signature, &typeoffset, &next_cu_header, &header_cu_type, &err);
+
+        if (res != DW_DLV_OK)
+            return true;
+
+        Dwarf_Off offset;
+        if (dwarf_dieoffset(cu_die, &offset, &err) != DW_DLV_OK) {
+            dwarf_dealloc_die(cu_die);
+            continue;
+        }
+
+        if (index->unit_count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            struct sylvan_line_unit *units = realloc(index->units, capacity * sizeof(struct sylvan_line_unit));
+            if (!units) {
+                dwarf_dealloc_die(cu_die);
+                return false;
+            }
+            index->units = units;
+        }
+
+        struct sylvan_line_unit *unit = &index->units[index->unit_count];
+        memset(unit, 0, sizeof(struct sylvan_line_unit));
+        unit->offset = offset;
+
+        /* a unit with DW_AT_ranges has no high_pc, its sequences tell where it is once it's loaded */
+        Dwarf_Addr lowpc, highpc;
+        Dwarf_Half form;
+        enum Dwarf_Form_Class formclass;
+        if (dwarf_lowpc(cu_die, &lowpc, &err) == DW_DLV_OK &&
+            dwarf_highpc_b(cu_die, &highpc, &form, &formclass, &err) == DW_DLV_OK) {
+            uintptr_t high = formclass == DW_FORM_CLASS_CONSTANT ? lowpc + highpc : highpc;
+            if (high > lowpc && !sylvan_line_add_span(index, lowpc, high, index->unit_count)) {
+                dwarf_dealloc_die(cu_die);
+                return false;
+            }
+            unit->has_range = high > lowpc;
+        }
+
+        if (!unit->has_range)
+            index->unranged++;
+
+        index->unit_count++;
+        dwarf_dealloc_die(cu_die);
+    }
+}
+
+/**
+ * opens the executable's line table on the first lookup, false if it has none
+ * doesn't touch the last error, the callers tell what's missing
+ */
+static bool
+sylvan_line_open(struct sylvan_inferior *inf) {
+    if (inf->line_index)
+        return inf->line_index->dbg != NULL;
+
+    if (!inf->realpath)
+        return false;
+
+    struct sylvan_line_index *index = calloc(1, sizeof(struct sylvan_line_index));
+    if (!index)
+        return false;
+
+    /* kept even without debug info so the file isn't opened again on every lookup */
+    inf->line_index = index;
+
+    Dwarf_Error err;
+    if (dwarf_init_path(inf->realpath, NULL, 0, DW_GROUPNUMBER_ANY, NULL, NULL, &index->dbg, &err) != DW_DLV_OK) {
+        index->dbg = NULL;
+        return false;
+    }
+
+    return sylvan_line_scan_units(index);
+}
+
+/**
+ * interns a source path, *id is its index in files
+ */
+static bool
+sylvan_line_file_id(struct sylvan_line_index *index, const char *path, uint32_t *id) {
+    struct sylvan_line_file *file;
+    HASH_FIND_STR(index->file_ids, path, file);
+    if (file) {
+        *id = file->id;
+        return true;
+    }
+
+    if (index->file_count == index->file_capacity) {
+        size_t capacity = index->file_capacity ? index->file_capacity * 2 : 64;
+        const char **files = realloc(index->files, capacity * sizeof(char *));
+        if (!files)
+            return false;
+        index->files = files;
+        index->file_capacity = capacity;
+    }
+
+    if (!(file = malloc(sizeof(struct sylvan_line_file))))
+        return false;
+
+    if (!(file->path = strdup(path))) {
+        free(file);
+        return false;
+    }
+
+    file->id = (uint32_t)index->file_count;
+    index->files[index->file_count++] = file->path;
+    HASH_ADD_KEYPTR(hh, index->file_ids, file->path, strlen(file->path), file);
+
+    *id = file->id;
+    return true;
+}
+
+/* a sequence of rows while a unit is loaded */
+struct sylvan_line_seq {
+    size_t start;
+    size_t count;
+};
+
+static int
+sylvan_line_seq_cmp(const void *l, const void *r, void *arg) {
+    const struct sylvan_line_row *rows = arg;
+    uintptr_t laddr = rows[((const struct sylvan_line_seq *)l)->start].addr;
+    uintptr_t raddr = rows[((const struct sylvan_line_seq *)r)->start].addr;
+    return laddr < raddr ? -1 : laddr > raddr;
+}
+
+static int
+sylvan_line_by_line_cmp(const void *l, const void *r, void *arg) {
+    const struct sylvan_line_row *rows = arg;
+    const struct sylvan_line_row *lrow = &rows[*(const uint32_t *)l];
+    const struct sylvan_line_row *rrow = &rows[*(const uint32_t *)r];
+    if (lrow->file != rrow->file)
+        return lrow->file < rrow->file ? -1 : 1;
+    if (lrow->line != rrow->line)
+        return lrow->line < rrow->line ? -1 : 1;
+    return lrow->addr < rrow->addr ? -1 : lrow->addr > rrow->addr;
+}
+
+/**
+ * reads the rows of a unit's line program, the sources are interned once per file number
+ */
+static bool
+sylvan_line_read_rows(struct sylvan_line_index *index, Dwarf_Line *lines, Dwarf_Signed line_count,
+                      struct sylvan_line_row *rows, size_t *countp) {
+    Dwarf_Error err;
+    uint32_t *file_map = NULL;
+    size_t file_map_size = 0;
+    size_t count = 0;
+    bool ok = true;
+
+    for (Dwarf_Signed i = 0; i < line_count && ok; i++) {
+        Dwarf_Addr addr;
+        Dwarf_Unsigned lineno, fileno;
+        Dwarf_Bool is_stmt, end_sequence;
+        if (dwarf_lineaddr(lines[i], &addr, &err) != DW_DLV_OK ||
+            dwarf_lineno(lines[i], &lineno, &err) != DW_DLV_OK ||
+            dwarf_line_srcfileno(lines[i], &fileno, &err) != DW_DLV_OK ||
+            dwarf_linebeginstatement(lines[i], &is_stmt, &err) != DW_DLV_OK ||
+            dwarf_lineendsequence(lines[i], &end_sequence, &err) != DW_DLV_OK)
+            continue;
+
+        if (fileno >= file_map_size) {
+            size_t size = fileno + 16;
+            uint32_t *map = realloc(file_map, size * sizeof(uint32_t));
+            if (!map) {
+                ok = false;
+                break;
+            }
+            for (size_t j = file_map_size; j < size; j++)
+                map[j] = SYLVAN_LINE_NO_FILE;
+            file_map = map;
+            file_map_size = size;
+        }
+
+        if (file_map[fileno] == SYLVAN_LINE_NO_FILE) {
+            char *path;
+            if (dwarf_linesrc(lines[i], &path, &err) != DW_DLV_OK)
+                continue;
+            ok = sylvan_line_file_id(index, path, &file_map[fileno]);
+            dwarf_dealloc(index->dbg, path, DW_DLA_STRING);
+        }
+
+        rows[count++] = (struct sylvan_line_row){ (uintptr_t)addr, (uint32_t)lineno, file_map[fileno],
+                                                  is_stmt != 0, end_sequence != 0 };
+    }
+
+    free(file_map);
+    *countp = count;
+    return ok;
+}
+
+/**
+ * reads the line program of a unit and sorts its rows both ways
+ * a unit that can't be read is left empty, it isn't tried again
+ */
+static bool
+sylvan_line_load_unit(struct sylvan_line_index *index, size_t i) {
+    struct sylvan_line_unit *unit = &index->units[i];
+    unit->loaded = true;
+    if (!unit->has_range)
+        index->unranged--;
+
+    Dwarf_Error err;
+    Dwarf_Die cu_die;
+    if (dwarf_offdie_b(index->dbg, unit->offset, true, &cu_die, &err) != DW_DLV_OK)
+        return true;
+
+    Dwarf_Unsigned version;
+    Dwarf_Small table_count;
+    Dwarf_Line_Context context;
+    if (dwarf_srclines_b(cu_die, &version, &table_count, &context, &err) != DW_DLV_OK) {
+        dwarf_dealloc_die(cu_die);
+        return true;
+    }
+
+    Dwarf_Line *lines;
+    Dwarf_Signed line_count = 0;
+    struct sylvan_line_row *raw = NULL;
+    size_t raw_count = 0;
+    bool ok = true;
+
+    if (dwarf_srclines_from_linecontext(context, &lines, &line_count, &err) == DW_DLV_OK && line_count > 0) {
+        if ((raw = malloc(line_count * sizeof(struct sylvan_line_row))))
+            ok = sylvan_line_read_rows(index, lines, line_count, raw, &raw_count);
+        else
+            ok = false;
+    }
+
+    dwarf_srclines_dealloc_b(context);
+    dwarf_dealloc_die(cu_die);
+
+    /* the addresses only grow within a sequence, ordering the sequences sorts the rows */
+    struct sylvan_line_seq *seqs = raw_count ? malloc(raw_count * sizeof(struct sylvan_line_seq)) : NULL;
+    size_t seq_count = 0;
+    if (ok && raw_count && !seqs)
+        ok = false;
+
+    for (size_t j = 0, start = 0; ok && j < raw_count; j++) {
+        if (!raw[j].end_sequence)
+            continue;
+        /* the code of functions the linker dropped is left at 0 */
+        if (raw[start].addr)
+            seqs[seq_count++] = (struct sylvan_line_seq){ start, j + 1 - start };
+        start = j + 1;
+    }
+
+    if (ok && seq_count) {
+        qsort_r(seqs, seq_count, sizeof(struct sylvan_line_seq), sylvan_line_seq_cmp, raw);
+
+        size_t total = 0;
+        for (size_t j = 0; j < seq_count; j++)
+            total += seqs[j].count;
+
+        unit->rows = malloc(total * sizeof(struct sylvan_line_row));
+        unit->by_line = malloc(total * sizeof(uint32_t));
+        ok = unit->rows && unit->by_line;
+
+        for (size_t j = 0; ok && j < seq_count; j++) {
+            struct sylvan_line_row *seq = &raw[seqs[j].start];
+            if (!unit->has_range)
+                ok = sylvan_line_add_span(index, seq[0].addr, seq[seqs[j].count - 1].addr, i);
+
+            for (size_t k = 0; k < seqs[j].count; k++) {
+                if (seq[k].is_stmt && !seq[k].end_sequence)
+                    unit->by_line[unit->by_line_count++] = (uint32_t)unit->count;
+                unit->rows[unit->count++] = seq[k];
+            }
+        }
+
+        if (ok)
+            qsort_r(unit->by_line, unit->by_line_count, sizeof(uint32_t), sylvan_line_by_line_cmp, unit->rows);
+    }
+
+    free(seqs);
+    free(raw);
+
+    if (!ok) {
+        free(unit->rows);
+        free(unit->by_line);
+        unit->rows = NULL;
+        unit->by_line = NULL;
+        unit->count = 0;
+        unit->by_line_count = 0;
+    }
+
+    return ok;
+}
+
+static int
+sylvan_line_span_cmp(const void *l, const void *r) {
+    uintptr_t llow = ((const struct sylvan_line_span *)l)->low;
+    uintptr_t rlow = ((const struct sylvan_line_span *)r)->low;
+    return llow < rlow ? -1 : llow > rlow;
+}
+
+/**
+ * binary search for the span starting at or below addr, NULL if addr is past its end
+ */
+static struct sylvan_line_span *
+sylvan_line_find_span(struct sylvan_line_index *index, uintptr_t addr) {
+    if (!index->spans_sorted) {
+        qsort(index->spans, index->span_count, sizeof(struct sylvan_line_span), sylvan_line_span_cmp);
+        index->spans_sorted = true;
+    }
+
+    size_t lo = 0, hi = index->span_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->spans[mid].low <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (!lo || addr >= index->spans[lo - 1].high)
+        return NULL;
+
+    return &index->spans[lo - 1];
+}
+
+/**
+ * binary search for the row whose line holds addr, the last one at or below it
+ * false if addr is between sequences
+ */
+static bool
+sylvan_line_find_row(struct sylvan_line_unit *unit, uintptr_t addr, size_t *row) {
+    size_t lo = 0, hi = unit->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (unit->rows[mid].addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (!lo || unit->rows[lo - 1].end_sequence)
+        return false;
+
+    *row = lo - 1;
+    return true;
+}
+
+/**
+ * finds the unit and row of the link time address addr, loading what it takes
+ * units without a range are only loaded when no range covers addr
+ */
+static bool
+sylvan_line_lookup(struct sylvan_line_index *index, uintptr_t addr, struct sylvan_line_unit **unitp, size_t *row) {
+    for (;;) {
+        struct sylvan_line_span *span = sylvan_line_find_span(index, addr);
+        if (span) {
+            struct sylvan_line_unit *unit = &index->units[span->unit];
+            if (!unit->loaded)
+                sylvan_line_load_unit(index, span->unit);
+
+            if (sylvan_line_find_row(unit, addr, row)) {
+                *unitp = unit;
+                return true;
+            }
+        }
+
+        if (!index->unranged)
+            return false;
+
+        for (size_t i = 0; i < index->unit_count; i++)
+            if (!index->units[i].loaded && !index->units[i].has_range)
+                sylvan_line_load_unit(index, i);
+    }
+}
+
+/**
+ * see include/sylvan/line.h
+ */
+sylvan_code_t sylvan_line_lookup_addr(struct sylvan_inferior *inf, uintptr_t addr, struct sylvan_line_info *info) {
+    if (inf == NULL || info == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (!sylvan_line_open(inf))
+        return sylvan_set_message(SYLVANC_DWARF_NOT_FOUND, "No line table in %s", inf->realpath ? inf->realpath : "the inferior");
+
+    struct sylvan_line_unit *unit;
+    size_t row;
+    if (addr < inf->load_bias || !sylvan_line_lookup(inf->line_index, addr - inf->load_bias, &unit, &row))
+        return sylvan_set_message(SYLVANC_SYMBOL_NOT_FOUND, "No line information for %#lx", addr);
+
+    const struct sylvan_line_row *rows = unit->rows;
+    const struct sylvan_line_row *found = &rows[row];
+
+    /* the rows of the line next to this one, up to the next line or the end of the sequence */
+    size_t first = row;
+    while (first > 0 && !rows[first - 1].end_sequence && rows[first - 1].line == found->line &&
+           rows[first - 1].file == found->file)
+        first--;
+
+    size_t last = row + 1;
+    while (!rows[last].end_sequence && rows[last].line == found->line && rows[last].file == found->file)
+        last++;
+
+    info->file = inf->line_index->files[found->file];
+    info->line = found->line;
+    info->start = rows[first].addr + inf->load_bias;
+    info->end = rows[last].addr + inf->load_bias;
+    info->is_statement = found->is_stmt && found->addr == addr - inf->load_bias;
+    return SYLVANC_OK;
+}
+
+/**
+ * true if path is file or ends with /file
+ */
+static bool
+sylvan_line_file_matches(const char *path, const char *file, size_t len) {
+    size_t path_len = strlen(path);
+    if (path_len < len || memcmp(path + path_len - len, file, len) != 0)
+        return false;
+
+    return path_len == len || path[path_len - len - 1] == '/';
+}
+
+/**
+ * finds the link time address of line, or of the next line with code, in the files matching file
+ * every unit is loaded, any of them may have code from the file
+ */
+static bool
+sylvan_line_find_link(struct sylvan_line_index *index, const char *file, size_t len, unsigned int line, uintptr_t *addr) {
+    for (size_t i = 0; i < index->unit_count; i++)
+        if (!index->units[i].loaded)
+            sylvan_line_load_unit(index, i);
+
+    bool found = false;
+    uint32_t best_line = 0;
+    uintptr_t best_addr = 0;
+
+    for (uint32_t id = 0; id < index->file_count; id++) {
+        if (!sylvan_line_file_matches(index->files[id], file, len))
+            continue;
+
+        for (size_t i = 0; i < index->unit_count; i++) {
+            struct sylvan_line_unit *unit = &index->units[i];
+
+            /* the first statement row at or after (id, line) */
+            size_t lo = 0, hi = unit->by_line_count;
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                const struct sylvan_line_row *row = &unit->rows[unit->by_line[mid]];
+                if (row->file < id || (row->file == id && row->line < line))
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+
+            if (lo == unit->by_line_count)
+                continue;
+
+            const struct sylvan_line_row *row = &unit->rows[unit->by_line[lo]];
+            if (row->file != id)
+                continue;
+
+            if (!found || row->line < best_line || (row->line == best_line && row->addr < best_addr)) {
+                found = true;
+                best_line = row->line;
+                best_addr = row->addr;
+            }
+        }
+    }
+
+    *addr = best_addr;
+    return found;
+}
+
+/**
+ * see lib/sylvan/line.h
+ */
+SYLVAN_INTERNAL bool
+sylvan_line_is_location(const char *location, size_t *file_len, unsigned int *line) {
+
+    assert(location && file_len && line); // should have been checked by the caller
+
+    const char *colon = strrchr(location, ':');
+    if (!colon || colon == location || !colon[1])
+        return false;
+
+    unsigned long value = 0;
+    for (const char *p = colon + 1; *p; p++) {
+        if (!isdigit((unsigned char)*p) || value > UINT32_MAX / 10)
+            return false;
+        value = value * 10 + (*p - '0');
+    }
+
+    if (!value || value > UINT32_MAX)
+        return false;
+
+    *file_len = colon - location;
+    *line = (unsigned int)value;
+    return true;
+}
+
+/**
+ * see lib/sylvan/line.h
+ */
+SYLVAN_INTERNAL bool
+sylvan_line_resolve(struct sylvan_inferior *inf, const char *location, uintptr_t *addr) {
+
+    assert(inf && location && addr); // should have been checked by the caller
+
+    size_t file_len;
+    unsigned int line;
+    if (!sylvan_line_is_location(location, &file_len, &line) || !sylvan_line_open(inf))
+        return false;
+
+    if (!sylvan_line_find_link(inf->line_index, location, file_len, line, addr))
+        return false;
+
+    *addr += inf->load_bias;
+    return true;
+}
+
+/**
+ * see include/sylvan/line.h
+ */
+sylvan_code_t sylvan_line_find(struct sylvan_inferior *inf, const char *file, unsigned int line, uintptr_t *addr) {
+    if (inf == NULL || file == NULL || !*file || addr == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (!sylvan_line_open(inf))
+        return sylvan_set_message(SYLVANC_DWARF_NOT_FOUND, "No line table in %s", inf->realpath ? inf->realpath : "the inferior");
+
+    if (!sylvan_line_find_link(inf->line_index, file, strlen(file), line, addr))
+        return sylvan_set_message(SYLVANC_SYMBOL_NOT_FOUND, "No code at %.256s:%u", file, line);
+
+    *addr += inf->load_bias;
+    return SYLVANC_OK;
+}
\ No newline at end of file
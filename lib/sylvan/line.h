@@ -0,0 +1,23 @@
+#ifndef SYLVAN_LINE_H
+#define SYLVAN_LINE_H
+
+#include <stdbool.h>
+#include <sylvan/inferior.h>
+#include <sylvan/line.h>
+
+/**
+ * closes the executable's line table and frees everything read from it
+ */
+void sylvan_line_destroy(struct sylvan_inferior *inf);
+
+/**
+ * true if location is written file:line, *file_len is the length of the file part
+ */
+bool sylvan_line_is_location(const char *location, size_t *file_len, unsigned int *line);
+
+/**
+ * resolves a file:line location like sylvan_line_find, without touching the last error
+ */
+bool sylvan_line_resolve(struct sylvan_inferior *inf, const char *location, uintptr_t *addr);
+
+#endif /* SYLVAN_LINE_H */
\ No newline at end of file
@@ -0,0 +1,206 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include <sylvan/inferior.h>
+#include "breakpoint.h"
+#include "inferior.h"
+#include "memcache.h"
+#include "sylvan.h"
+
+#define SYLVAN_MEMCACHE_PAGE(addr) ((addr) & ~(SYLVAN_MEMCACHE_PAGE_SIZE - 1))
+
+/**
+ * the slot page maps to, whatever it holds
+ */
+static struct sylvan_memcache_slot *
+sylvan_memcache_slot(struct sylvan_memcache *cache, uintptr_t page) {
+    return &cache->slots[(page / SYLVAN_MEMCACHE_PAGE_SIZE) % SYLVAN_MEMCACHE_SLOTS];
+}
+
+/**
+ * the slot holding page, NULL if it isn't cached
+ */
+static struct sylvan_memcache_slot *
+sylvan_memcache_find(struct sylvan_memcache *cache, uintptr_t page) {
+    struct sylvan_memcache_slot *slot = sylvan_memcache_slot(cache, page);
+    return slot->generation == cache->generation && slot->addr == page ? slot : NULL;
+}
+
+/**
+ * true if no thread of inf can change the memory, pages read before that may be stale by the time they're used
+ */
+static bool
+sylvan_memcache_stopped(struct sylvan_inferior *inf) {
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp)
+        if (!thread->is_stopped)
+            return false;
+    return inf->threads != NULL;
+}
+
+/**
+ * reads the count pages from first that aren't cached, all of them with one system call if they can be read
+ */
+static void
+sylvan_memcache_fill(struct sylvan_inferior *inf, uintptr_t first, size_t count) {
+
+    struct sylvan_memcache *cache = inf->memcache;
+    struct sylvan_memcache_slot *slots[SYLVAN_MEMCACHE_FILL_MAX];
+    struct iovec local[SYLVAN_MEMCACHE_FILL_MAX];
+    struct iovec remote[SYLVAN_MEMCACHE_FILL_MAX];
+    size_t n = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        uintptr_t page = first + i * SYLVAN_MEMCACHE_PAGE_SIZE;
+        if (sylvan_memcache_find(cache, page))
+            continue;
+
+        /* the slot is claimed now, it's empty until the page is in it */
+        struct sylvan_memcache_slot *slot = sylvan_memcache_slot(cache, page);
+        slot->addr = page;
+        slot->generation = 0;
+
+        slots[n] = slot;
+        local[n] = (struct iovec){ .iov_base = slot->data, .iov_len = SYLVAN_MEMCACHE_PAGE_SIZE };
+        remote[n] = (struct iovec){ .iov_base = (void *)page, .iov_len = SYLVAN_MEMCACHE_PAGE_SIZE };
+        n++;
+    }
+
+    /* it stops at the first page it can't read, those left try the slower ways one by one */
+    ssize_t done = n ? process_vm_readv(inf->pid, local, n, remote, n, 0) : 0;
+    size_t filled = done > 0 ? (size_t)done / SYLVAN_MEMCACHE_PAGE_SIZE : 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (i >= filled && sylvan_read_memory_raw(inf->pid, slots[i]->addr, slots[i]->data, SYLVAN_MEMCACHE_PAGE_SIZE) < SYLVAN_MEMCACHE_PAGE_SIZE)
+            continue;
+
+        sylvan_breakpoint_shadow(inf, slots[i]->addr, slots[i]->data, SYLVAN_MEMCACHE_PAGE_SIZE);
+        slots[i]->generation = cache->generation;
+    }
+}
+
+/**
+ * see lib/sylvan/memcache.h
+ */
+SYLVAN_INTERNAL bool
+sylvan_memcache_read(struct sylvan_inferior *inf, uintptr_t addr, void *buf, size_t len) {
+
+    assert(inf && buf); // should have been checked by the caller
+
+    if (len == 0 || addr + len < addr)
+        return false;
+
+    uintptr_t first = SYLVAN_MEMCACHE_PAGE(addr);
+    size_t count = (SYLVAN_MEMCACHE_PAGE(addr + len - 1) - first) / SYLVAN_MEMCACHE_PAGE_SIZE + 1;
+    if (count > SYLVAN_MEMCACHE_FILL_MAX)
+        return false;
+
+    struct sylvan_memcache *cache = inf->memcache;
+    bool cached = cache != NULL;
+    for (size_t i = 0; cached && i < count; i++)
+        cached = sylvan_memcache_find(cache, first + i * SYLVAN_MEMCACHE_PAGE_SIZE) != NULL;
+
+    if (!cached) {
+        if (!sylvan_memcache_stopped(inf))
+            return false;
+
+        if (!cache) {
+            if (!(cache = calloc(1, sizeof(*cache))))
+                return false;
+            cache->generation = 1;
+            inf->memcache = cache;
+        }
+
+        sylvan_memcache_fill(inf, first, count);
+    }
+
+    uint8_t *bytes = buf;
+    for (size_t done = 0; done < len;) {
+        uintptr_t at = addr + done;
+        struct sylvan_memcache_slot *slot = sylvan_memcache_find(cache, SYLVAN_MEMCACHE_PAGE(at));
+        if (!slot)
+            return false;
+
+        size_t offset = at - slot->addr;
+        size_t n = SYLVAN_MEMCACHE_PAGE_SIZE - offset < len - done ? SYLVAN_MEMCACHE_PAGE_SIZE - offset : len - done;
+        memcpy(bytes + done, slot->data + offset, n);
+        done += n;
+    }
+
+    return true;
+}
+
+/**
+ * see lib/sylvan/memcache.h
+ */
+SYLVAN_INTERNAL void
+sylvan_memcache_write(struct sylvan_inferior *inf, uintptr_t addr, const void *buf, size_t len) {
+
+    assert(inf && buf); // should have been checked by the caller
+
+    struct sylvan_memcache *cache = inf->memcache;
+    if (!cache)
+        return;
+
+    /* every slot is looked at instead of every page, writes can be far larger than the cache */
+    const uint8_t *bytes = buf;
+    for (size_t i = 0; i < SYLVAN_MEMCACHE_SLOTS; i++) {
+        struct sylvan_memcache_slot *slot = &cache->slots[i];
+        if (slot->generation != cache->generation ||
+            slot->addr + SYLVAN_MEMCACHE_PAGE_SIZE <= addr || slot->addr >= addr + len)
+            continue;
+
+        uintptr_t start = slot->addr > addr ? slot->addr : addr;
+        uintptr_t end = slot->addr + SYLVAN_MEMCACHE_PAGE_SIZE < addr + len ? slot->addr + SYLVAN_MEMCACHE_PAGE_SIZE : addr + len;
+        memcpy(slot->data + (start - slot->addr), bytes + (start - addr), end - start);
+    }
+}
+
+/**
+ * see lib/sylvan/memcache.h
+ */
+SYLVAN_INTERNAL void
+sylvan_memcache_drop(struct sylvan_inferior *inf, uintptr_t addr, size_t len) {
+
+    assert(inf); // should have been checked by the caller
+
+    struct sylvan_memcache *cache = inf->memcache;
+    if (!cache)
+        return;
+
+    for (size_t i = 0; i < SYLVAN_MEMCACHE_SLOTS; i++) {
+        struct sylvan_memcache_slot *slot = &cache->slots[i];
+        if (slot->addr + SYLVAN_MEMCACHE_PAGE_SIZE > addr && slot->addr < addr + len)
+            slot->generation = 0;
+    }
+}
+
+/**
+ * see lib/sylvan/memcache.h
+ */
+SYLVAN_INTERNAL void
+sylvan_memcache_invalidate(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    if (inf->memcache)
+        inf->memcache->generation++;
+}
+
+/**
+ * see lib/sylvan/memcache.h
+ */
+SYLVAN_INTERNAL void
+sylvan_memcache_destroy(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    free(inf->memcache);
+    inf->memcache = NULL;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#ifndef SYLVAN_MEMCACHE_H
+#define SYLVAN_MEMCACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sylvan/inferior.h>
+
+#define SYLVAN_MEMCACHE_PAGE_SIZE 0x1000UL
+#define SYLVAN_MEMCACHE_SLOTS 64        /* direct mapped by page number, 256 KiB per inferior */
+#define SYLVAN_MEMCACHE_FILL_MAX 16     /* pages one read may fill, longer reads go around the cache */
+
+/* a page of the process as the user sees it, with the bytes inserted int3s replaced */
+struct sylvan_memcache_slot {
+    uintptr_t addr;                     /* page address */
+    uint64_t generation;                /* holds addr while it's the cache's generation */
+    uint8_t data[SYLVAN_MEMCACHE_PAGE_SIZE];
+};
+
+/* pages read since the process last ran, allocated on the first read of a stop */
+struct sylvan_memcache {
+    uint64_t generation;                /* bumped by every resume, slots of older generations are empty */
+    struct sylvan_memcache_slot slots[SYLVAN_MEMCACHE_SLOTS];
+};
+
+/**
+ * reads len bytes at addr from the cache, filling the pages it misses with one process_vm_readv
+ * returns false if the read has to go to the process, when some thread of inf is running,
+ * a page can't be read or the read is longer than SYLVAN_MEMCACHE_FILL_MAX pages.
+ * like the symbol cache it never modifies sylvan_last_error
+ */
+bool sylvan_memcache_read(struct sylvan_inferior *inf, uintptr_t addr, void *buf, size_t len);
+
+/**
+ * copies len bytes written at addr into the cached pages they touch
+ */
+void sylvan_memcache_write(struct sylvan_inferior *inf, uintptr_t addr, const void *buf, size_t len);
+
+/**
+ * drops the cached pages the len bytes at addr touch, for writes the cache can't follow
+ */
+void sylvan_memcache_drop(struct sylvan_inferior *inf, uintptr_t addr, size_t len);
+
+/**
+ * empties the cache, called whenever a thread of inf may run or the process changes
+ */
+void sylvan_memcache_invalidate(struct sylvan_inferior *inf);
+
+void sylvan_memcache_destroy(struct sylvan_inferior *inf);
+
+#endif /* SYLVAN_MEMCACHE_H */
\ No newline at end of file
@@ -0,0 +1,165 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sylvan/inferior.h>
+#include "error.h"
+#include "profile.h"
+#include "sylvan.h"
+
+/* a line of the folded output */
+struct sylvan_folded_line {
+    char *text;
+    size_t count;
+};
+
+/**
+ * see lib/sylvan/profile.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_profile_create(struct sylvan_profile **profilep) {
+
+    assert(profilep); // should have been checked by the caller
+
+    if (!(*profilep = calloc(1, sizeof(**profilep))))
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    return SYLVANC_OK;
+}
+
+/**
+ * see lib/sylvan/profile.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_profile_add(struct sylvan_profile *profile, const struct sylvan_frame *frames, size_t count) {
+
+    assert(profile && (frames || !count)); // should have been checked by the caller
+
+    /* the pcs are the key, copied into a buffer of their own so frames can be anything */
+    uintptr_t pcs[SYLVAN_PROFILE_MAX_FRAMES];
+    if (count > SYLVAN_PROFILE_MAX_FRAMES)
+        count = SYLVAN_PROFILE_MAX_FRAMES;
+    for (size_t i = 0; i < count; i++)
+        pcs[i] = frames[i].pc;
+
+    struct sylvan_profile_stack *stack;
+    HASH_FIND(hh, profile->stacks, pcs, count * sizeof(uintptr_t), stack);
+    if (!stack) {
+        if (!(stack = malloc(sizeof(*stack) + count * sizeof(uintptr_t))))
+            return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+        stack->count = 0;
+        stack->depth = count;
+        memcpy(stack->pcs, pcs, count * sizeof(uintptr_t));
+        HASH_ADD_KEYPTR(hh, profile->stacks, stack->pcs, count * sizeof(uintptr_t), stack);
+    }
+
+    stack->count++;
+    return SYLVANC_OK;
+}
+
+/**
+ * writes the function pc is in, a return address is looked up before itself since a call
+ * to a function that doesn't return may be the last instruction of its caller
+ */
+static void
+sylvan_profile_put_frame(struct sylvan_inferior *inf, uintptr_t pc, bool caller, FILE *out) {
+
+    const char *name;
+    uintptr_t offset;
+    if (sylvan_sym_lookup_addr(inf, caller ? pc - 1 : pc, &name, &offset)) {
+        fprintf(out, "%#lx", pc);
+        return;
+    }
+
+    /* ';' separates the frames and the count follows the last space, names with them are rare but possible */
+    for (; *name; name++)
+        fputc(*name == ';' ? ':' : *name, out);
+}
+
+static int
+sylvan_folded_line_cmp(const void *a, const void *b) {
+    return strcmp(((const struct sylvan_folded_line *)a)->text, ((const struct sylvan_folded_line *)b)->text);
+}
+
+/**
+ * see include/sylvan/profile.h
+ */
+sylvan_code_t sylvan_profile_write_folded(struct sylvan_inferior *inf, const struct sylvan_profile *profile, FILE *file) {
+    if (inf == NULL || profile == NULL || file == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    size_t count = HASH_COUNT(profile->stacks);
+    struct sylvan_folded_line *lines = calloc(count ? count : 1, sizeof(*lines));
+    if (!lines)
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    sylvan_code_t code = SYLVANC_OK;
+    size_t n = 0;
+    struct sylvan_profile_stack *stack, *tmp;
+    HASH_ITER(hh, profile->stacks, stack, tmp) {
+        size_t len;
+        FILE *out = open_memstream(&lines[n].text, &len);
+        if (!out) {
+            code = sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+            break;
+        }
+
+        for (size_t i = stack->depth; i-- > 0;) {
+            sylvan_profile_put_frame(inf, stack->pcs[i], i > 0, out);
+            if (i)
+                fputc(';', out);
+        }
+
+        if (fclose(out)) {
+            free(lines[n].text);
+            code = sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+            break;
+        }
+        lines[n++].count = stack->count;
+    }
+
+    /* stacks that differ only in where inside the same functions they were sampled are one line */
+    if (!code) {
+        qsort(lines, n, sizeof(*lines), sylvan_folded_line_cmp);
+        for (size_t i = 0; i < n;) {
+            size_t total = 0, j = i;
+            for (; j < n && strcmp(lines[j].text, lines[i].text) == 0; j++)
+                total += lines[j].count;
+
+            if (*lines[i].text)
+                fprintf(file, "%s %zu\n", lines[i].text, total);
+            i = j;
+        }
+
+        if (fflush(file) || ferror(file))
+            code = sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "Can't write the folded stacks");
+    }
+
+    for (size_t i = 0; i < n; i++)
+        free(lines[i].text);
+    free(lines);
+
+    return code;
+}
+
+/**
+ * see include/sylvan/profile.h
+ */
+void sylvan_profile_free(struct sylvan_profile *profile) {
+    if (profile == NULL)
+        return;
+
+    struct sylvan_profile_stack *stack, *tmp;
+    HASH_ITER(hh, profile->stacks, stack, tmp) {
+        HASH_DEL(profile->stacks, stack);
+        free(stack);
+    }
+
+    free(profile);
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef SYLVAN_PROFILE_H
+#define SYLVAN_PROFILE_H
+
+#include <uthash.h>
+#include <sylvan/profile.h>
+#include <sylvan/unwind.h>
+
+/* a distinct stack and how often it was sampled */
+struct sylvan_profile_stack {
+    size_t count;
+    size_t depth;
+    UT_hash_handle hh;          /* sylvan_profile.stacks */
+    uintptr_t pcs[];            /* hash key, innermost first */
+};
+
+sylvan_code_t sylvan_profile_create(struct sylvan_profile **profilep);
+
+/**
+ * counts a sample of the stack in frames
+ */
+sylvan_code_t sylvan_profile_add(struct sylvan_profile *profile, const struct sylvan_frame *frames, size_t count);
+
+#endif /* SYLVAN_PROFILE_H */
\ No newline at end of file
@@ -0,0 +1,394 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sylvan/inferior.h>
+#include "breakpoint.h"
+#include "error.h"
+#include "solib.h"
+#include "sylvan.h"
+#include "symbol.h"
+#include "unwind.h"
+
+#define SYLVAN_SOLIB_MAX 4096           /* bound on list walks, in case the process corrupted them */
+#define SYLVAN_PAGE_SIZE 0x1000UL
+
+/* what the kernel told the process about its image */
+struct sylvan_auxv {
+    uintptr_t phdr;
+    uintptr_t phnum;
+    uintptr_t entry;
+    uintptr_t base;                     /* load address of the dynamic linker, 0 for static executables */
+};
+
+static sylvan_code_t
+sylvan_solib_read_auxv(struct sylvan_inferior *inf, struct sylvan_auxv *auxv) {
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/auxv", inf->pid);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "open %s", path);
+
+    memset(auxv, 0, sizeof(*auxv));
+
+    Elf64_auxv_t entries[64];
+    bool done = false;
+    while (!done) {
+        ssize_t n = read(fd, entries, sizeof(entries));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+
+        for (size_t i = 0; i < (size_t)n / sizeof(Elf64_auxv_t) && !done; i++)
+            switch (entries[i].a_type) {
+                case AT_PHDR:   auxv->phdr = entries[i].a_un.a_val; break;
+                case AT_PHNUM:  auxv->phnum = entries[i].a_un.a_val; break;
+                case AT_ENTRY:  auxv->entry = entries[i].a_un.a_val; break;
+                case AT_BASE:   auxv->base = entries[i].a_un.a_val; break;
+                case AT_NULL:   done = true; break;
+            }
+    }
+
+    close(fd);
+    return SYLVANC_OK;
+}
+
+/**
+ * reads a NUL terminated string, a page at a time so it doesn't fail on the page after the string
+ */
+static sylvan_code_t
+sylvan_solib_read_string(struct sylvan_inferior *inf, uintptr_t addr, char *buf, size_t size) {
+    size_t done = 0;
+    while (done + 1 < size) {
+        size_t len = SYLVAN_PAGE_SIZE - ((addr + done) & (SYLVAN_PAGE_SIZE - 1));
+        if (len > size - 1 - done)
+            len = size - 1 - done;
+
+        sylvan_code_t code;
+        if ((code = sylvan_read_memory(inf, addr + done, buf + done, len)))
+            return code;
+
+        char *nul = memchr(buf + done, '\0', len);
+        if (nul)
+            return SYLVANC_OK;
+        done += len;
+    }
+
+    buf[done] = '\0';
+    return SYLVANC_OK;
+}
+
+/**
+ * finds the runtime address of the executable's dynamic section and the path of its interpreter
+ * through the program headers the kernel mapped at AT_PHDR
+ */
+static sylvan_code_t
+sylvan_solib_read_image(struct sylvan_inferior *inf, const struct sylvan_auxv *auxv, uintptr_t *dynamic, char *interp, size_t size) {
+    *dynamic = 0;
+    interp[0] = '\0';
+
+    if (!auxv->phdr || !auxv->phnum || auxv->phnum > SYLVAN_SOLIB_MAX)
+        return SYLVANC_OK;
+
+    Elf64_Phdr *phdrs = malloc(auxv->phnum * sizeof(Elf64_Phdr));
+    if (!phdrs)
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    sylvan_code_t code;
+    if ((code = sylvan_read_memory(inf, auxv->phdr, phdrs, auxv->phnum * sizeof(Elf64_Phdr)))) {
+        free(phdrs);
+        return code;
+    }
+
+    /* PT_PHDR is where the headers were linked to be, the difference is the load bias */
+    uintptr_t bias = 0;
+    for (size_t i = 0; i < auxv->phnum; i++)
+        if (phdrs[i].p_type == PT_PHDR)
+            bias = auxv->phdr - phdrs[i].p_vaddr;
+
+    uintptr_t interp_addr = 0;
+    for (size_t i = 0; i < auxv->phnum; i++) {
+        if (phdrs[i].p_type == PT_DYNAMIC)
+            *dynamic = bias + phdrs[i].p_vaddr;
+        else
+        if (phdrs[i].p_type == PT_INTERP)
+            interp_addr = bias + phdrs[i].p_vaddr;
+    }
+    free(phdrs);
+
+    if (interp_addr)
+        return sylvan_solib_read_string(inf, interp_addr, interp, size);
+
+    return SYLVANC_OK;
+}
+
+/**
+ * reads DT_DEBUG out of the executable's dynamic section, the dynamic linker stores &_r_debug there
+ * leaves inf->r_debug at 0 if it hasn't done that yet
+ */
+static sylvan_code_t
+sylvan_solib_find_r_debug(struct sylvan_inferior *inf) {
+    sylvan_code_t code;
+    struct sylvan_auxv auxv;
+    if ((code = sylvan_solib_read_auxv(inf, &auxv)))
+        return code;
+
+    uintptr_t dynamic;
+    char interp[PATH_MAX];
+    if ((code = sylvan_solib_read_image(inf, &auxv, &dynamic, interp, sizeof(interp))))
+        return code;
+
+    for (int i = 0; dynamic && i < SYLVAN_SOLIB_MAX; i++) {
+        Elf64_Dyn dyn;
+        if ((code = sylvan_read_memory(inf, dynamic + i * sizeof(Elf64_Dyn), &dyn, sizeof(dyn))))
+            return code;
+
+        if (dyn.d_tag == DT_NULL)
+            break;
+
+        if (dyn.d_tag == DT_DEBUG) {
+            inf->r_debug = dyn.d_un.d_ptr;
+            break;
+        }
+    }
+
+    return SYLVANC_OK;
+}
+
+/**
+ * see lib/sylvan/solib.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_solib_find_load_bias(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    inf->load_bias = 0;
+    if (!inf->realpath)
+        return SYLVANC_OK;
+
+    sylvan_code_t code;
+    struct sylvan_auxv auxv;
+    if ((code = sylvan_solib_read_auxv(inf, &auxv)))
+        return code;
+
+    int fd = open(inf->realpath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "open %.256s", inf->realpath);
+
+    Elf64_Ehdr ehdr;
+    ssize_t n = pread(fd, &ehdr, sizeof(ehdr), 0);
+    close(fd);
+
+    /* only a position independent executable is moved, AT_ENTRY is its entry point after the move */
+    if (n == sizeof(ehdr) && !memcmp(ehdr.e_ident, ELFMAG, SELFMAG) && ehdr.e_type == ET_DYN && auxv.entry)
+        inf->load_bias = auxv.entry - ehdr.e_entry;
+
+    return SYLVANC_OK;
+}
+
+static void
+sylvan_solib_free(struct sylvan_solib *solib) {
+    sylvan_sym_table_destroy(&solib->table);
+    sylvan_sym_strings_destroy(&solib->strings);
+    free(solib->path);
+    free(solib);
+}
+
+/**
+ * loads the symbols of the object at path, relocated by base, and appends it to the list
+ * an object that can't be read is kept with no symbols so it isn't retried on every event
+ */
+static sylvan_code_t
+sylvan_solib_add(struct sylvan_inferior *inf, const char *path, uintptr_t base, struct sylvan_solib **solibp) {
+    struct sylvan_solib *solib = calloc(1, sizeof(struct sylvan_solib));
+    if (!solib || !(solib->path = strdup(path))) {
+        free(solib);
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+    }
+
+    sylvan_code_t code;
+    if ((code = sylvan_sym_table_init(&solib->table))) {
+        sylvan_solib_free(solib);
+        return code;
+    }
+
+    solib->base = base;
+    solib->seen = true;
+
+    if (sylvan_sym_load_elf(path, &solib->strings, &solib->table) == SYLVANC_OK) {
+        for (size_t i = 0; i < solib->table.count; i++)
+            solib->table.symbols[i].addr += base;
+        solib->table.text_end += base;
+    }
+
+    if ((code = sylvan_sym_table_sort(&solib->table))) {
+        sylvan_solib_free(solib);
+        return code;
+    }
+
+    struct sylvan_solib **tail = &inf->solibs;
+    while (*tail)
+        tail = &(*tail)->next;
+    *tail = solib;
+
+    if (solibp)
+        *solibp = solib;
+    return SYLVANC_OK;
+}
+
+/**
+ * see lib/sylvan/solib.h
+ */
+SYLVAN_INTERNAL void
+sylvan_solib_clear(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    if (inf->solib_breakpoint)
+        sylvan_breakpoint_delete(inf, inf->solib_breakpoint);
+
+    struct sylvan_solib *solib = inf->solibs;
+    while (solib) {
+        struct sylvan_solib *next = solib->next;
+        sylvan_solib_free(solib);
+        solib = next;
+    }
+
+    inf->solibs = NULL;
+    inf->r_debug = 0;
+    sylvan_unwind_destroy(inf);
+}
+
+/**
+ * see lib/sylvan/solib.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_solib_update(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    sylvan_code_t code;
+    if (!inf->r_debug && (code = sylvan_solib_find_r_debug(inf)))
+        return code;
+
+    if (!inf->r_debug)
+        return SYLVANC_OK;
+
+    struct r_debug r_debug;
+    if ((code = sylvan_read_memory(inf, inf->r_debug, &r_debug, sizeof(r_debug))))
+        return code;
+
+    /* the hook runs before and after every change, the list is only valid once it's consistent */
+    if (r_debug.r_state != RT_CONSISTENT)
+        return SYLVANC_OK;
+
+    for (struct sylvan_solib *solib = inf->solibs; solib; solib = solib->next)
+        solib->seen = false;
+
+    uintptr_t map_addr = (uintptr_t)r_debug.r_map;
+    for (int i = 0; map_addr && i < SYLVAN_SOLIB_MAX; i++) {
+        struct link_map map;
+        if ((code = sylvan_read_memory(inf, map_addr, &map, sizeof(map))))
+            return code;
+        map_addr = (uintptr_t)map.l_next;
+
+        /* the executable has an empty name and the vdso has no file behind it */
+        char path[PATH_MAX];
+        if (!map.l_name || sylvan_solib_read_string(inf, (uintptr_t)map.l_name, path, sizeof(path)) || !strchr(path, '/'))
+            continue;
+
+        struct sylvan_solib *solib;
+        for (solib = inf->solibs; solib; solib = solib->next)
+            if (solib->base == map.l_addr && !strcmp(solib->path, path))
+                break;
+
+        if (solib)
+            solib->seen = true;
+        else
+        if ((code = sylvan_solib_add(inf, path, map.l_addr, NULL)))
+            return code;
+    }
+
+    bool unloaded = false;
+    struct sylvan_solib **solibp = &inf->solibs;
+    while (*solibp) {
+        struct sylvan_solib *solib = *solibp;
+        if (solib->seen) {
+            solibp = &solib->next;
+            continue;
+        }
+        *solibp = solib->next;
+        sylvan_solib_free(solib);
+        unloaded = true;
+    }
+
+    /* another object may be loaded where it was, what was unwound through it is forgotten */
+    if (unloaded)
+        sylvan_unwind_destroy(inf);
+
+    /* breakpoints in an unloaded object go back to pending, the same library may come back elsewhere */
+    return sylvan_breakpoint_resolve(inf, unloaded);
+}
+
+/**
+ * see lib/sylvan/solib.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_solib_start(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    sylvan_code_t code;
+    struct sylvan_auxv auxv;
+    if ((code = sylvan_solib_read_auxv(inf, &auxv)))
+        return code;
+
+    if (!auxv.base)
+        return SYLVANC_OK;
+
+    uintptr_t dynamic;
+    char interp[PATH_MAX];
+    if ((code = sylvan_solib_read_image(inf, &auxv, &dynamic, interp, sizeof(interp))))
+        return code;
+
+    if (!interp[0])
+        return SYLVANC_OK;
+
+    /* the dynamic linker is mapped before the process runs, its own hook is all we need from it for now */
+    struct sylvan_solib *ldso;
+    if ((code = sylvan_solib_add(inf, interp, auxv.base, &ldso)))
+        return code;
+
+    struct symbol *hook = sylvan_sym_table_lookup(&ldso->table, "_dl_debug_state");
+    uintptr_t brk = hook ? hook->addr : 0;
+
+    /* an attached process is past startup, r_brk is authoritative and the list is already there */
+    if ((code = sylvan_solib_find_r_debug(inf)))
+        return code;
+
+    if (inf->r_debug) {
+        struct r_debug r_debug;
+        if ((code = sylvan_read_memory(inf, inf->r_debug, &r_debug, sizeof(r_debug))))
+            return code;
+        if (r_debug.r_brk)
+            brk = r_debug.r_brk;
+    }
+
+    /* a user breakpoint already there can't be shared, loads just aren't tracked then */
+    if (brk && (code = sylvan_breakpoint_set_internal(inf, brk, &inf->solib_breakpoint)) && code != SYVLANC_BREAKPOINT_ALREADY_EXISTS)
+        return code;
+
+    return inf->r_debug ? sylvan_solib_update(inf) : SYLVANC_OK;
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef SYLVAN_SOLIB_H
+#define SYLVAN_SOLIB_H
+
+#include <sylvan/inferior.h>
+
+/**
+ * forgets the shared objects and the internal breakpoint of the previous process without touching memory
+ * called before the breakpoints are inserted in a new process
+ */
+void sylvan_solib_clear(struct sylvan_inferior *inf);
+
+/**
+ * sets inf->load_bias from AT_ENTRY and the entry point in the executable's header
+ * the executable's symbol tables keep their link time addresses, lookups add the bias
+ */
+sylvan_code_t sylvan_solib_find_load_bias(struct sylvan_inferior *inf);
+
+/**
+ * loads the dynamic linker's symbols and sets the internal breakpoint on _dl_debug_state
+ * picks up what is already loaded when attaching, a static executable has nothing to track
+ */
+sylvan_code_t sylvan_solib_start(struct sylvan_inferior *inf);
+
+/**
+ * called when the internal breakpoint is hit, loads the symbols of new objects in link_map
+ * and drops the ones that were unloaded
+ */
+sylvan_code_t sylvan_solib_update(struct sylvan_inferior *inf);
+
+#endif /* SYLVAN_SOLIB_H */
\ No newline at end of file
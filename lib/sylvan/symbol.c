@@ -3,26 +3,184 @@
 #include <fcntl.h>
 #include <gelf.h>
 #include <libelf.h>
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <assert.h>
 
 #include <sylvan/inferior.h>
 #include "error.h"
+#include "line.h"
 #include "sylvan.h"
 #include "symbol.h"
+#include "symcache.h"
+#include "unwind.h"
+
+#define SYLVAN_ARENA_BLOCK_SIZE (64 * 1024)
+#define SYLVAN_INTERN_INITIAL_SLOTS 1024
+#define SYLVAN_DWARF_MAX_WORKERS 16
+
+struct sylvan_arena_block {
+    struct sylvan_arena_block *next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+/**
+ * bump allocates len bytes from the newest block, starting a new block when it's full
+ */
+static char *
+sylvan_arena_alloc(struct sylvan_sym_strings *strings, size_t len) {
+    struct sylvan_arena_block *block = strings->blocks;
+
+    if (!block || block->size - block->used < len) {
+        size_t size = len > SYLVAN_ARENA_BLOCK_SIZE ? len : SYLVAN_ARENA_BLOCK_SIZE;
+        if (!(block = malloc(sizeof(struct sylvan_arena_block) + size)))
+            return NULL;
+        block->next = strings->blocks;
+        block->used = 0;
+        block->size = size;
+        strings->blocks = block;
+    }
 
+    char *ptr = block->data + block->used;
+    block->used += len;
+    return ptr;
+}
 
-static sylvan_code_t
+static uint64_t
+sylvan_intern_hash(const char *str) {
+    uint64_t hash = 0xcbf29ce484222325ULL;     /* FNV-1a */
+    for (; *str; str++)
+        hash = (hash ^ (unsigned char)*str) * 0x100000001b3ULL;
+    return hash;
+}
+
+/**
+ * doubles the slot array, false if out of memory
+ * doesn't set the error code since the dwarf workers call it off the main thread
+ */
+static bool
+sylvan_intern_grow(struct sylvan_sym_strings *strings) {
+    size_t slot_count = strings->slot_count ? strings->slot_count * 2 : SYLVAN_INTERN_INITIAL_SLOTS;
+    const char **slots = calloc(slot_count, sizeof(const char *));
+    if (!slots)
+        return false;
+
+    for (size_t i = 0; i < strings->slot_count; i++) {
+        const char *str = strings->slots[i];
+        if (!str)
+            continue;
+        size_t j = sylvan_intern_hash(str) & (slot_count - 1);
+        while (slots[j])
+            j = (j + 1) & (slot_count - 1);
+        slots[j] = str;
+    }
+
+    free(strings->slots);
+    strings->slots = slots;
+    strings->slot_count = slot_count;
+    return true;
+}
+
+/**
+ * returns the single arena copy of name, NULL if out of memory
+ * the caller sets the error code, workers report it through their failed flag
+ */
+static const char *
+sylvan_intern(struct sylvan_sym_strings *strings, const char *name) {
+    if (strings->used * 2 >= strings->slot_count && !sylvan_intern_grow(strings))
+        return NULL;
+
+    size_t mask = strings->slot_count - 1;
+    size_t i = sylvan_intern_hash(name) & mask;
+    for (; strings->slots[i]; i = (i + 1) & mask)
+        if (strcmp(strings->slots[i], name) == 0)
+            return strings->slots[i];
+
+    size_t len = strlen(name) + 1;
+    char *copy = sylvan_arena_alloc(strings, len);
+    if (!copy)
+        return NULL;
+    memcpy(copy, name, len);
+
+    strings->slots[i] = copy;
+    strings->used++;
+    return copy;
+}
+
+/* compile units found by the header scan, parsed on the first lookup */
+struct sylvan_dwarf_index {
+    char *path;
+    struct sylvan_symcache cache;   /* written once the units are parsed */
+    Dwarf_Off *cu_offsets;      /* offsets of the CU DIEs in .debug_info */
+    size_t cu_count;
+};
+
+struct sylvan_dwarf_entry {
+    const char *name;
+    uintptr_t addr;
+    size_t size;
+};
+
+/* a worker has its own Dwarf_Debug, libdwarf handles can't be shared between threads */
+struct sylvan_dwarf_worker {
+    pthread_t thread;
+    const struct sylvan_dwarf_index *index;
+    atomic_size_t *next_cu;
+    struct sylvan_sym_strings strings;  /* worker local, interned again when merged */
+    struct sylvan_dwarf_entry *entries;
+    size_t count;
+    size_t capacity;
+    bool failed;                        /* ran out of memory, some entries are missing */
+};
+
+static void
+sylvan_dwarf_index_destroy(struct sylvan_dwarf_index *index) {
+    if (!index)
+        return;
+    free(index->path);
+    free(index->cu_offsets);
+    sylvan_symcache_destroy(&index->cache);
+    free(index);
+}
+
+SYLVAN_INTERNAL void
+sylvan_sym_strings_destroy(struct sylvan_sym_strings *strings) {
+    struct sylvan_arena_block *block = strings->blocks;
+    while (block) {
+        struct sylvan_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(strings->slots);
+    if (strings->map)
+        munmap(strings->map, strings->map_size);
+    strings->map = NULL;
+    strings->map_size = 0;
+    strings->blocks = NULL;
+    strings->slots = NULL;
+    strings->slot_count = 0;
+    strings->used = 0;
+}
+
+
+SYLVAN_INTERNAL sylvan_code_t
 sylvan_sym_table_init(struct sylvan_sym_table *sym_table) {
     assert(sym_table);
 
     sym_table->count = 0;
     sym_table->capacity = 256;
+    sym_table->by_addr = NULL;
+    sym_table->text_end = 0;
     sym_table->symbols = malloc(sym_table->capacity * sizeof(struct symbol));
     if (!sym_table->symbols)
         return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
@@ -34,6 +192,8 @@ SYLVAN_INTERNAL sylvan_code_t
 sylvan_sym_init(struct sylvan_inferior *inf) {
     assert(inf);
 
+    inf->load_bias = 0;
+
     sylvan_code_t code;
     if ((code = sylvan_sym_table_init(&inf->elf_table)))
         return code;
@@ -44,19 +204,19 @@ sylvan_sym_init(struct sylvan_inferior *inf) {
     return SYLVANC_OK;
 }
 
-static sylvan_code_t
+SYLVAN_INTERNAL sylvan_code_t
 sylvan_sym_table_destroy(struct sylvan_sym_table *sym_table) {    
     if (!sym_table)
         return SYLVANC_OK;
 
-    int count = sym_table->count;
-    for (int i = 0; i < count; i++)
-        free(sym_table->symbols[i].name);
     free(sym_table->symbols);
+    free(sym_table->by_addr);
 
     sym_table->capacity = 0;
     sym_table->count = 0;
     sym_table->symbols = NULL;
+    sym_table->by_addr = NULL;
+    sym_table->text_end = 0;
 
     return SYLVANC_OK;
 }
@@ -72,12 +232,18 @@ sylvan_sym_destroy(struct sylvan_inferior *inf) {
     if ((code = sylvan_sym_table_destroy(&inf->dwarf_table)))
         return code;
 
+    sylvan_sym_strings_destroy(&inf->sym_strings);
+    sylvan_dwarf_index_destroy(inf->dwarf_index);
+    inf->dwarf_index = NULL;
+    sylvan_line_destroy(inf);
+    sylvan_unwind_destroy(inf);
+
     return SYLVANC_OK;
 }
 
 static sylvan_code_t
-sylvan_sym_add(struct sylvan_sym_table *sym_table, const char *name, uintptr_t addr) {
-    assert(sym_table);
+sylvan_sym_add(struct sylvan_sym_strings *strings, struct sylvan_sym_table *sym_table, const char *name, uintptr_t addr, size_t size) {
+    assert(strings && sym_table);
 
     if (sym_table->count == sym_table->capacity) {
         sym_table->capacity <<= 1;
@@ -87,8 +253,10 @@ sylvan_sym_add(struct sylvan_sym_table *sym_table, const char *name, uintptr_t a
         sym_table->symbols = symbols;
     }
 
-    sym_table->symbols[sym_table->count].name = strdup(name);
+    if (!(sym_table->symbols[sym_table->count].name = sylvan_intern(strings, name)))
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
     sym_table->symbols[sym_table->count].addr = addr;
+    sym_table->symbols[sym_table->count].size = size;
     sym_table->count++;
 
     return SYLVANC_OK;
@@ -101,15 +269,180 @@ symcmp(const void *l, const void *r) {
     return strcmp(syml->name, symr->name);
 }
 
+/**
+ * address order, symbols with a known size first among aliases
+ */
+static int
+symaddrcmp(const void *l, const void *r) {
+    const struct symbol *syml = *(struct symbol *const *)l;
+    const struct symbol *symr = *(struct symbol *const *)r;
+    if (syml->addr != symr->addr)
+        return syml->addr < symr->addr ? -1 : 1;
+    if (!syml->size != !symr->size)
+        return syml->size ? -1 : 1;
+    return strcmp(syml->name, symr->name);
+}
+
 static struct symbol *
 sym_lookup(struct sylvan_sym_table *sym_table, const char *name) {
     struct symbol key;
-    key.name = (char *)name;
+    key.name = name;
     return bsearch(&key, sym_table->symbols, sym_table->count, sizeof(struct symbol), symcmp);
 }
 
+SYLVAN_INTERNAL struct symbol *
+sylvan_sym_table_lookup(struct sylvan_sym_table *sym_table, const char *name) {
+    return sym_lookup(sym_table, name);
+}
+
+/**
+ * sorts the table by name and builds the address index over it
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_sym_table_sort(struct sylvan_sym_table *sym_table) {
+    qsort(sym_table->symbols, sym_table->count, sizeof(struct symbol), symcmp);
+
+    free(sym_table->by_addr);
+    sym_table->by_addr = malloc((sym_table->count ? sym_table->count : 1) * sizeof(struct symbol *));
+    if (!sym_table->by_addr)
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    for (size_t i = 0; i < sym_table->count; i++)
+        sym_table->by_addr[i] = &sym_table->symbols[i];
+    qsort(sym_table->by_addr, sym_table->count, sizeof(struct symbol *), symaddrcmp);
+
+    return SYLVANC_OK;
+}
+
+/**
+ * binary search for the symbol that contains addr
+ * a symbol of unknown size extends up to the next symbol, the last one up to the end of the object's text
+ */
+static struct symbol *
+sym_lookup_addr(struct sylvan_sym_table *sym_table, uintptr_t addr) {
+    if (!sym_table->by_addr)
+        return NULL;
+
+    size_t lo = 0, hi = sym_table->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sym_table->by_addr[mid]->addr <= addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (!lo)
+        return NULL;
+
+    /* aliases at that address are ordered sized first, take the first one that covers addr */
+    size_t i = lo - 1;
+    while (i > 0 && sym_table->by_addr[i - 1]->addr == sym_table->by_addr[i]->addr)
+        i--;
+
+    for (; i < lo; i++) {
+        struct symbol *sym = sym_table->by_addr[i];
+        if (sym->size ? addr - sym->addr < sym->size : addr < sym_table->text_end)
+            return sym;
+    }
+    return NULL;
+}
+
+/**
+ * collects the subprograms that are direct children of cu_die, false if out of memory
+ */
+static bool
+sylvan_dwarf_parse_cu(Dwarf_Debug dbg, Dwarf_Die cu_die, struct sylvan_dwarf_worker *worker) {
+    Dwarf_Error err;
+    Dwarf_Die child_die;
+    if (dwarf_child(cu_die, &child_die, &err) != DW_DLV_OK)
+        return true;
+
+    for (;;) {
+        Dwarf_Half tag;
+        if (dwarf_tag(child_die, &tag, &err) != DW_DLV_OK)
+            break;
+
+        char *name = NULL;
+        Dwarf_Addr lowpc, highpc;
+        Dwarf_Half form;
+        enum Dwarf_Form_Class formclass;
+        if (tag == DW_TAG_subprogram && dwarf_diename(child_die, &name, &err) == DW_DLV_OK && name &&
+            dwarf_lowpc(child_die, &lowpc, &err) == DW_DLV_OK) {
+            size_t size = 0;
+            /* DWARF 4+ stores high_pc as the size, older versions as an address */
+            if (dwarf_highpc_b(child_die, &highpc, &form, &formclass, &err) == DW_DLV_OK)
+                size = formclass == DW_FORM_CLASS_CONSTANT ? highpc : highpc > lowpc ? highpc - lowpc : 0;
+
+            if (worker->count == worker->capacity) {
+                size_t capacity = worker->capacity ? worker->capacity * 2 : 256;
+                struct sylvan_dwarf_entry *entries = realloc(worker->entries, capacity * sizeof(struct sylvan_dwarf_entry));
+                if (!entries) {
+                    dwarf_dealloc_die(child_die);
+                    return false;
+                }
+                worker->entries = entries;
+                worker->capacity = capacity;
+            }
+
+            const char *interned = sylvan_intern(&worker->strings, name);
+            if (!interned) {
+                dwarf_dealloc_die(child_die);
+                return false;
+            }
+            worker->entries[worker->count++] = (struct sylvan_dwarf_entry){ interned, (uintptr_t)lowpc, size };
+        }
+
+        Dwarf_Die next_die;
+        int sres = dwarf_siblingof_b(dbg, child_die, true, &next_die, &err);
+        dwarf_dealloc_die(child_die);
+        if (sres != DW_DLV_OK)
+            return true;
+        child_die = next_die;
+    }
+
+    dwarf_dealloc_die(child_die);
+    return true;
+}
+
+/**
+ * takes compile units off the shared counter until none are left
+ */
+static void *
+sylvan_dwarf_worker_run(void *arg) {
+    struct sylvan_dwarf_worker *worker = arg;
+    const struct sylvan_dwarf_index *index = worker->index;
+
+    Dwarf_Debug dbg = 0;
+    Dwarf_Error err;
+    if (dwarf_init_path(index->path, NULL, 0, DW_GROUPNUMBER_ANY, NULL, NULL, &dbg, &err) != DW_DLV_OK)
+        return NULL;
+
+    for (;;) {
+        size_t i = atomic_fetch_add(worker->next_cu, 1);
+        if (i >= index->cu_count)
+            break;
+
+        Dwarf_Die cu_die;
+        if (dwarf_offdie_b(dbg, index->cu_offsets[i], true, &cu_die, &err) != DW_DLV_OK)
+            continue;
+
+        bool parsed = sylvan_dwarf_parse_cu(dbg, cu_die, worker);
+        dwarf_dealloc_die(cu_die);
+        if (!parsed) {
+            worker->failed = true;
+            break;
+        }
+    }
+
+    dwarf_finish(dbg);
+    return NULL;
+}
+
+/**
+ * records where each compile unit starts without looking at its DIEs
+ */
 static sylvan_code_t
-sylvan_sym_load_dwarf(const char *path, struct sylvan_sym_table *sym_table) {
+sylvan_sym_index_dwarf(const char *path, struct sylvan_dwarf_index **indexp) {
     Dwarf_Debug dbg = 0;
     Dwarf_Error err;
     Dwarf_Unsigned next_cu_header = 0;
@@ -117,6 +450,14 @@ sylvan_sym_load_dwarf(const char *path, struct sylvan_sym_table *sym_table) {
     if (dwarf_init_path(path, NULL, 0, DW_GROUPNUMBER_ANY, NULL, NULL, &dbg, &err) != DW_DLV_OK)
         return SYLVANC_DWARF_NOT_FOUND;
 
+    struct sylvan_dwarf_index *index = calloc(1, sizeof(struct sylvan_dwarf_index));
+    if (!index || !(index->path = strdup(path))) {
+        free(index);
+        dwarf_finish(dbg);
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+    }
+
+    size_t capacity = 0;
     for (;;) {
         Dwarf_Die cu_die = 0;
         Dwarf_Unsigned cu_header_length = 0;
@@ -135,49 +476,98 @@ sylvan_sym_load_dwarf(const char *path, struct sylvan_sym_table *sym_table) {
             &abbrev_offset, &address_size, &offset_size, &extension_size,
             &signature, &typeoffset, &next_cu_header, &header_cu_type, &err);
 
-        if (res == DW_DLV_NO_ENTRY)
+        if (res != DW_DLV_OK)
             break;
 
-        if (res == DW_DLV_ERROR) {
-            dwarf_finish(dbg);
-            return SYLVANC_OK;
-        }
-
-        Dwarf_Die child_die;
-        if (dwarf_child(cu_die, &child_die, &err) != DW_DLV_OK)
+        Dwarf_Off offset;
+        int ores = dwarf_dieoffset(cu_die, &offset, &err);
+        dwarf_dealloc_die(cu_die);
+        if (ores != DW_DLV_OK)
             continue;
 
-        for (;;) {
-            Dwarf_Half tag;
-            if (dwarf_tag(child_die, &tag, &err) != DW_DLV_OK)
-                break;
-
-            if (tag == DW_TAG_subprogram) {
-                char *name = NULL;
-                if (dwarf_diename(child_die, &name, &err) == DW_DLV_OK && name) {
-                    Dwarf_Addr lowpc;
-                    if (dwarf_lowpc(child_die, &lowpc, &err) == DW_DLV_OK)
-                        sylvan_sym_add(sym_table, name, (unsigned long)lowpc);
-                }
+        if (index->cu_count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            Dwarf_Off *offsets = realloc(index->cu_offsets, capacity * sizeof(Dwarf_Off));
+            if (!offsets) {
+                sylvan_dwarf_index_destroy(index);
+                dwarf_finish(dbg);
+                return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
             }
-
-            Dwarf_Die next_die;
-            int sres = dwarf_siblingof_b(dbg, child_die, true, &next_die, &err);
-            if (sres == DW_DLV_NO_ENTRY)
-                break;
-            if (sres == DW_DLV_ERROR)
-                break;
-            child_die = next_die;
+            index->cu_offsets = offsets;
         }
+        index->cu_offsets[index->cu_count++] = offset;
     }
 
     dwarf_finish(dbg);
+    *indexp = index;
     return SYLVANC_OK;
-
 }
 
+/**
+ * parses the indexed compile units on a pool of threads, one per core, and fills dwarf_table
+ * the calling thread is one of the workers
+ */
 static sylvan_code_t
-sylvan_sym_load_elf(const char *path, struct sylvan_sym_table *sym_table) {
+sylvan_sym_dwarf_ensure(struct sylvan_inferior *inf) {
+    struct sylvan_dwarf_index *index = inf->dwarf_index;
+    if (!index)
+        return SYLVANC_OK;
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t worker_count = cpus > 0 ? (size_t)cpus : 1;
+    if (worker_count > SYLVAN_DWARF_MAX_WORKERS)
+        worker_count = SYLVAN_DWARF_MAX_WORKERS;
+    if (worker_count > index->cu_count)
+        worker_count = index->cu_count ? index->cu_count : 1;
+
+    struct sylvan_dwarf_worker *workers = calloc(worker_count, sizeof(struct sylvan_dwarf_worker));
+    if (!workers)
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    atomic_size_t next_cu = 0;
+    size_t started = 0;
+    for (size_t i = 0; i < worker_count; i++) {
+        workers[i].index = index;
+        workers[i].next_cu = &next_cu;
+    }
+
+    /* if a thread can't be started the others pick up its share */
+    for (size_t i = 1; i < worker_count; i++) {
+        if (pthread_create(&workers[i].thread, NULL, sylvan_dwarf_worker_run, &workers[i]))
+            break;
+        started++;
+    }
+    sylvan_dwarf_worker_run(&workers[0]);
+    for (size_t i = 1; i <= started; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    /* workers can't touch the error state, it isn't thread local */
+    sylvan_code_t code = SYLVANC_OK;
+    for (size_t i = 0; i < worker_count; i++)
+        if (workers[i].failed)
+            code = sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    for (size_t i = 0; i < worker_count; i++) {
+        for (size_t j = 0; j < workers[i].count && !code; j++) {
+            struct sylvan_dwarf_entry *entry = &workers[i].entries[j];
+            code = sylvan_sym_add(&inf->sym_strings, &inf->dwarf_table, entry->name, entry->addr, entry->size);
+        }
+        free(workers[i].entries);
+        sylvan_sym_strings_destroy(&workers[i].strings);
+    }
+    free(workers);
+
+    if (!code && !(code = sylvan_sym_table_sort(&inf->dwarf_table)))
+        sylvan_symcache_store(&index->cache, &inf->elf_table, &inf->dwarf_table);
+
+    sylvan_dwarf_index_destroy(index);
+    inf->dwarf_index = NULL;
+
+    return code;
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_sym_load_elf(const char *path, struct sylvan_sym_strings *strings, struct sylvan_sym_table *sym_table) {
     if (elf_version(EV_CURRENT) == EV_NONE)
         return sylvan_set_code(SYLVANC_ELF_FAILED);
 
@@ -220,9 +610,12 @@ sylvan_sym_load_elf(const char *path, struct sylvan_sym_table *sym_table) {
             if (!(target_shdr.sh_flags & SHF_EXECINSTR))
                 continue;
 
+            if (target_shdr.sh_addr + target_shdr.sh_size > sym_table->text_end)
+                sym_table->text_end = target_shdr.sh_addr + target_shdr.sh_size;
+
             const char *name = elf_strptr(elf, shdr.sh_link, sym.st_name);
             if (name && *name)
-                sylvan_sym_add(sym_table, name, (uintptr_t)sym.st_value);
+                sylvan_sym_add(strings, sym_table, name, (uintptr_t)sym.st_value, (size_t)sym.st_size);
         }
     }
 
@@ -235,18 +628,97 @@ fail:
     return sylvan_set_code(SYLVANC_ELF_FAILED);
 }
 
+/**
+ * looks name up in the executable, then in the shared objects in load order
+ * sets *addr to where the symbol is in the process, the executable's tables keep their link time addresses
+ */
+static struct symbol *
+sylvan_sym_find(struct sylvan_inferior *inf, const char *name, uintptr_t *addr) {
+    struct symbol *sym;
+    if ((sym = sym_lookup(&inf->dwarf_table, name)) || (sym = sym_lookup(&inf->elf_table, name))) {
+        *addr = sym->addr + inf->load_bias;
+        return sym;
+    }
+
+    for (struct sylvan_solib *solib = inf->solibs; solib; solib = solib->next)
+        if ((sym = sym_lookup(&solib->table, name))) {
+            *addr = sym->addr;
+            return sym;
+        }
+
+    return NULL;
+}
+
+/**
+ * a symbol of unknown size runs up to the next one in its own table, which can be past the end of the
+ * function it names, so any table with a sized match wins over it
+ * sets *start to where the symbol begins in the process
+ */
+static struct symbol *
+sylvan_sym_find_addr(struct sylvan_inferior *inf, uintptr_t addr, uintptr_t *start) {
+    struct symbol *sym, *unsized = NULL;
+    if (addr >= inf->load_bias) {
+        uintptr_t link_addr = addr - inf->load_bias;
+        if ((sym = sym_lookup_addr(&inf->dwarf_table, link_addr)) || (sym = sym_lookup_addr(&inf->elf_table, link_addr))) {
+            *start = sym->addr + inf->load_bias;
+            if (sym->size)
+                return sym;
+            unsized = sym;
+        }
+    }
+
+    for (struct sylvan_solib *solib = inf->solibs; solib; solib = solib->next)
+        if ((sym = sym_lookup_addr(&solib->table, addr))) {
+            if (sym->size) {
+                *start = sym->addr;
+                return sym;
+            }
+            if (!unsized) {
+                *start = sym->addr;
+                unsized = sym;
+            }
+        }
+
+    return unsized;
+}
+
+/**
+ * see lib/sylvan/symbol.h
+ */
+SYLVAN_INTERNAL bool
+sylvan_sym_resolve(struct sylvan_inferior *inf, const char *name, uintptr_t *addr) {
+
+    assert(inf && name && addr); // should have been checked by the caller
+
+    size_t file_len;
+    unsigned int line;
+    if (sylvan_line_is_location(name, &file_len, &line))
+        return sylvan_line_resolve(inf, name, addr);
+
+    sylvan_sym_dwarf_ensure(inf);
+    return sylvan_sym_find(inf, name, addr) != NULL;
+}
 
 SYLVAN_INTERNAL sylvan_code_t
 sylvan_get_label_addr(struct sylvan_inferior *inf, const char *name, uintptr_t *addr) {
     assert(name && addr);
-    struct symbol *sym;
-    if ((sym = sym_lookup(&inf->dwarf_table, name)))
-        *addr = sym->addr;
-    else
-    if ((sym = sym_lookup(&inf->elf_table, name)))
-        *addr = sym->addr;
-    else
+
+    /* file:line is looked up in the line table */
+    size_t file_len;
+    unsigned int line;
+    if (sylvan_line_is_location(name, &file_len, &line)) {
+        if (!sylvan_line_resolve(inf, name, addr))
+            return sylvan_set_message(SYLVANC_SYMBOL_NOT_FOUND, "No code at %.256s", name);
+        return SYLVANC_OK;
+    }
+
+    sylvan_code_t code;
+    if ((code = sylvan_sym_dwarf_ensure(inf)))
+        return code;
+
+    if (!sylvan_sym_find(inf, name, addr))
         return sylvan_set_message(SYLVANC_SYMBOL_NOT_FOUND, "%.256s not found", name);
+
     return SYLVANC_OK;
 }
 
@@ -257,15 +729,86 @@ sylvan_sym_load_tables(struct sylvan_inferior *inf) {
     sylvan_sym_destroy(inf);
     sylvan_sym_init(inf);
 
+    /* a binary seen before is mapped from the cache without reading its elf or dwarf */
+    struct sylvan_symcache cache;
+    bool cacheable = sylvan_symcache_init(&cache, inf->realpath);
+    if (cacheable && sylvan_symcache_load(&cache, &inf->sym_strings, &inf->elf_table, &inf->dwarf_table)) {
+        sylvan_symcache_destroy(&cache);
+        return SYLVANC_OK;
+    }
+
+    /* only the compile unit headers are read here, sylvan_sym_dwarf_ensure parses them when a symbol is needed */
     sylvan_code_t code;
-    if ((code = sylvan_sym_load_dwarf(inf->realpath, &inf->dwarf_table)) && code != SYLVANC_DWARF_NOT_FOUND)
-        return code;
+    if ((code = sylvan_sym_index_dwarf(inf->realpath, &inf->dwarf_index)) && code != SYLVANC_DWARF_NOT_FOUND)
+        goto out;
 
-    if ((code = sylvan_sym_load_elf(inf->realpath, &inf->elf_table)))
+    if ((code = sylvan_sym_load_elf(inf->realpath, &inf->sym_strings, &inf->elf_table)))
+        goto out;
+    inf->dwarf_table.text_end = inf->elf_table.text_end;
+
+    if ((code = sylvan_sym_table_sort(&inf->dwarf_table)))
+        goto out;
+
+    if ((code = sylvan_sym_table_sort(&inf->elf_table)))
+        goto out;
+
+    if (cacheable && inf->dwarf_index) {
+        /* with dwarf the cache is written once its units are parsed */
+        inf->dwarf_index->cache = cache;
+        cacheable = false;
+    }
+    else
+    if (cacheable)
+        sylvan_symcache_store(&cache, &inf->elf_table, &inf->dwarf_table);
+
+out:
+    if (cacheable)
+        sylvan_symcache_destroy(&cache);
+    return code;
+}
+
+/**
+ * maps addr to the function containing it, sets *name and *offset from its start
+ * dwarf symbols are preferred, elf symbols cover what has no debug info, then the shared objects
+ */
+sylvan_code_t sylvan_sym_lookup_addr(struct sylvan_inferior *inf, uintptr_t addr, const char **name, uintptr_t *offset) {
+    if (!inf || !name || !offset)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    sylvan_code_t code;
+    if ((code = sylvan_sym_dwarf_ensure(inf)))
         return code;
 
-    qsort(inf->dwarf_table.symbols, inf->dwarf_table.count, sizeof(struct symbol), symcmp);
-    qsort(inf->elf_table.symbols, inf->elf_table.count, sizeof(struct symbol), symcmp);
+    struct symbol *sym;
+    uintptr_t start;
+    if (!(sym = sylvan_sym_find_addr(inf, addr, &start)))
+        return sylvan_set_message(SYLVANC_SYMBOL_NOT_FOUND, "No symbol contains %#lx", addr);
 
+    *name = sym->name;
+    *offset = addr - start;
     return SYLVANC_OK;
 }
+
+/**
+ * formats " <func+0x1c>" for addr into buf, or an empty string if no symbol contains it
+ * doesn't touch the last error unless parsing the pending dwarf units fails
+ */
+SYLVAN_INTERNAL const char *
+sylvan_sym_format_addr(struct sylvan_inferior *inf, uintptr_t addr, char *buf, size_t size) {
+    assert(inf && buf && size);
+
+    /* without the dwarf symbols this still falls back to the elf table */
+    sylvan_sym_dwarf_ensure(inf);
+
+    struct symbol *sym;
+    uintptr_t start;
+    if (!(sym = sylvan_sym_find_addr(inf, addr, &start)))
+        buf[0] = '\0';
+    else
+    if (addr == start)
+        snprintf(buf, size, " <%s>", sym->name);
+    else
+        snprintf(buf, size, " <%s+%#lx>", sym->name, addr - start);
+
+    return buf;
+}
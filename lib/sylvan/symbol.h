@@ -9,6 +9,21 @@ sylvan_code_t sylvan_sym_destroy(struct sylvan_inferior *inf);
 
 sylvan_code_t sylvan_sym_load_tables(struct sylvan_inferior *inf);
 
+sylvan_code_t sylvan_sym_table_init(struct sylvan_sym_table *sym_table);
+sylvan_code_t sylvan_sym_table_destroy(struct sylvan_sym_table *sym_table);
+sylvan_code_t sylvan_sym_table_sort(struct sylvan_sym_table *sym_table);
+struct symbol *sylvan_sym_table_lookup(struct sylvan_sym_table *sym_table, const char *name);
+void sylvan_sym_strings_destroy(struct sylvan_sym_strings *strings);
+sylvan_code_t sylvan_sym_load_elf(const char *path, struct sylvan_sym_strings *strings, struct sylvan_sym_table *sym_table);
+
+/**
+ * sets *addr to where name is in the process, returns false if no loaded object has it
+ * a missing symbol isn't an error, pending breakpoints are resolved with it whenever code is loaded
+ */
+bool sylvan_sym_resolve(struct sylvan_inferior *inf, const char *name, uintptr_t *addr);
+
 sylvan_code_t sylvan_get_label_addr(struct sylvan_inferior *inf, const char *name, uintptr_t *addr);
 
+const char *sylvan_sym_format_addr(struct sylvan_inferior *inf, uintptr_t addr, char *buf, size_t size);
+
 #endif /* SYLVAN_SYMBOL_H */
@@ -0,0 +1,465 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <gelf.h>
+#include <libelf.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <assert.h>
+
+#include "symcache.h"
+#include "sylvan.h"
+
+#define SYLVAN_SYMCACHE_MAGIC "SYLVSYM"
+#define SYLVAN_SYMCACHE_VERSION 2
+#define SYLVAN_SYMCACHE_TABLES 2       /* elf, dwarf */
+
+#define ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+/*
+ * file layout, all offsets are from the start of the file:
+ *   header, key (key_len bytes, no NUL)
+ *   per table, 8 byte aligned: count entries sorted by name, then count u32 indexes of the entries in address order
+ *   strings, NUL terminated names the entries point into
+ */
+struct sylvan_symcache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t key_len;
+    uint64_t table_offset[SYLVAN_SYMCACHE_TABLES];
+    uint64_t table_count[SYLVAN_SYMCACHE_TABLES];
+    uint64_t table_text_end[SYLVAN_SYMCACHE_TABLES];
+    uint64_t strings_offset;
+    uint64_t strings_size;
+};
+
+struct sylvan_symcache_entry {
+    uint64_t name;              /* offset in the strings */
+    uint64_t addr;
+    uint64_t size;
+};
+
+static uint64_t
+sylvan_symcache_hash(const char *str) {
+    uint64_t hash = 0xcbf29ce484222325ULL;     /* FNV-1a */
+    for (; *str; str++)
+        hash = (hash ^ (unsigned char)*str) * 0x100000001b3ULL;
+    return hash;
+}
+
+/**
+ * returns the hex NT_GNU_BUILD_ID of the elf file, NULL if it has none
+ * also sets the sizes of .symtab and .debug_info, 0 if they are missing
+ */
+static char *
+sylvan_symcache_build_id(const char *binary, uint64_t *symtab_size, uint64_t *debug_info_size) {
+    *symtab_size = 0;
+    *debug_info_size = 0;
+
+    if (elf_version(EV_CURRENT) == EV_NONE)
+        return NULL;
+
+    int fd;
+    if ((fd = open(binary, O_RDONLY)) < 0)
+        return NULL;
+
+    Elf *elf = elf_begin(fd, ELF_C_READ, NULL);
+    if (!elf) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t shstrndx;
+    if (elf_getshdrstrndx(elf, &shstrndx) != 0) {
+        elf_end(elf);
+        close(fd);
+        return NULL;
+    }
+
+    char *build_id = NULL;
+    Elf_Scn *scn = NULL;
+    while ((scn = elf_nextscn(elf, scn))) {
+        GElf_Shdr shdr;
+        if (!gelf_getshdr(scn, &shdr))
+            continue;
+
+        const char *name = elf_strptr(elf, shstrndx, shdr.sh_name);
+        if (shdr.sh_type == SHT_SYMTAB)
+            *symtab_size = shdr.sh_size;
+        else
+        if (name && strcmp(name, ".debug_info") == 0 && shdr.sh_type != SHT_NOBITS)
+            *debug_info_size = shdr.sh_size;
+
+        if (build_id || shdr.sh_type != SHT_NOTE)
+            continue;
+
+        Elf_Data *data = elf_getdata(scn, NULL);
+        if (!data)
+            continue;
+
+        GElf_Nhdr nhdr;
+        size_t offset = 0, name_offset, desc_offset;
+        while ((offset = gelf_getnote(data, offset, &nhdr, &name_offset, &desc_offset)) > 0) {
+            const char *buf = data->d_buf;
+            if (nhdr.n_type != NT_GNU_BUILD_ID || nhdr.n_namesz != sizeof(ELF_NOTE_GNU) ||
+                memcmp(buf + name_offset, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) || !nhdr.n_descsz)
+                continue;
+
+            if (!(build_id = malloc(nhdr.n_descsz * 2 + 1)))
+                break;
+            for (size_t i = 0; i < nhdr.n_descsz; i++)
+                sprintf(build_id + i * 2, "%02x", (unsigned char)buf[desc_offset + i]);
+            break;
+        }
+    }
+
+    elf_end(elf);
+    close(fd);
+    return build_id;
+}
+
+/**
+ * $XDG_CACHE_HOME/sylvan, or ~/.cache/sylvan
+ */
+static bool
+sylvan_symcache_dir(char *buf, size_t size) {
+    const char *base = getenv("XDG_CACHE_HOME");
+    int len;
+    if (base && *base)
+        len = snprintf(buf, size, "%s/sylvan", base);
+    else
+    if ((base = getenv("HOME")) && *base)
+        len = snprintf(buf, size, "%s/.cache/sylvan", base);
+    else
+        return false;
+    return len > 0 && (size_t)len < size;
+}
+
+/**
+ * see lib/sylvan/symcache.h
+ */
+SYLVAN_INTERNAL bool
+sylvan_symcache_init(struct sylvan_symcache *cache, const char *binary) {
+
+    assert(cache && binary); // should have been checked by the caller
+
+    cache->path = NULL;
+    cache->key = NULL;
+
+    char dir[PATH_MAX];
+    if (!sylvan_symcache_dir(dir, sizeof(dir)))
+        return false;
+
+    uint64_t symtab_size, debug_info_size;
+    char *build_id = sylvan_symcache_build_id(binary, &symtab_size, &debug_info_size);
+    char *path = NULL;
+    char *key = NULL;
+
+    /*
+     * strip keeps the build id, the symbol sections tell a stripped build from the one it came from
+     * they share the file, whichever was loaded last replaces the other's tables
+     */
+    if (build_id) {
+        if (asprintf(&key, "build-id:%s:symtab=%llu:debug_info=%llu", build_id, (unsigned long long)symtab_size,
+                     (unsigned long long)debug_info_size) < 0)
+            key = NULL;
+        else
+        if (asprintf(&path, "%s/%s.sym", dir, build_id) < 0)
+            path = NULL;
+        free(build_id);
+    }
+    else {
+        struct stat st;
+        if (stat(binary, &st))
+            return false;
+        if (asprintf(&key, "path:%s:%lu:%lld:%lld.%09ld", binary, (unsigned long)st.st_ino, (long long)st.st_size,
+                     (long long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec) < 0)
+            key = NULL;
+        else
+        if (asprintf(&path, "%s/path-%016llx.sym", dir, (unsigned long long)sylvan_symcache_hash(key)) < 0)
+            path = NULL;
+    }
+
+    if (!key || !path) {
+        free(key);
+        free(path);
+        return false;
+    }
+
+    cache->path = path;
+    cache->key = key;
+    return true;
+}
+
+SYLVAN_INTERNAL void
+sylvan_symcache_destroy(struct sylvan_symcache *cache) {
+    if (!cache)
+        return;
+    free(cache->path);
+    free(cache->key);
+    cache->path = NULL;
+    cache->key = NULL;
+}
+
+/**
+ * builds a table from the entries and address indexes of the mapping, names point into strings
+ * the entries are copied rather than used in place: struct symbol holds a name pointer where the file has
+ * an offset, solib relocates the addresses and the tables are freed and grown like parsed ones
+ */
+static bool
+sylvan_symcache_table(const char *map, size_t map_size, const struct sylvan_symcache_header *header, int i,
+                      struct symbol **symbolsp, struct symbol ***by_addrp) {
+    uint64_t offset = header->table_offset[i];
+    uint64_t count = header->table_count[i];
+    const size_t record = sizeof(struct sylvan_symcache_entry) + sizeof(uint32_t);
+
+    if (offset > map_size || count > (map_size - offset) / record || count > UINT32_MAX || offset % 8)
+        return false;
+
+    const struct sylvan_symcache_entry *entries = (const void *)(map + offset);
+    const uint32_t *order = (const void *)(entries + count);
+    const char *strings = map + header->strings_offset;
+
+    struct symbol *symbols = malloc((count ? count : 1) * sizeof(struct symbol));
+    struct symbol **by_addr = malloc((count ? count : 1) * sizeof(struct symbol *));
+    if (!symbols || !by_addr)
+        goto fail;
+
+    for (uint64_t j = 0; j < count; j++) {
+        if (entries[j].name >= header->strings_size || order[j] >= count)
+            goto fail;
+        symbols[j].name = strings + entries[j].name;
+        symbols[j].addr = (uintptr_t)entries[j].addr;
+        symbols[j].size = (size_t)entries[j].size;
+    }
+
+    for (uint64_t j = 0; j < count; j++)
+        by_addr[j] = &symbols[order[j]];
+
+    *symbolsp = symbols;
+    *by_addrp = by_addr;
+    return true;
+
+fail:
+    free(symbols);
+    free(by_addr);
+    return false;
+}
+
+/**
+ * see lib/sylvan/symcache.h
+ */
+SYLVAN_INTERNAL bool
+sylvan_symcache_load(const struct sylvan_symcache *cache, struct sylvan_sym_strings *strings,
+                     struct sylvan_sym_table *elf_table, struct sylvan_sym_table *dwarf_table) {
+
+    assert(cache && strings && elf_table && dwarf_table); // should have been checked by the caller
+
+    int fd;
+    if (!cache->path || (fd = open(cache->path, O_RDONLY | O_CLOEXEC)) < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(struct sylvan_symcache_header)) {
+        close(fd);
+        return false;
+    }
+
+    size_t map_size = (size_t)st.st_size;
+    char *map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    const struct sylvan_symcache_header *header = (const void *)map;
+    size_t key_len = strlen(cache->key);
+
+    struct symbol *symbols[SYLVAN_SYMCACHE_TABLES] = { NULL };
+    struct symbol **by_addr[SYLVAN_SYMCACHE_TABLES] = { NULL };
+
+    if (memcmp(header->magic, SYLVAN_SYMCACHE_MAGIC, sizeof(header->magic)) ||
+        header->version != SYLVAN_SYMCACHE_VERSION || header->key_len != key_len ||
+        key_len > map_size - sizeof(struct sylvan_symcache_header) ||
+        memcmp(map + sizeof(struct sylvan_symcache_header), cache->key, key_len))
+        goto fail;
+
+    /* every name offset is checked against strings_size, the last name has to be terminated */
+    if (header->strings_offset > map_size || header->strings_size > map_size - header->strings_offset ||
+        !header->strings_size || map[header->strings_offset + header->strings_size - 1] != '\0')
+        goto fail;
+
+    for (int i = 0; i < SYLVAN_SYMCACHE_TABLES; i++)
+        if (!sylvan_symcache_table(map, map_size, header, i, &symbols[i], &by_addr[i]))
+            goto fail;
+
+    struct sylvan_sym_table *tables[SYLVAN_SYMCACHE_TABLES] = { elf_table, dwarf_table };
+    for (int i = 0; i < SYLVAN_SYMCACHE_TABLES; i++) {
+        free(tables[i]->symbols);
+        free(tables[i]->by_addr);
+        tables[i]->symbols = symbols[i];
+        tables[i]->by_addr = by_addr[i];
+        tables[i]->count = header->table_count[i];
+        tables[i]->capacity = header->table_count[i] ? header->table_count[i] : 1;
+        tables[i]->text_end = header->table_text_end[i];
+    }
+
+    if (strings->map)
+        munmap(strings->map, strings->map_size);
+    strings->map = map;
+    strings->map_size = map_size;
+
+    return true;
+
+fail:
+    for (int i = 0; i < SYLVAN_SYMCACHE_TABLES; i++) {
+        free(symbols[i]);
+        free(by_addr[i]);
+    }
+    munmap(map, map_size);
+    return false;
+}
+
+/**
+ * creates the cache directory and its parent
+ */
+static bool
+sylvan_symcache_mkdir(const char *path) {
+    char dir[PATH_MAX];
+    size_t len = strlen(path);
+    if (len >= sizeof(dir))
+        return false;
+    memcpy(dir, path, len + 1);
+
+    char *slash = strrchr(dir, '/');
+    if (!slash)
+        return false;
+    *slash = '\0';
+
+    if (!mkdir(dir, 0700) || errno == EEXIST)
+        return true;
+    if (errno != ENOENT)
+        return false;
+
+    /* ~/.cache may not exist yet */
+    char *parent = strrchr(dir, '/');
+    if (!parent || parent == dir)
+        return false;
+    *parent = '\0';
+    if (mkdir(dir, 0700) && errno != EEXIST)
+        return false;
+    *parent = '/';
+
+    return !mkdir(dir, 0700) || errno == EEXIST;
+}
+
+static bool
+sylvan_symcache_write_table(FILE *file, const struct sylvan_sym_table *table, const uint64_t *name_offsets) {
+    for (size_t i = 0; i < table->count; i++) {
+        const struct symbol *sym = &table->symbols[i];
+        struct sylvan_symcache_entry entry = { name_offsets[i], sym->addr, sym->size };
+        if (fwrite(&entry, sizeof(entry), 1, file) != 1)
+            return false;
+    }
+
+    for (size_t i = 0; i < table->count; i++) {
+        uint32_t index = (uint32_t)(table->by_addr[i] - table->symbols);
+        if (fwrite(&index, sizeof(index), 1, file) != 1)
+            return false;
+    }
+
+    static const char zeros[8];
+    size_t written = table->count * (sizeof(struct sylvan_symcache_entry) + sizeof(uint32_t));
+    return fwrite(zeros, 1, ALIGN8(written) - written, file) == ALIGN8(written) - written;
+}
+
+/**
+ * see lib/sylvan/symcache.h
+ */
+SYLVAN_INTERNAL void
+sylvan_symcache_store(const struct sylvan_symcache *cache, const struct sylvan_sym_table *elf_table,
+                      const struct sylvan_sym_table *dwarf_table) {
+
+    assert(cache && elf_table && dwarf_table); // should have been checked by the caller
+
+    if (!cache->path || !cache->key || !sylvan_symcache_mkdir(cache->path))
+        return;
+
+    const struct sylvan_sym_table *tables[SYLVAN_SYMCACHE_TABLES] = { elf_table, dwarf_table };
+    struct sylvan_symcache_header header = { .magic = SYLVAN_SYMCACHE_MAGIC, .version = SYLVAN_SYMCACHE_VERSION };
+    header.key_len = strlen(cache->key);
+
+    /* a table is sorted by name, so repeated names are next to each other and written once */
+    uint64_t *name_offsets[SYLVAN_SYMCACHE_TABLES] = { NULL };
+    uint64_t strings_size = 0;
+    uint64_t offset = ALIGN8(sizeof(header) + header.key_len);
+
+    for (int i = 0; i < SYLVAN_SYMCACHE_TABLES; i++) {
+        size_t count = tables[i]->count;
+        if (count > UINT32_MAX)
+            goto out;
+        name_offsets[i] = malloc((count ? count : 1) * sizeof(uint64_t));
+        if (!name_offsets[i])
+            goto out;
+
+        for (size_t j = 0; j < count; j++) {
+            const char *name = tables[i]->symbols[j].name;
+            if (j && tables[i]->symbols[j - 1].name == name) {
+                name_offsets[i][j] = name_offsets[i][j - 1];
+                continue;
+            }
+            name_offsets[i][j] = strings_size;
+            strings_size += strlen(name) + 1;
+        }
+
+        header.table_offset[i] = offset;
+        header.table_count[i] = count;
+        header.table_text_end[i] = tables[i]->text_end;
+        offset = ALIGN8(offset + count * (sizeof(struct sylvan_symcache_entry) + sizeof(uint32_t)));
+    }
+
+    /* an empty blob would be rejected on load, write a single NUL instead */
+    bool empty = !strings_size;
+    if (empty)
+        strings_size = 1;
+    header.strings_offset = offset;
+    header.strings_size = strings_size;
+
+    char tmp_path[PATH_MAX];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", cache->path, (int)getpid()) >= (int)sizeof(tmp_path))
+        goto out;
+
+    FILE *file = fopen(tmp_path, "wbe");
+    if (!file)
+        goto out;
+
+    static const char zeros[8];
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(cache->key, 1, header.key_len, file) == header.key_len &&
+              fwrite(zeros, 1, header.table_offset[0] - sizeof(header) - header.key_len, file) ==
+                  header.table_offset[0] - sizeof(header) - header.key_len;
+
+    for (int i = 0; ok && i < SYLVAN_SYMCACHE_TABLES; i++)
+        ok = sylvan_symcache_write_table(file, tables[i], name_offsets[i]);
+
+    for (int i = 0; ok && i < SYLVAN_SYMCACHE_TABLES; i++)
+        for (size_t j = 0; ok && j < tables[i]->count; j++)
+            if (!j || tables[i]->symbols[j - 1].name != tables[i]->symbols[j].name)
+                ok = fwrite(tables[i]->symbols[j].name, 1, strlen(tables[i]->symbols[j].name) + 1, file) > 0;
+
+    if (ok && empty)
+        ok = fwrite(zeros, 1, 1, file) == 1;
+
+    if (fclose(file) || !ok || rename(tmp_path, cache->path))
+        unlink(tmp_path);
+
+out:
+    for (int i = 0; i < SYLVAN_SYMCACHE_TABLES; i++)
+        free(name_offsets[i]);
+}
\ No newline at end of file
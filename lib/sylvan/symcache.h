@@ -0,0 +1,35 @@
+#ifndef SYLVAN_SYMCACHE_H
+#define SYLVAN_SYMCACHE_H
+
+#include <stdbool.h>
+#include <sylvan/symbol.h>
+
+/* where the symbol tables of a binary are cached and what identifies the binary */
+struct sylvan_symcache {
+    char *path;                 /* cache file under ~/.cache/sylvan */
+    char *key;                  /* build id and symbol section sizes, or path, inode, size and mtime if it has none */
+};
+
+/**
+ * computes the cache file and key of binary
+ * returns false if there is no cache directory or binary can't be read
+ * none of the cache functions modify sylvan_last_error, the cache is only an optimization
+ */
+bool sylvan_symcache_init(struct sylvan_symcache *cache, const char *binary);
+
+void sylvan_symcache_destroy(struct sylvan_symcache *cache);
+
+/**
+ * maps the cache file and fills both tables from it, the names stay in the mapping which strings owns
+ * the tables are untouched if it returns false
+ */
+bool sylvan_symcache_load(const struct sylvan_symcache *cache, struct sylvan_sym_strings *strings,
+                          struct sylvan_sym_table *elf_table, struct sylvan_sym_table *dwarf_table);
+
+/**
+ * writes both sorted tables to the cache file, replacing it atomically
+ */
+void sylvan_symcache_store(const struct sylvan_symcache *cache, const struct sylvan_sym_table *elf_table,
+                           const struct sylvan_sym_table *dwarf_table);
+
+#endif /* SYLVAN_SYMCACHE_H */
\ No newline at end of file
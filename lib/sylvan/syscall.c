@@ -0,0 +1,319 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/prctl.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+
+#include <sylvan/inferior.h>
+#include "error.h"
+#include "inferior.h"
+#include "sylvan.h"
+#include "syscall.h"
+#include "thread.h"
+
+#define SYLVAN_INJECT_TRIES 8   /* steps an injected system call gets before a signal stop is taken for a failure */
+#define SYLVAN_RED_ZONE 128     /* below rsp, the code that stopped may keep data there */
+
+#define SYLVAN_SYSCALL_BIT(set, nr) ((set)[(nr) / 64] & (1ULL << ((nr) % 64)))
+
+/**
+ * see lib/sylvan/syscall.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_syscall_inject(struct sylvan_inferior *inf, uintptr_t addr, long nr, const unsigned long args[6], long *result) {
+
+    assert(inf && args && result); // should have been checked by the caller
+
+    struct sylvan_thread *thread = inf->thread;
+    sylvan_code_t code;
+    if ((code = sylvan_regs_fetch(inf)))
+        return code;
+
+    static const uint8_t syscall_insn[2] = { 0x0f, 0x05 };
+    uint8_t saved_text[sizeof(syscall_insn)];
+    struct user_regs_struct saved_regs = thread->regs;
+
+    /* the text as it is, an int3 at addr has to be replaced and put back like any other byte */
+    if (sylvan_read_memory_raw(inf->pid, addr, saved_text, sizeof(saved_text)) < sizeof(saved_text))
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_PEEKDATA_FAILED, "Cannot read address %lx", addr);
+
+    if ((code = sylvan_write_memory_raw(inf, addr, syscall_insn, sizeof(syscall_insn))))
+        return code;
+
+    /* a signal can stop the step before the syscall instruction runs, rax still holds nr then and it's run again */
+    sylvan_code_t restore_code;
+    pid_t tid = thread->tid;
+    int status;
+    for (int tries = 0;; tries++) {
+        thread->regs.rax = nr;
+        thread->regs.rdi = args[0];
+        thread->regs.rsi = args[1];
+        thread->regs.rdx = args[2];
+        thread->regs.r10 = args[3];
+        thread->regs.r8 = args[4];
+        thread->regs.r9 = args[5];
+        thread->regs.rip = addr;
+        thread->regs_dirty = true;
+
+        code = sylvan_step(inf, &status);
+
+        /* the thread may have exited or been left behind with a followed fork, there's nothing to put back then */
+        if (sylvan_thread_find(inf, tid) != thread || inf->thread != thread) {
+            if (!code)
+                code = sylvan_set_message(SYLVANC_PROC_STOPPED, "Thread %d is gone, system call %ld wasn't injected", tid, nr);
+            return code;
+        }
+
+        if (code || (code = sylvan_regs_fetch(inf)))
+            goto restore;
+
+        if (WIFSTOPPED(status) && WSTOPSIG(status) == SIGTRAP && thread->regs.rip == addr + sizeof(syscall_insn))
+            break;
+
+        if (!WIFSTOPPED(status) || tries + 1 == SYLVAN_INJECT_TRIES) {
+            code = sylvan_set_message(SYLVANC_PROC_STOPPED, "System call %ld injected at 0x%lx didn't run", nr, addr);
+            goto restore;
+        }
+
+        /* the signal that got in the way is the program's, it gets it when it's continued */
+        if (WSTOPSIG(status) != SIGTRAP && !thread->pending_signal)
+            thread->pending_signal = WSTOPSIG(status);
+    }
+
+    *result = (long)thread->regs.rax;
+
+restore:
+    /* the text and the registers are put back on every way out */
+    restore_code = sylvan_write_memory_raw(inf, addr, saved_text, sizeof(saved_text));
+    if (!code)
+        code = restore_code;
+
+    thread->regs = saved_regs;
+    thread->regs_dirty = true;
+
+    return code;
+}
+
+/**
+ * see lib/sylvan/syscall.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_syscall_filter_build(const uint64_t *set, struct sock_fprog *prog) {
+
+    assert(set && prog); // should have been checked by the caller
+
+    prog->len = 0;
+    prog->filter = NULL;
+
+    unsigned int count = 0;
+    for (int nr = 0; nr < SYLVAN_SYSCALL_MAX; nr++)
+        if (SYLVAN_SYSCALL_BIT(set, nr))
+            count++;
+
+    if (!count)
+        return SYLVANC_OK;
+
+    /* the jumps are 8 bit, SYLVAN_SYSCALL_TRACE_MAX keeps them in range */
+    assert(count <= SYLVAN_SYSCALL_TRACE_MAX);
+
+    struct sock_filter *filter = malloc((count + 5) * sizeof(struct sock_filter));
+    if (!filter)
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    /* i386 and x32 calls have numbers of their own, they're let through */
+    unsigned int len = 0;
+    filter[len++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, arch));
+    filter[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 0, count + 1);
+    filter[len++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(struct seccomp_data, nr));
+
+    unsigned int i = 0;
+    for (int nr = 0; nr < SYLVAN_SYSCALL_MAX; nr++)
+        if (SYLVAN_SYSCALL_BIT(set, nr))
+            filter[len++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, nr, count - i++, 0);
+
+    filter[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW);
+    filter[len++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_TRACE);
+
+    prog->len = len;
+    prog->filter = filter;
+    return SYLVANC_OK;
+}
+
+/**
+ * see lib/sylvan/syscall.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_syscall_filter_load(const struct sock_fprog *prog) {
+
+    assert(prog); // should have been checked by the caller
+
+    if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) < 0)
+        return sylvan_set_errno_msg(SYLVANC_SYSCALL_FILTER_FAILED, "prctl no new privs");
+
+    if (syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER, 0, prog) < 0)
+        return sylvan_set_errno_msg(SYLVANC_SYSCALL_FILTER_FAILED, "seccomp");
+
+    return SYLVANC_OK;
+}
+
+/**
+ * see lib/sylvan/syscall.h
+ */
+SYLVAN_INTERNAL bool
+sylvan_syscall_filtering(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    for (int i = 0; i < SYLVAN_SYSCALL_WORDS; i++)
+        if (inf->syscalls_filtered[i])
+            return true;
+
+    return false;
+}
+
+/**
+ * see lib/sylvan/syscall.h
+ */
+SYLVAN_INTERNAL bool
+sylvan_syscall_entering(struct sylvan_thread *thread) {
+
+    assert(thread); // should have been checked by the caller
+
+    siginfo_t info;
+    return ptrace(PTRACE_GETSIGINFO, thread->tid, NULL, &info) == 0 &&
+           info.si_code == (SIGTRAP | (PTRACE_EVENT_SECCOMP << 8));
+}
+
+/**
+ * makes the stopped process install a filter for the system calls in set, in all of its threads
+ * the program is written below the red zone of the current thread's stack
+ */
+static sylvan_code_t
+sylvan_syscall_filter_inject(struct sylvan_inferior *inf, const uint64_t *set) {
+
+    sylvan_code_t code;
+    if ((code = sylvan_regs_fetch(inf)))
+        return code;
+
+    if (sylvan_syscall_entering(inf->thread))
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Thread %d is entering a system call, step it first", inf->thread->tid);
+
+    struct sock_fprog prog;
+    if ((code = sylvan_syscall_filter_build(set, &prog)))
+        return code;
+
+    size_t size = prog.len * sizeof(struct sock_filter);
+    uintptr_t filter_addr = (inf->thread->regs.rsp - SYLVAN_RED_ZONE - size) & ~(uintptr_t)15;
+    uintptr_t prog_addr = filter_addr - sizeof(struct sock_fprog);
+    struct sock_fprog remote = { .len = prog.len, .filter = (struct sock_filter *)filter_addr };
+
+    code = sylvan_write_memory(inf, filter_addr, prog.filter, size);
+    free(prog.filter);
+
+    if (code || (code = sylvan_write_memory(inf, prog_addr, &remote, sizeof(remote))))
+        return code;
+
+    uintptr_t addr = inf->thread->regs.rip;
+    long result;
+
+    unsigned long nnp_args[6] = { PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0, 0 };
+    if ((code = sylvan_syscall_inject(inf, addr, SYS_prctl, nnp_args, &result)))
+        return code;
+
+    if (result < 0) {
+        errno = (int)-result;
+        return sylvan_set_errno_msg(SYLVANC_SYSCALL_FILTER_FAILED, "prctl no new privs in process %d", inf->pid);
+    }
+
+    unsigned long seccomp_args[6] = { SECCOMP_SET_MODE_FILTER, SECCOMP_FILTER_FLAG_TSYNC, prog_addr, 0, 0, 0 };
+    if ((code = sylvan_syscall_inject(inf, addr, SYS_seccomp, seccomp_args, &result)))
+        return code;
+
+    if (result < 0) {
+        errno = (int)-result;
+        return sylvan_set_errno_msg(SYLVANC_SYSCALL_FILTER_FAILED, "seccomp in process %d", inf->pid);
+    }
+
+    /* with TSYNC a positive result is a thread that couldn't take the filter */
+    if (result > 0)
+        return sylvan_set_message(SYLVANC_SYSCALL_FILTER_FAILED, "Thread %ld of process %d can't take the filter", result, inf->pid);
+
+    for (int i = 0; i < SYLVAN_SYSCALL_WORDS; i++)
+        inf->syscalls_filtered[i] |= set[i];
+
+    return SYLVANC_OK;
+}
+
+/**
+ * sets what sylvan_syscall_is_traced reports, a stopped process gets a filter for the system calls
+ * its filters don't trap yet, the other threads are paused while it's installed
+ */
+sylvan_code_t sylvan_set_syscall_trace(struct sylvan_inferior *inf, const int *nrs, size_t count) {
+    if (inf == NULL || (count && nrs == NULL))
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (count > SYLVAN_SYSCALL_TRACE_MAX)
+        return sylvan_set_message(SYLVANC_INVALID_ARGUMENT, "At most %d system calls can be traced", SYLVAN_SYSCALL_TRACE_MAX);
+
+    uint64_t set[SYLVAN_SYSCALL_WORDS] = { 0 };
+    for (size_t i = 0; i < count; i++) {
+        if (nrs[i] < 0 || nrs[i] >= SYLVAN_SYSCALL_MAX)
+            return sylvan_set_message(SYLVANC_INVALID_ARGUMENT, "Invalid system call number %d", nrs[i]);
+        set[nrs[i] / 64] |= 1ULL << (nrs[i] % 64);
+    }
+
+    uint64_t missing[SYLVAN_SYSCALL_WORDS];
+    bool any = false;
+    for (int i = 0; i < SYLVAN_SYSCALL_WORDS; i++) {
+        missing[i] = set[i] & ~inf->syscalls_filtered[i];
+        any |= missing[i] != 0;
+    }
+
+    bool live = inf->pid > 0 && (inf->status == SYLVAN_INFSTATE_STOPPED || inf->status == SYLVAN_INFSTATE_RUNNING);
+
+    /* its traced system calls would fail with ENOSYS once it's detached */
+    if (live && count && inf->is_attached)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "System calls of a process that was attached to can't be traced");
+
+    if (live && any) {
+        if (inf->status == SYLVAN_INFSTATE_RUNNING)
+            return sylvan_set_message(SYLVANC_PROC_RUNNING, "Process %d is running in the background", inf->pid);
+
+        sylvan_code_t code;
+        bool paused;
+        if ((code = sylvan_thread_pause_all(inf, &paused)))
+            return code;
+
+        code = sylvan_syscall_filter_inject(inf, missing);
+
+        sylvan_code_t resume_code = paused ? sylvan_thread_resume_paused(inf) : SYLVANC_OK;
+        if (code || (code = resume_code))
+            return code;
+    }
+
+    memcpy(inf->syscalls_traced, set, sizeof(set));
+    return SYLVANC_OK;
+}
+
+/**
+ * true if the system call nr is traced in inf
+ */
+bool sylvan_syscall_is_traced(struct sylvan_inferior *inf, long nr) {
+    if (inf == NULL || nr < 0 || nr >= SYLVAN_SYSCALL_MAX)
+        return false;
+
+    return SYLVAN_SYSCALL_BIT(inf->syscalls_traced, nr) != 0;
+}
\ No newline at end of file
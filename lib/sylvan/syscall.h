@@ -0,0 +1,39 @@
+#ifndef SYLVAN_SYSCALL_H
+#define SYLVAN_SYSCALL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <linux/filter.h>
+#include <sylvan/inferior.h>
+#include <sylvan/syscall.h>
+
+/**
+ * runs the system call nr with args in the current thread, the syscall instruction is written over addr
+ * for a single step and the text and the registers are restored right after. *result is what it returned
+ */
+sylvan_code_t sylvan_syscall_inject(struct sylvan_inferior *inf, uintptr_t addr, long nr, const unsigned long args[6],
+                                    long *result);
+
+/**
+ * builds a seccomp filter that traces the system calls in set and allows the rest, prog->filter is allocated
+ * and prog->len is 0 if set is empty
+ */
+sylvan_code_t sylvan_syscall_filter_build(const uint64_t *set, struct sock_fprog *prog);
+
+/**
+ * installs prog in the calling process, for the child of sylvan_run right before its exec
+ */
+sylvan_code_t sylvan_syscall_filter_load(const struct sock_fprog *prog);
+
+/**
+ * true if thread is stopped entering a system call a filter traced, the system call runs when it's resumed
+ * and would run with the registers of an injected one
+ */
+bool sylvan_syscall_entering(struct sylvan_thread *thread);
+
+/**
+ * true if a filter of inf's process traces some system call, its stops need a tracer from then on
+ */
+bool sylvan_syscall_filtering(struct sylvan_inferior *inf);
+
+#endif /* SYLVAN_SYSCALL_H */
\ No newline at end of file
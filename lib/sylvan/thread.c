@@ -0,0 +1,798 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/ptrace.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+
+#include <sylvan/inferior.h>
+#include <sylvan/thread.h>
+#include "breakpoint.h"
+#include "error.h"
+#include "event.h"
+#include "fork.h"
+#include "inferior.h"
+#include "memcache.h"
+#include "sylvan.h"
+#include "thread.h"
+
+#define SYLVAN_THREAD_YIELDS 16     /* polls for an interrupted leader before it's checked for being a zombie */
+
+/* a stop of a thread nobody knows yet, the clone event announcing it can be collected after it */
+struct sylvan_thread_orphan {
+    pid_t tid;
+    int status;
+    struct sylvan_thread_orphan *next;
+};
+
+static struct sylvan_thread_orphan *sylvan_thread_orphans = NULL;
+static int sylvan_thread_pending = 0;      /* threads of all inferiors with has_pending set */
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_add(struct sylvan_inferior *inf, pid_t tid, struct sylvan_thread **threadp) {
+
+    assert(inf); // should have been checked by the caller
+
+    struct sylvan_thread *thread = calloc(1, sizeof(struct sylvan_thread));
+    if (!thread)
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    thread->tid = tid;
+    HASH_ADD(hh, inf->threads, tid, sizeof(pid_t), thread);
+
+    if (threadp)
+        *threadp = thread;
+    return SYLVANC_OK;
+}
+
+SYLVAN_INTERNAL void
+sylvan_thread_remove(struct sylvan_inferior *inf, struct sylvan_thread *thread) {
+
+    assert(inf && thread); // should have been checked by the caller
+
+    if (thread->has_pending)
+        sylvan_thread_pending--;
+
+    if (inf->thread == thread)
+        inf->thread = NULL;
+
+    HASH_DEL(inf->threads, thread);
+    free(thread);
+}
+
+/**
+ * forgets every thread, the process is gone or about to be
+ */
+SYLVAN_INTERNAL void
+sylvan_thread_clear(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp)
+        sylvan_thread_remove(inf, thread);
+
+    sylvan_memcache_invalidate(inf);
+}
+
+SYLVAN_INTERNAL struct sylvan_thread *
+sylvan_thread_find(struct sylvan_inferior *inf, pid_t tid) {
+
+    assert(inf); // should have been checked by the caller
+
+    struct sylvan_thread *thread;
+    HASH_FIND(hh, inf->threads, &tid, sizeof(pid_t), thread);
+    return thread;
+}
+
+/**
+ * the inferior tid belongs to, NULL if no inferior knows it
+ */
+static struct sylvan_inferior *
+sylvan_thread_owner(pid_t tid, struct sylvan_thread **threadp) {
+    for (struct sylvan_inferior *inf = sylvan_inferior_list(); inf; inf = inf->next)
+        if ((*threadp = sylvan_thread_find(inf, tid)))
+            return inf;
+
+    return NULL;
+}
+
+/**
+ * fills the register cache, at most one PTRACE_GETREGS per stop
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_regs_fetch(struct sylvan_thread *thread) {
+
+    assert(thread); // should have been checked by the caller
+
+    if (thread->regs_valid)
+        return SYLVANC_OK;
+
+    if (ptrace(PTRACE_GETREGS, thread->tid, NULL, &thread->regs) < 0)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_GETREGS_FAILED, "ptrace get regs");
+
+    thread->regs_valid = true;
+    thread->regs_dirty = false;
+    return SYLVANC_OK;
+}
+
+/**
+ * writes the register cache back to the thread if it was modified
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_regs_flush(struct sylvan_thread *thread) {
+
+    assert(thread); // should have been checked by the caller
+
+    if (!thread->regs_valid || !thread->regs_dirty)
+        return SYLVANC_OK;
+
+    if (ptrace(PTRACE_SETREGS, thread->tid, NULL, &thread->regs) < 0)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_SETREGS_FAILED, "ptrace set regs");
+
+    thread->regs_dirty = false;
+    return SYLVANC_OK;
+}
+
+SYLVAN_INTERNAL void
+sylvan_thread_regs_invalidate(struct sylvan_thread *thread) {
+    thread->regs_valid = false;
+    thread->regs_dirty = false;
+}
+
+static void
+sylvan_thread_set_pending(struct sylvan_thread *thread, int status) {
+    if (!thread->has_pending)
+        sylvan_thread_pending++;
+
+    thread->has_pending = true;
+    thread->pending_status = status;
+}
+
+static void
+sylvan_thread_clear_pending(struct sylvan_thread *thread) {
+    if (thread->has_pending)
+        sylvan_thread_pending--;
+
+    thread->has_pending = false;
+}
+
+SYLVAN_INTERNAL bool
+sylvan_thread_has_pending(void) {
+    return sylvan_thread_pending > 0;
+}
+
+/**
+ * takes a pending stop of inf, or of any inferior running in the background or in non-stop mode if inf is NULL
+ */
+static bool
+sylvan_thread_take_pending(struct sylvan_inferior *inf, struct sylvan_inferior **ownerp,
+                           struct sylvan_thread **threadp, int *status) {
+    if (!sylvan_thread_pending)
+        return false;
+
+    for (struct sylvan_inferior *owner = inf ? inf : sylvan_inferior_list(); owner; owner = inf ? NULL : owner->next) {
+        if (!inf && owner->status != SYLVAN_INFSTATE_RUNNING && !owner->non_stop)
+            continue;
+
+        struct sylvan_thread *thread, *tmp;
+        HASH_ITER(hh, owner->threads, thread, tmp)
+            if (thread->has_pending) {
+                *ownerp = owner;
+                *threadp = thread;
+                *status = thread->pending_status;
+                sylvan_thread_clear_pending(thread);
+                return true;
+            }
+    }
+
+    return false;
+}
+
+static void
+sylvan_thread_orphan_add(pid_t tid, int status) {
+    struct sylvan_thread_orphan *orphan = malloc(sizeof(struct sylvan_thread_orphan));
+    if (!orphan)
+        return;     /* the new thread is waited for again, waitpid reports nothing and it's taken as gone */
+
+    orphan->tid = tid;
+    orphan->status = status;
+    orphan->next = sylvan_thread_orphans;
+    sylvan_thread_orphans = orphan;
+}
+
+static bool
+sylvan_thread_orphan_take(pid_t tid, int *status) {
+    for (struct sylvan_thread_orphan **orphanp = &sylvan_thread_orphans; *orphanp; orphanp = &(*orphanp)->next)
+        if ((*orphanp)->tid == tid) {
+            struct sylvan_thread_orphan *orphan = *orphanp;
+            if (status)
+                *status = orphan->status;
+            *orphanp = orphan->next;
+            free(orphan);
+            return true;
+        }
+
+    return false;
+}
+
+/**
+ * waits for tid, retrying on EINTR
+ */
+static pid_t
+sylvan_thread_waitpid(pid_t tid, int *status, int flags) {
+    pid_t result;
+    do {
+        result = waitpid(tid, status, flags | __WALL);
+    } while (result == -1 && errno == EINTR);
+    return result;
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_resume(struct sylvan_inferior *inf, struct sylvan_thread *thread, enum __ptrace_request request) {
+
+    assert(inf && thread); // should have been checked by the caller
+
+    sylvan_code_t code;
+    if ((code = sylvan_thread_regs_flush(thread)))
+        return code;
+
+    sylvan_thread_regs_invalidate(thread);
+    sylvan_thread_clear_pending(thread);
+    sylvan_memcache_invalidate(inf);
+    thread->stop_breakpoint = NULL;
+    thread->paused = false;
+
+    /* a step keeps the signal, delivering it would end the step at the first instruction of the handler */
+    int sig = request == PTRACE_CONT ? thread->pending_signal : 0;
+    if (ptrace(request, thread->tid, NULL, (void *)(long)sig) < 0) {
+        if (request == PTRACE_SINGLESTEP)
+            return sylvan_set_errno_msg(SYLVANC_PTRACE_STEP_FAILED, "ptrace single step");
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_CONT_FAILED, "ptrace cont");
+    }
+
+    if (sig)
+        thread->pending_signal = 0;
+    thread->is_stopped = false;
+    return SYLVANC_OK;
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_resume_all(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    struct sylvan_thread *thread, *tmp;
+    if (sylvan_thread_pending)
+        HASH_ITER(hh, inf->threads, thread, tmp)
+            if (thread->has_pending)
+                return SYLVANC_OK;
+
+    sylvan_code_t code;
+    HASH_ITER(hh, inf->threads, thread, tmp) {
+        if (!thread->is_stopped)
+            continue;
+
+        /* a thread killed in its stop reports its exit later */
+        if ((code = sylvan_thread_resume(inf, thread, PTRACE_CONT)) && errno != ESRCH)
+            return code;
+        thread->is_stopped = false;
+    }
+
+    return SYLVANC_OK;
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_wait_new(pid_t tid, int *status) {
+
+    assert(status); // should have been checked by the caller
+
+    /* the stop may have been collected by a waitpid(-1) before the event announcing it */
+    if (!sylvan_thread_orphan_take(tid, status) && sylvan_thread_waitpid(tid, status, 0) < 0)
+        return sylvan_set_errno_msg(SYLVANC_WAITPID_FAILED, "waitpid");
+
+    return SYLVANC_OK;
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_add_clone(struct sylvan_inferior *inf, struct sylvan_thread *parent, struct sylvan_thread **threadp) {
+
+    assert(inf && parent); // should have been checked by the caller
+
+    if (threadp)
+        *threadp = NULL;
+
+    unsigned long msg;
+    if (ptrace(PTRACE_GETEVENTMSG, parent->tid, NULL, &msg) < 0)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace get event message");
+
+    pid_t tid = (pid_t)msg;
+
+    int status;
+    sylvan_code_t code;
+    if ((code = sylvan_thread_wait_new(tid, &status)))
+        return code;
+
+    if (!WIFSTOPPED(status))
+        return SYLVANC_OK;
+
+    struct sylvan_thread *thread;
+    if ((code = sylvan_thread_add(inf, tid, &thread)))
+        return code;
+
+    thread->is_stopped = true;
+
+    /* the first stop of a seized clone is a PTRACE_EVENT_STOP, anything else is its own */
+    if (SYLVAN_PTRACE_EVENT(status) != PTRACE_EVENT_STOP)
+        sylvan_thread_set_pending(thread, status);
+
+    if (threadp)
+        *threadp = thread;
+
+    /* debug registers aren't inherited by clones */
+    return sylvan_breakpoint_load_hwbp(inf, thread);
+}
+
+/**
+ * rewinds a thread that stopped on an int3 of an inserted breakpoint, *rewound is false if it didn't
+ * it executes the int3 again when resumed, so the hit is reported then and not lost
+ */
+static sylvan_code_t
+sylvan_thread_rewind_swbp(struct sylvan_inferior *inf, struct sylvan_thread *thread, bool *rewound) {
+
+    *rewound = false;
+
+    siginfo_t info;
+    if (ptrace(PTRACE_GETSIGINFO, thread->tid, NULL, &info) < 0)
+        return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace get siginfo");
+
+    if (info.si_signo != SIGTRAP || info.si_code != SI_KERNEL)
+        return SYLVANC_OK;
+
+    sylvan_code_t code;
+    if ((code = sylvan_thread_regs_fetch(thread)))
+        return code;
+
+    struct sylvan_breakpoint *breakpoint;
+    if (sylvan_breakpoint_find_by_addr(inf, thread->regs.rip - 1, &breakpoint) ||
+        breakpoint->type != SYLVAN_BREAKPOINT_SOFTWARE || !breakpoint->is_enabled_phy)
+        return SYLVANC_OK;
+
+    thread->regs.rip = breakpoint->addr;
+    thread->regs_dirty = true;
+    *rewound = true;
+
+    return SYLVANC_OK;
+}
+
+/**
+ * true if tid is a zombie, a leader that called pthread_exit stays one until the other threads exit
+ */
+static bool
+sylvan_thread_is_zombie(pid_t tid) {
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/stat", tid);
+
+    FILE *file = fopen(path, "re");
+    if (!file)
+        return true;
+
+    char buf[512];
+    size_t len = fread(buf, 1, sizeof(buf) - 1, file);
+    fclose(file);
+    buf[len] = '\0';
+
+    /* the state follows the command name, which may contain anything */
+    char *end = strrchr(buf, ')');
+    return !end || end[1] != ' ' || end[2] == 'Z' || end[2] == 'X';
+}
+
+/**
+ * sorts out the status of a thread that was running, its stop is kept as pending
+ * unless it's an interrupt or it can be handled here
+ */
+static sylvan_code_t
+sylvan_thread_sort_stop(struct sylvan_inferior *inf, struct sylvan_thread *thread, int status) {
+
+    if (!WIFSTOPPED(status)) {
+        if (thread->tid == inf->pid)
+            return sylvan_set_wait_status(inf, status);
+        sylvan_thread_remove(inf, thread);
+        return SYLVANC_OK;
+    }
+
+    thread->is_stopped = true;
+
+    sylvan_code_t code;
+    if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_CLONE << 8))) {
+        struct sylvan_thread *clone;
+        if ((code = sylvan_thread_add_clone(inf, thread, &clone)))
+            return code;
+        if (clone)
+            clone->paused = thread->paused;
+        return SYLVANC_OK;
+    }
+
+    if (SYLVAN_PTRACE_EVENT(status) == PTRACE_EVENT_STOP)
+        return SYLVANC_OK;
+
+    /* threads hitting the same breakpoint at once are the common case, they just hit it again later */
+    bool rewound = false;
+    if (WSTOPSIG(status) == SIGTRAP && !SYLVAN_PTRACE_EVENT(status) &&
+        (code = sylvan_thread_rewind_swbp(inf, thread, &rewound)))
+        return code;
+
+    if (!rewound)
+        sylvan_thread_set_pending(thread, status);
+
+    return SYLVANC_OK;
+}
+
+/**
+ * waits until thread, which was interrupted, is stopped and sorts out why it stopped
+ */
+static sylvan_code_t
+sylvan_thread_wait_stopped(struct sylvan_inferior *inf, struct sylvan_thread *thread) {
+
+    /* a zombie leader never stops and its exit waits for the other threads, so it's polled */
+    bool leader = thread->tid == inf->pid && HASH_COUNT(inf->threads) > 1;
+
+    int status;
+    pid_t result;
+    for (int polls = 0; !(result = sylvan_thread_waitpid(thread->tid, &status, leader ? WNOHANG : 0)); polls++) {
+        /* it's usually just about to stop, the cpu is handed over before checking and sleeping */
+        if (polls < SYLVAN_THREAD_YIELDS) {
+            sched_yield();
+            continue;
+        }
+        if (sylvan_thread_is_zombie(thread->tid)) {
+            thread->is_stopped = true;
+            return SYLVANC_OK;
+        }
+        nanosleep(&(struct timespec){ .tv_nsec = 100000 }, NULL);
+    }
+
+    if (result < 0)
+        return sylvan_set_errno_msg(SYLVANC_WAITPID_FAILED, "waitpid");
+
+    return sylvan_thread_sort_stop(inf, thread, status);
+}
+
+/**
+ * waits for every thread that isn't stopped, the leader last
+ */
+static sylvan_code_t
+sylvan_thread_wait_all(struct sylvan_inferior *inf) {
+    for (;;) {
+        struct sylvan_thread *thread, *tmp, *next = NULL;
+        HASH_ITER(hh, inf->threads, thread, tmp)
+            if (!thread->is_stopped) {
+                next = thread;
+                if (thread->tid != inf->pid)
+                    break;
+            }
+
+        if (!next)
+            return SYLVANC_OK;
+
+        sylvan_code_t code;
+        if ((code = sylvan_thread_wait_stopped(inf, next)))
+            return code;
+    }
+}
+
+/**
+ * interrupts every running thread and waits for them, pause marks them for sylvan_thread_resume_paused
+ * *interrupted is set if there was any
+ */
+static sylvan_code_t
+sylvan_thread_interrupt_all(struct sylvan_inferior *inf, bool pause, bool *interrupted) {
+    *interrupted = false;
+
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp) {
+        if (thread->is_stopped)
+            continue;
+        thread->paused = pause;
+        *interrupted = true;
+
+        /* one that stopped by itself since it was resumed would take the interrupt as its next stop */
+        int status;
+        pid_t result = sylvan_thread_waitpid(thread->tid, &status, WNOHANG);
+        if (result > 0) {
+            sylvan_code_t code;
+            if ((code = sylvan_thread_sort_stop(inf, thread, status)))
+                return code;
+            continue;
+        }
+
+        if (ptrace(PTRACE_INTERRUPT, thread->tid, NULL, NULL) < 0 && errno != ESRCH)
+            return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace interrupt");
+    }
+
+    return sylvan_thread_wait_all(inf);
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_stop_all(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    inf->interrupting = false;
+
+    bool interrupted;
+    return sylvan_thread_interrupt_all(inf, false, &interrupted);
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_pause_all(struct sylvan_inferior *inf, bool *paused) {
+
+    assert(inf && paused); // should have been checked by the caller
+
+    return sylvan_thread_interrupt_all(inf, true, paused);
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_resume_paused(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    sylvan_code_t code;
+    bool interrupted = !inf->interrupting;
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, inf->threads, thread, tmp) {
+        if (!thread->paused)
+            continue;
+
+        /* the pause took the stop sylvan_interrupt asked for, hand it back so it's still reported */
+        if (!interrupted && !thread->has_pending) {
+            sylvan_thread_set_pending(thread, SIGTRAP << 8 | PTRACE_EVENT_STOP << 16 | 0x7f);
+            interrupted = true;
+        }
+
+        thread->paused = false;
+        if (!thread->is_stopped || thread->has_pending)
+            continue;
+
+        if ((code = sylvan_thread_resume(inf, thread, PTRACE_CONT)) && errno != ESRCH)
+            return code;
+        thread->is_stopped = false;
+    }
+
+    return SYLVANC_OK;
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_seize_all(struct sylvan_inferior *inf) {
+
+    assert(inf && inf->pid > 0); // should have been checked by the caller
+
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%d/task", inf->pid);
+
+    /* threads started by ones that aren't seized yet only show up in the next pass */
+    sylvan_code_t code;
+    bool found;
+    do {
+        DIR *dir = opendir(path);
+        if (!dir)
+            return sylvan_set_errno_msg(SYLVANC_SYSTEM_ERROR, "open %s", path);
+
+        found = false;
+        struct dirent *entry;
+        while ((entry = readdir(dir))) {
+            pid_t tid = (pid_t)strtol(entry->d_name, NULL, 10);
+            if (tid <= 0 || sylvan_thread_find(inf, tid))
+                continue;
+
+            /* EPERM for a clone of a seized thread whose event hasn't been collected, it's traced already */
+            if (ptrace(PTRACE_SEIZE, tid, NULL, (void *)SYLVAN_PTRACE_OPTIONS) < 0) {
+                if (errno == ESRCH || errno == EPERM)
+                    continue;
+                closedir(dir);
+                return sylvan_set_errno_msg(SYLVANC_PTRACE_ATTACH_FAILED, "ptrace seize thread %d", tid);
+            }
+
+            if ((code = sylvan_thread_add(inf, tid, NULL))) {
+                closedir(dir);
+                return code;
+            }
+
+            if (ptrace(PTRACE_INTERRUPT, tid, NULL, NULL) < 0 && errno != ESRCH) {
+                closedir(dir);
+                return sylvan_set_errno_msg(SYLVANC_PTRACE_ERROR, "ptrace interrupt");
+            }
+            found = true;
+        }
+        closedir(dir);
+
+        if ((code = sylvan_thread_wait_all(inf)))
+            return code;
+    } while (found);
+
+    return SYLVANC_OK;
+}
+
+/**
+ * handles a status the caller of sylvan_thread_wait never sees, returns false if it has to see it
+ * the threads involved are resumed, sets *code if that fails
+ */
+static bool
+sylvan_thread_absorb(struct sylvan_inferior *inf, struct sylvan_thread *thread, int status, sylvan_code_t *code) {
+
+    *code = SYLVANC_OK;
+
+    if (!WIFSTOPPED(status)) {
+        if (thread->tid == inf->pid)
+            return false;
+        sylvan_thread_remove(inf, thread);
+        return true;
+    }
+
+    thread->is_stopped = true;
+
+    if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_CLONE << 8))) {
+        struct sylvan_thread *clone;
+        if ((*code = sylvan_thread_add_clone(inf, thread, &clone)))
+            return true;
+
+        if (clone && !clone->has_pending && (*code = sylvan_thread_resume(inf, clone, PTRACE_CONT)) && errno != ESRCH)
+            return true;
+
+        if ((*code = sylvan_thread_resume(inf, thread, PTRACE_CONT)) && errno == ESRCH)
+            *code = SYLVANC_OK;
+        return true;
+    }
+
+    int event = SYLVAN_PTRACE_EVENT(status);
+    if (WSTOPSIG(status) == SIGTRAP && (event == PTRACE_EVENT_FORK || event == PTRACE_EVENT_VFORK)) {
+        /* in follow-fork child mode the thread is gone afterwards and the child's runs in its place */
+        struct sylvan_thread *stopped;
+        if ((*code = sylvan_fork_follow(inf, thread, event == PTRACE_EVENT_VFORK, &stopped)))
+            return true;
+
+        if ((*code = sylvan_thread_resume(inf, stopped, PTRACE_CONT)) && errno == ESRCH)
+            *code = SYLVANC_OK;
+        return true;
+    }
+
+    if (WSTOPSIG(status) == SIGTRAP && event == PTRACE_EVENT_VFORK_DONE) {
+        if ((*code = sylvan_fork_vfork_done(inf)))
+            return true;
+
+        if ((*code = sylvan_thread_resume(inf, thread, PTRACE_CONT)) && errno == ESRCH)
+            *code = SYLVANC_OK;
+        return true;
+    }
+
+    /* the other threads are gone after an exec, the one that called it is the leader now */
+    if (status >> 8 == (SIGTRAP | (PTRACE_EVENT_EXEC << 8))) {
+        struct sylvan_thread *other, *tmp;
+        HASH_ITER(hh, inf->threads, other, tmp)
+            if (other != thread)
+                sylvan_thread_remove(inf, other);
+        sylvan_thread_regs_invalidate(thread);
+        return false;
+    }
+
+    /* an interrupt that arrived after the thread had stopped for something else */
+    if (SYLVAN_PTRACE_EVENT(status) == PTRACE_EVENT_STOP && WSTOPSIG(status) == SIGTRAP && !inf->interrupting) {
+        if ((*code = sylvan_thread_resume(inf, thread, PTRACE_CONT)) && errno == ESRCH)
+            *code = SYLVANC_OK;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * handles a status of an inferior other than the one being waited for like the event loop would,
+ * what it has to report is kept for sylvan_event_poll
+ */
+static void
+sylvan_thread_handle_other(struct sylvan_inferior *owner, struct sylvan_thread *thread, int status) {
+
+    sylvan_code_t code;
+    if (sylvan_thread_absorb(owner, thread, status, &code)) {
+        if (code)
+            sylvan_event_defer(owner, code);
+        return;
+    }
+
+    bool report;
+    code = sylvan_handle_event(owner, thread, status, &report);
+    if (report || code)
+        sylvan_event_defer(owner, code);
+}
+
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_thread_wait(struct sylvan_inferior *inf, bool blocking, struct sylvan_inferior **infp,
+                   struct sylvan_thread **threadp, int *status) {
+
+    assert(infp && threadp && status); // should have been checked by the caller
+
+    *infp = NULL;
+    *threadp = NULL;
+
+    bool exits_only = inf && !blocking;
+
+    for (;;) {
+        struct sylvan_inferior *owner;
+        struct sylvan_thread *thread;
+        int status_;
+
+        if (exits_only || !sylvan_thread_take_pending(inf, &owner, &thread, &status_)) {
+            pid_t tid = sylvan_thread_waitpid(-1, &status_, blocking ? 0 : WNOHANG);
+            if (!tid)
+                return SYLVANC_OK;
+            if (tid < 0)
+                return sylvan_set_errno_msg(SYLVANC_WAITPID_FAILED, "waitpid");
+
+            /* a new thread before its clone event, or a process of an inferior that was destroyed */
+            if (!(owner = sylvan_thread_owner(tid, &thread))) {
+                if (WIFSTOPPED(status_))
+                    sylvan_thread_orphan_add(tid, status_);
+                else
+                    sylvan_thread_orphan_take(tid, NULL);
+                continue;
+            }
+
+            /* one of inf's threads may be waiting for the other inferior, like a parent for a followed child */
+            if (inf && owner != inf && blocking) {
+                sylvan_thread_handle_other(owner, thread, status_);
+                continue;
+            }
+
+            /* not running either way, an exit is taken from here like a stop */
+            if ((inf && owner != inf) || (exits_only && WIFSTOPPED(status_))) {
+                thread->is_stopped = true;
+                sylvan_thread_set_pending(thread, status_);
+                continue;
+            }
+        }
+
+        sylvan_code_t code;
+        if (sylvan_thread_absorb(owner, thread, status_, &code)) {
+            if (!code)
+                continue;
+            *infp = owner;
+            return code;
+        }
+
+        *infp = owner;
+        *threadp = thread;
+        *status = status_;
+        return SYLVANC_OK;
+    }
+}
+
+/**
+ * see include/sylvan/thread.h
+ */
+sylvan_code_t sylvan_thread_select(struct sylvan_inferior *inf, pid_t tid) {
+    if (!inf)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (inf->status != SYLVAN_INFSTATE_STOPPED && !(inf->non_stop && inf->status == SYLVAN_INFSTATE_RUNNING))
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Process is not stopped");
+
+    struct sylvan_thread *thread = sylvan_thread_find(inf, tid);
+    if (!thread)
+        return sylvan_set_message(SYLVANC_INVALID_ARGUMENT, "No thread %d", tid);
+
+    if (!thread->is_stopped)
+        return sylvan_set_message(SYLVANC_PROC_RUNNING, "Thread %d is running", tid);
+
+    inf->thread = thread;
+    inf->status = SYLVAN_INFSTATE_STOPPED;
+    return SYLVANC_OK;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef SYLVAN_THREAD_H
+#define SYLVAN_THREAD_H
+
+#include <stdbool.h>
+#include <sys/ptrace.h>
+#include <sylvan/inferior.h>
+#include <sylvan/thread.h>
+
+/* every thread is seized with these, clones and forked children are traced from their first instruction
+ * and a system call a seccomp filter traces stops it instead of failing with ENOSYS */
+#define SYLVAN_PTRACE_OPTIONS (PTRACE_O_TRACECLONE | PTRACE_O_TRACEEXEC | PTRACE_O_TRACEFORK | \
+                               PTRACE_O_TRACEVFORK | PTRACE_O_TRACEVFORKDONE | PTRACE_O_TRACESECCOMP)
+
+/* PTRACE_EVENT_* of a ptrace event stop, 0 for any other wait status */
+#define SYLVAN_PTRACE_EVENT(status) ((status) >> 16)
+
+sylvan_code_t sylvan_thread_add(struct sylvan_inferior *inf, pid_t tid, struct sylvan_thread **threadp);
+void sylvan_thread_remove(struct sylvan_inferior *inf, struct sylvan_thread *thread);
+void sylvan_thread_clear(struct sylvan_inferior *inf);
+struct sylvan_thread *sylvan_thread_find(struct sylvan_inferior *inf, pid_t tid);
+
+sylvan_code_t sylvan_thread_regs_fetch(struct sylvan_thread *thread);
+sylvan_code_t sylvan_thread_regs_flush(struct sylvan_thread *thread);
+void sylvan_thread_regs_invalidate(struct sylvan_thread *thread);
+
+/**
+ * flushes the thread's register cache and resumes it with PTRACE_CONT or PTRACE_SINGLESTEP
+ * a pending stop of the thread is dropped, PTRACE_CONT delivers its pending signal
+ */
+sylvan_code_t sylvan_thread_resume(struct sylvan_inferior *inf, struct sylvan_thread *thread, enum __ptrace_request request);
+
+/**
+ * resumes every stopped thread, unless one of them has a pending stop, which the next wait reports instead
+ */
+sylvan_code_t sylvan_thread_resume_all(struct sylvan_inferior *inf);
+
+/**
+ * interrupts the threads that are running and waits until all of them are stopped
+ * a thread found on an int3 is rewound and hits it again when resumed, any other stop is kept as pending
+ */
+sylvan_code_t sylvan_thread_stop_all(struct sylvan_inferior *inf);
+
+/**
+ * interrupts the threads that are running and marks them paused, for changing what all threads share
+ * like the text or the debug registers while none of them runs. stops are sorted out like in sylvan_thread_stop_all.
+ * *paused is false if every thread was stopped already, the caller has nothing to resume then,
+ * which keeps a pause inside another one from resuming the threads early
+ */
+sylvan_code_t sylvan_thread_pause_all(struct sylvan_inferior *inf, bool *paused);
+
+/**
+ * resumes the threads sylvan_thread_pause_all stopped, except the ones that have a pending stop now
+ */
+sylvan_code_t sylvan_thread_resume_paused(struct sylvan_inferior *inf);
+
+/**
+ * seizes the threads the process of inf already has, called once its leader is stopped
+ */
+sylvan_code_t sylvan_thread_seize_all(struct sylvan_inferior *inf);
+
+/**
+ * waits for the first wait status of a task announced by a clone or fork event, which
+ * may have been collected already by a wait for any task
+ */
+sylvan_code_t sylvan_thread_wait_new(pid_t tid, int *status);
+
+/**
+ * adds the thread announced by a PTRACE_EVENT_CLONE stop of parent and waits for its first stop
+ * the new thread is left stopped with the debug registers loaded, *threadp is NULL if it's already gone
+ */
+sylvan_code_t sylvan_thread_add_clone(struct sylvan_inferior *inf, struct sylvan_thread *parent, struct sylvan_thread **threadp);
+
+/**
+ * waits for the next wait status of a thread of inf and sets *infp and *threadp to where it came from
+ * new threads, forks, exits of threads other than the leader and stale interrupts are handled on the way.
+ * statuses of other inferiors are handled like the event loop would and their reports are deferred to it.
+ * when blocking is false only an exit of the process is returned, stops are kept as pending.
+ * with a NULL inf, returns any status and the pending stops of inferiors running in the background
+ * or in non-stop mode, the event loop uses that. *infp is NULL if nothing happened
+ */
+sylvan_code_t sylvan_thread_wait(struct sylvan_inferior *inf, bool blocking, struct sylvan_inferior **infp,
+                                 struct sylvan_thread **threadp, int *status);
+
+/**
+ * true if some thread of any inferior has a pending stop
+ */
+bool sylvan_thread_has_pending(void);
+
+#endif /* SYLVAN_THREAD_H */
\ No newline at end of file
@@ -0,0 +1,1100 @@
+#define _GNU_SOURCE
+
+#include <dwarf.h>
+#include <assert.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <sylvan/inferior.h>
+#include "displaced.h"
+#include "error.h"
+#include "sylvan.h"
+#include "thread.h"
+#include "unwind.h"
+
+#define SYLVAN_DWARF_RBP        6       /* DWARF numbers of the registers the CFA is computed from */
+#define SYLVAN_DWARF_RSP        7
+
+#define SYLVAN_CFI_SAME         0       /* how a row recovers a register */
+#define SYLVAN_CFI_OFFSET       1       /* saved at an offset from the CFA */
+#define SYLVAN_CFI_UNDEFINED    2       /* the return address of the outermost frame */
+#define SYLVAN_CFI_UNKNOWN      3       /* a rule rows don't hold, like an expression */
+
+#define SYLVAN_CFI_NO_CFA       0xff    /* cfa_reg of a row whose CFA isn't rsp or rbp plus an offset */
+#define SYLVAN_CFI_STATE_MAX    16      /* DW_CFA_remember_state nesting */
+
+#define SYLVAN_UNWIND_CACHE     1024    /* slots of the pc to row cache, a power of 2 */
+#define SYLVAN_UNWIND_PAGE      0x1000UL
+#define SYLVAN_UNWIND_PAGES     16      /* stack read at once */
+
+/* the rules of an address range of an FDE, 24 bytes */
+struct sylvan_cfi_row {
+    uintptr_t start;                /* link time, the row holds until the next one or the end of the FDE */
+    int32_t cfa_offset;
+    int16_t rbp_offset;             /* where rbp is saved, from the CFA */
+    int16_t ra_offset;              /* where the return address is, from the CFA */
+    uint8_t cfa_reg;                /* SYLVAN_DWARF_RSP or SYLVAN_DWARF_RBP */
+    uint8_t rbp_rule;
+    uint8_t ra_rule;
+};
+
+/* an FDE, its instructions are run the first time a frame is in its code */
+struct sylvan_cfi_fde {
+    uintptr_t start;                /* link time */
+    uintptr_t end;
+    size_t offset;                  /* of the FDE in its section */
+    bool in_debug_frame;
+    bool evaluated;
+    struct sylvan_cfi_row *rows;    /* sorted by start */
+    size_t row_count;
+};
+
+/* a frame section read from the file */
+struct sylvan_cfi_section {
+    uint8_t *data;
+    size_t size;
+    uintptr_t addr;                 /* sh_addr, what pc relative pointers are relative to */
+    bool is_eh;                     /* .eh_frame, whose CIE pointers differ from .debug_frame's */
+};
+
+/* an executable or a library, its sections are read the first time a pc is in its code */
+struct sylvan_cfi_object {
+    char *path;
+    uintptr_t bias;                 /* added to link time addresses */
+    uintptr_t start;                /* what its executable segments cover in the process */
+    uintptr_t end;
+    bool indexed;
+    struct sylvan_cfi_section eh_frame;
+    struct sylvan_cfi_section debug_frame;
+    struct sylvan_cfi_fde *fdes;    /* sorted by start */
+    size_t fde_count;
+    struct sylvan_cfi_object *next;
+};
+
+struct sylvan_unwind {
+    struct sylvan_cfi_object *objects;
+    struct {
+        uintptr_t pc;               /* 0 for an empty slot */
+        const struct sylvan_cfi_row *row;   /* NULL if no FDE covers pc */
+    } cache[SYLVAN_UNWIND_CACHE];
+    uintptr_t stack_addr;           /* where stack was read from, valid during one unwind */
+    size_t stack_len;
+    uint8_t stack[SYLVAN_UNWIND_PAGES * SYLVAN_UNWIND_PAGE];
+};
+
+/* reads an entry of a frame section, reading past end or a form that isn't handled sets failed */
+struct sylvan_cfi_cursor {
+    const uint8_t *pos;
+    const uint8_t *end;
+    bool failed;
+};
+
+/* what a CIE tells about its FDEs */
+struct sylvan_cfi_cie {
+    uint64_t code_align;
+    int64_t data_align;
+    uint64_t ra_reg;
+    uint8_t fde_encoding;           /* DW_EH_PE_* of the addresses in its FDEs */
+    bool has_augmentation;          /* 'z', the FDEs have augmentation data to skip */
+    struct sylvan_cfi_cursor insns; /* initial instructions */
+};
+
+/* the header of a CIE or an FDE */
+struct sylvan_cfi_entry {
+    struct sylvan_cfi_cursor cursor;    /* past the id, ends with the entry */
+    bool is_cie;
+    size_t cie_offset;              /* of the CIE of an FDE */
+    size_t next;                    /* offset of the next entry */
+};
+
+/* a register rule while a CFA program runs */
+struct sylvan_cfi_rule {
+    uint8_t how;
+    int64_t offset;
+};
+
+struct sylvan_cfi_state {
+    uint64_t cfa_reg;
+    int64_t cfa_offset;
+    bool cfa_is_expr;
+    struct sylvan_cfi_rule rbp;
+    struct sylvan_cfi_rule ra;
+};
+
+/**
+ * see lib/sylvan/unwind.h
+ */
+SYLVAN_INTERNAL void
+sylvan_unwind_destroy(struct sylvan_inferior *inf) {
+
+    assert(inf); // should have been checked by the caller
+
+    struct sylvan_unwind *unwind = inf->unwind;
+    if (!unwind)
+        return;
+
+    struct sylvan_cfi_object *object = unwind->objects;
+    while (object) {
+        struct sylvan_cfi_object *next = object->next;
+        for (size_t i = 0; i < object->fde_count; i++)
+            free(object->fdes[i].rows);
+        free(object->fdes);
+        free(object->eh_frame.data);
+        free(object->debug_frame.data);
+        free(object->path);
+        free(object);
+        object = next;
+    }
+
+    free(unwind);
+    inf->unwind = NULL;
+}
+
+static uint64_t
+sylvan_cfi_read(struct sylvan_cfi_cursor *cursor, size_t size) {
+    if ((size_t)(cursor->end - cursor->pos) < size) {
+        cursor->pos = cursor->end;
+        cursor->failed = true;
+        return 0;
+    }
+
+    uint64_t value = 0;
+    memcpy(&value, cursor->pos, size);
+    cursor->pos += size;
+    return value;
+}
+
+static uint64_t
+sylvan_cfi_uleb(struct sylvan_cfi_cursor *cursor) {
+    uint64_t value = 0;
+    for (unsigned int shift = 0; cursor->pos < cursor->end; shift += 7) {
+        uint8_t byte = *cursor->pos++;
+        if (shift < 64)
+            value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+
+    cursor->failed = true;
+    return 0;
+}
+
+static int64_t
+sylvan_cfi_sleb(struct sylvan_cfi_cursor *cursor) {
+    uint64_t value = 0;
+    for (unsigned int shift = 0; cursor->pos < cursor->end;) {
+        uint8_t byte = *cursor->pos++;
+        if (shift < 64)
+            value |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) {
+            if (shift < 64 && (byte & 0x40))
+                value |= ~(uint64_t)0 << shift;
+            return (int64_t)value;
+        }
+    }
+
+    cursor->failed = true;
+    return 0;
+}
+
+/**
+ * reads a pointer in a DW_EH_PE_* encoding, pc relative ones are relative to where they are in section
+ */
+static uintptr_t
+sylvan_cfi_pointer(struct sylvan_cfi_cursor *cursor, uint8_t encoding, const struct sylvan_cfi_section *section) {
+    if (encoding == DW_EH_PE_omit)
+        return 0;
+
+    /* text, data and function relative pointers aren't used on x86-64, an indirect one is in the process */
+    uint8_t application = encoding & 0x70;
+    if ((application != DW_EH_PE_absptr && application != DW_EH_PE_pcrel) || (encoding & DW_EH_PE_indirect)) {
+        cursor->failed = true;
+        return 0;
+    }
+
+    uintptr_t base = application == DW_EH_PE_pcrel ? section->addr + (uintptr_t)(cursor->pos - section->data) : 0;
+
+    switch (encoding & 0x0f) {
+        case DW_EH_PE_absptr:
+        case DW_EH_PE_udata8:
+        case DW_EH_PE_sdata8:
+            return base + sylvan_cfi_read(cursor, 8);
+        case DW_EH_PE_uleb128:
+            return base + sylvan_cfi_uleb(cursor);
+        case DW_EH_PE_udata2:
+            return base + sylvan_cfi_read(cursor, 2);
+        case DW_EH_PE_udata4:
+            return base + sylvan_cfi_read(cursor, 4);
+        case DW_EH_PE_sleb128:
+            return base + sylvan_cfi_sleb(cursor);
+        case DW_EH_PE_sdata2:
+            return base + (int16_t)sylvan_cfi_read(cursor, 2);
+        case DW_EH_PE_sdata4:
+            return base + (int32_t)sylvan_cfi_read(cursor, 4);
+        default:
+            cursor->failed = true;
+            return 0;
+    }
+}
+
+/**
+ * reads the header of the entry at offset, false past the last one
+ */
+static bool
+sylvan_cfi_entry(const struct sylvan_cfi_section *section, size_t offset, struct sylvan_cfi_entry *entry) {
+    if (offset >= section->size)
+        return false;
+
+    struct sylvan_cfi_cursor cursor = { section->data + offset, section->data + section->size, false };
+    uint64_t length = sylvan_cfi_read(&cursor, 4);
+    bool is_64 = length == 0xffffffff;
+    if (is_64)
+        length = sylvan_cfi_read(&cursor, 8);
+
+    /* a zero length terminates .eh_frame */
+    if (cursor.failed || length == 0 || length > (size_t)(cursor.end - cursor.pos))
+        return false;
+
+    cursor.end = cursor.pos + length;
+    entry->next = (size_t)(cursor.end - section->data);
+
+    size_t id_offset = (size_t)(cursor.pos - section->data);
+    uint64_t id = sylvan_cfi_read(&cursor, is_64 ? 8 : 4);
+
+    /* an FDE of .eh_frame points back to its CIE, one of .debug_frame has its offset */
+    if (section->is_eh) {
+        entry->is_cie = id == 0;
+        entry->cie_offset = id <= id_offset ? id_offset - id : SIZE_MAX;
+    } else {
+        entry->is_cie = id == (is_64 ? UINT64_MAX : 0xffffffff);
+        entry->cie_offset = id;
+    }
+
+    entry->cursor = cursor;
+    return !cursor.failed;
+}
+
+static bool
+sylvan_cfi_parse_cie(const struct sylvan_cfi_section *section, size_t offset, struct sylvan_cfi_cie *cie) {
+    struct sylvan_cfi_entry entry;
+    if (!sylvan_cfi_entry(section, offset, &entry) || !entry.is_cie)
+        return false;
+
+    struct sylvan_cfi_cursor *cursor = &entry.cursor;
+    uint8_t version = sylvan_cfi_read(cursor, 1);
+
+    const char *augmentation = (const char *)cursor->pos;
+    size_t len = strnlen(augmentation, (size_t)(cursor->end - cursor->pos));
+    if (len == (size_t)(cursor->end - cursor->pos))
+        return false;
+    cursor->pos += len + 1;
+
+    /* the address and segment selector sizes */
+    if (version >= 4 && (sylvan_cfi_read(cursor, 1) != 8 || sylvan_cfi_read(cursor, 1) != 0))
+        return false;
+
+    cie->code_align = sylvan_cfi_uleb(cursor);
+    cie->data_align = sylvan_cfi_sleb(cursor);
+    cie->ra_reg = version == 1 ? sylvan_cfi_read(cursor, 1) : sylvan_cfi_uleb(cursor);
+    cie->fde_encoding = DW_EH_PE_absptr;
+    cie->has_augmentation = augmentation[0] == 'z';
+
+    if (cie->has_augmentation) {
+        uint64_t data_len = sylvan_cfi_uleb(cursor);
+        if (data_len > (size_t)(cursor->end - cursor->pos))
+            return false;
+
+        struct sylvan_cfi_cursor data = { cursor->pos, cursor->pos + data_len, false };
+        cursor->pos += data_len;
+
+        /* what follows a letter that isn't known is skipped with the rest of the data */
+        for (const char *c = augmentation + 1; *c && !data.failed; c++) {
+            if (*c == 'R')
+                cie->fde_encoding = sylvan_cfi_read(&data, 1);
+            else
+            if (*c == 'P')
+                sylvan_cfi_pointer(&data, sylvan_cfi_read(&data, 1) & ~DW_EH_PE_indirect, section);
+            else
+            if (*c == 'L')
+                sylvan_cfi_read(&data, 1);
+            else
+            if (*c != 'S')
+                break;
+        }
+
+        if (data.failed)
+            return false;
+    } else
+    /* an old augmentation without a length can't be skipped */
+    if (augmentation[0])
+        return false;
+
+    cie->insns = *cursor;
+    return !cursor->failed;
+}
+
+/**
+ * reads the code range of an FDE, its cursor is left at the instructions
+ */
+static bool
+sylvan_cfi_parse_fde(const struct sylvan_cfi_section *section, struct sylvan_cfi_entry *entry,
+                     const struct sylvan_cfi_cie *cie, uintptr_t *start, uintptr_t *end) {
+
+    struct sylvan_cfi_cursor *cursor = &entry->cursor;
+    *start = sylvan_cfi_pointer(cursor, cie->fde_encoding, section);
+    *end = *start + sylvan_cfi_pointer(cursor, cie->fde_encoding & 0x0f, section);
+
+    if (cie->has_augmentation) {
+        uint64_t len = sylvan_cfi_uleb(cursor);
+        if (len > (size_t)(cursor->end - cursor->pos))
+            return false;
+        cursor->pos += len;
+    }
+
+    return !cursor->failed;
+}
+
+/**
+ * skips the DWARF expression of an instruction, rows can't hold what it computes
+ */
+static bool
+sylvan_cfi_skip_block(struct sylvan_cfi_cursor *cursor) {
+    uint64_t len = sylvan_cfi_uleb(cursor);
+    if (cursor->failed || len > (size_t)(cursor->end - cursor->pos))
+        return false;
+
+    cursor->pos += len;
+    return true;
+}
+
+/**
+ * sets the rule of reg, only rbp and the return address are tracked
+ */
+static void
+sylvan_cfi_set_rule(const struct sylvan_cfi_cie *cie, struct sylvan_cfi_state *state, uint64_t reg, uint8_t how, int64_t offset) {
+    if (reg == SYLVAN_DWARF_RBP)
+        state->rbp = (struct sylvan_cfi_rule){ how, offset };
+    else
+    if (reg == cie->ra_reg)
+        state->ra = (struct sylvan_cfi_rule){ how, offset };
+}
+
+static void
+sylvan_cfi_restore(const struct sylvan_cfi_cie *cie, struct sylvan_cfi_state *state, const struct sylvan_cfi_state *initial, uint64_t reg) {
+    if (reg == SYLVAN_DWARF_RBP)
+        state->rbp = initial->rbp;
+    else
+    if (reg == cie->ra_reg)
+        state->ra = initial->ra;
+}
+
+static void
+sylvan_cfi_pack_rule(const struct sylvan_cfi_rule *rule, uint8_t *how, int16_t *offset) {
+    *how = rule->how;
+    *offset = 0;
+
+    if (rule->how == SYLVAN_CFI_OFFSET) {
+        if (rule->offset < INT16_MIN || rule->offset > INT16_MAX)
+            *how = SYLVAN_CFI_UNKNOWN;
+        else
+            *offset = (int16_t)rule->offset;
+    }
+}
+
+/**
+ * appends a row holding from loc, rows that change nothing are left out
+ */
+static bool
+sylvan_cfi_emit(struct sylvan_cfi_fde *fde, const struct sylvan_cfi_state *state, uintptr_t loc, size_t *capacity) {
+    if (loc >= fde->end)
+        return true;
+
+    struct sylvan_cfi_row row = { .start = loc, .cfa_reg = SYLVAN_CFI_NO_CFA };
+    if (!state->cfa_is_expr && (state->cfa_reg == SYLVAN_DWARF_RSP || state->cfa_reg == SYLVAN_DWARF_RBP) &&
+        state->cfa_offset >= INT32_MIN && state->cfa_offset <= INT32_MAX) {
+        row.cfa_reg = (uint8_t)state->cfa_reg;
+        row.cfa_offset = (int32_t)state->cfa_offset;
+    }
+
+    sylvan_cfi_pack_rule(&state->rbp, &row.rbp_rule, &row.rbp_offset);
+    sylvan_cfi_pack_rule(&state->ra, &row.ra_rule, &row.ra_offset);
+
+    /* the return address is never the caller's own */
+    if (row.ra_rule == SYLVAN_CFI_SAME)
+        row.ra_rule = SYLVAN_CFI_UNKNOWN;
+
+    if (fde->row_count) {
+        struct sylvan_cfi_row *last = &fde->rows[fde->row_count - 1];
+        if (last->start == loc) {
+            *last = row;
+            return true;
+        }
+        if (last->cfa_reg == row.cfa_reg && last->cfa_offset == row.cfa_offset &&
+            last->rbp_rule == row.rbp_rule && last->rbp_offset == row.rbp_offset &&
+            last->ra_rule == row.ra_rule && last->ra_offset == row.ra_offset)
+            return true;
+    }
+
+    if (fde->row_count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 8;
+        struct sylvan_cfi_row *rows = realloc(fde->rows, new_capacity * sizeof(struct sylvan_cfi_row));
+        if (!rows)
+            return false;
+        fde->rows = rows;
+        *capacity = new_capacity;
+    }
+
+    fde->rows[fde->row_count++] = row;
+    return true;
+}
+
+/**
+ * runs the CFA instructions at cursor from *loc, adding a row to fde each time the location moves
+ * the CIE's initial instructions run with a NULL fde and initial. false on an instruction that isn't handled
+ */
+static bool
+sylvan_cfi_run(const struct sylvan_cfi_section *section, const struct sylvan_cfi_cie *cie, struct sylvan_cfi_cursor cursor,
+               const struct sylvan_cfi_state *initial, struct sylvan_cfi_state *state, uintptr_t *loc,
+               struct sylvan_cfi_fde *fde, size_t *capacity) {
+
+    struct sylvan_cfi_state saved[SYLVAN_CFI_STATE_MAX];
+    size_t depth = 0;
+
+    while (cursor.pos < cursor.end) {
+        uint8_t op = sylvan_cfi_read(&cursor, 1);
+        uintptr_t next = *loc;
+        uint64_t reg;
+
+        switch (op & 0xc0) {
+            case DW_CFA_advance_loc:
+                next += (op & 0x3f) * cie->code_align;
+                break;
+            case DW_CFA_offset:
+                sylvan_cfi_set_rule(cie, state, op & 0x3f, SYLVAN_CFI_OFFSET, (int64_t)sylvan_cfi_uleb(&cursor) * cie->data_align);
+                break;
+            case DW_CFA_restore:
+                if (!initial)
+                    return false;
+                sylvan_cfi_restore(cie, state, initial, op & 0x3f);
+                break;
+            default:
+                switch (op) {
+                    case DW_CFA_nop:
+                        break;
+                    case DW_CFA_set_loc:
+                        next = sylvan_cfi_pointer(&cursor, cie->fde_encoding, section);
+                        break;
+                    case DW_CFA_advance_loc1:
+                        next += sylvan_cfi_read(&cursor, 1) * cie->code_align;
+                        break;
+                    case DW_CFA_advance_loc2:
+                        next += sylvan_cfi_read(&cursor, 2) * cie->code_align;
+                        break;
+                    case DW_CFA_advance_loc4:
+                        next += sylvan_cfi_read(&cursor, 4) * cie->code_align;
+                        break;
+                    case DW_CFA_offset_extended:
+                        reg = sylvan_cfi_uleb(&cursor);
+                        sylvan_cfi_set_rule(cie, state, reg, SYLVAN_CFI_OFFSET, (int64_t)sylvan_cfi_uleb(&cursor) * cie->data_align);
+                        break;
+                    case DW_CFA_offset_extended_sf:
+                        reg = sylvan_cfi_uleb(&cursor);
+                        sylvan_cfi_set_rule(cie, state, reg, SYLVAN_CFI_OFFSET, sylvan_cfi_sleb(&cursor) * cie->data_align);
+                        break;
+                    case DW_CFA_GNU_negative_offset_extended:
+                        reg = sylvan_cfi_uleb(&cursor);
+                        sylvan_cfi_set_rule(cie, state, reg, SYLVAN_CFI_OFFSET, -(int64_t)sylvan_cfi_uleb(&cursor) * cie->data_align);
+                        break;
+                    case DW_CFA_restore_extended:
+                        reg = sylvan_cfi_uleb(&cursor);
+                        if (!initial)
+                            return false;
+                        sylvan_cfi_restore(cie, state, initial, reg);
+                        break;
+                    case DW_CFA_undefined:
+                        sylvan_cfi_set_rule(cie, state, sylvan_cfi_uleb(&cursor), SYLVAN_CFI_UNDEFINED, 0);
+                        break;
+                    case DW_CFA_same_value:
+                        sylvan_cfi_set_rule(cie, state, sylvan_cfi_uleb(&cursor), SYLVAN_CFI_SAME, 0);
+                        break;
+                    case DW_CFA_register:
+                        reg = sylvan_cfi_uleb(&cursor);
+                        sylvan_cfi_uleb(&cursor);
+                        sylvan_cfi_set_rule(cie, state, reg, SYLVAN_CFI_UNKNOWN, 0);
+                        break;
+                    case DW_CFA_val_offset:
+                    case DW_CFA_val_offset_sf:
+                        reg = sylvan_cfi_uleb(&cursor);
+                        sylvan_cfi_uleb(&cursor);
+                        sylvan_cfi_set_rule(cie, state, reg, SYLVAN_CFI_UNKNOWN, 0);
+                        break;
+                    case DW_CFA_expression:
+                    case DW_CFA_val_expression:
+                        reg = sylvan_cfi_uleb(&cursor);
+                        if (!sylvan_cfi_skip_block(&cursor))
+                            return false;
+                        sylvan_cfi_set_rule(cie, state, reg, SYLVAN_CFI_UNKNOWN, 0);
+                        break;
+                    case DW_CFA_remember_state:
+                        if (depth == SYLVAN_CFI_STATE_MAX)
+                            return false;
+                        saved[depth++] = *state;
+                        break;
+                    case DW_CFA_restore_state:
+                        if (depth == 0)
+                            return false;
+                        *state = saved[--depth];
+                        break;
+                    case DW_CFA_def_cfa:
+                        state->cfa_reg = sylvan_cfi_uleb(&cursor);
+                        state->cfa_offset = (int64_t)sylvan_cfi_uleb(&cursor);
+                        state->cfa_is_expr = false;
+                        break;
+                    case DW_CFA_def_cfa_sf:
+                        state->cfa_reg = sylvan_cfi_uleb(&cursor);
+                        state->cfa_offset = sylvan_cfi_sleb(&cursor) * cie->data_align;
+                        state->cfa_is_expr = false;
+                        break;
+                    case DW_CFA_def_cfa_register:
+                        state->cfa_reg = sylvan_cfi_uleb(&cursor);
+                        state->cfa_is_expr = false;
+                        break;
+                    case DW_CFA_def_cfa_offset:
+                        state->cfa_offset = (int64_t)sylvan_cfi_uleb(&cursor);
+                        break;
+                    case DW_CFA_def_cfa_offset_sf:
+                        state->cfa_offset = sylvan_cfi_sleb(&cursor) * cie->data_align;
+                        break;
+                    case DW_CFA_def_cfa_expression:
+                        if (!sylvan_cfi_skip_block(&cursor))
+                            return false;
+                        state->cfa_is_expr = true;
+                        break;
+                    case DW_CFA_GNU_args_size:
+                        sylvan_cfi_uleb(&cursor);
+                        break;
+                    default:
+                        return false;
+                }
+        }
+
+        if (cursor.failed)
+            return false;
+
+        if (next != *loc && fde) {
+            if (next < *loc || !sylvan_cfi_emit(fde, state, *loc, capacity))
+                return false;
+            *loc = next;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * runs the CIE's and the FDE's instructions into the FDE's rows, an FDE that can't be read
+ * or has an instruction that isn't handled gets a row without a CFA from there on
+ */
+static void
+sylvan_cfi_evaluate(struct sylvan_cfi_object *object, struct sylvan_cfi_fde *fde) {
+    fde->evaluated = true;
+
+    const struct sylvan_cfi_section *section = fde->in_debug_frame ? &object->debug_frame : &object->eh_frame;
+    struct sylvan_cfi_entry entry;
+    struct sylvan_cfi_cie cie;
+    uintptr_t start, end;
+    if (!sylvan_cfi_entry(section, fde->offset, &entry) || !sylvan_cfi_parse_cie(section, entry.cie_offset, &cie) ||
+        !sylvan_cfi_parse_fde(section, &entry, &cie, &start, &end))
+        return;
+
+    struct sylvan_cfi_state initial = {
+        .cfa_reg = SYLVAN_CFI_NO_CFA,
+        .rbp = { SYLVAN_CFI_SAME, 0 },
+        .ra = { SYLVAN_CFI_UNKNOWN, 0 },
+    };
+
+    uintptr_t loc = start;
+    size_t capacity = 0;
+    if (!sylvan_cfi_run(section, &cie, cie.insns, NULL, &initial, &loc, NULL, &capacity))
+        return;
+
+    struct sylvan_cfi_state state = initial;
+    if (!sylvan_cfi_run(section, &cie, entry.cursor, &initial, &state, &loc, fde, &capacity))
+        state.cfa_is_expr = true;
+
+    sylvan_cfi_emit(fde, &state, loc, &capacity);
+}
+
+/**
+ * finds the row for link_pc in object, NULL if no FDE covers it
+ */
+static const struct sylvan_cfi_row *
+sylvan_cfi_find_row(struct sylvan_cfi_object *object, uintptr_t link_pc) {
+    size_t low = 0, high = object->fde_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (object->fdes[mid].start <= link_pc)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (low == 0 || link_pc >= object->fdes[low - 1].end)
+        return NULL;
+
+    struct sylvan_cfi_fde *fde = &object->fdes[low - 1];
+    if (!fde->evaluated)
+        sylvan_cfi_evaluate(object, fde);
+
+    low = 0;
+    high = fde->row_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (fde->rows[mid].start <= link_pc)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low ? &fde->rows[low - 1] : NULL;
+}
+
+static int
+sylvan_cfi_fde_compare(const void *a, const void *b) {
+    const struct sylvan_cfi_fde *fa = a, *fb = b;
+    if (fa->start != fb->start)
+        return fa->start < fb->start ? -1 : 1;
+
+    /* .eh_frame is what the program itself unwinds with, it wins over .debug_frame */
+    return (int)fa->in_debug_frame - (int)fb->in_debug_frame;
+}
+
+/**
+ * adds the code ranges of the FDEs of section to object->fdes, false if out of memory
+ */
+static bool
+sylvan_cfi_index_section(struct sylvan_cfi_object *object, const struct sylvan_cfi_section *section, size_t *capacity) {
+    struct sylvan_cfi_entry entry;
+    struct sylvan_cfi_cie cie;
+    size_t cie_offset = SIZE_MAX;
+
+    for (size_t offset = 0; sylvan_cfi_entry(section, offset, &entry); offset = entry.next) {
+        if (entry.is_cie)
+            continue;
+
+        /* the FDEs of a CIE follow it, it's parsed again only when that changes */
+        if (entry.cie_offset != cie_offset) {
+            cie_offset = SIZE_MAX;
+            if (!sylvan_cfi_parse_cie(section, entry.cie_offset, &cie))
+                continue;
+            cie_offset = entry.cie_offset;
+        }
+
+        /* the FDEs of code the linker dropped are left in at address 0 */
+        uintptr_t start, end;
+        if (!sylvan_cfi_parse_fde(section, &entry, &cie, &start, &end) || start == 0 || start >= end)
+            continue;
+
+        if (object->fde_count == *capacity) {
+            size_t new_capacity = *capacity ? *capacity * 2 : 256;
+            struct sylvan_cfi_fde *fdes = realloc(object->fdes, new_capacity * sizeof(struct sylvan_cfi_fde));
+            if (!fdes)
+                return false;
+            object->fdes = fdes;
+            *capacity = new_capacity;
+        }
+
+        object->fdes[object->fde_count++] = (struct sylvan_cfi_fde){
+            .start = start,
+            .end = end,
+            .offset = offset,
+            .in_debug_frame = !section->is_eh,
+        };
+    }
+
+    return true;
+}
+
+static bool
+sylvan_cfi_read_section(int fd, const Elf64_Shdr *shdr, struct sylvan_cfi_section *section, bool is_eh) {
+    if (shdr->sh_type == SHT_NOBITS || (shdr->sh_flags & SHF_COMPRESSED) || !shdr->sh_size || section->data)
+        return true;
+
+    if (!(section->data = malloc(shdr->sh_size)))
+        return false;
+
+    if (pread(fd, section->data, shdr->sh_size, (off_t)shdr->sh_offset) != (ssize_t)shdr->sh_size) {
+        free(section->data);
+        section->data = NULL;
+        return true;
+    }
+
+    section->size = shdr->sh_size;
+    section->addr = shdr->sh_addr;
+    section->is_eh = is_eh;
+    return true;
+}
+
+/**
+ * reads the frame sections of object and the code ranges of their FDEs
+ * an object without them is left with no FDEs, its frames are unwound with the frame pointer
+ */
+static void
+sylvan_cfi_index(struct sylvan_cfi_object *object) {
+    object->indexed = true;
+
+    int fd = open(object->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    Elf64_Ehdr ehdr;
+    Elf64_Shdr *shdrs = NULL;
+    char *names = NULL;
+    if (pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr) || ehdr.e_shentsize != sizeof(Elf64_Shdr) ||
+        !ehdr.e_shnum || ehdr.e_shstrndx >= ehdr.e_shnum)
+        goto out;
+
+    size_t size = ehdr.e_shnum * sizeof(Elf64_Shdr);
+    if (!(shdrs = malloc(size)) || pread(fd, shdrs, size, (off_t)ehdr.e_shoff) != (ssize_t)size)
+        goto out;
+
+    const Elf64_Shdr *strtab = &shdrs[ehdr.e_shstrndx];
+    if (!(names = malloc(strtab->sh_size + 1)) ||
+        pread(fd, names, strtab->sh_size, (off_t)strtab->sh_offset) != (ssize_t)strtab->sh_size)
+        goto out;
+    names[strtab->sh_size] = '\0';
+
+    for (size_t i = 0; i < ehdr.e_shnum; i++) {
+        if (shdrs[i].sh_name >= strtab->sh_size)
+            continue;
+
+        const char *name = names + shdrs[i].sh_name;
+        if ((!strcmp(name, ".eh_frame") && !sylvan_cfi_read_section(fd, &shdrs[i], &object->eh_frame, true)) ||
+            (!strcmp(name, ".debug_frame") && !sylvan_cfi_read_section(fd, &shdrs[i], &object->debug_frame, false)))
+            goto out;
+    }
+
+    size_t capacity = 0;
+    if (sylvan_cfi_index_section(object, &object->eh_frame, &capacity) &&
+        sylvan_cfi_index_section(object, &object->debug_frame, &capacity))
+        qsort(object->fdes, object->fde_count, sizeof(struct sylvan_cfi_fde), sylvan_cfi_fde_compare);
+    else
+        object->fde_count = 0;
+
+out:
+    free(names);
+    free(shdrs);
+    close(fd);
+}
+
+/**
+ * adds the object at path loaded at bias, only the range its executable segments cover is read for now
+ */
+static struct sylvan_cfi_object *
+sylvan_cfi_add_object(struct sylvan_unwind *unwind, const char *path, uintptr_t bias) {
+    struct sylvan_cfi_object *object = calloc(1, sizeof(struct sylvan_cfi_object));
+    if (!object || !(object->path = strdup(path))) {
+        free(object);
+        return NULL;
+    }
+
+    object->bias = bias;
+    object->next = unwind->objects;
+    unwind->objects = object;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return object;
+
+    Elf64_Ehdr ehdr;
+    if (pread(fd, &ehdr, sizeof(ehdr), 0) == sizeof(ehdr) && !memcmp(ehdr.e_ident, ELFMAG, SELFMAG) &&
+        ehdr.e_ident[EI_CLASS] == ELFCLASS64 && ehdr.e_phentsize == sizeof(Elf64_Phdr)) {
+
+        uintptr_t start = UINTPTR_MAX, end = 0;
+        for (size_t i = 0; i < ehdr.e_phnum; i++) {
+            Elf64_Phdr phdr;
+            if (pread(fd, &phdr, sizeof(phdr), (off_t)(ehdr.e_phoff + i * sizeof(phdr))) != sizeof(phdr))
+                break;
+            if (phdr.p_type != PT_LOAD || !(phdr.p_flags & PF_X))
+                continue;
+            if (phdr.p_vaddr < start)
+                start = phdr.p_vaddr;
+            if (phdr.p_vaddr + phdr.p_memsz > end)
+                end = phdr.p_vaddr + phdr.p_memsz;
+        }
+
+        if (start < end) {
+            object->start = start + bias;
+            object->end = end + bias;
+        }
+    }
+
+    close(fd);
+    return object;
+}
+
+static bool
+sylvan_cfi_has_object(struct sylvan_unwind *unwind, const char *path, uintptr_t bias) {
+    for (struct sylvan_cfi_object *object = unwind->objects; object; object = object->next)
+        if (object->bias == bias && !strcmp(object->path, path))
+            return true;
+    return false;
+}
+
+/**
+ * finds the object whose code pc is in, the executable and the libraries are added the first time
+ * a pc isn't in any of the known ones
+ */
+static struct sylvan_cfi_object *
+sylvan_unwind_find_object(struct sylvan_inferior *inf, struct sylvan_unwind *unwind, uintptr_t pc) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (struct sylvan_cfi_object *object = unwind->objects; object; object = object->next) {
+            if (pc < object->start || pc >= object->end)
+                continue;
+            if (!object->indexed)
+                sylvan_cfi_index(object);
+            return object;
+        }
+
+        bool added = false;
+        if (inf->realpath && !sylvan_cfi_has_object(unwind, inf->realpath, inf->load_bias))
+            added |= sylvan_cfi_add_object(unwind, inf->realpath, inf->load_bias) != NULL;
+
+        for (struct sylvan_solib *solib = inf->solibs; solib; solib = solib->next)
+            if (!sylvan_cfi_has_object(unwind, solib->path, solib->base))
+                added |= sylvan_cfi_add_object(unwind, solib->path, solib->base) != NULL;
+
+        if (!added)
+            break;
+    }
+
+    return NULL;
+}
+
+/**
+ * finds the row for pc, a lookup of the same pc again is served from a direct mapped cache
+ */
+static const struct sylvan_cfi_row *
+sylvan_unwind_row(struct sylvan_inferior *inf, struct sylvan_unwind *unwind, uintptr_t pc) {
+    size_t slot = (pc ^ (pc >> 10)) & (SYLVAN_UNWIND_CACHE - 1);
+    if (unwind->cache[slot].pc == pc)
+        return unwind->cache[slot].row;
+
+    struct sylvan_cfi_object *object = sylvan_unwind_find_object(inf, unwind, pc);
+    const struct sylvan_cfi_row *row = object ? sylvan_cfi_find_row(object, pc - object->bias) : NULL;
+
+    unwind->cache[slot].pc = pc;
+    unwind->cache[slot].row = row;
+    return row;
+}
+
+/**
+ * reads the word at addr on the stack, from pages read in one go the last time an address wasn't in them
+ */
+static bool
+sylvan_unwind_read(struct sylvan_inferior *inf, struct sylvan_unwind *unwind, uintptr_t addr, uintptr_t *value) {
+    if (addr < unwind->stack_addr || addr - unwind->stack_addr + sizeof(*value) > unwind->stack_len) {
+        uintptr_t page = addr & ~(SYLVAN_UNWIND_PAGE - 1);
+        struct iovec local = { .iov_base = unwind->stack, .iov_len = sizeof(unwind->stack) };
+        struct iovec remote[SYLVAN_UNWIND_PAGES];
+        for (size_t i = 0; i < SYLVAN_UNWIND_PAGES; i++)
+            remote[i] = (struct iovec){ .iov_base = (void *)(page + i * SYLVAN_UNWIND_PAGE), .iov_len = SYLVAN_UNWIND_PAGE };
+
+        /* a page at a time, the read stops at the first one that isn't mapped, past the top of the stack */
+        ssize_t n = process_vm_readv(inf->pid, &local, 1, remote, SYLVAN_UNWIND_PAGES, 0);
+        unwind->stack_addr = page;
+        unwind->stack_len = n > 0 ? (size_t)n : 0;
+
+        if (addr - page + sizeof(*value) > unwind->stack_len)
+            return sylvan_read_memory(inf, addr, value, sizeof(*value)) == SYLVANC_OK;
+    }
+
+    memcpy(value, unwind->stack + (addr - unwind->stack_addr), sizeof(*value));
+    return true;
+}
+
+/**
+ * true if the instruction before addr is a call, which tells a return address from other values on the stack
+ */
+static bool
+sylvan_unwind_is_return(struct sylvan_inferior *inf, uintptr_t addr) {
+    uint8_t code[SYLVAN_INSN_MAX];
+    if (addr < 7 || sylvan_dstep_read_original(inf, addr - 7, code) < 7)
+        return false;
+
+    /* call rel32, or ff /2 with a register, an indirect register, a disp8 or SIB, or a disp32 operand */
+    return code[2] == 0xe8 ||
+           (code[5] == 0xff && (code[6] & 0x38) == 0x10) ||
+           (code[4] == 0xff && (code[5] & 0x38) == 0x10) ||
+           (code[1] == 0xff && (code[2] & 0x38) == 0x10) ||
+           (code[0] == 0xff && (code[1] & 0x38) == 0x10);
+}
+
+/**
+ * finds the return address slot of a frame that stopped at the entry, in the prologue or on the ret
+ * of a function, where rbp isn't its frame pointer (yet or anymore). *slot is 0 anywhere else
+ */
+static void
+sylvan_unwind_prologue(struct sylvan_inferior *inf, const struct sylvan_unwind_regs *regs, uintptr_t *slot, uintptr_t *rbp_slot) {
+    int kind;
+    if (sylvan_dstep_decode(inf, regs->pc, &kind) && kind == SYLVAN_INSN_RET) {
+        *slot = regs->sp;
+        return;
+    }
+
+    const char *name;
+    uintptr_t offset;
+    if (sylvan_sym_lookup_addr(inf, regs->pc, &name, &offset))
+        return;
+
+    uint8_t prologue[SYLVAN_INSN_MAX];
+    size_t len = sylvan_dstep_read_original(inf, regs->pc - offset, prologue);
+
+    static const uint8_t endbr64[] = { 0xf3, 0x0f, 0x1e, 0xfa };
+    size_t start = len >= sizeof(endbr64) && memcmp(prologue, endbr64, sizeof(endbr64)) == 0 ? sizeof(endbr64) : 0;
+
+    if (offset <= start) {
+        *slot = regs->sp;
+        return;
+    }
+
+    /* between push rbp and mov rbp, rsp the caller's rbp is on top of the stack */
+    if (offset == start + 1 && len > start && prologue[start] == 0x55) {
+        *slot = regs->sp + 8;
+        *rbp_slot = regs->sp;
+    }
+}
+
+/**
+ * unwinds a frame without CFI, like hand-written assembly. a caller has to keep the rbp chain,
+ * the innermost frame may also be in a prologue or a leaf that keeps no frame pointer
+ */
+static sylvan_code_t
+sylvan_unwind_frame_pointer(struct sylvan_inferior *inf, struct sylvan_unwind *unwind, struct sylvan_unwind_regs *regs,
+                            bool innermost, uintptr_t *ra_slot) {
+
+    uintptr_t slot = 0, rbp_slot = 0, pc, rbp = regs->rbp;
+    if (innermost)
+        sylvan_unwind_prologue(inf, regs, &slot, &rbp_slot);
+
+    /* rbp is just another register in code built without frame pointers, the chain has to lead to a call */
+    if (!slot && regs->rbp >= regs->sp && !(regs->rbp & 7) &&
+        sylvan_unwind_read(inf, unwind, regs->rbp + 8, &pc) && sylvan_unwind_is_return(inf, pc)) {
+        slot = regs->rbp + 8;
+        rbp_slot = regs->rbp;
+    }
+
+    if (!slot && innermost && sylvan_unwind_read(inf, unwind, regs->sp, &pc) && sylvan_unwind_is_return(inf, pc))
+        slot = regs->sp;
+
+    if (!slot || !sylvan_unwind_read(inf, unwind, slot, &pc) || (rbp_slot && !sylvan_unwind_read(inf, unwind, rbp_slot, &rbp)))
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Can't unwind the frame at %#lx, it has no unwind info or frame pointer", regs->pc);
+
+    *ra_slot = slot;
+    regs->pc = pc;
+    regs->sp = slot + sizeof(pc);
+    regs->rbp = rbp;
+    return SYLVANC_OK;
+}
+
+/**
+ * see lib/sylvan/unwind.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_unwind_step(struct sylvan_inferior *inf, struct sylvan_unwind_regs *regs, bool innermost, uintptr_t *ra_slot) {
+
+    assert(inf && regs && ra_slot); // should have been checked by the caller
+
+    struct sylvan_unwind *unwind = inf->unwind;
+    if (!unwind && !(unwind = inf->unwind = calloc(1, sizeof(struct sylvan_unwind))))
+        return sylvan_set_code(SYLVANC_OUT_OF_MEMORY);
+
+    /* the stack moved since the last unwind */
+    if (innermost)
+        unwind->stack_len = 0;
+
+    /* the call of a caller may be the last instruction of its function, its return address past the end */
+    const struct sylvan_cfi_row *row = sylvan_unwind_row(inf, unwind, innermost ? regs->pc : regs->pc - 1);
+
+    if (!row || row->cfa_reg == SYLVAN_CFI_NO_CFA || row->ra_rule == SYLVAN_CFI_UNKNOWN || row->rbp_rule == SYLVAN_CFI_UNKNOWN)
+        return sylvan_unwind_frame_pointer(inf, unwind, regs, innermost, ra_slot);
+
+    uintptr_t cfa = (row->cfa_reg == SYLVAN_DWARF_RSP ? regs->sp : regs->rbp) + row->cfa_offset;
+    uintptr_t slot = cfa + row->ra_offset;
+    uintptr_t pc, rbp = regs->rbp;
+
+    /* a caller's frame is always above, anything else is a corrupt stack or a bad rbp */
+    if (cfa <= regs->sp)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Can't unwind the frame at %#lx, its CFA %#lx is below rsp", regs->pc, cfa);
+
+    if (row->ra_rule == SYLVAN_CFI_UNDEFINED) {
+        regs->pc = 0;
+        regs->sp = cfa;
+        return SYLVANC_OK;
+    }
+
+    if (!sylvan_unwind_read(inf, unwind, slot, &pc) ||
+        (row->rbp_rule == SYLVAN_CFI_OFFSET && !sylvan_unwind_read(inf, unwind, cfa + row->rbp_offset, &rbp)))
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Can't unwind the frame at %#lx, its stack can't be read", regs->pc);
+
+    *ra_slot = slot;
+    regs->pc = pc;
+    regs->sp = cfa;
+    regs->rbp = rbp;
+    return SYLVANC_OK;
+}
+
+/**
+ * see lib/sylvan/unwind.h
+ */
+SYLVAN_INTERNAL sylvan_code_t
+sylvan_unwind_thread(struct sylvan_inferior *inf, struct sylvan_thread *thread,
+                     struct sylvan_frame *frames, size_t max, size_t *count) {
+
+    assert(inf && thread && count); // should have been checked by the caller
+
+    sylvan_code_t code;
+    if ((code = sylvan_thread_regs_fetch(thread)))
+        return code;
+
+    struct sylvan_unwind_regs regs = { thread->regs.rip, thread->regs.rsp, thread->regs.rbp };
+    size_t n = 0;
+
+    /* the stack ends at a frame that can't be unwound or whose return address is undefined, like _start */
+    while (n < max && regs.pc) {
+        struct sylvan_frame *frame = &frames[n];
+        frame->pc = regs.pc;
+        frame->cfa = 0;
+
+        uintptr_t slot;
+        if (sylvan_unwind_step(inf, &regs, n++ == 0, &slot))
+            break;
+        frame->cfa = regs.sp;
+    }
+
+    *count = n;
+    return SYLVANC_OK;
+}
+
+/**
+ * unwinds the current thread's stack into frames, innermost first, at most max of them
+ */
+sylvan_code_t sylvan_backtrace(struct sylvan_inferior *inf, struct sylvan_frame *frames, size_t max, size_t *count) {
+    if (inf == NULL || (max && frames == NULL) || count == NULL)
+        return sylvan_set_code(SYLVANC_INVALID_ARGUMENT);
+
+    if (inf->pid <= 0 || inf->thread == NULL)
+        return sylvan_set_message(SYLVANC_INVALID_STATE, "Program is not being run");
+
+    if (!inf->thread->is_stopped)
+        return sylvan_set_message(SYLVANC_PROC_RUNNING, "Thread %d is running", inf->thread->tid);
+
+    return sylvan_unwind_thread(inf, inf->thread, frames, max, count);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef SYLVAN_UNWIND_H
+#define SYLVAN_UNWIND_H
+
+#include <stdbool.h>
+#include <sylvan/inferior.h>
+#include <sylvan/unwind.h>
+
+/* the registers unwinding tracks, the others aren't needed to find the callers */
+struct sylvan_unwind_regs {
+    uintptr_t pc;
+    uintptr_t sp;
+    uintptr_t rbp;
+};
+
+/**
+ * forgets the unwind rules of every object, called when the executable or the libraries change
+ */
+void sylvan_unwind_destroy(struct sylvan_inferior *inf);
+
+/**
+ * unwinds one frame, regs become the caller's and *ra_slot is where the return address was read from
+ * innermost is true for the frame a thread stopped in, which may be in a prologue, and starts reading the stack anew.
+ * regs->pc is 0 if the frame is the outermost one
+ */
+sylvan_code_t sylvan_unwind_step(struct sylvan_inferior *inf, struct sylvan_unwind_regs *regs, bool innermost, uintptr_t *ra_slot);
+
+/**
+ * unwinds the stack of a stopped thread of inf like sylvan_backtrace
+ */
+sylvan_code_t sylvan_unwind_thread(struct sylvan_inferior *inf, struct sylvan_thread *thread,
+                                   struct sylvan_frame *frames, size_t max, size_t *count);
+
+#endif /* SYLVAN_UNWIND_H */
\ No newline at end of file
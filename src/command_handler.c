@@ -11,9 +11,17 @@
 #include "command_registry.h"
 #include "auxiliary_vectors.h"
 #include "sylvan/error.h"
+#include "sylvan/profile.h"
 #include "register.h"
 #include "ui_utils.h"
 #include "disassemble.h"
+#include "syscall.h"
+
+#define MEMORY_READ_CHUNK_ROWS 4096
+#define BACKTRACE_DEFAULT_FRAMES 64
+#define BACKTRACE_MAX_FRAMES 4096
+#define PROFILE_DEFAULT_HZ 99
+#define PROFILE_DEFAULT_FILE "sylvan.folded"
 
 /**
  * @brief Prints available commands or info subcommands with detailed usage
@@ -117,14 +125,197 @@ int handle_exit(char **command, struct sylvan_inferior **inf)
  */
 int handle_continue(char **command, struct sylvan_inferior **inf)
 {
-    (void)command;
     struct sylvan_inferior *curr_inf = *inf;
 
-    if (sylvan_continue(curr_inf))
+    int background = command[1] && strcmp(command[1], "&") == 0;
+    if ((command[1] && !background) || (background && command[2]))
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tcontinue [&]");
+        return 0;
+    }
+
+    if (background)
+    {
+        if (sylvan_continue_background(curr_inf))
+            sylvan_print_error(sylvan_get_last_error());
+        else
+            sylvan_print_ok("Inferior %d running in the background", curr_inf->id);
+        return 0;
+    }
+
+    sylvan_code_t code = sylvan_continue(curr_inf);
+    if (code)
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        if (code == SYLVANC_SYSCALL_ENTRY)
+            print_syscall_entry(curr_inf);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Handler for 'interrupt' command, stops an inferior running in the background
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_interrupt(char **command, struct sylvan_inferior **inf)
+{
+    struct sylvan_inferior *target = *inf;
+
+    if (command[1])
+    {
+        char *endptr;
+        long id = strtol(command[1], &endptr, 10);
+        if (*endptr != '\0' || command[2] || sylvan_inferior_find((int)id, &target))
+        {
+            sylvan_print_error("Invalid Arguments");
+            sylvan_print_instruction("\tinterrupt [id]");
+            return 0;
+        }
+    }
+
+    if (sylvan_interrupt(target))
+        sylvan_print_error(sylvan_get_last_error());
+
+    return 0;
+}
+
+/**
+ * @brief Handler for 'inferior' command, makes another inferior the current one
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_inferior(char **command, struct sylvan_inferior **inf)
+{
+    if (!command[1] || command[2])
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tinferior <id>");
+        return 0;
+    }
+
+    char *endptr;
+    long id = strtol(command[1], &endptr, 10);
+    struct sylvan_inferior *target;
+    if (*endptr != '\0' || sylvan_inferior_find((int)id, &target))
+    {
+        sylvan_print_error("No inferior with id %s", command[1]);
+        return 0;
+    }
+
+    *inf = target;
+    sylvan_print_ok("Switched to inferior %d", target->id);
+    return 0;
+}
+
+/**
+ * @brief Handler for 'thread' command, makes another thread of the current inferior the current one
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_thread(char **command, struct sylvan_inferior **inf)
+{
+    if (!command[1] || command[2])
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tthread <tid>");
+        return 0;
+    }
+
+    char *endptr;
+    long tid = strtol(command[1], &endptr, 10);
+    if (*endptr != '\0' || tid <= 0)
+    {
+        sylvan_print_error("Invalid thread id %s", command[1]);
+        return 0;
+    }
+
+    if (sylvan_thread_select(*inf, (pid_t)tid))
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        return 0;
+    }
+
+    sylvan_print_ok("Switched to thread %ld", tid);
+    return 0;
+}
+
+/**
+ * @brief Prints the system calls traced in the inferior
+ * @param inf The inferior to list them for
+ */
+static void print_traced_syscalls(struct sylvan_inferior *inf)
+{
+    char line[1024];
+    size_t len = 0;
+    line[0] = '\0';
+
+    for (long nr = 0; nr < SYLVAN_SYSCALL_MAX && len < sizeof(line) - 1; nr++)
+    {
+        if (!sylvan_syscall_is_traced(inf, nr))
+            continue;
+
+        const struct sylvan_syscall *syscall_info = find_syscall_by_nr(nr);
+        int count = syscall_info ? snprintf(line + len, sizeof(line) - len, "%s%s", len ? " " : "", syscall_info->name)
+                                 : snprintf(line + len, sizeof(line) - len, "%s%ld", len ? " " : "", nr);
+        len = count > 0 && (size_t)count < sizeof(line) - len ? len + count : sizeof(line) - 1;
+    }
+
+    if (len)
+        sylvan_print_ok("Tracing system calls: %s", line);
+    else
+        sylvan_print_ok("No system calls are traced");
+}
+
+/**
+ * @brief Handler for 'trace_syscalls' command, stops the inferior when it enters one of the given
+ * system calls, 'off' stops tracing and no arguments lists the traced ones
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_trace_syscalls(char **command, struct sylvan_inferior **inf)
+{
+    if (!command[1])
+    {
+        print_traced_syscalls(*inf);
+        return 0;
+    }
+
+    int nrs[SYLVAN_SYSCALL_TRACE_MAX];
+    size_t count = 0;
+
+    if (strcmp(command[1], "off") != 0 || command[2])
+    {
+        for (int i = 1; command[i]; i++)
+        {
+            if (count == SYLVAN_SYSCALL_TRACE_MAX)
+            {
+                sylvan_print_error("At most %d system calls can be traced", SYLVAN_SYSCALL_TRACE_MAX);
+                return 0;
+            }
+
+            const struct sylvan_syscall *syscall_info = find_syscall_by_name(command[i]);
+            char *endptr;
+            long nr = syscall_info ? syscall_info->nr : strtol(command[i], &endptr, 10);
+            if (!syscall_info && (*endptr != '\0' || nr < 0 || nr >= SYLVAN_SYSCALL_MAX))
+            {
+                sylvan_print_error("Unknown system call %s", command[i]);
+                sylvan_print_instruction("\ttrace_syscalls [<name|number>... | off]");
+                return 0;
+            }
+            nrs[count++] = (int)nr;
+        }
+    }
+
+    if (sylvan_set_syscall_trace(*inf, nrs, count))
     {
         sylvan_print_error(sylvan_get_last_error());
+        return 0;
     }
 
+    print_traced_syscalls(*inf);
     return 0;
 }
 
@@ -248,16 +439,114 @@ int handle_info_auxv(char **command, struct sylvan_inferior **inf)
     return 0;
 }
 
+static const char *breakpoint_type_name(sylvan_breakpoint_type_t type)
+{
+    switch (type)
+    {
+    case SYLVAN_BREAKPOINT_HARDWARE:
+        return "hardware";
+    case SYLVAN_BREAKPOINT_WATCH:
+        return "watch";
+    default:
+        return "software";
+    }
+}
+
+/**
+ * @brief Formats a duration in nanoseconds with a readable unit, "-" for 0
+ */
+static void format_duration(uint64_t ns, char *buf, size_t size)
+{
+    if (!ns)
+        snprintf(buf, size, "-");
+    else if (ns < 1000)
+        snprintf(buf, size, "%luns", (unsigned long)ns);
+    else if (ns < 1000000)
+        snprintf(buf, size, "%.1fus", ns / 1e3);
+    else if (ns < 1000000000)
+        snprintf(buf, size, "%.2fms", ns / 1e6);
+    else
+        snprintf(buf, size, "%.2fs", ns / 1e9);
+}
+
+#define DURATION_LEN 16
+#define LOCATION_LEN 128
+
 /**
- * @brief Handler for 'info breakpoints' command
+ * @brief Prints hit counts and the time between consecutive hits of every breakpoint
+ */
+static void print_breakpoint_stats(struct sylvan_inferior *curr_inf)
+{
+    struct table_col cols[] = {
+        {"NUM", 5, TABLE_COL_INT},
+        {"ADDRESS", 18, TABLE_COL_HEX_LONG},
+        {"HITS", 10, TABLE_COL_ULONG},
+        {"IGNORE", 8, TABLE_COL_ULONG},
+        {"MIN", 10, TABLE_COL_STR},
+        {"AVG", 10, TABLE_COL_STR},
+        {"P99", 10, TABLE_COL_STR}};
+
+    int col_count = 7;
+    size_t fixed = sizeof(int) + sizeof(uint64_t) + 2 * sizeof(unsigned long) + 3 * sizeof(char *);
+
+    struct table_row *rows = NULL, *current = NULL;
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, curr_inf->breakpoints, breakpoint, tmp)
+    {
+        if (breakpoint->is_internal)
+            continue;
+
+        struct sylvan_breakpoint_stats stats;
+        sylvan_breakpoint_get_stats(breakpoint, &stats);
+
+        struct table_row *new_row = malloc(sizeof(struct table_row));
+        void *row_data = malloc(fixed + 3 * DURATION_LEN);
+        char *text = (char *)row_data + fixed;
+        format_duration(stats.min_ns, text, DURATION_LEN);
+        format_duration(stats.avg_ns, text + DURATION_LEN, DURATION_LEN);
+        format_duration(stats.p99_ns, text + 2 * DURATION_LEN, DURATION_LEN);
+
+        void *p = row_data;
+        *(int *)p = breakpoint->id;                     p += sizeof(int);
+        *(uint64_t *)p = breakpoint->addr;              p += sizeof(uint64_t);
+        *(unsigned long *)p = stats.hit_count;          p += sizeof(unsigned long);
+        *(unsigned long *)p = breakpoint->ignore_count; p += sizeof(unsigned long);
+        *(const char **)p = text;                       p += sizeof(char *);
+        *(const char **)p = text + DURATION_LEN;        p += sizeof(char *);
+        *(const char **)p = text + 2 * DURATION_LEN;
+        new_row->data = row_data;
+        new_row->next = NULL;
+
+        if (!rows)
+            rows = new_row;
+        else
+            current->next = new_row;
+        current = new_row;
+    }
+
+    print_table("BREAKPOINT HITS", cols, col_count, rows, curr_inf->breakpoint_count);
+    current = rows;
+    while (current)
+    {
+        struct table_row *next = current->next;
+        free((void *)current->data);
+        free(current);
+        current = next;
+    }
+}
+
+/**
+ * @brief Handler for 'info breakpoints' command, -s shows hit statistics
  * @param command Array of command strings
  * @param inf Pointer to the current inferior structure
  */
 int handle_info_breakpoints(char **command, struct sylvan_inferior **inf)
 {
-    if (command[1])
+    int show_stats = command[1] && strcmp(command[1], "-s") == 0;
+    if (command[1] && (!show_stats || command[2]))
     {
         sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tinfo_breakpoints [-s]");
         return 0;
     }
 
@@ -268,23 +557,53 @@ int handle_info_breakpoints(char **command, struct sylvan_inferior **inf)
         return 0;
     }
 
+    if (show_stats)
+    {
+        print_breakpoint_stats(curr_inf);
+        return 0;
+    }
+
     struct table_col cols[] = {
         {"NUM", 5, TABLE_COL_INT},
         {"TYPE", 12, TABLE_COL_STR},
         {"ADDRESS", 18, TABLE_COL_HEX_LONG},
-        {"STATUS", 10, TABLE_COL_INT}};
+        {"STATUS", 10, TABLE_COL_INT},
+        {"HITS", 10, TABLE_COL_ULONG},
+        {"LOCATION", 24, TABLE_COL_STR},
+        {"CONDITION", 24, TABLE_COL_STR}};
 
-    int col_count = 4;
+    int col_count = 7;
     
     struct table_row *rows = NULL, *current = NULL;
-    for (int i = 0; i < curr_inf->breakpoint_count; i++)
+    struct sylvan_breakpoint *breakpoint, *tmp;
+    HASH_ITER(hh, curr_inf->breakpoints, breakpoint, tmp)
     {
+        if (breakpoint->is_internal)
+            continue;
+
         struct table_row *new_row = malloc(sizeof(struct table_row));
-        void *row_data = malloc(sizeof(int) + sizeof(char *) + sizeof(uint64_t) + sizeof(int));
-        *(int *)(row_data) = i;
-        *(const char **)(row_data + sizeof(int)) = "software";
-        *(uint64_t *)(row_data + sizeof(int) + sizeof(char *)) = curr_inf->breakpoints[i].addr;
-        *(int *)(row_data + sizeof(int) + sizeof(char *) + sizeof(uint64_t)) = curr_inf->breakpoints[i].is_enabled_log;
+        size_t fixed = sizeof(int) + sizeof(char *) + sizeof(uint64_t) + sizeof(int) + sizeof(unsigned long) + 2 * sizeof(char *);
+        void *row_data = malloc(fixed + LOCATION_LEN);
+        char *location = (char *)row_data + fixed;
+        const char *name;
+        uintptr_t offset;
+        if (breakpoint->is_pending)
+            snprintf(location, LOCATION_LEN, "%s (pending)", breakpoint->symbol);
+        else if (sylvan_sym_lookup_addr(curr_inf, breakpoint->addr, &name, &offset))
+            snprintf(location, LOCATION_LEN, "-");
+        else if (offset)
+            snprintf(location, LOCATION_LEN, "%s+%#lx", name, offset);
+        else
+            snprintf(location, LOCATION_LEN, "%s", name);
+
+        void *p = row_data;
+        *(int *)p = breakpoint->id;                                         p += sizeof(int);
+        *(const char **)p = breakpoint_type_name(breakpoint->type);         p += sizeof(char *);
+        *(uint64_t *)p = breakpoint->addr;                                  p += sizeof(uint64_t);
+        *(int *)p = breakpoint->is_enabled_log;                             p += sizeof(int);
+        *(unsigned long *)p = breakpoint->hit_count;                        p += sizeof(unsigned long);
+        *(const char **)p = location;                                       p += sizeof(char *);
+        *(const char **)p = breakpoint->condition ? breakpoint->condition : "-";
         new_row->data = row_data;
         new_row->next = NULL;
         
@@ -307,43 +626,447 @@ int handle_info_breakpoints(char **command, struct sylvan_inferior **inf)
     return 0;
 }
 
+static const char *follow_fork_names[] = {
+    [SYLVAN_FOLLOW_FORK_PARENT] = "parent",
+    [SYLVAN_FOLLOW_FORK_CHILD]  = "child",
+    [SYLVAN_FOLLOW_FORK_BOTH]   = "both",
+};
+
+static const char *inferior_state_name(sylvan_inferior_state_t state)
+{
+    switch (state)
+    {
+    case SYLVAN_INFSTATE_RUNNING:
+        return "running";
+    case SYLVAN_INFSTATE_STOPPED:
+        return "stopped";
+    case SYLVAN_INFSTATE_EXITED:
+        return "exited";
+    case SYLVAN_INFSTATE_TERMINATED:
+        return "terminated";
+    default:
+        return "not started";
+    }
+}
+
+/**
+ * @brief Handler for 'info inferiors' command
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_info_inferiors(char **command, struct sylvan_inferior **inf)
+{
+    if (command[1])
+    {
+        sylvan_print_error("Invalid Arguments");
+        return 0;
+    }
+
+    if (!inf || !*inf)
+    {
+        return 0;
+    }
+
+    for (struct sylvan_inferior *curr_inf = sylvan_inferior_list(); curr_inf; curr_inf = curr_inf->next)
+    {
+        printf("%s%s Id:%s %d\n", BLUE, curr_inf == *inf ? "*" : " ", RESET, curr_inf->id);
+        printf("\t%sPID:%s %d\n", BLUE, RESET, curr_inf->pid);
+        printf("\t%sStatus:%s %s\n", BLUE, RESET, inferior_state_name(curr_inf->status));
+        printf("\t%sPath:%s %s\n", BLUE, RESET, curr_inf->realpath);
+        printf("\t%sIs Attached:%s %d\n", BLUE, RESET, curr_inf->is_attached);
+        printf("\t%sNon-stop:%s %d\n", BLUE, RESET, curr_inf->non_stop);
+        printf("\t%sFollow fork:%s %s\n", BLUE, RESET, follow_fork_names[curr_inf->follow_fork]);
+        printf("\t%sNum Breakpoints:%s %d\n", BLUE, RESET, curr_inf->breakpoint_count);
+    }
+    return 0;
+}
+
+/**
+ * @brief Handler for 'info threads' command
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_info_threads(char **command, struct sylvan_inferior **inf)
+{
+    if (command[1])
+    {
+        sylvan_print_error("Invalid Arguments");
+        return 0;
+    }
+
+    if (!inf || !*inf || !(*inf)->threads)
+    {
+        sylvan_print_error("Program is not being run");
+        return 0;
+    }
+
+    struct sylvan_thread *thread, *tmp;
+    HASH_ITER(hh, (*inf)->threads, thread, tmp)
+    {
+        const char *state = thread->has_pending ? "stopped (pending)" : thread->is_stopped ? "stopped" : "running";
+        printf("%s%s Tid:%s %d\t%s", BLUE, thread == (*inf)->thread ? "*" : " ", RESET, thread->tid, state);
+        /* registers are only known for threads looked at during this stop */
+        if (thread->is_stopped && thread->regs_valid)
+            printf("\t%sRip:%s 0x%llx", BLUE, RESET, thread->regs.rip);
+        printf("\n");
+    }
+    return 0;
+}
+
+/**
+ * @brief Handler for 'add-inferior' command creates a new inferior
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_add_inferior(char **command, struct sylvan_inferior **inf)
+{
+    if (command[1])
+    {
+        sylvan_print_error("Invalid Arguments");
+        return 0;
+    }
+
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    /* the previous one keeps its process, switch back to it with 'inferior <id>' */
+    if (sylvan_inferior_create(inf))
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        return 0;
+    }
+
+    sylvan_print_ok("Created New Inferior: ID: %d", (*inf)->id);
+    return 0;
+}
+
+/**
+ * @brief runs a program which is given in args
+ */
+int handle_run(char **command, struct sylvan_inferior **inf)
+{
+    if (command[1])
+    {
+        sylvan_print_error("Invalid Arguments");
+        return 0;
+    }
+
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    sylvan_code_t code = sylvan_run(*inf);
+    if (code)
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        if (code == SYLVANC_SYSCALL_ENTRY)
+            print_syscall_entry(*inf);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief step instruction command
+ */
+int handle_step_inst(char **command, struct sylvan_inferior **inf)
+{
+    unsigned long count = 1;
+    if (command[1])
+    {
+        char *endptr;
+        errno = 0;
+        count = strtoul(command[1], &endptr, 10);
+        if (errno == ERANGE || *endptr != '\0' || command[1][0] == '-' || count == 0 || command[2])
+        {
+            sylvan_print_error("Invalid Arguments");
+            sylvan_print_instruction("\tstepi [N]");
+            return 0;
+        }
+    }
+
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    if (count == 1)
+    {
+        if (sylvan_stepinst(*inf))
+        {
+            sylvan_print_error(sylvan_get_last_error());
+            return 0;
+        }
+
+        sylvan_print_ok("Single Instruction executed");
+        return 0;
+    }
+
+    /* the steps are taken in the library, only the outcome is printed */
+    unsigned long done;
+    sylvan_code_t code = sylvan_stepinst_count(*inf, count, &done);
+    if (code)
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        if (code == SYLVANC_SYSCALL_ENTRY)
+            print_syscall_entry(*inf);
+        if (done)
+            sylvan_print_instruction("%lu of %lu instructions executed", done, count);
+        return 0;
+    }
+
+    sylvan_print_ok("%lu instructions executed", done);
+    return 0;
+}
+
+/**
+ * @brief Handler for 'nexti' command, steps one instruction and runs a call as a whole
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_next_inst(char **command, struct sylvan_inferior **inf)
+{
+    if (command[1])
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tnexti");
+        return 0;
+    }
+
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    /* a call that returned counts as the single instruction, anything else stopped it on the way */
+    sylvan_code_t code = sylvan_nexti(*inf);
+    if (code)
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        if (code == SYLVANC_SYSCALL_ENTRY)
+            print_syscall_entry(*inf);
+        return 0;
+    }
+
+    sylvan_print_ok("Single Instruction executed");
+    return 0;
+}
+
+/**
+ * @brief Handler for 'finish' command, runs until the current function returns and prints rax
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_finish(char **command, struct sylvan_inferior **inf)
+{
+    if (command[1])
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tfinish");
+        return 0;
+    }
+
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    uintptr_t ret_addr = 0;
+    sylvan_code_t code = sylvan_finish(*inf, &ret_addr);
+    if (code == SYLVANC_OK)
+        return 0;
+
+    sylvan_print_error(sylvan_get_last_error());
+    if (code == SYLVANC_SYSCALL_ENTRY)
+        print_syscall_entry(*inf);
+
+    /* anything else stopped it before the function returned */
+    struct user_regs_struct regs;
+    if (code == SYLVANC_PROC_STOPPED && !sylvan_get_regs(*inf, &regs) && regs.rip == ret_addr)
+        sylvan_print_ok("Value returned: rax = %#llx (%lld)", regs.rax, (long long)regs.rax);
+
+    return 0;
+}
+
+/**
+ * @brief steps to another source line with step_line, used by 'step' and 'next', and prints where it is
+ */
+static int step_source_line(char **command, struct sylvan_inferior **inf, const char *usage,
+                            sylvan_code_t (*step_line)(struct sylvan_inferior *))
+{
+    if (command[1])
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction(usage);
+        return 0;
+    }
+
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    sylvan_code_t code = step_line(*inf);
+    if (code)
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        if (code == SYLVANC_SYSCALL_ENTRY)
+            print_syscall_entry(*inf);
+        return 0;
+    }
+
+    struct user_regs_struct regs;
+    if (sylvan_get_regs(*inf, &regs))
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        return 0;
+    }
+
+    const char *name;
+    uintptr_t offset;
+    char where[128] = "";
+    if (!sylvan_sym_lookup_addr(*inf, regs.rip, &name, &offset))
+        snprintf(where, sizeof(where), offset ? " <%s+%#lx>" : " <%s>", name, offset);
+
+    /* a step can end in code without line info, like a library the program returned to */
+    struct sylvan_line_info line;
+    if (sylvan_line_lookup_addr(*inf, regs.rip, &line))
+        sylvan_print_ok("Stopped at %#llx%s", regs.rip, where);
+    else
+        sylvan_print_ok("Stopped at %s:%u, %#llx%s", line.file, line.line, regs.rip, where);
+
+    return 0;
+}
+
+/**
+ * @brief Handler for 'step' command, steps to the next source line, into called functions
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_step(char **command, struct sylvan_inferior **inf)
+{
+    return step_source_line(command, inf, "\tstep", sylvan_stepline);
+}
+
+/**
+ * @brief Handler for 'next' command, steps to the next source line, over called functions
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_next(char **command, struct sylvan_inferior **inf)
+{
+    return step_source_line(command, inf, "\tnext", sylvan_nextline);
+}
+
 /**
- * @brief Handler for 'info inferiors' command
+ * @brief Handler for 'backtrace' command, prints the frames of the current thread, innermost first
  * @param command Array of command strings
  * @param inf Pointer to the current inferior structure
  */
-int handle_info_inferiors(char **command, struct sylvan_inferior **inf)
+int handle_backtrace(char **command, struct sylvan_inferior **inf)
 {
+    unsigned long max = BACKTRACE_DEFAULT_FRAMES;
     if (command[1])
     {
-        sylvan_print_error("Invalid Arguments");
+        char *endptr;
+        errno = 0;
+        max = strtoul(command[1], &endptr, 10);
+        if (errno == ERANGE || *endptr != '\0' || command[1][0] == '-' || max == 0 || max > BACKTRACE_MAX_FRAMES || command[2])
+        {
+            sylvan_print_error("Invalid Arguments");
+            sylvan_print_instruction("\tbacktrace [N], N at most %d", BACKTRACE_MAX_FRAMES);
+            return 0;
+        }
+    }
+
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
         return 0;
     }
 
-    struct sylvan_inferior *curr_inf = *inf;
-    if (!inf || !curr_inf)
+    struct sylvan_frame *frames = calloc(max, sizeof(*frames));
+    if (!frames)
+    {
+        sylvan_print_error("Out of memory");
+        return 0;
+    }
+
+    size_t count;
+    if (sylvan_backtrace(*inf, frames, max, &count))
     {
+        sylvan_print_error(sylvan_get_last_error());
+        free(frames);
         return 0;
     }
 
-    printf("%sId:%s %d\n", BLUE, RESET, curr_inf->id);
-    printf("\t%sPID:%s %d\n", BLUE, RESET, curr_inf->pid);
-    printf("\t%sPath:%s %s\n", BLUE, RESET, curr_inf->realpath);
-    printf("\t%sIs Attached:%s %d\n", BLUE, RESET, curr_inf->is_attached);
-    printf("\t%sNum Breakpoints:%s %d\n", BLUE, RESET, curr_inf->breakpoint_count);
+    for (size_t i = 0; i < count; i++)
+    {
+        printf("%s#%-3zu%s %#018lx", BLUE, i, RESET, frames[i].pc);
+
+        const char *name;
+        uintptr_t offset;
+        if (!sylvan_sym_lookup_addr(*inf, frames[i].pc, &name, &offset))
+            printf(offset ? " in %s+%#lx" : " in %s", name, offset);
+
+        /* a return address may already be on the line after the call */
+        struct sylvan_line_info line;
+        if (!sylvan_line_lookup_addr(*inf, i ? frames[i].pc - 1 : frames[i].pc, &line))
+            printf(" at %s:%u", line.file, line.line);
+
+        printf("\n");
+    }
+
+    /* the last frame couldn't be unwound, the stack may go on */
+    if (count == max && frames[count - 1].cfa)
+        sylvan_print_instruction("(more frames, see backtrace N)");
+
+    free(frames);
     return 0;
 }
 
 /**
- * @brief Handler for 'add-inferior' command creates a new inferior
+ * @brief Handler for 'profile' command, samples the stacks of the running program and writes them folded
  * @param command Array of command strings
  * @param inf Pointer to the current inferior structure
  */
-int handle_add_inferior(char **command, struct sylvan_inferior **inf)
+int handle_profile(char **command, struct sylvan_inferior **inf)
 {
+    char *endptr = NULL;
+    double seconds = 0;
+    unsigned long hz = PROFILE_DEFAULT_HZ;
+    const char *path = PROFILE_DEFAULT_FILE;
+
     if (command[1])
+    {
+        errno = 0;
+        seconds = strtod(command[1], &endptr);
+    }
+    int valid = endptr && *endptr == '\0' && errno != ERANGE && seconds > 0 && seconds <= SYLVAN_PROFILE_MAX_SECONDS;
+
+    if (valid && command[2])
+    {
+        errno = 0;
+        hz = strtoul(command[2], &endptr, 10);
+        valid = *endptr == '\0' && errno != ERANGE && command[2][0] != '-' && hz > 0 && hz <= SYLVAN_PROFILE_MAX_HZ;
+        if (valid && command[3])
+            path = command[3];
+        valid = valid && (!command[3] || !command[4]);
+    }
+
+    if (!valid)
     {
         sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tprofile <seconds> [hz] [file], seconds at most %d", SYLVAN_PROFILE_MAX_SECONDS);
         return 0;
     }
 
@@ -353,55 +1076,84 @@ int handle_add_inferior(char **command, struct sylvan_inferior **inf)
         return 0;
     }
 
-    if (sylvan_inferior_destroy(*inf))
+    /* an early end still leaves the samples taken up to it */
+    struct sylvan_profile *profile = NULL;
+    sylvan_code_t code = sylvan_profile(*inf, seconds, (unsigned int)hz, &profile);
+    if (code)
     {
         sylvan_print_error(sylvan_get_last_error());
+        if (code == SYLVANC_SYSCALL_ENTRY)
+            print_syscall_entry(*inf);
+    }
+
+    if (!profile || !profile->samples)
+    {
+        sylvan_profile_free(profile);
         return 0;
     }
 
-    if (sylvan_inferior_create(inf))
+    FILE *file = fopen(path, "w");
+    if (!file)
     {
-        sylvan_print_error(sylvan_get_last_error());
+        sylvan_print_error("Can't open %s: %s", path, strerror(errno));
+        sylvan_profile_free(profile);
         return 0;
     }
 
-    sylvan_print_ok("Created New Inferior: ID: %d", (*inf)->id);
+    if (sylvan_profile_write_folded(*inf, profile, file))
+        sylvan_print_error(sylvan_get_last_error());
+    else
+        sylvan_print_ok("%zu samples, %zu stacks in %.2f s written to %s", profile->samples,
+                        profile->thread_samples, profile->elapsed_ns / 1e9, path);
+
+    fclose(file);
+
+    printf("Stop time per sample: %savg %.1f us%s, %smax %.1f us%s, stopped %.2f%% of the time\n",
+           BLUE, profile->stop_ns / 1e3 / profile->samples, RESET, BLUE, profile->max_stop_ns / 1e3, RESET,
+           profile->elapsed_ns ? 100.0 * profile->stop_ns / profile->elapsed_ns : 0.0);
+
+    sylvan_profile_free(profile);
     return 0;
 }
 
 /**
- * @brief runs a program which is given in args
+ * @brief resolves a location given as a 0x address, a function name or file:line
+ * @return 0 on success, -1 after printing the error
  */
-int handle_run(char **command, struct sylvan_inferior **inf)
+static int parse_location(struct sylvan_inferior *inf, const char *loc, uintptr_t *addr)
 {
-    if (command[1])
-    {
-        sylvan_print_error("Invalid Arguments");
-        return 0;
-    }
-
-    if (!inf)
+    if (strncmp(loc, "0x", 2) == 0)
     {
-        sylvan_print_error("Null Inferior Pointer");
+        char *endptr;
+        errno = 0;
+        *addr = strtoul(&loc[2], &endptr, 16);
+        if (errno == ERANGE || *endptr != '\0' || loc[2] == '\0')
+        {
+            sylvan_print_error("Invalid address: %s", loc);
+            return -1;
+        }
         return 0;
     }
 
-    if (sylvan_run(*inf))
+    if (sylvan_get_function_addr(inf, loc, addr))
     {
         sylvan_print_error(sylvan_get_last_error());
+        return -1;
     }
 
     return 0;
 }
 
 /**
- * @brief step instruction command
+ * @brief runs the current thread to a location with a temporary breakpoint, used by 'until' and 'advance'
  */
-int handle_step_inst(char **command, struct sylvan_inferior **inf)
+static int run_to_location(char **command, struct sylvan_inferior **inf, const char *usage,
+                           sylvan_code_t (*run_to)(struct sylvan_inferior *, uintptr_t))
 {
-    if (command[1])
+    if (!command[1] || command[2])
     {
         sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction(usage);
         return 0;
     }
 
@@ -410,16 +1162,43 @@ int handle_step_inst(char **command, struct sylvan_inferior **inf)
         sylvan_print_error("Null Inferior Pointer");
         return 0;
     }
-    if (sylvan_stepinst(*inf))
+
+    uintptr_t addr;
+    if (parse_location(*inf, command[1], &addr))
+        return 0;
+
+    /* reaching the location is reported as a stop, like any other way the run can end */
+    sylvan_code_t code = run_to(*inf, addr);
+    if (code)
     {
         sylvan_print_error(sylvan_get_last_error());
-        return 0;
+        if (code == SYLVANC_SYSCALL_ENTRY)
+            print_syscall_entry(*inf);
     }
 
-    sylvan_print_ok("Single Instruction executed");
     return 0;
 }
 
+/**
+ * @brief Handler for 'until' command, runs to a location of the current frame, calls that pass it are skipped
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_until(char **command, struct sylvan_inferior **inf)
+{
+    return run_to_location(command, inf, "\tuntil <address|function|file:line>", sylvan_until);
+}
+
+/**
+ * @brief Handler for 'advance' command, runs to a location wherever the current thread reaches it
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_advance(char **command, struct sylvan_inferior **inf)
+{
+    return run_to_location(command, inf, "\tadvance <address|function|file:line>", sylvan_advance);
+}
+
 int handle_file(char **command, struct sylvan_inferior **inf)
 {
     if (command[1] == NULL)
@@ -583,6 +1362,74 @@ int handle_set_args(char **command, struct sylvan_inferior **inf)
     return 0;
 }
 
+/**
+ * @brief Handler for 'set non-stop' command, switches between stopping every thread on a stop and
+ * stopping only the thread it happened in
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_set_non_stop(char **command, struct sylvan_inferior **inf)
+{
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    if (!command[1] || command[2] || (strcmp(command[1], "on") && strcmp(command[1], "off")))
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tset_non_stop on|off");
+        return 0;
+    }
+
+    bool non_stop = strcmp(command[1], "on") == 0;
+    if (sylvan_set_non_stop(*inf, non_stop))
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        return 0;
+    }
+
+    sylvan_print_ok("Non-stop mode is %s for inferior %d", non_stop ? "on" : "off", (*inf)->id);
+    return 0;
+}
+
+/**
+ * @brief Handler for 'set follow-fork' command, chooses whether the parent, the child or both
+ * are debugged after the process forks
+ * @param command Array of command strings
+ * @param inf Pointer to the current inferior structure
+ */
+int handle_set_follow_fork(char **command, struct sylvan_inferior **inf)
+{
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    int mode = -1;
+    for (int i = 0; command[1] && !command[2] && i < (int)(sizeof(follow_fork_names) / sizeof(follow_fork_names[0])); i++)
+        if (strcmp(command[1], follow_fork_names[i]) == 0)
+            mode = i;
+
+    if (mode < 0)
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tset_follow_fork parent|child|both");
+        return 0;
+    }
+
+    if (sylvan_set_follow_fork(*inf, (sylvan_follow_fork_t)mode))
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        return 0;
+    }
+
+    sylvan_print_ok("Inferior %d follows the %s after a fork", (*inf)->id, follow_fork_names[mode]);
+    return 0;
+}
+
 /**
  * @brief handler to set register values
  */
@@ -654,7 +1501,7 @@ int handle_set_reg(char **command, struct sylvan_inferior **inf)
 }
 
 /**
- * @brief sets a breakpoint
+ * @brief sets a breakpoint, -h uses a debug register instead of patching the text
  */
 int handle_breakpoint_set(char **command, struct sylvan_inferior **inf)
 {
@@ -663,47 +1510,137 @@ int handle_breakpoint_set(char **command, struct sylvan_inferior **inf)
         sylvan_print_error("Null Inferior Pointer");
         return 0;
     }
-    if (command[1] == NULL)
+
+    int is_hw = command[1] && strcmp(command[1], "-h") == 0;
+    char *loc = is_hw ? command[2] : command[1];
+    if (loc == NULL)
     {
         sylvan_print_error("address missing");
-        sylvan_print_instruction("\tbreakpoint <address>");
+        sylvan_print_instruction("\tbreakpoint [-h] <address> [if <condition>]");
         return 0;
     }
 
-    if (command[2])
+    char **rest = is_hw ? &command[3] : &command[2];
+    char condition[512] = "";
+    if (rest[0])
     {
-        sylvan_print_error("Invalid Arguments");
-        return 0;
+        if (strcmp(rest[0], "if") != 0 || !rest[1])
+        {
+            sylvan_print_error("Invalid Arguments");
+            sylvan_print_instruction("\tbreakpoint [-h] <address> [if <condition>]");
+            return 0;
+        }
+
+        /* the condition was split on spaces, glue it back together */
+        size_t len = 0;
+        for (int i = 1; rest[i]; i++)
+        {
+            int written = snprintf(condition + len, sizeof(condition) - len, "%s%s", i > 1 ? " " : "", rest[i]);
+            if (written < 0 || (size_t)written >= sizeof(condition) - len)
+            {
+                sylvan_print_error("Condition is too long");
+                return 0;
+            }
+            len += written;
+        }
     }
 
     char *endptr;
     errno = 0;
-    uintptr_t addr = strtol(&command[1][2], &endptr, 16);
+    uintptr_t addr = strtol(&loc[2], &endptr, 16);
     if (errno == ERANGE || *endptr != '\0')
     {
         addr = 0;
     }
 
-    if (command[1][0] != '0')
+    /* a function name is looked up again in every run, an address is taken as is */
+    sylvan_code_t code;
+    if (loc[0] != '0')
+        code = sylvan_breakpoint_set_symbol(*inf, loc, is_hw, &addr);
+    else
+        code = is_hw ? sylvan_breakpoint_set_hw(*inf, addr) : sylvan_breakpoint_set(*inf, addr);
+
+    if (code)
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        return 0;
+    }
+
+    if (condition[0] && sylvan_breakpoint_set_condition(*inf, addr, condition))
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        sylvan_breakpoint_unset(*inf, addr);
+        return 0;
+    }
+
+    struct sylvan_breakpoint *breakpoint = NULL;
+    HASH_FIND(hh, (*inf)->breakpoints, &addr, sizeof(uintptr_t), breakpoint);
+
+    if (breakpoint && breakpoint->is_pending)
+        sylvan_print_ok("%sbreakpoint pending on: %s", is_hw ? "hardware " : "", loc);
+    else if (loc[0] != '0')
+        sylvan_print_ok("%sbreakpoint set at: %s", is_hw ? "hardware " : "", loc);
+    else
+        sylvan_print_ok("%sbreakpoint set at: %#lx", is_hw ? "hardware " : "", addr);
+
+    return 0;
+}
+
+/**
+ * @brief sets a data watchpoint, -rw also stops on reads
+ */
+int handle_watchpoint_set(char **command, struct sylvan_inferior **inf)
+{
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    int arg = 1;
+    sylvan_watch_t kind = SYLVAN_WATCH_WRITE;
+    if (command[arg] && strcmp(command[arg], "-rw") == 0)
+    {
+        kind = SYLVAN_WATCH_READWRITE;
+        arg++;
+    }
+
+    char *addr_str = command[arg];
+    char *len_str = addr_str ? command[arg + 1] : NULL;
+    if (!addr_str || (len_str && command[arg + 2]) || strncmp(addr_str, "0x", 2) != 0)
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\twatchpoint [-rw] <address> [1|2|4|8]");
+        return 0;
+    }
+
+    char *endptr;
+    errno = 0;
+    uintptr_t addr = strtoul(&addr_str[2], &endptr, 16);
+    if (errno == ERANGE || addr == 0 || *endptr != '\0')
+    {
+        sylvan_print_error("Invalid address: %s", addr_str);
+        return 0;
+    }
+
+    size_t len = 8;
+    if (len_str)
     {
-        if (sylvan_set_breakpoint_function(*inf, command[1]))
+        len = strtoul(len_str, &endptr, 10);
+        if (errno == ERANGE || *endptr != '\0')
         {
-            sylvan_print_error(sylvan_get_last_error());
+            sylvan_print_error("Invalid length: %s", len_str);
             return 0;
         }
-        
-        sylvan_print_ok("breakpoint set at: %s", command[1]);
-        return 0;
     }
-    
-    if (sylvan_breakpoint_set(*inf, addr))
+
+    if (sylvan_watchpoint_set(*inf, addr, len, kind))
     {
         sylvan_print_error(sylvan_get_last_error());
         return 0;
     }
-    sylvan_print_ok("breakpoint set at: %#lx", addr);
 
-    
+    sylvan_print_ok("watchpoint set at: %#lx (%zu bytes, %s)", addr, len, kind == SYLVAN_WATCH_WRITE ? "write" : "read/write");
     return 0;
 }
 
@@ -732,15 +1669,17 @@ static int toggle_breakpoint(char **command, struct sylvan_inferior *inf, int is
             return 0;
         }
 
-        if (id > inf->breakpoint_count)
+        struct sylvan_breakpoint *breakpoint;
+        if (sylvan_breakpoint_get_by_id(inf, id, &breakpoint))
         {
             sylvan_print_error("Invalid id use: info breakpoint");
             return 0;
         }
 
+        uintptr_t addr = breakpoint->addr;
         if (isDisable)
         {
-            if (sylvan_breakpoint_disable(inf, inf->breakpoints[id].addr))
+            if (sylvan_breakpoint_disable(inf, addr))
             {
                 sylvan_print_error(sylvan_get_last_error());
                 return 0;
@@ -748,13 +1687,13 @@ static int toggle_breakpoint(char **command, struct sylvan_inferior *inf, int is
         }
         else
         {
-            if (sylvan_breakpoint_enable(inf, inf->breakpoints[id].addr))
+            if (sylvan_breakpoint_enable(inf, addr))
             {
                 sylvan_print_error(sylvan_get_last_error());
                 return 0;
             }
         }
-        sylvan_print_ok("breakpoint at addr 0x%lx  %s", inf->breakpoints[id].addr, (isDisable ? "disabled" : "enabled"));
+        sylvan_print_ok("breakpoint at addr 0x%lx  %s", addr, (isDisable ? "disabled" : "enabled"));
         return 0;
     }
 
@@ -854,19 +1793,21 @@ int handle_delete_breakpoint(char **command, struct sylvan_inferior **inf)
             return 0;
         }
 
-        if (id > (*inf)->breakpoint_count)
+        struct sylvan_breakpoint *breakpoint;
+        if (sylvan_breakpoint_get_by_id(*inf, id, &breakpoint))
         {
             sylvan_print_error("Invalid id use: info_breakpoint");
             return 0;
         }
 
-        if (sylvan_breakpoint_unset((*inf), (*inf)->breakpoints[id].addr))
+        uintptr_t addr = breakpoint->addr;
+        if (sylvan_breakpoint_unset((*inf), addr))
         {
             sylvan_print_error(sylvan_get_last_error());
             return 0;
         }
         
-        sylvan_print_ok("breakpoint at addr 0x%lx  is deleted", (*inf)->breakpoints[id].addr);
+        sylvan_print_ok("breakpoint at addr 0x%lx  is deleted", addr);
         return 0;
     }
 
@@ -895,6 +1836,58 @@ int handle_delete_breakpoint(char **command, struct sylvan_inferior **inf)
     return 0;
 }
 
+/**
+ * @brief Makes the next <count> hits of a breakpoint continue without stopping
+ */
+int handle_ignore_breakpoint(char **command, struct sylvan_inferior **inf)
+{
+    if (!inf)
+    {
+        sylvan_print_error("Null Inferior Pointer");
+        return 0;
+    }
+
+    if (command[1] == NULL || command[2] == NULL || command[3])
+    {
+        sylvan_print_error("Invalid Arguments");
+        sylvan_print_instruction("\tignore <id> <count>");
+        return 0;
+    }
+
+    char *endptr;
+    errno = 0;
+    int id = strtol(command[1], &endptr, 10);
+    if (errno == ERANGE || id < 0 || *endptr != '\0')
+    {
+        sylvan_print_error("Invalid id");
+        return 0;
+    }
+
+    errno = 0;
+    unsigned long count = strtoul(command[2], &endptr, 10);
+    if (errno == ERANGE || command[2][0] == '-' || *endptr != '\0')
+    {
+        sylvan_print_error("Invalid count");
+        return 0;
+    }
+
+    struct sylvan_breakpoint *breakpoint;
+    if (sylvan_breakpoint_get_by_id(*inf, id, &breakpoint))
+    {
+        sylvan_print_error("Invalid id use: info_breakpoint");
+        return 0;
+    }
+
+    if (sylvan_breakpoint_set_ignore(*inf, breakpoint->addr, count))
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        return 0;
+    }
+
+    sylvan_print_ok("breakpoint %d will ignore the next %lu hits", id, count);
+    return 0;
+}
+
 /**
  * @brief Handles the 'set alias' command to create a new alias for an existing command
  * @param[in] command The command array (command[1] is the original command, command[2] is the alias name)
@@ -1027,11 +2020,6 @@ int handle_read_memory(char **command, struct sylvan_inferior **inf)
             sylvan_print_error("Invalid lines number");
             return 0;
         }
-        if (num_rows > 16)
-        {
-            printf("%sLimiting the lines to 16%s\n", YELLOW, RESET);
-            num_rows = 16;
-        }
     }
 
     if(strncmp(addr_str, "0x", 3) == 0)
@@ -1049,29 +2037,45 @@ int handle_read_memory(char **command, struct sylvan_inferior **inf)
         return 0;
     }
 
-    uint64_t *data = malloc(num_rows * sizeof(uint64_t));
-    for (int i = 0; i < num_rows; i++)
+    if (p_table)
     {
-        uintptr_t current_addr = addr + (i * 8);
-        if (sylvan_get_memory(*inf, current_addr, &data[i]))
+        uint64_t *data = malloc(num_rows * sizeof(uint64_t));
+        if (!data)
         {
-            sylvan_print_error("Error at 0x%016lx: %s", current_addr, sylvan_get_last_error());
-            free(data);
+            sylvan_print_error("Memory allocation failed");
             return 0;
         }
 
-        if (!p_table)
+        if (sylvan_read_memory(*inf, addr, data, num_rows * sizeof(uint64_t)))
         {
-            printf("%s0x%016lx:%s     %s0x%016lx%s\n", BLUE, current_addr, RESET, GREEN, data[i], RESET);
+            sylvan_print_error(sylvan_get_last_error());
+            free(data);
+            return 0;
         }
+
+        print_memory_table(data, num_rows, addr);
+        free(data);
+        return 0;
     }
 
-    if (p_table)
+    // plain output is streamed, one bulk read per chunk of rows
+    uint64_t data[MEMORY_READ_CHUNK_ROWS];
+    for (int i = 0; i < num_rows; i += MEMORY_READ_CHUNK_ROWS)
     {
-        print_memory_table(data, num_rows, addr);
+        int chunk_rows = num_rows - i < MEMORY_READ_CHUNK_ROWS ? num_rows - i : MEMORY_READ_CHUNK_ROWS;
+        uintptr_t chunk_addr = addr + ((uintptr_t)i * 8);
+        if (sylvan_read_memory(*inf, chunk_addr, data, chunk_rows * sizeof(uint64_t)))
+        {
+            sylvan_print_error(sylvan_get_last_error());
+            return 0;
+        }
+
+        for (int j = 0; j < chunk_rows; j++)
+        {
+            printf("%s0x%016lx:%s     %s0x%016lx%s\n", BLUE, chunk_addr + (j * 8), RESET, GREEN, data[j], RESET);
+        }
     }
 
-    free(data);
     return 0;
 }
 
@@ -1142,7 +2146,7 @@ int handle_write_memory(char **command, struct sylvan_inferior **inf)
         bytes[size++] = (uint8_t)value;
     }
 
-    if (sylvan_set_memory(*inf, addr, bytes, size))
+    if (sylvan_write_memory(*inf, addr, bytes, size))
     {
 
         sylvan_print_error(sylvan_get_last_error());
@@ -1222,7 +2226,7 @@ int handle_disassemble(char **command, struct sylvan_inferior **inf)
 
     if (result == 0)
     {
-        print_disassembly(instructions, count);
+        print_disassembly(*inf, instructions, count);
     }
 
     struct disassembled_instruction *current = instructions;
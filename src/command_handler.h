@@ -5,6 +5,18 @@
 int handle_help(char **command, struct sylvan_inferior **inf);
 int handle_exit(char **command, struct sylvan_inferior **inf);
 int handle_continue(char **command, struct sylvan_inferior **inf);
+int handle_interrupt(char **command, struct sylvan_inferior **inf);
+int handle_inferior(char **command, struct sylvan_inferior **inf);
+int handle_thread(char **command, struct sylvan_inferior **inf);
+int handle_trace_syscalls(char **command, struct sylvan_inferior **inf);
+int handle_until(char **command, struct sylvan_inferior **inf);
+int handle_advance(char **command, struct sylvan_inferior **inf);
+int handle_next_inst(char **command, struct sylvan_inferior **inf);
+int handle_finish(char **command, struct sylvan_inferior **inf);
+int handle_step(char **command, struct sylvan_inferior **inf);
+int handle_next(char **command, struct sylvan_inferior **inf);
+int handle_backtrace(char **command, struct sylvan_inferior **inf);
+int handle_profile(char **command, struct sylvan_inferior **inf);
 int handle_info(char **command, struct sylvan_inferior **inf);
 int handle_add_inferior(char **command, struct sylvan_inferior **inf);
 
@@ -17,6 +29,7 @@ int handle_info_bookmark(char **command, struct sylvan_inferior **inf);
 int handle_info_breakpoints(char **command, struct sylvan_inferior **inf);
 int handle_info_copying(char **command, struct sylvan_inferior **inf);
 int handle_info_inferiors(char **command, struct sylvan_inferior **inf);
+int handle_info_threads(char **command, struct sylvan_inferior **inf);
 int handle_run(char **command, struct sylvan_inferior **inf);
 int handle_step_inst(char **command, struct sylvan_inferior **inf);
 int handle_file(char **command, struct sylvan_inferior **inf);
@@ -24,10 +37,14 @@ int handle_attach(char **command, struct sylvan_inferior **inf);
 int handle_set(char **command, struct sylvan_inferior **inf);
 int handle_set_args(char **command, struct sylvan_inferior **inf);
 int handle_set_reg(char **command, struct sylvan_inferior **inf);
+int handle_set_non_stop(char **command, struct sylvan_inferior **inf);
+int handle_set_follow_fork(char **command, struct sylvan_inferior **inf);
 int handle_breakpoint_set(char **command, struct sylvan_inferior **inf);
+int handle_watchpoint_set(char **command, struct sylvan_inferior **inf);
 int handle_disable_breakpoint(char **command, struct sylvan_inferior **inf);
 int handle_enable_breakpoint(char **command, struct sylvan_inferior **inf);
 int handle_delete_breakpoint(char **command, struct sylvan_inferior **inf);
+int handle_ignore_breakpoint(char **command, struct sylvan_inferior **inf);
 int handle_set_alias(char **command, struct sylvan_inferior **inf);
 int handle_info_alias(char **command, struct sylvan_inferior **inf);
 int handle_read_memory(char **command, struct sylvan_inferior **inf);
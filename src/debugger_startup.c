@@ -152,10 +152,14 @@ int debugger_main(int argc, char **argv)
     
     interface_loop(&inf);
 
-    if (sylvan_inferior_destroy(inf))
+    /* add_inferior may have left others behind, their processes are killed or detached too */
+    while ((inf = sylvan_inferior_list()))
     {
-        error(sylvan_get_last_error());
-        return EXIT_FAILURE;
+        if (sylvan_inferior_destroy(inf))
+        {
+            error(sylvan_get_last_error());
+            return EXIT_FAILURE;
+        }
     }
 
     return EXIT_SUCCESS;
@@ -25,4 +25,7 @@ DEFINE_ALIAS("i_inf",     "info_inferiors",     20),
 DEFINE_ALIAS("s_args",    "set_args",           21),  
 DEFINE_ALIAS("s_reg",     "set_reg",            22),
 DEFINE_ALIAS("r_mem",     "memory_read",        23),
-DEFINE_ALIAS("w_mem",     "memory_write",       24),
\ No newline at end of file
+DEFINE_ALIAS("w_mem",     "memory_write",       24),
+DEFINE_ALIAS("wp",        "watchpoint",         25),
+DEFINE_ALIAS("i_thr",     "info_threads",       26),
+DEFINE_ALIAS("bt",        "backtrace",          27),
\ No newline at end of file
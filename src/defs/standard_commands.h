@@ -8,16 +8,16 @@ DEFINE_COMMAND(help,            "List all available commands with usage details;
 DEFINE_COMMAND(quit,            "Exit the Sylvan debugger cleanly, terminating the session", 
                 handle_exit,                2,  SYLVAN_STANDARD_COMMAND, 
                 "quit - Exit the debugger"),
-DEFINE_COMMAND(continue,        "Resume execution of the current inferior until the next breakpoint or end", 
+DEFINE_COMMAND(continue,        "Resume execution of the current inferior until the next breakpoint or end; & returns to the prompt while it runs", 
                 handle_continue,            3,  SYLVAN_STANDARD_COMMAND, 
-                "continue - Resume program execution"),
-DEFINE_COMMAND(breakpoint,      "Set a breakpoint at a specified address (hex) or function name", 
+                "continue [&] - Resume program execution, in the background with &"),
+DEFINE_COMMAND(breakpoint,      "Set a breakpoint at a specified address (hex), function name or source line; use -h for a hardware breakpoint", 
                 handle_breakpoint_set,      4,  SYLVAN_STANDARD_COMMAND, 
-                "breakpoint <address|function> - Set a breakpoint (e.g., 0x1234 or main)"),
+                "breakpoint [-h] <address|function|file:line> [if <condition>] - Set a breakpoint (e.g., 0x1234, main, main.c:42, -h main or main if rdi == 0x10 && *(u32*)(rsi+8) > 5)"),
 DEFINE_COMMAND(info,            "Display a list of all info subcommands with descriptions and usage", 
                 handle_info,                5,  SYLVAN_STANDARD_COMMAND, 
                 "info - List all info subcommands"),
-DEFINE_COMMAND(add_inferior,    "Create a new inferior for debugging a separate process or program", 
+DEFINE_COMMAND(add_inferior,    "Create a new inferior for debugging a separate process or program and make it current", 
                 handle_add_inferior,        6,  SYLVAN_STANDARD_COMMAND, 
                 "add_inferior - Create a new inferior"),
 DEFINE_COMMAND(disassemble,     "Disassemble machine code between two addresses or for a function; use -c for current instruction", 
@@ -26,9 +26,9 @@ DEFINE_COMMAND(disassemble,     "Disassemble machine code between two addresses
 DEFINE_COMMAND(run,             "Start execution of the program assigned to the current inferior", 
                 handle_run,                 8,  SYLVAN_STANDARD_COMMAND, 
                 "run - Start the program in the current inferior"),
-DEFINE_COMMAND(stepi,           "Execute a single machine instruction and stop", 
+DEFINE_COMMAND(stepi,           "Execute one machine instruction, or N of them, and stop", 
                 handle_step_inst,           9,  SYLVAN_STANDARD_COMMAND, 
-                "stepi - Step one instruction"),
+                "stepi [N] - Step instructions (e.g., stepi or stepi 1000)"),
 DEFINE_COMMAND(file,            "Assign an executable file to the current inferior for debugging", 
                 handle_file,                10, SYLVAN_STANDARD_COMMAND, 
                 "file <path> - Assign an executable (e.g., ./a.out)"),
@@ -52,4 +52,46 @@ DEFINE_COMMAND(memory_read,     "Read memory contents from a specified address;
                 "memory_read [-t] <address> [rows] - Read memory (e.g., 0x1000 or -t 0x1000 4)"),
 DEFINE_COMMAND(memory_write,    "Write values (hex, decimal, or string) to a specified memory address", 
                 handle_write_memory,        17, SYLVAN_STANDARD_COMMAND, 
-                "memory_write <address> <value>... - Write to memory (e.g., 0x1000 0x12 \"hello\")"),
\ No newline at end of file
+                "memory_write <address> <value>... - Write to memory (e.g., 0x1000 0x12 \"hello\")"),
+DEFINE_COMMAND(watchpoint,      "Stop when memory at an address is written (or read with -rw), using a debug register", 
+                handle_watchpoint_set,      18, SYLVAN_STANDARD_COMMAND, 
+                "watchpoint [-rw] <address> [1|2|4|8] - Watch memory (e.g., 0x4000 or -rw 0x4000 4)"),
+DEFINE_COMMAND(ignore,          "Continue through the next N hits of a breakpoint without stopping", 
+                handle_ignore_breakpoint,   19, SYLVAN_STANDARD_COMMAND, 
+                "ignore <id> <count> - Ignore hits of a breakpoint (e.g., 1 100)"),
+DEFINE_COMMAND(interrupt,       "Stop an inferior running in the background, the current one by default", 
+                handle_interrupt,           20, SYLVAN_STANDARD_COMMAND, 
+                "interrupt [id] - Stop a background inferior (e.g., interrupt or interrupt 1)"),
+DEFINE_COMMAND(inferior,        "Make another inferior the current one, see info_inferiors for the ids", 
+                handle_inferior,            21, SYLVAN_STANDARD_COMMAND, 
+                "inferior <id> - Switch to an inferior (e.g., inferior 1)"),
+DEFINE_COMMAND(thread,          "Make another thread of the current inferior the current one, see info_threads for the ids", 
+                handle_thread,              22, SYLVAN_STANDARD_COMMAND, 
+                "thread <tid> - Switch to a thread (e.g., thread 4242)"),
+DEFINE_COMMAND(trace_syscalls,  "Stop when the program enters one of the given system calls, the others don't slow it down", 
+                handle_trace_syscalls,      23, SYLVAN_STANDARD_COMMAND, 
+                "trace_syscalls [<name|number>... | off] - Trace system calls (e.g., openat write, off, or none to list them)"),
+DEFINE_COMMAND(until,           "Continue until the current frame reaches a location, deeper calls that pass it don't stop", 
+                handle_until,               24, SYLVAN_STANDARD_COMMAND, 
+                "until <address|function|file:line> - Run to a location in this frame (e.g., until 0x401136 or main.c:50)"),
+DEFINE_COMMAND(advance,         "Continue until the current thread reaches a location, in any frame", 
+                handle_advance,             25, SYLVAN_STANDARD_COMMAND, 
+                "advance <address|function|file:line> - Run to a location (e.g., advance main or main.c:50)"),
+DEFINE_COMMAND(nexti,           "Execute one machine instruction and stop, a call is run until it returns", 
+                handle_next_inst,           26, SYLVAN_STANDARD_COMMAND, 
+                "nexti - Step one instruction, stepping over calls"),
+DEFINE_COMMAND(finish,          "Continue until the current function returns and show the value it returned in rax", 
+                handle_finish,              27, SYLVAN_STANDARD_COMMAND, 
+                "finish - Run until the current function returns"),
+DEFINE_COMMAND(step,            "Execute until the program reaches another source line, stepping into called functions", 
+                handle_step,                28, SYLVAN_STANDARD_COMMAND, 
+                "step - Step one source line, into calls"),
+DEFINE_COMMAND(next,            "Execute until the program reaches another source line, running called functions as a whole", 
+                handle_next,                29, SYLVAN_STANDARD_COMMAND, 
+                "next - Step one source line, over calls"),
+DEFINE_COMMAND(backtrace,       "Show the frames of the current thread's stack, from unwind info or the frame pointer", 
+                handle_backtrace,           30, SYLVAN_STANDARD_COMMAND, 
+                "backtrace [N] - Show at most N frames, 64 by default (e.g., backtrace or backtrace 10)"),
+DEFINE_COMMAND(profile,         "Sample the stacks of all threads while the program runs and write them as folded stacks for a flame graph", 
+                handle_profile,             31, SYLVAN_STANDARD_COMMAND, 
+                "profile <seconds> [hz] [file] - Profile for a while, at 99 Hz into sylvan.folded by default (e.g., profile 10 or profile 5 999 out.folded)"),
\ No newline at end of file
@@ -14,10 +14,13 @@ DEFINE_COMMAND(info_auxv,           "List all information about auxilary vectors
     "info_args - Show current stack frame arguments"),
 DEFINE_COMMAND(info_breakpoints,    "List all user-set breakpoints with their status, type, and address", 
                 handle_info_breakpoints,    105, SYLVAN_INFO_COMMAND, 
-                "info_breakpoints - List all breakpoints"),
+                "info_breakpoints [-s] - List all breakpoints, -s shows hit counts and time between hits"),
 DEFINE_COMMAND(info_inferiors,      "List all inferiors being managed, including their IDs, PIDs, and paths", 
                 handle_info_inferiors,      107, SYLVAN_INFO_COMMAND, 
                 "info_inferiors - List all managed inferiors"),
+DEFINE_COMMAND(info_threads,        "List the threads of the current inferior, the current one is marked with *", 
+                handle_info_threads,        109, SYLVAN_INFO_COMMAND, 
+                "info_threads - List all threads of the current inferior"),
 DEFINE_COMMAND(info_alias,          "Display all defined command aliases with their original commands", 
                 handle_info_alias,          108, SYLVAN_INFO_COMMAND, 
                 "info_alias - List all command aliases"),
@@ -29,4 +32,10 @@ DEFINE_COMMAND(set_reg,             "Assign a value to a specified CPU register
                 "set_reg <register> <value> - Set a register value (e.g., rax 123)"),
 DEFINE_COMMAND(set_alias,           "Create an alias for an existing command to simplify usage", 
                 handle_set_alias,           203, SYLVAN_SET_COMMAND, 
-                "set_alias <command> <alias> - Create a command alias (e.g., run r)"),
\ No newline at end of file
+                "set_alias <command> <alias> - Create a command alias (e.g., run r)"),
+DEFINE_COMMAND(set_non_stop,        "Stop only the thread that hit a breakpoint while the others keep running, or every thread (off)", 
+                handle_set_non_stop,        204, SYLVAN_SET_COMMAND, 
+                "set_non_stop on|off - Switch non-stop mode (e.g., on)"),
+DEFINE_COMMAND(set_follow_fork,     "Choose which process is debugged after a fork: the parent, the child or both as separate inferiors", 
+                handle_set_follow_fork,     205, SYLVAN_SET_COMMAND, 
+                "set_follow_fork parent|child|both - Choose the process to debug after a fork (e.g., both)"),
\ No newline at end of file
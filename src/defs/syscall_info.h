@@ -0,0 +1,122 @@
+#ifndef DEFINE_SYSCALL
+#error "This file is intended for textual inclusion with the DEFINE_SYSCALL macro defined"
+#endif
+
+
+#define DEFINE_SYSCALL_0(name) \
+    DEFINE_SYSCALL(name, 0, NONE, NONE, NONE, NONE, NONE, NONE)
+#define DEFINE_SYSCALL_1(name, a0) \
+    DEFINE_SYSCALL(name, 1, a0, NONE, NONE, NONE, NONE, NONE)
+#define DEFINE_SYSCALL_2(name, a0, a1) \
+    DEFINE_SYSCALL(name, 2, a0, a1, NONE, NONE, NONE, NONE)
+#define DEFINE_SYSCALL_3(name, a0, a1, a2) \
+    DEFINE_SYSCALL(name, 3, a0, a1, a2, NONE, NONE, NONE)
+#define DEFINE_SYSCALL_4(name, a0, a1, a2, a3) \
+    DEFINE_SYSCALL(name, 4, a0, a1, a2, a3, NONE, NONE)
+#define DEFINE_SYSCALL_5(name, a0, a1, a2, a3, a4) \
+    DEFINE_SYSCALL(name, 5, a0, a1, a2, a3, a4, NONE)
+#define DEFINE_SYSCALL_6(name, a0, a1, a2, a3, a4, a5) \
+    DEFINE_SYSCALL(name, 6, a0, a1, a2, a3, a4, a5)
+
+/* files */
+DEFINE_SYSCALL_3(read, FD, PTR, UINT),                          /**< read(fd, buf, count) */
+DEFINE_SYSCALL_3(write, FD, PTR, UINT),                         /**< write(fd, buf, count) */
+DEFINE_SYSCALL_3(open, STR, HEX, OCT),                          /**< open(path, flags, mode) */
+DEFINE_SYSCALL_1(close, FD),                                    /**< close(fd) */
+DEFINE_SYSCALL_2(stat, STR, PTR),                               /**< stat(path, statbuf) */
+DEFINE_SYSCALL_2(fstat, FD, PTR),                               /**< fstat(fd, statbuf) */
+DEFINE_SYSCALL_2(lstat, STR, PTR),                              /**< lstat(path, statbuf) */
+DEFINE_SYSCALL_3(poll, PTR, UINT, INT),                         /**< poll(fds, nfds, timeout) */
+DEFINE_SYSCALL_3(lseek, FD, INT, INT),                          /**< lseek(fd, offset, whence) */
+DEFINE_SYSCALL_3(ioctl, FD, HEX, HEX),                          /**< ioctl(fd, request, arg) */
+DEFINE_SYSCALL_4(pread64, FD, PTR, UINT, INT),                  /**< pread64(fd, buf, count, offset) */
+DEFINE_SYSCALL_4(pwrite64, FD, PTR, UINT, INT),                 /**< pwrite64(fd, buf, count, offset) */
+DEFINE_SYSCALL_3(readv, FD, PTR, INT),                          /**< readv(fd, iov, iovcnt) */
+DEFINE_SYSCALL_3(writev, FD, PTR, INT),                         /**< writev(fd, iov, iovcnt) */
+DEFINE_SYSCALL_2(access, STR, OCT),                             /**< access(path, mode) */
+DEFINE_SYSCALL_1(pipe, PTR),                                    /**< pipe(fds) */
+DEFINE_SYSCALL_5(select, INT, PTR, PTR, PTR, PTR),              /**< select(nfds, readfds, writefds, exceptfds, timeout) */
+DEFINE_SYSCALL_1(dup, FD),                                      /**< dup(oldfd) */
+DEFINE_SYSCALL_2(dup2, FD, FD),                                 /**< dup2(oldfd, newfd) */
+DEFINE_SYSCALL_3(fcntl, FD, INT, HEX),                          /**< fcntl(fd, cmd, arg) */
+DEFINE_SYSCALL_1(fsync, FD),                                    /**< fsync(fd) */
+DEFINE_SYSCALL_2(truncate, STR, INT),                           /**< truncate(path, length) */
+DEFINE_SYSCALL_2(ftruncate, FD, INT),                           /**< ftruncate(fd, length) */
+DEFINE_SYSCALL_3(getdents64, FD, PTR, UINT),                    /**< getdents64(fd, dirp, count) */
+DEFINE_SYSCALL_2(getcwd, PTR, UINT),                            /**< getcwd(buf, size) */
+DEFINE_SYSCALL_1(chdir, STR),                                   /**< chdir(path) */
+DEFINE_SYSCALL_2(rename, STR, STR),                             /**< rename(oldpath, newpath) */
+DEFINE_SYSCALL_2(mkdir, STR, OCT),                              /**< mkdir(path, mode) */
+DEFINE_SYSCALL_1(rmdir, STR),                                   /**< rmdir(path) */
+DEFINE_SYSCALL_1(unlink, STR),                                  /**< unlink(path) */
+DEFINE_SYSCALL_3(readlink, STR, PTR, UINT),                     /**< readlink(path, buf, bufsiz) */
+DEFINE_SYSCALL_2(chmod, STR, OCT),                              /**< chmod(path, mode) */
+DEFINE_SYSCALL_4(openat, FD, STR, HEX, OCT),                    /**< openat(dirfd, path, flags, mode) */
+DEFINE_SYSCALL_3(mkdirat, FD, STR, OCT),                        /**< mkdirat(dirfd, path, mode) */
+DEFINE_SYSCALL_4(newfstatat, FD, STR, PTR, HEX),                /**< newfstatat(dirfd, path, statbuf, flags) */
+DEFINE_SYSCALL_3(unlinkat, FD, STR, HEX),                       /**< unlinkat(dirfd, path, flags) */
+DEFINE_SYSCALL_4(readlinkat, FD, STR, PTR, UINT),               /**< readlinkat(dirfd, path, buf, bufsiz) */
+DEFINE_SYSCALL_4(faccessat, FD, STR, OCT, HEX),                 /**< faccessat(dirfd, path, mode, flags) */
+DEFINE_SYSCALL_2(pipe2, PTR, HEX),                              /**< pipe2(fds, flags) */
+DEFINE_SYSCALL_3(dup3, FD, FD, HEX),                            /**< dup3(oldfd, newfd, flags) */
+DEFINE_SYSCALL_5(statx, FD, STR, HEX, HEX, PTR),                /**< statx(dirfd, path, flags, mask, statxbuf) */
+
+/* memory */
+DEFINE_SYSCALL_6(mmap, PTR, UINT, HEX, HEX, FD, HEX),           /**< mmap(addr, length, prot, flags, fd, offset) */
+DEFINE_SYSCALL_3(mprotect, PTR, UINT, HEX),                     /**< mprotect(addr, len, prot) */
+DEFINE_SYSCALL_2(munmap, PTR, UINT),                            /**< munmap(addr, length) */
+DEFINE_SYSCALL_1(brk, PTR),                                     /**< brk(addr) */
+DEFINE_SYSCALL_5(mremap, PTR, UINT, UINT, HEX, PTR),            /**< mremap(old_address, old_size, new_size, flags, new_address) */
+DEFINE_SYSCALL_3(madvise, PTR, UINT, INT),                      /**< madvise(addr, length, advice) */
+
+/* signals */
+DEFINE_SYSCALL_4(rt_sigaction, INT, PTR, PTR, UINT),            /**< rt_sigaction(signum, act, oldact, sigsetsize) */
+DEFINE_SYSCALL_4(rt_sigprocmask, INT, PTR, PTR, UINT),          /**< rt_sigprocmask(how, set, oldset, sigsetsize) */
+DEFINE_SYSCALL_2(kill, INT, INT),                               /**< kill(pid, sig) */
+DEFINE_SYSCALL_3(tgkill, INT, INT, INT),                        /**< tgkill(tgid, tid, sig) */
+
+/* processes */
+DEFINE_SYSCALL_5(clone, HEX, PTR, PTR, PTR, HEX),               /**< clone(flags, stack, parent_tid, child_tid, tls) */
+DEFINE_SYSCALL_2(clone3, PTR, UINT),                            /**< clone3(args, size) */
+DEFINE_SYSCALL_0(fork),                                         /**< fork() */
+DEFINE_SYSCALL_0(vfork),                                        /**< vfork() */
+DEFINE_SYSCALL_3(execve, STR, PTR, PTR),                        /**< execve(path, argv, envp) */
+DEFINE_SYSCALL_5(execveat, FD, STR, PTR, PTR, HEX),             /**< execveat(dirfd, path, argv, envp, flags) */
+DEFINE_SYSCALL_1(exit, INT),                                    /**< exit(status) */
+DEFINE_SYSCALL_1(exit_group, INT),                              /**< exit_group(status) */
+DEFINE_SYSCALL_4(wait4, INT, PTR, HEX, PTR),                    /**< wait4(pid, wstatus, options, rusage) */
+DEFINE_SYSCALL_0(getpid),                                       /**< getpid() */
+DEFINE_SYSCALL_0(getppid),                                      /**< getppid() */
+DEFINE_SYSCALL_0(gettid),                                       /**< gettid() */
+DEFINE_SYSCALL_0(getuid),                                       /**< getuid() */
+DEFINE_SYSCALL_1(uname, PTR),                                   /**< uname(buf) */
+DEFINE_SYSCALL_5(prctl, INT, HEX, HEX, HEX, HEX),               /**< prctl(option, arg2, arg3, arg4, arg5) */
+DEFINE_SYSCALL_2(arch_prctl, HEX, PTR),                         /**< arch_prctl(code, addr) */
+DEFINE_SYSCALL_1(set_tid_address, PTR),                         /**< set_tid_address(tidptr) */
+DEFINE_SYSCALL_4(prlimit64, INT, INT, PTR, PTR),                /**< prlimit64(pid, resource, new_limit, old_limit) */
+DEFINE_SYSCALL_3(seccomp, INT, HEX, PTR),                       /**< seccomp(operation, flags, args) */
+DEFINE_SYSCALL_0(sched_yield),                                  /**< sched_yield() */
+
+/* time and synchronization */
+DEFINE_SYSCALL_2(nanosleep, PTR, PTR),                          /**< nanosleep(req, rem) */
+DEFINE_SYSCALL_2(clock_gettime, INT, PTR),                      /**< clock_gettime(clockid, tp) */
+DEFINE_SYSCALL_4(clock_nanosleep, INT, HEX, PTR, PTR),          /**< clock_nanosleep(clockid, flags, request, remain) */
+DEFINE_SYSCALL_6(futex, PTR, INT, INT, PTR, PTR, INT),          /**< futex(uaddr, futex_op, val, timeout, uaddr2, val3) */
+DEFINE_SYSCALL_3(getrandom, PTR, UINT, HEX),                    /**< getrandom(buf, buflen, flags) */
+
+/* sockets and events */
+DEFINE_SYSCALL_3(socket, INT, INT, INT),                        /**< socket(domain, type, protocol) */
+DEFINE_SYSCALL_3(connect, FD, PTR, UINT),                       /**< connect(sockfd, addr, addrlen) */
+DEFINE_SYSCALL_3(accept, FD, PTR, PTR),                         /**< accept(sockfd, addr, addrlen) */
+DEFINE_SYSCALL_4(accept4, FD, PTR, PTR, HEX),                   /**< accept4(sockfd, addr, addrlen, flags) */
+DEFINE_SYSCALL_3(bind, FD, PTR, UINT),                          /**< bind(sockfd, addr, addrlen) */
+DEFINE_SYSCALL_2(listen, FD, INT),                              /**< listen(sockfd, backlog) */
+DEFINE_SYSCALL_6(sendto, FD, PTR, UINT, HEX, PTR, UINT),        /**< sendto(sockfd, buf, len, flags, dest_addr, addrlen) */
+DEFINE_SYSCALL_6(recvfrom, FD, PTR, UINT, HEX, PTR, PTR),       /**< recvfrom(sockfd, buf, len, flags, src_addr, addrlen) */
+DEFINE_SYSCALL_3(sendmsg, FD, PTR, HEX),                        /**< sendmsg(sockfd, msg, flags) */
+DEFINE_SYSCALL_3(recvmsg, FD, PTR, HEX),                        /**< recvmsg(sockfd, msg, flags) */
+DEFINE_SYSCALL_2(shutdown, FD, INT),                            /**< shutdown(sockfd, how) */
+DEFINE_SYSCALL_1(epoll_create1, HEX),                           /**< epoll_create1(flags) */
+DEFINE_SYSCALL_4(epoll_ctl, FD, INT, FD, PTR),                  /**< epoll_ctl(epfd, op, fd, event) */
+DEFINE_SYSCALL_4(epoll_wait, FD, PTR, INT, INT),                /**< epoll_wait(epfd, events, maxevents, timeout) */
+DEFINE_SYSCALL_2(eventfd2, UINT, HEX),                          /**< eventfd2(initval, flags) */
\ No newline at end of file
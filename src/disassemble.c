@@ -306,7 +306,50 @@ int disassemble(struct sylvan_inferior *inf, uintptr_t start_addr, uintptr_t end
     }
 }
 
-void print_disassembly(struct disassembled_instruction *instructions, int count)
+/**
+ * formats the function+offset of addr, empty if no symbol contains it
+ */
+static char *symbolize(struct sylvan_inferior *inf, uintptr_t addr)
+{
+    const char *name;
+    uintptr_t offset;
+    char buf[128] = "";
+
+    if (inf && !sylvan_sym_lookup_addr(inf, addr, &name, &offset))
+    {
+        if (offset)
+            snprintf(buf, sizeof(buf), "<%s+%#lx>", name, offset);
+        else
+            snprintf(buf, sizeof(buf), "<%s>", name);
+    }
+    return strdup(buf);
+}
+
+/**
+ * formats the file:line addr starts, empty if it's in the line before it or has no line info
+ */
+static char *annotate_line(struct sylvan_inferior *inf, uintptr_t addr, struct sylvan_line_info *prev)
+{
+    struct sylvan_line_info info;
+    char buf[128] = "";
+
+    if (inf && !sylvan_line_lookup_addr(inf, addr, &info))
+    {
+        if (info.file != prev->file || info.line != prev->line)
+        {
+            const char *base = strrchr(info.file, '/');
+            snprintf(buf, sizeof(buf), "%s:%u", base ? base + 1 : info.file, info.line);
+        }
+        *prev = info;
+    }
+    else
+    {
+        prev->file = NULL;
+    }
+    return strdup(buf);
+}
+
+void print_disassembly(struct sylvan_inferior *inf, struct disassembled_instruction *instructions, int count)
 {
     if (!instructions || count == 0)
     {
@@ -316,19 +359,24 @@ void print_disassembly(struct disassembled_instruction *instructions, int count)
 
     struct table_col cols[] = {
         {"Address", 18, TABLE_COL_HEX_LONG},
+        {"Symbol", 24, TABLE_COL_STR},
         {"Opcodes", 34, TABLE_COL_STR},
-        {"Instruction", 40, TABLE_COL_STR}};
+        {"Instruction", 40, TABLE_COL_STR},
+        {"Source", 20, TABLE_COL_STR}};
 
     struct table_row *rows = NULL, *current = NULL;
     struct disassembled_instruction *inst = instructions;
+    struct sylvan_line_info prev_line = {0};
 
     while (inst)
     {
         struct table_row *new_row = malloc(sizeof(struct table_row));
-        void *row_data = malloc(sizeof(uintptr_t) + 2 * sizeof(char *));
+        void *row_data = malloc(sizeof(uintptr_t) + 4 * sizeof(char *));
         *(uintptr_t *)row_data = inst->addr;
-        *(char **)(row_data + sizeof(uintptr_t)) = strdup(inst->opcodes);
-        *(char **)(row_data + sizeof(uintptr_t) + sizeof(char *)) = strdup(inst->instruction);
+        *(char **)(row_data + sizeof(uintptr_t)) = symbolize(inf, inst->addr);
+        *(char **)(row_data + sizeof(uintptr_t) + sizeof(char *)) = strdup(inst->opcodes);
+        *(char **)(row_data + sizeof(uintptr_t) + 2 * sizeof(char *)) = strdup(inst->instruction);
+        *(char **)(row_data + sizeof(uintptr_t) + 3 * sizeof(char *)) = annotate_line(inf, inst->addr, &prev_line);
         new_row->data = row_data;
         new_row->next = NULL;
 
@@ -341,7 +389,7 @@ void print_disassembly(struct disassembled_instruction *instructions, int count)
         inst = inst->next;
     }
 
-    print_table("Disassembly", cols, 3, rows, count);
+    print_table("Disassembly", cols, 5, rows, count);
 
     current = rows;
     while (current)
@@ -349,6 +397,8 @@ void print_disassembly(struct disassembled_instruction *instructions, int count)
         struct table_row *next = current->next;
         free((char *)(*(char **)((char *)current->data + sizeof(uintptr_t))));
         free((char *)(*(char **)((char *)current->data + sizeof(uintptr_t) + sizeof(char *))));
+        free((char *)(*(char **)((char *)current->data + sizeof(uintptr_t) + 2 * sizeof(char *))));
+        free((char *)(*(char **)((char *)current->data + sizeof(uintptr_t) + 3 * sizeof(char *))));
         free((void *)current->data);
         free(current);
         current = next;
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <sys/user.h>
+
+#include "syscall.h"
+#include "ui_utils.h"
+
+#define SYSCALL_STR_MAX 48
+#define SYSCALL_PAGE_SIZE 0x1000UL
+#define SYSCALL_LINE_MAX 512
+
+const struct sylvan_syscall sylvan_syscalls_info[] =
+    {
+#define DEFINE_SYSCALL(name, argc, a0, a1, a2, a3, a4, a5)                                          \
+    {SYS_##name, #name, argc, {SYLVAN_SYSCALL_ARG_##a0, SYLVAN_SYSCALL_ARG_##a1, SYLVAN_SYSCALL_ARG_##a2, \
+                               SYLVAN_SYSCALL_ARG_##a3, SYLVAN_SYSCALL_ARG_##a4, SYLVAN_SYSCALL_ARG_##a5}}
+#include "defs/syscall_info.h"
+#undef DEFINE_SYSCALL
+        {0, NULL, 0, {0}}};
+
+/**
+ * @brief finds a system call by name
+ * @return the table entry, NULL if there's none
+ */
+const struct sylvan_syscall *find_syscall_by_name(const char *name)
+{
+    for (int i = 0; sylvan_syscalls_info[i].name != NULL; i++)
+        if (strcmp(sylvan_syscalls_info[i].name, name) == 0)
+            return &sylvan_syscalls_info[i];
+
+    return NULL;
+}
+
+/**
+ * @brief finds a system call by its number
+ * @return the table entry, NULL if it isn't in the table
+ */
+const struct sylvan_syscall *find_syscall_by_nr(long nr)
+{
+    for (int i = 0; sylvan_syscalls_info[i].name != NULL; i++)
+        if (sylvan_syscalls_info[i].nr == nr)
+            return &sylvan_syscalls_info[i];
+
+    return NULL;
+}
+
+/**
+ * @brief appends to the line being built, output that doesn't fit is cut off
+ */
+static void append(char *buf, size_t size, size_t *len, const char *fmt, ...)
+{
+    if (*len >= size - 1)
+        return;
+
+    va_list args;
+    va_start(args, fmt);
+    int count = vsnprintf(buf + *len, size - *len, fmt, args);
+    va_end(args);
+
+    if (count > 0)
+        *len += (size_t)count < size - *len ? (size_t)count : size - *len - 1;
+}
+
+/**
+ * @brief appends the string at addr in the process, quoted and escaped, at most SYSCALL_STR_MAX bytes of it
+ */
+static void append_string(struct sylvan_inferior *inf, uintptr_t addr, char *buf, size_t size, size_t *len)
+{
+    char data[SYSCALL_STR_MAX];
+    size_t count = sizeof(data);
+
+    /* the string may end right before an unmapped page */
+    size_t to_page = SYSCALL_PAGE_SIZE - (addr & (SYSCALL_PAGE_SIZE - 1));
+    if (sylvan_read_memory(inf, addr, data, count))
+    {
+        if (to_page >= count || sylvan_read_memory(inf, addr, data, to_page))
+        {
+            append(buf, size, len, "%#lx", addr);
+            return;
+        }
+        count = to_page;
+    }
+
+    append(buf, size, len, "\"");
+
+    size_t i;
+    for (i = 0; i < count && data[i]; i++)
+    {
+        unsigned char c = data[i];
+        if (c == '"' || c == '\\')
+            append(buf, size, len, "\\%c", c);
+        else if (c == '\n')
+            append(buf, size, len, "\\n");
+        else if (c < 0x20 || c >= 0x7f)
+            append(buf, size, len, "\\x%02x", c);
+        else
+            append(buf, size, len, "%c", c);
+    }
+
+    append(buf, size, len, i == count ? "\"..." : "\"");
+}
+
+/**
+ * @brief appends one argument formatted as its type says
+ */
+static void append_arg(struct sylvan_inferior *inf, enum sylvan_syscall_arg type, unsigned long value,
+                       char *buf, size_t size, size_t *len)
+{
+    switch (type)
+    {
+    case SYLVAN_SYSCALL_ARG_INT:
+        append(buf, size, len, "%ld", (long)value);
+        break;
+    case SYLVAN_SYSCALL_ARG_UINT:
+        append(buf, size, len, "%lu", value);
+        break;
+    case SYLVAN_SYSCALL_ARG_OCT:
+        append(buf, size, len, "0%lo", value);
+        break;
+    case SYLVAN_SYSCALL_ARG_PTR:
+        if (value)
+            append(buf, size, len, "%#lx", value);
+        else
+            append(buf, size, len, "NULL");
+        break;
+    case SYLVAN_SYSCALL_ARG_STR:
+        if (value)
+            append_string(inf, value, buf, size, len);
+        else
+            append(buf, size, len, "NULL");
+        break;
+    case SYLVAN_SYSCALL_ARG_FD:
+        if ((int)value == AT_FDCWD)
+            append(buf, size, len, "AT_FDCWD");
+        else
+            append(buf, size, len, "%d", (int)value);
+        break;
+    default:
+        append(buf, size, len, "%#lx", value);
+        break;
+    }
+}
+
+/**
+ * @brief prints the system call the current thread is entering with its arguments decoded,
+ * after the inferior stopped with SYLVANC_SYSCALL_ENTRY
+ */
+void print_syscall_entry(struct sylvan_inferior *inf)
+{
+    struct user_regs_struct regs;
+    if (sylvan_get_regs(inf, &regs))
+    {
+        sylvan_print_error(sylvan_get_last_error());
+        return;
+    }
+
+    unsigned long args[6] = {regs.rdi, regs.rsi, regs.rdx, regs.r10, regs.r8, regs.r9};
+    long nr = (long)regs.orig_rax;
+
+    char line[SYSCALL_LINE_MAX];
+    size_t len = 0;
+    line[0] = '\0';
+
+    const struct sylvan_syscall *syscall_info = find_syscall_by_nr(nr);
+    if (syscall_info)
+        append(line, sizeof(line), &len, "%s(", syscall_info->name);
+    else
+        append(line, sizeof(line), &len, "syscall_%ld(", nr);
+
+    int argc = syscall_info ? syscall_info->argc : 6;
+    for (int i = 0; i < argc; i++)
+    {
+        if (i)
+            append(line, sizeof(line), &len, ", ");
+        append_arg(inf, syscall_info ? syscall_info->args[i] : SYLVAN_SYSCALL_ARG_HEX, args[i], line, sizeof(line), &len);
+    }
+
+    append(line, sizeof(line), &len, ")");
+    sylvan_print_error("\t%s", line);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+#include <stddef.h>
+
+#include "sylvan/inferior.h"
+
+enum sylvan_syscall_arg
+{
+    SYLVAN_SYSCALL_ARG_NONE,
+    SYLVAN_SYSCALL_ARG_INT,  /**< signed decimal */
+    SYLVAN_SYSCALL_ARG_UINT, /**< unsigned decimal, sizes and counts */
+    SYLVAN_SYSCALL_ARG_HEX,  /**< flags */
+    SYLVAN_SYSCALL_ARG_OCT,  /**< file modes */
+    SYLVAN_SYSCALL_ARG_PTR,  /**< address, NULL if 0 */
+    SYLVAN_SYSCALL_ARG_STR,  /**< address of a string, read from the process */
+    SYLVAN_SYSCALL_ARG_FD,   /**< file descriptor, AT_FDCWD by name */
+};
+
+/**
+ * @brief Structure to hold how a system call is decoded.
+ */
+struct sylvan_syscall
+{
+    int nr;                            /**< System call number on x86_64 */
+    const char *name;                  /**< Name of the system call (e.g., "openat") */
+    int argc;                          /**< Number of arguments it takes */
+    enum sylvan_syscall_arg args[6];   /**< How each argument is printed, in rdi, rsi, rdx, r10, r8, r9 */
+};
+
+/**
+ * @brief constant array of system call information.
+ */
+extern const struct sylvan_syscall sylvan_syscalls_info[];
+
+const struct sylvan_syscall *find_syscall_by_name(const char *name);
+const struct sylvan_syscall *find_syscall_by_nr(long nr);
+void print_syscall_entry(struct sylvan_inferior *inf);
+
+#endif
\ No newline at end of file
@@ -194,6 +194,10 @@ void print_table(const char *title, struct table_col *cols, int col_count, struc
                 printf(" %-*s", widths[i] - 1, buffer);
                 data += sizeof(unsigned long);
                 break;
+            case TABLE_COL_ULONG:
+                printf(" %-*lu", widths[i] - 1, *(unsigned long *)data);
+                data += sizeof(unsigned long);
+                break;
             }
             if (i < col_count - 1)
                 printf("%s|%s", BORDER_COLOR, WHITE);
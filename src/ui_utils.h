@@ -33,7 +33,8 @@ enum table_col_format
     TABLE_COL_STR,
     TABLE_COL_INT,
     TABLE_COL_HEX,
-    TABLE_COL_HEX_LONG
+    TABLE_COL_HEX_LONG,
+    TABLE_COL_ULONG
 };
 
 struct term_size
@@ -6,6 +6,8 @@
 #include <readline/readline.h>
 #include <readline/history.h>
 
+#include "sylvan/event.h"
+#include "syscall.h"
 #include "ui_utils.h"
 #include "user_interface.h"
 #include "command_registry.h"
@@ -154,6 +156,56 @@ static void handle_sigint(int sig)
     interrupted = 1;
 }
 
+/**
+ * @brief Prints the stops and exits of inferiors running in the background above the prompt
+ * without losing what has been typed so far
+ */
+static void print_inferior_events(void)
+{
+    char *saved_line = NULL;
+    int saved_point = 0;
+
+    for (;;)
+    {
+        struct sylvan_inferior *inf;
+        sylvan_code_t code = sylvan_event_poll(0, &inf);
+        if (!inf && !code)
+            break;
+
+        if (!saved_line)
+        {
+            saved_point = rl_point;
+            saved_line = rl_copy_text(0, rl_end);
+            rl_save_prompt();
+            rl_replace_line("", 0);
+            rl_redisplay();
+        }
+
+        if (!inf)
+        {
+            sylvan_print_error(sylvan_get_last_error());
+            break;
+        }
+
+        if (code)
+            sylvan_print_error("[inferior %d] %s", inf->id, sylvan_get_last_error());
+        else
+            sylvan_print_error("[inferior %d] program stopped", inf->id);
+
+        if (code == SYLVANC_SYSCALL_ENTRY)
+            print_syscall_entry(inf);
+    }
+
+    if (saved_line)
+    {
+        rl_restore_prompt();
+        rl_replace_line(saved_line, 0);
+        rl_point = saved_point;
+        rl_forced_update_display();
+        free(saved_line);
+    }
+}
+
 static int event_hook(void)
 {
     if (interrupted)
@@ -163,6 +215,8 @@ static int event_hook(void)
         rl_redisplay();
         return 1;
     }
+
+    print_inferior_events();
     return 0;
 }
 
@@ -189,6 +243,13 @@ void interface_loop(struct sylvan_inferior **inf)
     print_heading();
     init_commands();
 
+    /* background inferiors are only reported if their events are collected from the start */
+    int event_fd;
+    if (sylvan_event_fd(&event_fd))
+    {
+        sylvan_print_error(sylvan_get_last_error());
+    }
+
     rl_initialize();
     rl_catch_signals = 1;
     rl_set_signals();